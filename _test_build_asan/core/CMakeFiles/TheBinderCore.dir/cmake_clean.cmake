@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/TheBinderCore.dir/src/main.cpp.o"
+  "CMakeFiles/TheBinderCore.dir/src/main.cpp.o.d"
+  "libTheBinderCore.a"
+  "libTheBinderCore.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/TheBinderCore.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "../bin/Tests"
+  "../bin/Tests.pdb"
+  "CMakeFiles/Tests.dir/src/main.cpp.o"
+  "CMakeFiles/Tests.dir/src/main.cpp.o.d"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/Tests.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
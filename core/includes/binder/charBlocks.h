@@ -0,0 +1,316 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "binder/memory/hashMapGroup.h"
+
+// the scanners classify the source a block of chars at the time, same width
+// choice of the hashmap groups, the BINDER_SCANNER_NO_AVX2 and
+// BINDER_SCANNER_NO_SIMD switches force the narrower versions, the hashmap
+// ones do as well so a single build covers both fallbacks
+#if defined(__AVX2__) && !defined(BINDER_SCANNER_NO_AVX2) &&                  \
+    !defined(BINDER_SCANNER_NO_SIMD) && !defined(BINDER_HASHMAP_NO_AVX2) &&   \
+    !defined(BINDER_HASHMAP_NO_SIMD)
+#define BINDER_SCANNER_AVX2_BLOCK
+#include <immintrin.h>
+#elif (defined(__SSE2__) || defined(_M_X64) ||                                 \
+       (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) &&                            \
+    !defined(BINDER_SCANNER_NO_SIMD) && !defined(BINDER_HASHMAP_NO_SIMD)
+#define BINDER_SCANNER_SSE2_BLOCK
+#include <emmintrin.h>
+#endif
+
+namespace binder::chars {
+
+inline bool isDigit(const char c) { return (c >= '0') & (c <= '9'); }
+inline bool isAlpha(const char c) {
+  return ((c >= 'a') & (c <= 'z')) | ((c >= 'A') & (c <= 'Z')) | (c == '_');
+}
+inline bool isIdentifier(const char c) { return isAlpha(c) | isDigit(c); }
+// new lines are whitespace too, the caller wants to count them though
+inline bool isWhiteSpace(const char c) {
+  return (c == ' ') | (c == '\t') | (c == '\r') | (c == '\n');
+}
+
+inline uint32_t countSetBits(uint32_t value) {
+#if defined(_MSC_VER)
+  return __popcnt(value);
+#else
+  return static_cast<uint32_t>(__builtin_popcount(value));
+#endif
+}
+
+#if defined(BINDER_SCANNER_AVX2_BLOCK) || defined(BINDER_SCANNER_SSE2_BLOCK)
+
+// one bit per char of the block, the lowest bit is the first char. Bytes
+// with the high bit set are negative for the signed compares, so they never
+// fall in a range
+#if defined(BINDER_SCANNER_AVX2_BLOCK)
+struct Block {
+  static constexpr uint32_t WIDTH = 32;
+  static constexpr uint32_t ALL = 0xFFFFFFFF;
+
+  explicit Block(const char *p)
+      : m_chars(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p))) {}
+
+  uint32_t equal(const char c) const {
+    return mask(_mm256_cmpeq_epi8(m_chars, _mm256_set1_epi8(c)));
+  }
+  uint32_t digits() const { return mask(inRange(m_chars, '0', '9')); }
+  uint32_t identifier() const {
+    // setting 0x20 folds upper case on lower case, nothing else lands in
+    // the lower case range
+    const __m256i lower = _mm256_or_si256(m_chars, _mm256_set1_epi8(0x20));
+    return mask(_mm256_or_si256(
+        _mm256_or_si256(inRange(lower, 'a', 'z'), inRange(m_chars, '0', '9')),
+        _mm256_cmpeq_epi8(m_chars, _mm256_set1_epi8('_'))));
+  }
+
+private:
+  static __m256i inRange(const __m256i chars, const char low,
+                         const char high) {
+    return _mm256_and_si256(
+        _mm256_cmpgt_epi8(chars, _mm256_set1_epi8(low - 1)),
+        _mm256_cmpgt_epi8(_mm256_set1_epi8(high + 1), chars));
+  }
+  static uint32_t mask(const __m256i bytes) {
+    return static_cast<uint32_t>(_mm256_movemask_epi8(bytes));
+  }
+  __m256i m_chars;
+};
+#else
+struct Block {
+  static constexpr uint32_t WIDTH = 16;
+  static constexpr uint32_t ALL = 0xFFFF;
+
+  explicit Block(const char *p)
+      : m_chars(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) {}
+
+  uint32_t equal(const char c) const {
+    return mask(_mm_cmpeq_epi8(m_chars, _mm_set1_epi8(c)));
+  }
+  uint32_t digits() const { return mask(inRange(m_chars, '0', '9')); }
+  uint32_t identifier() const {
+    const __m128i lower = _mm_or_si128(m_chars, _mm_set1_epi8(0x20));
+    return mask(
+        _mm_or_si128(_mm_or_si128(inRange(lower, 'a', 'z'),
+                                  inRange(m_chars, '0', '9')),
+                     _mm_cmpeq_epi8(m_chars, _mm_set1_epi8('_'))));
+  }
+
+private:
+  static __m128i inRange(const __m128i chars, const char low,
+                         const char high) {
+    return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(low - 1)),
+                         _mm_cmplt_epi8(chars, _mm_set1_epi8(high + 1)));
+  }
+  static uint32_t mask(const __m128i bytes) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(bytes));
+  }
+  __m128i m_chars;
+};
+#endif
+
+inline uint32_t firstBit(const uint32_t bits) {
+  return memory::countTrailingZeros(bits);
+}
+// the bits below the lowest set one of stop, stop can't be zero
+inline uint32_t bitsBefore(const uint32_t bits, const uint32_t stop) {
+  return bits & ((stop & (0u - stop)) - 1);
+}
+inline bool hasBlock(const char *p, const char *end) {
+  return end - p >= static_cast<ptrdiff_t>(Block::WIDTH);
+}
+
+#define BINDER_SCANNER_BLOCKS
+#endif
+
+// most runs in code are short, a name or a single blank, those are done one
+// char at the time in the inline part. Only a run longer than this goes to
+// the block loops, which are kept out of line, inlined they make every
+// caller pay for setting up the wide registers
+#if defined(BINDER_SCANNER_BLOCKS)
+static constexpr ptrdiff_t SCALAR_RUN = 8;
+#else
+static constexpr ptrdiff_t SCALAR_RUN = PTRDIFF_MAX;
+#endif
+
+#if defined(_MSC_VER)
+#define BINDER_SCANNER_NOINLINE __declspec(noinline)
+#else
+#define BINDER_SCANNER_NOINLINE __attribute__((noinline))
+#endif
+
+inline const char *scalarRunEnd(const char *p, const char *end) {
+  return end - p > SCALAR_RUN ? p + SCALAR_RUN : end;
+}
+
+// the block loops, they start where the scalar part gave up and finish the
+// run. Only whole blocks are loaded, the last few chars before end go one at
+// the time, so nothing past end is ever read
+#if defined(BINDER_SCANNER_BLOCKS)
+BINDER_SCANNER_NOINLINE inline const char *
+skipWhiteSpaceBlocks(const char *p, const char *end, uint32_t &newLines) {
+  while (hasBlock(p, end)) {
+    const Block block(p);
+    const uint32_t lines = block.equal('\n');
+    const uint32_t stop = ~(block.equal(' ') | block.equal('\t') |
+                            block.equal('\r') | lines) &
+                          Block::ALL;
+    if (stop != 0) {
+      newLines += countSetBits(bitsBefore(lines, stop));
+      return p + firstBit(stop);
+    }
+    newLines += countSetBits(lines);
+    p += Block::WIDTH;
+  }
+  while ((p < end) && isWhiteSpace(*p)) {
+    newLines += *p == '\n';
+    ++p;
+  }
+  return p;
+}
+
+BINDER_SCANNER_NOINLINE inline const char *
+skipIdentifierBlocks(const char *p, const char *end) {
+  while (hasBlock(p, end)) {
+    const uint32_t stop = ~Block(p).identifier() & Block::ALL;
+    if (stop != 0) {
+      return p + firstBit(stop);
+    }
+    p += Block::WIDTH;
+  }
+  while ((p < end) && isIdentifier(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+BINDER_SCANNER_NOINLINE inline const char *
+skipDigitsBlocks(const char *p, const char *end) {
+  while (hasBlock(p, end)) {
+    const uint32_t stop = ~Block(p).digits() & Block::ALL;
+    if (stop != 0) {
+      return p + firstBit(stop);
+    }
+    p += Block::WIDTH;
+  }
+  while ((p < end) && isDigit(*p)) {
+    ++p;
+  }
+  return p;
+}
+
+BINDER_SCANNER_NOINLINE inline const char *
+findNewLineBlocks(const char *p, const char *end) {
+  while (hasBlock(p, end)) {
+    const uint32_t stop = Block(p).equal('\n');
+    if (stop != 0) {
+      return p + firstBit(stop);
+    }
+    p += Block::WIDTH;
+  }
+  while ((p < end) && (*p != '\n')) {
+    ++p;
+  }
+  return p;
+}
+
+BINDER_SCANNER_NOINLINE inline const char *
+findQuoteBlocks(const char *p, const char *end, uint32_t &newLines) {
+  while (hasBlock(p, end)) {
+    const Block block(p);
+    const uint32_t lines = block.equal('\n');
+    const uint32_t stop = block.equal('"');
+    if (stop != 0) {
+      newLines += countSetBits(bitsBefore(lines, stop));
+      return p + firstBit(stop);
+    }
+    newLines += countSetBits(lines);
+    p += Block::WIDTH;
+  }
+  while ((p < end) && (*p != '"')) {
+    newLines += *p == '\n';
+    ++p;
+  }
+  return p;
+}
+#endif
+
+// all the functions walk from p and give back the first char that stops
+// them, or end
+
+// skips spaces, tabs, carriage returns and new lines, counting the latter
+inline const char *skipWhiteSpace(const char *p, const char *end,
+                                  uint32_t &newLines) {
+  const char *last = scalarRunEnd(p, end);
+  while ((p < last) && isWhiteSpace(*p)) {
+    newLines += *p == '\n';
+    ++p;
+  }
+#if defined(BINDER_SCANNER_BLOCKS)
+  if (p == last) {
+    return skipWhiteSpaceBlocks(p, end, newLines);
+  }
+#endif
+  return p;
+}
+
+inline const char *skipIdentifier(const char *p, const char *end) {
+  const char *last = scalarRunEnd(p, end);
+  while ((p < last) && isIdentifier(*p)) {
+    ++p;
+  }
+#if defined(BINDER_SCANNER_BLOCKS)
+  if (p == last) {
+    return skipIdentifierBlocks(p, end);
+  }
+#endif
+  return p;
+}
+
+inline const char *skipDigits(const char *p, const char *end) {
+  const char *last = scalarRunEnd(p, end);
+  while ((p < last) && isDigit(*p)) {
+    ++p;
+  }
+#if defined(BINDER_SCANNER_BLOCKS)
+  if (p == last) {
+    return skipDigitsBlocks(p, end);
+  }
+#endif
+  return p;
+}
+
+// the end of a comment
+inline const char *findNewLine(const char *p, const char *end) {
+  const char *last = scalarRunEnd(p, end);
+  while ((p < last) && (*p != '\n')) {
+    ++p;
+  }
+#if defined(BINDER_SCANNER_BLOCKS)
+  if (p == last) {
+    return findNewLineBlocks(p, end);
+  }
+#endif
+  return p;
+}
+
+// the closing quote of a string, strings can span lines so the new lines on
+// the way are counted
+inline const char *findQuote(const char *p, const char *end,
+                             uint32_t &newLines) {
+  const char *last = scalarRunEnd(p, end);
+  while ((p < last) && (*p != '"')) {
+    newLines += *p == '\n';
+    ++p;
+  }
+#if defined(BINDER_SCANNER_BLOCKS)
+  if (p == last) {
+    return findQuoteBlocks(p, end, newLines);
+  }
+#endif
+  return p;
+}
+
+} // namespace binder::chars
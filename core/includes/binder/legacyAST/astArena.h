@@ -0,0 +1,75 @@
+#pragma once
+#include <new>
+#include <type_traits>
+
+#include "binder/legacyAST/autogen/astgen.h"
+#include "binder/memory/resizableVector.h"
+#include "binder/memory/stackAllocator.h"
+
+namespace binder {
+
+// Memory for the AST nodes of a parse. Nodes are bumped one after the other
+// in the order the parser makes them, which is close enough to the order
+// the visitors walk them, and all go away together on reset.
+// Nothing calls the node destructors one by one, the only nodes that own
+// memory are the ones with a vector inside, those are kept aside and
+// destructed on reset.
+class AstArena final {
+public:
+  static constexpr size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+  struct Report {
+    uint32_t nodeCount;
+    uint64_t nodeBytes;
+    uint64_t reservedBytes;
+    uint32_t blockCount;
+  };
+
+  explicit AstArena(const size_t blockSize = DEFAULT_BLOCK_SIZE)
+      : m_allocator(blockSize), m_ownersOfMemory(16) {}
+  ~AstArena() { reset(); }
+
+  template <typename T> T *make() {
+    static_assert(std::is_base_of<autogen::Expr, T>::value ||
+                      std::is_base_of<autogen::Stmt, T>::value,
+                  "the arena only holds AST nodes");
+    void *memory = m_allocator.allocate(sizeof(T), alignof(T));
+    T *node = new (memory) T();
+    ++m_nodeCount;
+    m_nodeBytes += sizeof(T);
+    if constexpr (std::is_same<T, autogen::Block>::value ||
+                  std::is_same<T, autogen::Function>::value) {
+      m_ownersOfMemory.pushBack(node);
+    }
+    return node;
+  }
+
+  // every node handed out is gone after this, the blocks are kept for the
+  // next parse
+  void reset() {
+    for (uint32_t i = 0; i < m_ownersOfMemory.size(); ++i) {
+      m_ownersOfMemory[i]->~Stmt();
+    }
+    m_ownersOfMemory.clear();
+    m_allocator.reset();
+    m_nodeCount = 0;
+    m_nodeBytes = 0;
+  }
+
+  [[nodiscard]] Report getReport() const {
+    return {m_nodeCount, m_nodeBytes, m_allocator.getBytesReserved(),
+            m_allocator.getBlockCount()};
+  }
+
+  // deleted functions
+  AstArena(const AstArena &) = delete;
+  AstArena &operator=(const AstArena &) = delete;
+
+private:
+  memory::StackAllocator m_allocator;
+  memory::ResizableVector<autogen::Stmt *> m_ownersOfMemory;
+  uint32_t m_nodeCount = 0;
+  uint64_t m_nodeBytes = 0;
+};
+
+} // namespace binder
@@ -1,5 +1,6 @@
 #pragma once
 #include "binder/log/log.h"
+#include "binder/memory/stackAllocator.h"
 #include "binder/memory/stringPool.h"
 
 namespace binder {
@@ -10,6 +11,8 @@ struct ContextConfig {
   int m_stringPoolSizeInMb = 32;
   LOGGER_TYPE loggerType = LOGGER_TYPE::CONSOLE;
   int printFloatPrecision = 5;
+  // size of each block of the scratch allocator, it grows if needed
+  int scratchBlockSizeInKb = 16;
 };
 class BinderContext {
 public:
@@ -28,6 +31,8 @@ public:
   };
 
   memory::StringPool &getStringPool() { return m_stringPool; }
+  // short lived memory, the interpreter rewinds it after every statement
+  memory::StackAllocator &getScratch() { return m_scratch; }
 
   bool hadError() const { return m_hadError; }
   void setErrorReportingEnabled(bool value) { m_errorReportingEnabled = value; }
@@ -41,6 +46,7 @@ private:
 private:
   const ContextConfig m_config;
   memory::StringPool m_stringPool;
+  memory::StackAllocator m_scratch;
   bool m_hadError = false;
   bool m_errorReportingEnabled = true;
   log::Log *m_log = nullptr;
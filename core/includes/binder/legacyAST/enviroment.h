@@ -1,25 +1,31 @@
 #pragma once
-#include "binder/memory/stringHashMap.h"
+#include "binder/memory/stringMap.h"
 
 namespace binder {
 struct RuntimeValue;
 class Callable;
 class Enviroment {
 public:
-  // TODO we will need the hashmap to be resizable to be resizable
-  explicit Enviroment(Enviroment* enclosing ) : m_values(1024), m_callables(1024),m_enclosing(enclosing){};
-  Enviroment( ) : m_values(1024),m_callables(1024), m_enclosing(nullptr){};
+  // the maps grow as needed, most scopes only hold a handful of names
+  explicit Enviroment(Enviroment* enclosing ) : m_values(BINS), m_callables(BINS),m_enclosing(enclosing){};
+  Enviroment( ) : m_values(BINS),m_callables(BINS), m_enclosing(nullptr){};
   ~Enviroment() = default;
   // TODO block copy/assigment constructor etc
 
   void define(const char *variable, RuntimeValue *value) {
-    m_values.insert(variable, value);
+    m_values.insert(memory::StringKey(variable), value);
   }
   void define(const char *name, Callable *value) {
-    m_callables.insert(name, value);
+    m_callables.insert(memory::StringKey(name), value);
   }
 
+  // the name is hashed once here and the key is reused all the way up the
+  // enclosing enviroments
   bool assign(const char *variable, RuntimeValue *value)
+  {
+      return assign(memory::StringKey(variable), value);
+  }
+  bool assign(const memory::StringKey& variable, RuntimeValue *value)
   {
       if(m_values.containsKey(variable))
       {
@@ -37,6 +43,9 @@ public:
   }
 
   bool get(const char *variable, RuntimeValue**outValue) const {
+    return get(memory::StringKey(variable), outValue);
+  }
+  bool get(const memory::StringKey& variable, RuntimeValue**outValue) const {
     bool result = m_values.get(variable, *outValue);
     if(result)
     {
@@ -59,8 +68,9 @@ public:
   }
 
 private:
-  memory::HashMap<const char *, RuntimeValue *, hashString32> m_values;
-  memory::HashMap<const char *, Callable*, hashString32> m_callables;
+  static constexpr uint32_t BINS = 16;
+  memory::StringMap<RuntimeValue *> m_values;
+  memory::StringMap<Callable*> m_callables;
   Enviroment* m_enclosing;
 };
 
@@ -61,7 +61,8 @@ class ASTInterpreter {
   typedef uint32_t RuntimeValueHandle;
 
 public:
-  // poolSize is in number of elements stored in the pool;
+  // poolSize is in number of elements stored in each page of the pool, more
+  // pages get added when a run needs more values
   ASTInterpreter(BinderContext *context, int poolSize = 1000)
       : m_context(context), m_pool(poolSize){};
   ~ASTInterpreter() = default;
@@ -1,7 +1,9 @@
 #pragma once
 
+#include "binder/legacyAST/astArena.h"
 #include "binder/legacyAST/autogen/astgen.h"
 #include "binder/memory/resizableVector.h"
+#include "binder/memory/stringIntern.h"
 #include "binder/tokens.h"
 
 #include <exception>
@@ -16,14 +18,19 @@ class BinderContext;
 
 class Parser {
 public:
-  Parser(BinderContext *context) : m_context(context), m_stmts(10){};
+  Parser(BinderContext *context)
+      : m_context(context), m_stmts(10), m_intern(1024){};
   ~Parser() = default;
 
+  // the nodes live in the parser arena, a new parse frees the ones of the
+  // previous one. Names and literals live in the parser intern and stay
+  // for the life of the parser, the interpreter keeps pointers to them
   void parse(const memory::ResizableVector<Token> *tokens);
   // const autogen::Expr* getRoot() const {return m_root;}
   const memory::ResizableVector<autogen::Stmt *> &getStmts() const {
     return m_stmts;
   }
+  AstArena::Report getArenaReport() const { return m_arena.getReport(); }
 
 private:
   // private interface
@@ -58,12 +65,16 @@ private:
   const Token &previous() const;
   const Token &consume(TOKEN_TYPE type, const char *message);
   ParserException error(const Token &token, const char *message);
+  // null terminated copy of the lexeme, the tokens only point in the source
+  const char *intern(const Token &token);
 
 private:
   int current = 0;
   const memory::ResizableVector<Token> *m_tokens;
   BinderContext *m_context = nullptr;
   memory::ResizableVector<autogen::Stmt *> m_stmts;
+  AstArena m_arena;
+  memory::StringIntern m_intern;
 };
 
 } // namespace binder
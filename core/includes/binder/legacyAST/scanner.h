@@ -28,11 +28,21 @@ class Scanner {
   void scanString();
   void scanNumber();
   void scanIdentifier();
+  void skipWhiteSpace();
   static bool isDigit(const char c);
   static bool isAlpha(const char c);
-  static bool isAlphaNumeric(const char c);
-  void addStringToken(uint32_t startIdx, uint32_t endIdx);
-  void addNumberToken(uint32_t startIdx, uint32_t endIdx);
+  // the runs of chars are walked with pointers, a block at the time
+  [[nodiscard]] const char *cursor() const { return m_source + current; }
+  [[nodiscard]] const char *sourceEnd() const {
+    return m_source + m_sourceLength;
+  }
+  void moveTo(const char *p) {
+    current = static_cast<uint32_t>(p - m_source);
+  }
+  [[nodiscard]] TOKEN_TYPE identifierType() const;
+  [[nodiscard]] TOKEN_TYPE checkKeyword(uint32_t startIdx, uint32_t length,
+                                        const char *rest,
+                                        TOKEN_TYPE type) const;
 
  private:
   memory::ResizableVector<Token> m_tokens;
@@ -5,9 +5,6 @@
 
 namespace binder::log {
 
-static char logBuffer[1024];
-static char tempLogBuffer1[1024];
-
 // abstract interface for the Log/Printing system
 class Log {
 public:
@@ -29,9 +26,12 @@ public:
 };
 
 inline void LOG(log::Log *logger, const char *format, ...) {
+  // on the stack so that vms running on different threads can log at the
+  // same time
+  char logBuffer[1024];
   va_list args;
   va_start(args, format);
-  vsprintf(logBuffer, format, args);
+  vsnprintf(logBuffer, sizeof(logBuffer), format, args);
   va_end(args);
   logger->print(logBuffer);
 }
@@ -0,0 +1,326 @@
+#pragma once
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// the probing is done a group of bins at the time, the width depends on what
+// the target supports, BINDER_HASHMAP_NO_AVX2 and BINDER_HASHMAP_NO_SIMD force
+// the narrower versions, handy to test them on a machine that has avx2
+#if defined(__AVX2__) && !defined(BINDER_HASHMAP_NO_AVX2) &&                  \
+    !defined(BINDER_HASHMAP_NO_SIMD)
+#define BINDER_HASHMAP_AVX2_GROUP
+#include <immintrin.h>
+#elif (defined(__SSE2__) || defined(_M_X64) ||                                 \
+       (defined(_M_IX86_FP) && _M_IX86_FP >= 2)) &&                            \
+    !defined(BINDER_HASHMAP_NO_SIMD)
+#define BINDER_HASHMAP_SSE2_GROUP
+#include <emmintrin.h>
+#endif
+
+namespace binder::memory {
+
+// every bin has a control byte, the high bit set means the bin has no key,
+// otherwise the low 7 bits are the low 7 bits of the hash of the key in the
+// bin. A whole group of control bytes is compared against those 7 bits at
+// once and only the bins that match get their key compared
+static constexpr int8_t CTRL_EMPTY = -128; // 0b10000000
+static constexpr int8_t CTRL_DELETED = -2; // 0b11111110
+
+inline uint32_t countTrailingZeros(const uint32_t value) {
+  assert(value != 0);
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, value);
+  return index;
+#else
+  return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+}
+
+inline uint32_t countLeadingZeros(const uint32_t value) {
+  assert(value != 0);
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse(&index, value);
+  return 31 - index;
+#else
+  return static_cast<uint32_t>(__builtin_clz(value));
+#endif
+}
+
+// one bit per bin of the group, the lowest bit is the first bin
+struct GroupMask {
+  uint32_t bits;
+
+  explicit operator bool() const { return bits != 0; }
+  uint32_t lowestBin() const { return countTrailingZeros(bits); }
+  void clearLowestBin() { bits &= bits - 1; }
+};
+
+#if defined(BINDER_HASHMAP_AVX2_GROUP)
+
+struct Group {
+  static constexpr uint32_t WIDTH = 32;
+
+  explicit Group(const int8_t *control)
+      : m_control(_mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(control))) {}
+
+  GroupMask match(const int8_t tag) const {
+    return mask(_mm256_cmpeq_epi8(m_control, _mm256_set1_epi8(tag)));
+  }
+  GroupMask matchEmpty() const {
+    return mask(_mm256_cmpeq_epi8(m_control, _mm256_set1_epi8(CTRL_EMPTY)));
+  }
+  // the only two values with the high bit set
+  GroupMask matchEmptyOrDeleted() const { return mask(m_control); }
+
+private:
+  static GroupMask mask(const __m256i bytes) {
+    return GroupMask{static_cast<uint32_t>(_mm256_movemask_epi8(bytes))};
+  }
+  __m256i m_control;
+};
+
+#elif defined(BINDER_HASHMAP_SSE2_GROUP)
+
+struct Group {
+  static constexpr uint32_t WIDTH = 16;
+
+  explicit Group(const int8_t *control)
+      : m_control(
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(control))) {}
+
+  GroupMask match(const int8_t tag) const {
+    return mask(_mm_cmpeq_epi8(m_control, _mm_set1_epi8(tag)));
+  }
+  GroupMask matchEmpty() const {
+    return mask(_mm_cmpeq_epi8(m_control, _mm_set1_epi8(CTRL_EMPTY)));
+  }
+  GroupMask matchEmptyOrDeleted() const { return mask(m_control); }
+
+private:
+  static GroupMask mask(const __m128i bytes) {
+    return GroupMask{static_cast<uint32_t>(_mm_movemask_epi8(bytes))};
+  }
+  __m128i m_control;
+};
+
+#else
+
+// no simd, 8 control bytes in a 64 bit integer
+struct Group {
+  static constexpr uint32_t WIDTH = 8;
+
+  explicit Group(const int8_t *control) { memcpy(&m_control, control, 8); }
+
+  GroupMask match(const int8_t tag) const {
+    // zero bytes of the xor are the matches, classic has-zero-byte trick.
+    // The borrow can flag a 0x01 byte right after a real match, the keys are
+    // compared anyway so a false positive only costs a compare
+    const uint64_t x =
+        m_control ^ (LSBS * static_cast<uint8_t>(tag));
+    return mask((x - LSBS) & ~x & MSBS);
+  }
+  GroupMask matchEmpty() const {
+    // empty is the only value with the high bit set and the next one clear
+    return mask(m_control & ~(m_control << 1) & MSBS);
+  }
+  GroupMask matchEmptyOrDeleted() const { return mask(m_control & MSBS); }
+
+private:
+  static constexpr uint64_t LSBS = 0x0101010101010101ull;
+  static constexpr uint64_t MSBS = 0x8080808080808080ull;
+
+  // the high bit of every byte down to one bit per bin, bytes are loaded
+  // with memcpy so this assumes a little endian target
+  static GroupMask mask(const uint64_t highBits) {
+    uint32_t bits = 0;
+    for (uint32_t i = 0; i < WIDTH; ++i) {
+      bits |= static_cast<uint32_t>((highBits >> (i * 8 + 7)) & 1u) << i;
+    }
+    return GroupMask{bits};
+  }
+  uint64_t m_control;
+};
+
+#endif
+
+// the bookkeeping shared by the maps: control bytes, probing, growth. The
+// maps own keys and values and tell the control where to move them when
+// the table is rebuilt. The control bytes array is WIDTH bytes longer than
+// the bin count, the first WIDTH bytes are mirrored at the end so a group can
+// be loaded starting at any bin without wrapping around
+class HashMapControl {
+public:
+  explicit HashMapControl(const float maxLoadFactor)
+      : m_maxLoadFactor(maxLoadFactor) {
+    assert(maxLoadFactor > 0.0f && maxLoadFactor < 1.0f);
+  }
+  ~HashMapControl() { delete[] m_control; }
+
+  // bins are always a power of two and at least a group
+  static uint32_t binCountFor(const uint32_t requested) {
+    uint32_t bins = Group::WIDTH;
+    while (bins < requested) {
+      bins <<= 1;
+    }
+    return bins;
+  }
+
+  void allocate(const uint32_t bins) {
+    assert((bins & (bins - 1)) == 0 && bins >= Group::WIDTH);
+    m_bins = bins;
+    m_mask = bins - 1;
+    const auto filled =
+        static_cast<uint32_t>(static_cast<float>(bins) * m_maxLoadFactor);
+    // we always want at least one empty bin, probing stops at empty bins
+    m_maxFilledBins = filled < bins ? filled : bins - 1;
+    m_control = new int8_t[bins + Group::WIDTH];
+    clear();
+  }
+
+  // the old control bytes, the caller moves the used bins over and then
+  // deletes the array
+  int8_t *release() {
+    int8_t *control = m_control;
+    m_control = nullptr;
+    return control;
+  }
+
+  void clear() {
+    memset(m_control, CTRL_EMPTY, m_bins + Group::WIDTH);
+    m_usedBins = 0;
+    m_deletedBins = 0;
+  }
+
+  // walks the bins whose control byte matches the hash, stops at the first
+  // one isKey accepts, or when a group with an empty bin has been checked,
+  // the key can't be past it
+  template <typename IS_KEY>
+  bool find(const uint32_t hash, IS_KEY isKey, uint32_t &bin) const {
+    const int8_t tag = hashTag(hash);
+    uint32_t position = hashPosition(hash);
+    uint32_t stride = 0;
+    while (true) {
+      const Group group(m_control + position);
+      GroupMask matches = group.match(tag);
+      while (matches) {
+        bin = (position + matches.lowestBin()) & m_mask;
+        if (isKey(bin)) {
+          return true;
+        }
+        matches.clearLowestBin();
+      }
+      if (group.matchEmpty()) {
+        bin = (position + group.matchEmpty().lowestBin()) & m_mask;
+        return false;
+      }
+      // triangular probing over groups, goes through all of them since the
+      // bin count is a power of two
+      stride += Group::WIDTH;
+      position = (position + stride) & m_mask;
+    }
+  }
+
+  // true when the caller should rebuild the table before adding a key
+  [[nodiscard]] bool isFull() const {
+    return m_usedBins + m_deletedBins + 1 > m_maxFilledBins;
+  }
+  // the size for the rebuilt table, doubled when it is mostly live keys,
+  // otherwise the same, rebuilding just drops the deleted bins
+  [[nodiscard]] uint32_t rehashBinCount() const {
+    return m_usedBins + 1 > m_maxFilledBins / 2 ? m_bins * 2 : m_bins;
+  }
+
+  // there is always an empty bin, the load factor makes sure of it
+  uint32_t findWritableBin(const uint32_t hash) const {
+    uint32_t position = hashPosition(hash);
+    uint32_t stride = 0;
+    while (true) {
+      const GroupMask writable = Group(m_control + position).matchEmptyOrDeleted();
+      if (writable) {
+        return (position + writable.lowestBin()) & m_mask;
+      }
+      stride += Group::WIDTH;
+      position = (position + stride) & m_mask;
+    }
+  }
+
+  void markUsed(const uint32_t bin, const uint32_t hash) {
+    // reusing a deleted bin
+    m_deletedBins -= m_control[bin] == CTRL_DELETED;
+    setControl(bin, hashTag(hash));
+    ++m_usedBins;
+  }
+
+  void markRemoved(const uint32_t bin) {
+    // if there is an empty bin within a group width on both sides, no group
+    // probed through this bin ever found it full, so no probe went past it
+    // and there is no need to leave a deleted marker behind
+    const uint32_t before = (bin - Group::WIDTH) & m_mask;
+    const GroupMask emptyAfter = Group(m_control + bin).matchEmpty();
+    const GroupMask emptyBefore = Group(m_control + before).matchEmpty();
+    const bool wasNeverFull =
+        emptyAfter && emptyBefore &&
+        (emptyAfter.lowestBin() + leadingEmptyDistance(emptyBefore)) <
+            Group::WIDTH;
+    if (wasNeverFull) {
+      setControl(bin, CTRL_EMPTY);
+    } else {
+      setControl(bin, CTRL_DELETED);
+      ++m_deletedBins;
+    }
+    --m_usedBins;
+  }
+
+  [[nodiscard]] bool isBinUsed(const uint32_t bin) const {
+    return m_control[bin] >= 0;
+  }
+  static bool isUsedControl(const int8_t control) { return control >= 0; }
+
+  [[nodiscard]] uint32_t getBins() const { return m_bins; }
+  [[nodiscard]] uint32_t getUsedBins() const { return m_usedBins; }
+  [[nodiscard]] uint32_t getDeletedBins() const { return m_deletedBins; }
+
+  // deleted functions
+  HashMapControl(const HashMapControl &) = delete;
+  HashMapControl &operator=(const HashMapControl &) = delete;
+
+private:
+  static int8_t hashTag(const uint32_t hash) {
+    return static_cast<int8_t>(hash & 0x7f);
+  }
+  uint32_t hashPosition(const uint32_t hash) const {
+    return (hash >> 7) & m_mask;
+  }
+  // how many bins from the end of the group back to the last empty one
+  static uint32_t leadingEmptyDistance(const GroupMask mask) {
+    return countLeadingZeros(mask.bits) - (32 - Group::WIDTH);
+  }
+
+  void setControl(const uint32_t bin, const int8_t control) {
+    m_control[bin] = control;
+    // the mirrored copy of the first group
+    if (bin < Group::WIDTH) {
+      m_control[m_bins + bin] = control;
+    }
+  }
+
+private:
+  int8_t *m_control = nullptr;
+  uint32_t m_bins = 0;
+  uint32_t m_mask = 0;
+  uint32_t m_usedBins = 0;
+  // bins left behind by removals, they count towards the load factor since
+  // probes have to walk past them
+  uint32_t m_deletedBins = 0;
+  uint32_t m_maxFilledBins = 0;
+  float m_maxLoadFactor;
+};
+
+} // namespace binder::memory
@@ -40,4 +40,17 @@ inline uint32_t hashString32(const char *const&value,const uint32_t len) {
   return util::Hash32(value, len);
 }
 
+// fnv-1a, a lot slower than farmhash on long keys but it can be continued:
+// hashing the chars of b starting from the hash of a gives the hash of a + b
+static constexpr uint32_t FNV1A_32_SEED = 2166136261u;
+inline uint32_t hashFnv1a32(const char *value, const uint32_t len,
+                            const uint32_t seed = FNV1A_32_SEED) {
+  uint32_t hash = seed;
+  for (uint32_t i = 0; i < len; ++i) {
+    hash ^= static_cast<uint8_t>(value[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
 } // namespace binder
@@ -0,0 +1,34 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace binder::memory {
+
+// read only view of a whole file. On desktop the file is memory mapped so
+// nothing is read until it is touched, on emscripten there is no mmap, the
+// file gets read in a heap buffer instead
+class MappedFile final {
+public:
+  MappedFile() = default;
+  ~MappedFile() { close(); }
+
+  bool open(const char *path);
+  void close();
+
+  [[nodiscard]] const uint8_t *data() const { return m_data; }
+  [[nodiscard]] size_t size() const { return m_size; }
+
+  // deleted functions
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+private:
+  const uint8_t *m_data = nullptr;
+  size_t m_size = 0;
+#if defined(_WIN32)
+  void *m_file = nullptr;
+  void *m_mapping = nullptr;
+#endif
+};
+
+} // namespace binder::memory
@@ -2,6 +2,9 @@
 #include "binder/memory/threeSizesPool.h"
 #include <cassert>
 #include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <utility>
 
 namespace binder::memory {
 
@@ -12,6 +15,9 @@ compilation. You can only use POD data, and or structures in pod data, what
 happens is a shallow copy when resizing or more memory required, if you have
 pointers there those won't be deep copied, which might be the intended
 behaviour, just bewhare!
+Growing multiplies the reserved size by the growth factor, and the memory is
+extended in place whenever possible, realloc without an allocator, tryExtend
+on the pool otherwise, so most of the time growing doesn't copy anything.
 */
 template <typename T, typename ALLOCATOR = ThreeSizesPool>
 class ResizableVector {
@@ -55,22 +61,25 @@ public:
 
   inline void pushBack(const T &value) {
     // first checking whether there is enough buffer left, if
-    // not we re-allocate
-
-    if ((m_size == 0) & (m_reserved == 0)) {
-      reallocateMemoryInternal(INTERNAL_RESERVE);
-      m_reserved = INTERNAL_RESERVE;
-    }
-
+    // not we re-allocate, an empty vector with nothing reserved ends up here
+    // too
     if (m_size >= m_reserved) {
-      assert(m_reserved != 0);
-      reallocateMemoryInternal(m_size * 2);
-      m_reserved *= 2;
+      grow(m_size + 1);
     }
     m_memory[m_size] = value;
     m_size += 1;
   };
 
+  // builds the value straight in the vector memory instead of copying it in
+  template <typename... ARGS> inline T &emplaceBack(ARGS &&...args) {
+    if (m_size >= m_reserved) {
+      grow(m_size + 1);
+    }
+    T *value = new (m_memory + m_size) T{std::forward<ARGS>(args)...};
+    m_size += 1;
+    return *value;
+  }
+
   inline T &operator[](const uint32_t index) const {
 #if SE_MEMORY_INDEX_CHECKING
     assert(index < m_size);
@@ -84,18 +93,50 @@ public:
     return m_memory[index];
   }
 
+  // new elements are not initialized
   void resize(const uint32_t newSize) {
     if (newSize > m_reserved) {
       // if not enough space we re-allocate
-      reallocateMemoryInternal(newSize * 2);
-      m_reserved = newSize * 2;
-      m_size = newSize;
-    } else {
-      // updating the size
-      m_size = newSize;
+      grow(newSize);
+    }
+    m_size = newSize;
+  }
+
+  // makes room for at least the given count of elements, exactly that many
+  // if it has to reallocate, never shrinks
+  void reserve(const uint32_t count) {
+    if (count > m_reserved) {
+      reallocateMemoryInternal(count);
     }
   }
 
+  // gives back the memory past the size, an empty vector frees it all
+  void shrinkToFit() {
+    if (m_size == m_reserved) {
+      return;
+    }
+    if (m_size == 0) {
+      freeMemoryInternal(m_memory);
+      m_memory = nullptr;
+      m_reserved = 0;
+      return;
+    }
+    // allocations can't shrink in place, it is a new allocation and a copy
+    T *memory = reinterpret_cast<T *>(allocateMemoryInternal(m_size));
+    memcpy(memory, m_memory, m_size * sizeof(T));
+    freeMemoryInternal(m_memory);
+    m_memory = memory;
+    m_reserved = m_size;
+  }
+
+  // how much the reserved size is multiplied by when the vector runs out of
+  // space, has to be bigger than one
+  void setGrowthFactor(const float factor) {
+    assert(factor > 1.0f);
+    m_growthFactor = factor;
+  }
+  [[nodiscard]] float getGrowthFactor() const { return m_growthFactor; }
+
   inline const T &getConstRef(const uint32_t index) const {
 #if SE_MEMORY_INDEX_CHECKING
     assert(index < m_size);
@@ -111,32 +152,63 @@ public:
   ResizableVector &operator=(const ResizableVector &) = delete;
 
 private:
+  // geometric growth, big enough for the required count in one go, so a
+  // resize way past the reserve doesn't go through several reallocations
+  void grow(const uint32_t required) {
+    uint32_t newReserved = m_reserved == 0
+                               ? INTERNAL_RESERVE
+                               : static_cast<uint32_t>(
+                                     static_cast<float>(m_reserved) *
+                                     m_growthFactor);
+    // a small factor on a small vector could round back to the same size
+    newReserved = newReserved > m_reserved ? newReserved : m_reserved + 1;
+    newReserved = newReserved > required ? newReserved : required;
+    reallocateMemoryInternal(newReserved);
+  }
+
   void *allocateMemoryInternal(uint32_t size, uint8_t = 0) {
     if (m_allocator != nullptr) {
       return (m_allocator->allocate(sizeof(T) * size));
     } else {
-      return new T[size];
+      // only pod goes in here, no constructors to run
+      return malloc(sizeof(T) * size);
     }
   }
   void freeMemoryInternal(void *memory) {
-    if ((m_allocator != nullptr) & (memory != nullptr)) {
+    if (memory == nullptr) {
+      return;
+    }
+    if (m_allocator != nullptr) {
       m_allocator->free(memory);
     } else {
-      delete[] m_memory;
+      free(memory);
     }
   }
 
   void reallocateMemoryInternal(const uint32_t newSize) {
-    T *tempMemory = reinterpret_cast<T *>(allocateMemoryInternal(newSize));
-    if ((m_size != 0) & (m_memory != nullptr)) {
-      memcpy(tempMemory, m_memory, m_size * sizeof(T));
+    T *tempMemory = nullptr;
+    if (m_memory == nullptr) {
+      tempMemory = reinterpret_cast<T *>(allocateMemoryInternal(newSize));
+    } else if (m_allocator == nullptr) {
+      // realloc grows in place when it can and copies otherwise
+      tempMemory =
+          reinterpret_cast<T *>(realloc(m_memory, sizeof(T) * newSize));
+    } else if (m_allocator->tryExtend(m_memory, sizeof(T) * newSize)) {
+      tempMemory = m_memory;
+    } else {
+      tempMemory = reinterpret_cast<T *>(allocateMemoryInternal(newSize));
+      if (m_size != 0) {
+        memcpy(tempMemory, m_memory, m_size * sizeof(T));
+      }
+      freeMemoryInternal(m_memory);
     }
+    assert(tempMemory != nullptr);
 #if SE_DEBUG
     // just setting memory to an easily readable value in case we are in debug
     memset(tempMemory + m_size, 0xDEADBAAD, sizeof(T) * (newSize - m_size));
 #endif
-    freeMemoryInternal(m_memory);
     m_memory = tempMemory;
+    m_reserved = newSize;
   }
 
   T *m_memory = nullptr;
@@ -145,7 +217,9 @@ private:
   ALLOCATOR *m_allocator;
   uint32_t m_size;
   uint32_t m_reserved;
+  float m_growthFactor = DEFAULT_GROWTH_FACTOR;
   static const uint32_t INTERNAL_RESERVE = 8;
+  static constexpr float DEFAULT_GROWTH_FACTOR = 2.0f;
 }; // namespace binder
 
 } // namespace binder::memory
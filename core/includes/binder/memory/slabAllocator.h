@@ -0,0 +1,174 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+
+#include "binder/memory/resizableVector.h"
+
+namespace binder::memory {
+
+// Allocator for lots of small blocks of a handful of sizes, like the vm
+// objects. Requests are rounded up to a size class, every class carves its
+// slots out of big slabs and keeps the freed ones in an intrusive linked
+// list, so both allocating and freeing are a couple of pointer moves and
+// objects of the same size end up next to each other. Anything bigger than
+// the largest class goes straight to malloc. The caller passes the size back
+// when freeing, so there is no header in front of the blocks. Slabs are
+// only given back when the allocator goes away.
+class SlabAllocator final {
+public:
+  static constexpr uint32_t CLASS_COUNT = 8;
+  static constexpr uint32_t MAX_SLOT_SIZE = 256;
+  static constexpr uint32_t SLAB_SIZE = 64 * 1024;
+
+  struct ClassStats {
+    uint32_t slotSize;
+    uint32_t slotsInUse;
+    uint32_t slabs;
+  };
+  struct Stats {
+    ClassStats classes[CLASS_COUNT];
+    uint64_t allocations;
+    uint64_t frees;
+    // blocks too big for the classes, they went to malloc
+    uint32_t largeInUse;
+    // what the live blocks take, rounded up to their class
+    uint64_t bytesInUse;
+    // slabs plus the large blocks
+    uint64_t bytesReserved;
+  };
+
+  SlabAllocator() = default;
+  ~SlabAllocator() {
+    for (uint32_t i = 0; i < m_slabs.size(); ++i) {
+      ::free(m_slabs[i]);
+    }
+  }
+
+  void *allocate(const uint32_t sizeInByte) {
+    ++m_allocations;
+    if (sizeInByte > MAX_SLOT_SIZE) {
+      ++m_largeInUse;
+      m_largeBytes += sizeInByte;
+      return malloc(sizeInByte);
+    }
+
+    SizeClass &sizeClass = m_classes[getClassIndex(sizeInByte)];
+    ++sizeClass.slotsInUse;
+    if (sizeClass.freeList != nullptr) {
+      FreeSlot *slot = sizeClass.freeList;
+      sizeClass.freeList = slot->next;
+      return slot;
+    }
+    if (sizeClass.cursor == sizeClass.end) {
+      newSlab(sizeClass);
+    }
+    void *memory = sizeClass.cursor;
+    sizeClass.cursor += sizeClass.slotSize;
+    return memory;
+  }
+
+  void free(void *memory, const uint32_t sizeInByte) {
+    assert(memory != nullptr);
+    ++m_frees;
+    if (sizeInByte > MAX_SLOT_SIZE) {
+      --m_largeInUse;
+      m_largeBytes -= sizeInByte;
+      ::free(memory);
+      return;
+    }
+
+    SizeClass &sizeClass = m_classes[getClassIndex(sizeInByte)];
+    assert(sizeClass.slotsInUse != 0);
+    --sizeClass.slotsInUse;
+    auto *slot = static_cast<FreeSlot *>(memory);
+    slot->next = sizeClass.freeList;
+    sizeClass.freeList = slot;
+  }
+
+  [[nodiscard]] Stats getStats() const {
+    Stats stats{};
+    stats.allocations = m_allocations;
+    stats.frees = m_frees;
+    stats.largeInUse = m_largeInUse;
+    stats.bytesInUse = m_largeBytes;
+    stats.bytesReserved = m_largeBytes;
+    for (uint32_t i = 0; i < CLASS_COUNT; ++i) {
+      const SizeClass &sizeClass = m_classes[i];
+      stats.classes[i] = {sizeClass.slotSize, sizeClass.slotsInUse,
+                          sizeClass.slabs};
+      stats.bytesInUse +=
+          static_cast<uint64_t>(sizeClass.slotSize) * sizeClass.slotsInUse;
+      stats.bytesReserved += static_cast<uint64_t>(SLAB_SIZE) * sizeClass.slabs;
+    }
+    return stats;
+  }
+
+  // the size a request of sizeInByte actually takes
+  static uint32_t getSlotSize(const uint32_t sizeInByte) {
+    if (sizeInByte > MAX_SLOT_SIZE) {
+      return sizeInByte;
+    }
+    return CLASS_SIZES[getClassIndex(sizeInByte)];
+  }
+
+  // deleted functions
+  SlabAllocator(const SlabAllocator &) = delete;
+  SlabAllocator &operator=(const SlabAllocator &) = delete;
+
+private:
+  struct FreeSlot {
+    FreeSlot *next;
+  };
+  struct SizeClass {
+    uint32_t slotSize;
+    uint32_t slotsInUse;
+    uint32_t slabs;
+    FreeSlot *freeList;
+    // the part of the last slab not handed out yet
+    char *cursor;
+    char *end;
+  };
+
+  // multiples of 16 so every slot stays aligned for anything we put in it
+  static constexpr uint32_t CLASS_SIZES[CLASS_COUNT] = {16,  32,  48,  64,
+                                                        96, 128, 192, 256};
+  // size class for every 16 bytes step up to MAX_SLOT_SIZE
+  static constexpr uint8_t CLASS_LOOKUP[MAX_SLOT_SIZE / 16 + 1] = {
+      0, 0, 1, 2, 3, 4, 4, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7};
+
+  static uint32_t getClassIndex(const uint32_t sizeInByte) {
+    assert(sizeInByte <= MAX_SLOT_SIZE);
+    return CLASS_LOOKUP[(sizeInByte + 15) / 16];
+  }
+
+  void newSlab(SizeClass &sizeClass) {
+    // malloc alignment is at least 16 on the platforms we care about
+    char *slab = static_cast<char *>(malloc(SLAB_SIZE));
+    assert(slab != nullptr);
+    m_slabs.pushBack(slab);
+    ++sizeClass.slabs;
+    sizeClass.cursor = slab;
+    // the tail that can't fit a whole slot is wasted
+    sizeClass.end = slab + (SLAB_SIZE / sizeClass.slotSize) * sizeClass.slotSize;
+  }
+
+private:
+  SizeClass m_classes[CLASS_COUNT] = {
+      {CLASS_SIZES[0], 0, 0, nullptr, nullptr, nullptr},
+      {CLASS_SIZES[1], 0, 0, nullptr, nullptr, nullptr},
+      {CLASS_SIZES[2], 0, 0, nullptr, nullptr, nullptr},
+      {CLASS_SIZES[3], 0, 0, nullptr, nullptr, nullptr},
+      {CLASS_SIZES[4], 0, 0, nullptr, nullptr, nullptr},
+      {CLASS_SIZES[5], 0, 0, nullptr, nullptr, nullptr},
+      {CLASS_SIZES[6], 0, 0, nullptr, nullptr, nullptr},
+      {CLASS_SIZES[7], 0, 0, nullptr, nullptr, nullptr},
+  };
+  ResizableVector<char *> m_slabs;
+  uint64_t m_allocations = 0;
+  uint64_t m_frees = 0;
+  uint32_t m_largeInUse = 0;
+  uint64_t m_largeBytes = 0;
+};
+
+} // namespace binder::memory
@@ -3,143 +3,182 @@
 #include <cstdint>
 #include <cstring>
 
+#include "binder/memory/resizableVector.h"
+
 namespace binder::memory {
 
 // The Sparse in the names stands from the fact that, although
 // the pool tries to patch holes on new allocation, there is no
 // actual hard guarantees that the memory will actually be contiguous
 
-// the way it works is the following, you have a memory pool, which gets
-// allocated at the beginning. The memory gets initialized by a linked list,
-// which is a fancy term for index of the next available slot.
-// this mean the Nth index array will be initialized from Nth+1,
-// for example starting from zero memory will be set as 1,2,3,4...
-
-// the next empty slots starts at zero, when an allocation is made,
-// the nextAllocation slot is used and the value at which the slot points
-// to will be set as nextAllocation, for example if you do your first allocation
-// the address of memory[0] will be returned and nextAllocation will be 1,
-// because that is the value that memory[0] holds at the beginning.
+// the way it works is the following, slots are handed out one after the
+// other from the pool, once a slot gets freed it goes in a linked list,
+// which is a fancy term for the index of the next free slot stored in the
+// freed memory itself. New allocations patch the holes from the list first
+// and only then take a never used slot.
 
 // deletion works in a similar fashion, once a slot is freed, in the current
 // freed slot we store the current nextAllocation slot, and nextAllocation slot
 // gets set to the newly freed index.
 
+// the memory is split in pages of the same size, when the pool is full a new
+// page is added, the old ones never move so a slot index stays valid.
+
+// what the user gets back is not a plain index but an handle, the low bits
+// are the slot and the high bits the generation of the slot, bumped every
+// time the slot is freed. An handle to a freed, and maybe reused, slot won't
+// match the generation anymore and asserts on access. Handles are still 32
+// bits so they can travel in a void* on 32 bit targets.
 template <typename T> class SparseMemoryPool final {
 
 public:
+  static constexpr uint32_t SLOT_BITS = 24;
+  static constexpr uint32_t SLOT_MASK = (1u << SLOT_BITS) - 1;
+  static constexpr uint32_t MAX_SLOTS = 1u << SLOT_BITS;
+
+  // poolSize is rounded up to a power of two and becomes the page size
   explicit SparseMemoryPool(const uint32_t poolSize) {
     // since we use uint32_t as indices we need at least 4 byte dataType
     // to store the "linked list" in the same memory.
     assert(sizeof(T) >= 4);
+    assert(poolSize != 0 && poolSize <= MAX_SLOTS);
 
-    m_memory = new T[poolSize];
-    m_poolSize = poolSize;
-
-    setupLinkedList();
-
-#if SE_DEBUG
-    m_freedMemory = new char[poolSize];
-    memset(m_freedMemory, 1, sizeof(char) * poolSize);
-#endif
+    while ((1u << m_pageShift) < poolSize) {
+      ++m_pageShift;
+    }
+    addPage();
   };
 
   ~SparseMemoryPool() {
-    delete m_memory;
-#if SE_DEBUG
-    delete m_freedMemory;
-#endif
+    for (uint32_t i = 0; i < m_pages.size(); ++i) {
+      delete[] m_pages[i].memory;
+      delete[] m_pages[i].generations;
+    }
   };
   SparseMemoryPool(const SparseMemoryPool &) = delete;
   SparseMemoryPool &operator=(const SparseMemoryPool &) = delete;
 
-  inline T &getFreeMemoryData(uint32_t &index) {
-    assert(m_allocationCount < m_poolSize &&
-           "requested deallocation is outside pool range");
-
-    index = m_nextAllocation;
-    m_nextAllocation =
-        *(reinterpret_cast<uint32_t *>(&m_memory[m_nextAllocation]));
+  inline T &getFreeMemoryData(uint32_t &handle) {
+    uint32_t slot = m_nextAllocation;
+    if (slot != NO_SLOT) {
+      m_nextAllocation = *(reinterpret_cast<uint32_t *>(&getSlot(slot)));
+    } else {
+      // free list is empty, taking a never used slot, growing if needed
+      if (m_usedSlots == getCapacity()) {
+        addPage();
+      }
+      slot = m_usedSlots++;
+    }
     ++m_allocationCount;
-#if SE_DEBUG
-    m_memory[index] = T{};
-    assert(m_freedMemory[index] == 1);
-    m_freedMemory[index] = 0;
-#endif
-    return m_memory[index];
+    handle = makeHandle(slot, getGeneration(slot));
+    return getSlot(slot);
   }
-  inline void free(const uint32_t index) {
-#if SE_DEBUG
-    assert(m_freedMemory[index] == 0 && "memory has been already deallocated");
-#endif
+
+  inline void free(const uint32_t handle) {
+    assert(isValid(handle) && "memory has been already deallocated");
     --m_allocationCount;
 
-#if SE_DEBUG
-    m_freedMemory[index] = 1;
-    m_memory[index] = T{};
-#endif
+    const uint32_t slot = handle & SLOT_MASK;
+    // old handles to this slot are now stale
+    ++getGeneration(slot);
     // set in the new freed slot the value to the next free slot
-    *(reinterpret_cast<uint32_t *>(&m_memory[index])) = m_nextAllocation;
-    m_nextAllocation = index;
+    *(reinterpret_cast<uint32_t *>(&getSlot(slot))) = m_nextAllocation;
+    m_nextAllocation = slot;
   }
-  inline uint32_t getAllocatedCount() const { return m_allocationCount; }
 
-  // subscript operator to access the pool directly, we are adults, we don't
-  // make mistakes, direct memory access is fine.
-  inline T &operator[](const uint32_t index) {
-    assert(index < m_poolSize);
-    return m_memory[index];
+  // true if the handle points to a live slot, meaning it has not been freed
+  // since it was handed out
+  [[nodiscard]] inline bool isValid(const uint32_t handle) const {
+    const uint32_t slot = handle & SLOT_MASK;
+    // the generation can only be read for slots that exist, garbage handles
+    // can point way past the pages
+    if (slot >= m_usedSlots) {
+      return false;
+    }
+    return getGeneration(slot) == (handle >> SLOT_BITS);
   }
 
-  inline const T &getConstRef(const uint32_t index) const {
-    assert(index < m_poolSize);
-    return m_memory[index];
+  inline uint32_t getAllocatedCount() const { return m_allocationCount; }
+  inline uint32_t getCapacity() const {
+    return m_pages.size() << m_pageShift;
+  }
+  inline uint32_t getPageCount() const { return m_pages.size(); }
+  inline static uint32_t getSlotFromHandle(const uint32_t handle) {
+    return handle & SLOT_MASK;
   }
 
-  //TODO can we avoid the setup of linked list somehow? 
-  //to note this is not a fast operation, the whole pool is getting
-  //iterate to set the linked list of allocations
-  void clear()
-  {
-      setupLinkedList();
-      m_nextAllocation =0;
-      m_allocationCount =0;
-#if SE_DEBUG
-      //clearing the debug memory to zero
-      memset(m_freedMemory,0,sizeof(T)*m_poolSize);
-#endif
+  // subscript operator to access the pool directly, we are adults, we don't
+  // make mistakes, but if we do a stale handle asserts
+  inline T &operator[](const uint32_t handle) {
+    assert(isValid(handle) && "handle to freed memory");
+    return getSlot(handle & SLOT_MASK);
+  }
 
+  inline const T &getConstRef(const uint32_t handle) const {
+    assert(isValid(handle) && "handle to freed memory");
+    return const_cast<SparseMemoryPool *>(this)->getSlot(handle & SLOT_MASK);
   }
 
-#if SE_DEBUG
-  bool assertEverythingDealloc() const {
-    bool toReturn = true;
-    for (unsigned i = 0; i < m_poolSize; ++i) {
-      bool current = m_freedMemory[i];
-      toReturn &= current;
+  // frees everything at once, the slot memory is not touched, only the
+  // generations of the used slots get bumped so old handles are stale, the
+  // pages are kept for the next round
+  void clear() {
+    const uint32_t pageSize = 1u << m_pageShift;
+    for (uint32_t i = 0; i < m_pages.size(); ++i) {
+      const uint32_t first = i << m_pageShift;
+      if (first >= m_usedSlots) {
+        break;
+      }
+      const uint32_t count = m_usedSlots - first < pageSize
+                                 ? m_usedSlots - first
+                                 : pageSize;
+      uint8_t *generations = m_pages[i].generations;
+      for (uint32_t j = 0; j < count; ++j) {
+        ++generations[j];
+      }
     }
-    return toReturn;
+    m_nextAllocation = NO_SLOT;
+    m_usedSlots = 0;
+    m_allocationCount = 0;
   }
-#endif
+
 private:
-  inline void setupLinkedList()
-  {
-    // m_freeList = new uint32_t[poolSize];
-    // initializing the "linked list", nextAlloc is already init to 0;
-    for (uint32_t i = 0; i < m_poolSize; ++i) {
-      *(reinterpret_cast<uint32_t *>(&m_memory[i])) = i + 1;
-    }
+  static constexpr uint32_t NO_SLOT = 0xFFFFFFFF;
+
+  struct Page {
+    T *memory;
+    uint8_t *generations;
+  };
+
+  inline static uint32_t makeHandle(const uint32_t slot,
+                                    const uint8_t generation) {
+    return (static_cast<uint32_t>(generation) << SLOT_BITS) | slot;
+  }
+
+  inline T &getSlot(const uint32_t slot) {
+    return m_pages[slot >> m_pageShift]
+        .memory[slot & ((1u << m_pageShift) - 1)];
+  }
+  inline uint8_t &getGeneration(const uint32_t slot) const {
+    return m_pages[slot >> m_pageShift]
+        .generations[slot & ((1u << m_pageShift) - 1)];
+  }
 
+  void addPage() {
+    const uint32_t pageSize = 1u << m_pageShift;
+    assert(getCapacity() + pageSize <= MAX_SLOTS &&
+           "pool can't address more slots");
+    auto *generations = new uint8_t[pageSize];
+    memset(generations, 0, pageSize);
+    m_pages.pushBack({new T[pageSize], generations});
   }
 
 private:
-  T *m_memory = nullptr;
-  uint32_t m_poolSize;
+  ResizableVector<Page> m_pages;
+  uint32_t m_pageShift = 0;
+  uint32_t m_usedSlots = 0;
   uint32_t m_allocationCount = 0;
-  uint32_t m_nextAllocation = 0;
-#if SE_DEBUG
-  char *m_freedMemory = nullptr;
-#endif
+  uint32_t m_nextAllocation = NO_SLOT;
 };
 
 } // namespace binder::memory
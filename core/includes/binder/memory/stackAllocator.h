@@ -1,88 +1,240 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 // not thread safe
 namespace binder::memory {
 
+// Stack/arena allocator, memory is bumped from a block and handed back in
+// reverse order. When a block is full a new one is chained after it, so the
+// stack never runs out, the blocks are kept around after a rewind and reused
+// by the next allocations. Instead of remembering byte counts the caller
+// takes a marker and rewinds to it, or just opens a Scope.
 class StackAllocator final {
+  struct Block;
+
  public:
+  static constexpr size_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+
+  // a position in the stack, only valid until something below it is
+  // rewound
+  struct Marker {
+    Block *block = nullptr;
+    char *stackPtr = nullptr;
+  };
+
+  // rewinds the allocator to where it was when the scope was opened
+  class Scope {
+   public:
+    explicit Scope(StackAllocator &allocator)
+        : m_allocator(allocator), m_marker(allocator.getMarker()) {}
+    ~Scope() { m_allocator.rewind(m_marker); }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+   private:
+    StackAllocator &m_allocator;
+    Marker m_marker;
+  };
+
   StackAllocator() = default;
-  ~StackAllocator() { delete[] m_start; }
+  explicit StackAllocator(const size_t blockSizeInByte) {
+    initialize(blockSizeInByte);
+  }
+  ~StackAllocator() { release(); }
 
-  // request n bytes of memory
-  void *allocate(const size_t sizeInByte) {
+  // request n bytes of memory, alignment must be a power of two
+  void *allocate(const size_t sizeInByte, const size_t alignment = 1) {
     assert(isAllocatorValid());
-    auto basePtr = m_SP;
-    m_SP += sizeInByte;
+    assert((alignment & (alignment - 1)) == 0);
+    char *basePtr = alignUp(m_SP, alignment);
+    if (basePtr + sizeInByte > m_current->end) {
+      moveToNextBlock(sizeInByte, alignment);
+      basePtr = alignUp(m_SP, alignment);
+    }
+    m_SP = basePtr + sizeInByte;
     assert(isAllocatorValid());
     return basePtr;
   }
 
-  inline void reset() { m_SP = m_start; };
+  // constructs a T in the stack, nobody is going to call the destructor so
+  // only types that don't need one are allowed
+  template <typename T, typename... Args> T *create(Args &&...args) {
+    static_assert(std::is_trivially_destructible<T>::value,
+                  "stack allocated types are never destructed");
+    void *memory = allocate(sizeof(T), alignof(T));
+    return new (memory) T{std::forward<Args>(args)...};
+  }
 
-  // free bits from the top of the stack
+  // free bits from the top of the stack, can't go past the start of the
+  // current block, prefer markers
   void *free(const size_t sizeByte) {
     assert(isAllocatorValid());
+    assert(static_cast<size_t>(m_SP - m_current->start) >= sizeByte);
     m_SP -= sizeByte;
     assert(isAllocatorValid());
     return m_SP;
   };
 
-  void initialize(const size_t sizeInByte) {
-    assert(m_start == nullptr);
-    assert(m_end == nullptr);
-    m_start = new char[sizeInByte];
-    m_SP = m_start;
-    m_end = m_start + sizeInByte;
+  [[nodiscard]] Marker getMarker() const { return {m_current, m_SP}; }
+
+  void rewind(const Marker &marker) {
+    assert(marker.block != nullptr);
+    assert(marker.stackPtr >= marker.block->start);
+    assert(marker.stackPtr <= marker.block->end);
+    m_current = marker.block;
+    m_SP = marker.stackPtr;
     assert(isAllocatorValid());
+  }
+
+  // back to the start of the first block, the chained blocks are kept
+  inline void reset() {
+    m_current = &m_first;
+    m_SP = m_first.start;
+  };
+
+  // frees every block, the allocator needs to be initialized again
+  void release() {
+    Block *block = m_first.next;
+    while (block != nullptr) {
+      Block *next = block->next;
+      ::free(block);
+      block = next;
+    }
+    if (m_first.owned) {
+      delete[] m_first.start;
+    }
+    m_first = Block{};
+    m_current = nullptr;
+    m_SP = nullptr;
+    m_blockCount = 0;
+    m_bytesReserved = 0;
+  }
+
+  // size of the first block, is also the size of the chained ones unless a
+  // bigger allocation needs more
+  void initialize(const size_t sizeInByte) {
+    assert(m_first.start == nullptr);
+    assert(sizeInByte != 0);
+    setFirstBlock(new char[sizeInByte], sizeInByte, true);
   };
 
   // this function  won't allocate anything but will get initialized
-  // from a start and end and manage that memory, won't own it
+  // from a start and end and manage that memory, won't own it. If it
+  // runs out, the chained blocks are allocated and owned as usual
   void setMemoryStartEnd(void *start, void *end) {
     assert(start != nullptr);
     assert(end != nullptr);
-    assert(m_start == nullptr);
-    assert(m_end == nullptr);
+    assert(m_first.start == nullptr);
     assert((static_cast<char *>(end) > static_cast<char *>(start)));
 
-    m_start = static_cast<char *>(start);
-    m_end = static_cast<char *>(end);
-    m_SP = m_start;
-
-    assert(isAllocatorValid());
+    setFirstBlock(static_cast<char *>(start),
+                  static_cast<char *>(end) - static_cast<char *>(start), false);
   };
 
+  // blocks before the current one count as full
+  [[nodiscard]] size_t getBytesUsed() const {
+    if (m_current == nullptr) {
+      return 0;
+    }
+    size_t used = m_SP - m_current->start;
+    for (const Block *block = &m_first; block != m_current;
+         block = block->next) {
+      used += block->end - block->start;
+    }
+    return used;
+  }
+  [[nodiscard]] size_t getBytesReserved() const { return m_bytesReserved; }
+  [[nodiscard]] uint32_t getBlockCount() const { return m_blockCount; }
+
   [[nodiscard]] float getUsedMemoryPercentage() const {
     assert(isAllocatorValid());
-    return (static_cast<float>(m_SP - m_start) /
-            static_cast<float>(m_end - m_start));
+    return static_cast<float>(getBytesUsed()) /
+           static_cast<float>(m_bytesReserved);
   };
 
-  [[nodiscard]] void *getStartPtr() const { return m_start; }
+  // start is the first block, stack and end pointers are in the current one
+  [[nodiscard]] void *getStartPtr() const { return m_first.start; }
   [[nodiscard]] void *getStackPtr() const { return m_SP; }
-  [[nodiscard]] void *getEndPtr() const { return m_end; }
+  [[nodiscard]] void *getEndPtr() const {
+    return m_current != nullptr ? m_current->end : nullptr;
+  }
 
   // deleted copy constructor and assignment operator
   StackAllocator(StackAllocator const &) = delete;
   StackAllocator &operator=(StackAllocator const &) = delete;
 
  private:
+  // the first block is a member so it can wrap memory we don't own, the
+  // chained ones have the memory right after the header
+  struct Block {
+    Block *next = nullptr;
+    char *start = nullptr;
+    char *end = nullptr;
+    bool owned = false;
+  };
+
+  static char *alignUp(char *ptr, const size_t alignment) {
+    const auto address = reinterpret_cast<uintptr_t>(ptr);
+    return ptr + (((address + alignment - 1) & ~(alignment - 1)) - address);
+  }
+
+  void setFirstBlock(char *start, const size_t sizeInByte, const bool owned) {
+    m_first.start = start;
+    m_first.end = start + sizeInByte;
+    m_first.owned = owned;
+    m_blockSize = sizeInByte;
+    m_blockCount = 1;
+    m_bytesReserved = sizeInByte;
+    reset();
+    assert(isAllocatorValid());
+  }
+
+  void moveToNextBlock(const size_t sizeInByte, const size_t alignment) {
+    const size_t needed = sizeInByte + alignment - 1;
+    Block *next = m_current->next;
+    if (next == nullptr ||
+        static_cast<size_t>(next->end - next->start) < needed) {
+      // either we never got this far or the old block is too small for
+      // this request, a new block goes in between
+      const size_t size = needed > m_blockSize ? needed : m_blockSize;
+      auto *block = static_cast<Block *>(malloc(sizeof(Block) + size));
+      assert(block != nullptr);
+      block->next = next;
+      block->start = reinterpret_cast<char *>(block + 1);
+      block->end = block->start + size;
+      block->owned = true;
+      m_current->next = block;
+      next = block;
+      ++m_blockCount;
+      m_bytesReserved += size;
+    }
+    m_current = next;
+    m_SP = next->start;
+  }
+
   [[nodiscard]] bool isAllocatorValid() const {
-    assert(m_start != nullptr);
-    assert(m_end != nullptr);
+    assert(m_current != nullptr);
+    assert(m_current->start != nullptr);
     assert(m_SP != nullptr);
-    assert((static_cast<char *>(m_end) > static_cast<char *>(m_start)));
-    assert(m_SP < m_end);
-    assert(m_SP >= m_start);
+    assert(m_current->end > m_current->start);
+    assert(m_SP <= m_current->end);
+    assert(m_SP >= m_current->start);
     return true;
   }
 
  private:
-  // member pointers
-  char *m_SP{nullptr};
-  char *m_start{nullptr};
-  char *m_end{nullptr};
+  Block m_first;
+  Block *m_current = nullptr;
+  char *m_SP = nullptr;
+  size_t m_blockSize = DEFAULT_BLOCK_SIZE;
+  size_t m_bytesReserved = 0;
+  uint32_t m_blockCount = 0;
 };
 
 }  // namespace binder::memory
@@ -0,0 +1,124 @@
+#pragma once
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace binder::memory {
+
+// Bump allocator for strings that all go away together, like the keys of a
+// map. Chars are copied in big chunks one after the other, there is no way
+// to free a single string, the whole arena is reset or released at once.
+// Strings too big for a chunk get a chunk of their own.
+class StringArena final {
+public:
+  static constexpr uint32_t DEFAULT_CHUNK_SIZE = 16 * 1024;
+
+  explicit StringArena(const uint32_t chunkSize = DEFAULT_CHUNK_SIZE)
+      : m_chunkSize(chunkSize) {}
+  ~StringArena() { release(); }
+
+  // copies length chars and adds the null terminator
+  const char *copy(const char *chars, const uint32_t length) {
+    char *memory = allocate(length + 1);
+    memcpy(memory, chars, length);
+    memory[length] = '\0';
+    return memory;
+  }
+
+  char *allocate(const uint32_t sizeInByte) {
+    m_bytesUsed += sizeInByte;
+    if (sizeInByte > m_chunkSize / 4) {
+      // big strings would waste most of the chunk, they get their own, put
+      // behind the current one so we keep bumping in the current one
+      Chunk *chunk = allocateChunk(sizeInByte);
+      chunk->used = sizeInByte;
+      if (m_chunks == nullptr) {
+        m_chunks = chunk;
+      } else {
+        chunk->next = m_chunks->next;
+        m_chunks->next = chunk;
+      }
+      return chunk->data();
+    }
+
+    if (m_chunks == nullptr || m_chunks->used + sizeInByte > m_chunks->size) {
+      Chunk *chunk = allocateChunk(m_chunkSize);
+      chunk->next = m_chunks;
+      m_chunks = chunk;
+    }
+    char *memory = m_chunks->data() + m_chunks->used;
+    m_chunks->used += sizeInByte;
+    return memory;
+  }
+
+  // forgets every string but keeps the most recent chunk around for the
+  // next round, the other chunks are freed
+  void reset() {
+    if (m_chunks == nullptr) {
+      return;
+    }
+    Chunk *keep = m_chunks;
+    freeChunks(keep->next);
+    keep->next = nullptr;
+    keep->used = 0;
+    m_chunkCount = 1;
+    m_bytesReserved = keep->size;
+    m_bytesUsed = 0;
+  }
+
+  // gives all the memory back
+  void release() {
+    freeChunks(m_chunks);
+    m_chunks = nullptr;
+    m_chunkCount = 0;
+    m_bytesReserved = 0;
+    m_bytesUsed = 0;
+  }
+
+  // bytes handed out, null terminators included
+  [[nodiscard]] uint64_t getBytesUsed() const { return m_bytesUsed; }
+  [[nodiscard]] uint64_t getBytesReserved() const { return m_bytesReserved; }
+  [[nodiscard]] uint32_t getChunkCount() const { return m_chunkCount; }
+
+  // deleted functions
+  StringArena(const StringArena &) = delete;
+  StringArena &operator=(const StringArena &) = delete;
+
+private:
+  // the chars follow the header in the same allocation
+  struct Chunk {
+    Chunk *next;
+    uint32_t size;
+    uint32_t used;
+    char *data() { return reinterpret_cast<char *>(this + 1); }
+  };
+
+  Chunk *allocateChunk(const uint32_t size) {
+    auto *chunk = static_cast<Chunk *>(malloc(sizeof(Chunk) + size));
+    assert(chunk != nullptr);
+    chunk->next = nullptr;
+    chunk->size = size;
+    chunk->used = 0;
+    ++m_chunkCount;
+    m_bytesReserved += size;
+    return chunk;
+  }
+
+  static void freeChunks(Chunk *chunk) {
+    while (chunk != nullptr) {
+      Chunk *next = chunk->next;
+      free(chunk);
+      chunk = next;
+    }
+  }
+
+private:
+  Chunk *m_chunks = nullptr;
+  uint32_t m_chunkSize;
+  uint32_t m_chunkCount = 0;
+  uint64_t m_bytesReserved = 0;
+  uint64_t m_bytesUsed = 0;
+};
+
+} // namespace binder::memory
@@ -9,76 +9,56 @@ namespace binder::memory {
 template <typename VALUE> class HashMap<const char *, VALUE, hashString32> {
 public:
   // TODO add use of engine allocator, not only heap allocations
-  explicit HashMap(const uint32_t bins) : m_bins(bins) {
-    m_keys = new const char *[m_bins];
-    m_values = new VALUE[m_bins];
-    const int count = ((m_bins * BIN_FLAGS_SIZE) / (8 * sizeof(uint32_t))) + 1;
-    m_metadata = new uint32_t[count];
-    // 85 is 01010101 in binary this means we fill 4 bins with the value of 1,
-    // meaning free
-    memset(m_keys, 0, m_bins * sizeof(char *));
-    memset(m_metadata, 85, count * sizeof(uint32_t));
+  explicit HashMap(const uint32_t bins,
+                   const float maxLoadFactor = HASHMAP_DEFAULT_MAX_LOAD_FACTOR)
+      : m_control(maxLoadFactor) {
+    allocateBins(HashMapControl::binCountFor(bins));
   }
 
   ~HashMap() {
+    freeKeys();
     delete[] m_keys;
+    delete[] m_hashes;
     delete[] m_values;
-    delete[] m_metadata;
   }
   bool insert(const char *key, VALUE value) {
-    const uint32_t computedHash = hashString32(key);
-
-    // modding wit the bin count
-    uint32_t bin = computedHash % m_bins;
-    uint32_t meta = getMetadata(bin);
-    if ((m_keys[bin] != nullptr && strcmp(m_keys[bin], key) == 0) &
-        (meta == static_cast<uint32_t>(BIN_FLAGS::USED))) {
+    const auto keyLen = static_cast<uint32_t>(strlen(key));
+    return insert(key, keyLen, hashString32(key, keyLen), value);
+  }
+  // the key does not need to be null terminated. The hash is usually the
+  // hashString32 of the keyLen chars, callers that already have it avoid
+  // hashing the string again. A map can use a different hash function as
+  // long as every access to it passes the hash explicitly, the map stores
+  // the hashes and never recomputes them, not even when it grows
+  bool insert(const char *key, const uint32_t keyLen, const uint32_t hash,
+              VALUE value) {
+    uint32_t bin = 0;
+    if (getBin(key, keyLen, nullptr, 0, hash, bin)) {
       // key exists we just override the value
       m_values[bin] = value;
       return true;
     }
 
-    const uint32_t startBin = bin;
-    bool free = canWriteToBin(meta);
-    while (!free) {
-      ++bin;
-      bin = bin % m_bins; // wrap around the bins count
-      meta = getMetadata(bin);
-      free = canWriteToBin(meta);
-      if (bin == startBin) {
-        return false;
-      }
+    if (m_control.isFull()) {
+      rehash();
     }
+
     // NOTE this should use a pool for allocation, as it did in the
     // engine might need some work
     // const char *newKey = globals::STRING_POOL->allocatePersistent(key);
 
     // new allocation
-    const auto length = static_cast<uint32_t>(strlen(key) + 1);
-    void *memory = new char[length];
-    memcpy(memory, key, length);
-    const char *newKey = reinterpret_cast<char *>(memory);
-    writeToBin(bin, newKey, value);
-    setMetadata(bin, BIN_FLAGS::USED);
-
+    auto *newKey = new char[keyLen + 1];
+    memcpy(newKey, key, keyLen);
+    newKey[keyLen] = '\0';
+    writeToBin(m_control.findWritableBin(hash), newKey, hash, value);
     return true;
   }
 
   [[nodiscard]] bool containsKey(const char *key) const {
-
     uint32_t bin = 0;
     const auto keyLen = static_cast<const uint32_t>(strlen(key));
-    const bool isKeyFound = getBin(key,keyLen, bin);
-    const uint32_t meta = getMetadata(bin);
-    return isKeyFound &
-           (m_keys[bin] != nullptr &&
-            strcmp(m_keys[bin], key) == 0) // does the key match?
-           &
-           (meta == static_cast<uint32_t>(
-                        BIN_FLAGS::USED)); // is the bin actually used, we dont
-                                           // delete anything so if they key is
-                                           // deleted key value might still
-                                           // match but metadata is set to free
+    return getBin(key, keyLen, bin);
   }
 
   inline bool get(const char *key, VALUE &value) const {
@@ -94,39 +74,59 @@ public:
     value = m_values[bin];
     return result;
   }
+  inline bool get(const char *key, const uint32_t keyLen, const uint32_t hash,
+                  VALUE &value) const {
+    uint32_t bin = 0;
+    const bool result = getBin(key, keyLen, nullptr, 0, hash, bin);
+    value = m_values[bin];
+    return result;
+  }
+  // looks for the key made of prefix followed by suffix, without having to
+  // put the two together first, the hash has to be the one of the whole key
+  inline bool get(const char *prefix, const uint32_t prefixLen,
+                  const char *suffix, const uint32_t suffixLen,
+                  const uint32_t hash, VALUE &value) const {
+    uint32_t bin = 0;
+    const bool result = getBin(prefix, prefixLen, suffix, suffixLen, hash, bin);
+    value = m_values[bin];
+    return result;
+  }
 
   inline bool remove(const char *key) {
+    const auto keyLen = static_cast<uint32_t>(strlen(key));
+    return remove(key, keyLen, hashString32(key, keyLen));
+  }
+  inline bool remove(const char *key, const uint32_t keyLen,
+                     const uint32_t hash) {
     uint32_t bin = 0;
-    uint32_t keyLen = strlen(key);
-    const bool result = getBin(key,keyLen, bin);
-    const uint32_t meta = getMetadata(bin);
-    assert(meta == static_cast<uint32_t>(BIN_FLAGS::USED));
+    const bool result = getBin(key, keyLen, nullptr, 0, hash, bin);
     if (result) {
-      setMetadata(bin, BIN_FLAGS::DELETED);
       // NOTE this should use a pool globals::STRING_POOL->free(m_keys[bin]);
       delete[] m_keys[bin];
       m_keys[bin] = nullptr;
-      --m_usedBins;
+      m_control.markRemoved(bin);
     }
     return result;
   }
 
-  [[nodiscard]] uint32_t getUsedBins() const { return m_usedBins; }
-  inline uint32_t binCount() const { return m_bins; }
+  [[nodiscard]] uint32_t getUsedBins() const { return m_control.getUsedBins(); }
+  [[nodiscard]] uint32_t getDeletedBins() const {
+    return m_control.getDeletedBins();
+  }
+  inline uint32_t binCount() const { return m_control.getBins(); }
   inline bool isBinUsed(const uint32_t bin) const {
-    assert(bin < m_bins);
-    uint32_t meta = getMetadata(bin);
-    return meta == static_cast<uint32_t>(BIN_FLAGS::USED);
+    assert(bin < binCount());
+    return m_control.isBinUsed(bin);
   }
 
   const char *getKeyAtBin(const uint32_t bin) const {
     // no check done whether the bin is used or not, up to you kid
-    assert(bin < m_bins);
+    assert(bin < binCount());
     return m_keys[bin];
   }
   VALUE getValueAtBin(uint32_t bin) {
     // no check done whether the bin is used or not, up to you kid
-    assert(bin < m_bins);
+    assert(bin < binCount());
     return m_values[bin];
   }
 
@@ -135,90 +135,101 @@ public:
   HashMap &operator=(const HashMap &) = delete;
 
   void clear() {
-    // iterating all the bins making sure to set them as free
-    for (uint32_t i = 0; i < m_bins; ++i) {
-      m_keys[i] = nullptr;
-      setMetadata(i, BIN_FLAGS::FREE);
-    }
-    // clearing the used bins counter
-    m_usedBins = 0;
+    // the keys are our own copies, they go away with the bins
+    freeKeys();
+    m_control.clear();
   }
 
 private:
-  enum class BIN_FLAGS { NONE = 0, FREE = 1, DELETED = 2, USED = 3 };
-
-  bool getBin(const char *key, uint32_t &bin) const {
-    uint32_t len=  strlen(key);
-    return getBin(key,len,bin);
-  }
-  bool getBin(const char *key,uint32_t keyLen, uint32_t &bin) const {
-    const uint32_t computedHash = hashString32(key,keyLen);
-    bin = computedHash % m_bins;
-    const uint32_t startBin = bin;
-
-    bool go = true;
-    bool status = true;
-    while (go) {
-      const uint32_t meta = getMetadata(bin);
-      const bool isKeyTheSame =
-          m_keys[bin] != nullptr && strncmp(key, m_keys[bin],keyLen) == 0;
-      const bool isBinUsed = meta == static_cast<uint32_t>(BIN_FLAGS::USED);
-      if (isKeyTheSame & isBinUsed) {
-        break;
+  void freeKeys() {
+    for (uint32_t i = 0; i < binCount(); ++i) {
+      if (m_control.isBinUsed(i)) {
+        delete[] m_keys[i];
       }
+      m_keys[i] = nullptr;
+    }
+  }
 
-      ++bin;
-      bin = bin % m_bins; // wrap around the bins count
-      if ((bin == startBin) | !isBinUsed) {
-        go = false;
-        status = false;
+  void allocateBins(const uint32_t bins) {
+    m_control.allocate(bins);
+    m_keys = new const char *[bins];
+    m_hashes = new uint32_t[bins];
+    m_values = new VALUE[bins];
+    memset(m_keys, 0, bins * sizeof(char *));
+  }
+
+  // stop the world, every live key is moved to a fresh table, the keys are
+  // not copied again and the stored hashes are reused
+  void rehash() {
+    const uint32_t oldBins = binCount();
+    const uint32_t newBins = m_control.rehashBinCount();
+    const char **oldKeys = m_keys;
+    uint32_t *oldHashes = m_hashes;
+    VALUE *oldValues = m_values;
+    int8_t *oldControl = m_control.release();
+
+    allocateBins(newBins);
+    for (uint32_t i = 0; i < oldBins; ++i) {
+      if (HashMapControl::isUsedControl(oldControl[i])) {
+        writeToBin(m_control.findWritableBin(oldHashes[i]), oldKeys[i],
+                   oldHashes[i], oldValues[i]);
       }
     }
-    return status;
-  }
 
-  inline bool canWriteToBin(const uint32_t metadata) {
-    return (metadata == static_cast<uint32_t>(BIN_FLAGS::FREE)) |
-           (metadata == static_cast<uint32_t>(BIN_FLAGS::DELETED));
+    delete[] oldKeys;
+    delete[] oldHashes;
+    delete[] oldValues;
+    delete[] oldControl;
   }
 
-  inline void writeToBin(uint32_t bin, const char *key, VALUE value) {
+  bool getBin(const char *key, uint32_t &bin) const {
+    uint32_t len=  strlen(key);
+    return getBin(key,len,bin);
+  }
+  bool getBin(const char *key,uint32_t keyLen, uint32_t &bin) const {
+    return getBin(key, keyLen, nullptr, 0, hashString32(key, keyLen), bin);
+  }
+  bool getBin(const char *key, const uint32_t keyLen, const char *suffix,
+              const uint32_t suffixLen, const uint32_t hash,
+              uint32_t &bin) const {
+    // the control byte only holds 7 bits of the hash, the stored hash saves
+    // most of the string compares left
+    return m_control.find(
+        hash,
+        [&](const uint32_t candidate) {
+          return (m_hashes[candidate] == hash) &&
+                 isKeyInBin(candidate, key, keyLen, suffix, suffixLen);
+        },
+        bin);
+  }
+
+  // the key we get passed might not be null terminated, so we compare the
+  // first keyLen chars and make sure the stored key ends there, otherwise
+  // "ab" would match "abc". Same for a key split in two parts, the suffix
+  // can be empty
+  inline bool isKeyInBin(const uint32_t bin, const char *key,
+                         const uint32_t keyLen, const char *suffix,
+                         const uint32_t suffixLen) const {
+    return m_keys[bin] != nullptr && strncmp(key, m_keys[bin], keyLen) == 0 &&
+           (suffixLen == 0 ||
+            strncmp(suffix, m_keys[bin] + keyLen, suffixLen) == 0) &&
+           m_keys[bin][keyLen + suffixLen] == '\0';
+  }
+
+  inline void writeToBin(uint32_t bin, const char *key, const uint32_t hash,
+                         VALUE value) {
     m_keys[bin] = key;
+    m_hashes[bin] = hash;
     m_values[bin] = value;
-    ++m_usedBins;
-  }
-
-  inline void setMetadata(const uint32_t bin, BIN_FLAGS flag) {
-    const uint32_t bit = bin * BIN_FLAGS_SIZE;
-    const uint32_t bit32 = bit / 32;
-    const uint32_t reminder32 = bit % 32;
-    const auto flag32 = static_cast<uint32_t>(flag);
-    // first we want to clear the value
-    const uint32_t mask = (~0) & ~(3 << reminder32);
-    m_metadata[bit32] &= mask;
-    // now set the value
-    m_metadata[bit32] |= flag32 << reminder32;
-  }
-
-  inline uint32_t getMetadata(const uint32_t bin) const {
-    const uint32_t bit = bin * BIN_FLAGS_SIZE;
-    const uint32_t bit32 = bit / 32;
-    const uint32_t reminder32 = bit % 32;
-    const uint32_t mask = 3 << reminder32;
-
-    const uint32_t binMetadata = (m_metadata[bit32] & mask) >> reminder32;
-    return binMetadata;
+    m_control.markUsed(bin, hash);
   }
 
 private:
-  // this is the number of bits required for bin
-  static constexpr uint32_t BIN_FLAGS_SIZE = 2;
-  static constexpr uint32_t BIN_FLAGS_MASK = 3; // first two bit sets
-
+  HashMapControl m_control;
   const char **m_keys;
+  // the hash of every used bin, compared before the keys and reused when
+  // the table grows
+  uint32_t *m_hashes;
   VALUE *m_values;
-  uint32_t *m_metadata;
-  uint32_t m_bins;
-  uint32_t m_usedBins = 0;
 };
 } // namespace binder::memory
@@ -1,9 +1,12 @@
 #pragma once
 
-#include "binder/memory/stringHashMap.h"
+#include "binder/memory/stringMap.h"
 
 namespace binder::memory {
 
+// one copy of every string, interned strings can be compared by pointer.
+// The copies live in the arena of the map, there is no freeing a single
+// string, they all go away together with reset, release or the intern
 class StringIntern {
  public:
   StringIntern(int bucketCount) : m_values(bucketCount) {}
@@ -13,27 +16,51 @@ class StringIntern {
     return intern(string, len, copy);
   }
   const char *intern(const char *string, int len, bool copy = true) {
-    const char *toReturn;
-
-    bool result = m_values.get(string, len, toReturn);
-    if (result) {
+    return intern(StringKey(string, static_cast<uint32_t>(len)), copy);
+  }
+  // same as above for callers that already hashed the string, the hash has
+  // to be hashString32 of the len chars
+  const char *intern(const char *string, int len, uint32_t hash, bool copy) {
+    return intern(StringKey(string, static_cast<uint32_t>(len), hash), copy);
+  }
+  // without copy the given chars become the interned string, they have to
+  // be null terminated and outlive the intern
+  const char *intern(const StringKey &key, bool copy = true) {
+    bool unused = false;
+    const StringKey *stored = nullptr;
+    if (m_values.get(key, unused, stored)) {
       // string is present we intern it
-      return toReturn;
-    } else {
-      // we need to copy the string and insert it
-      char *toInsert = (char *)string;
-
-      if (copy) {
-        toInsert = new char[len + 1];
-        memcpy(toInsert, string, len);
-        toInsert[len] = '\0';
-      }
-      m_values.insert(toInsert, toInsert);
-      return toInsert;
+      return stored->chars;
+    }
+    if (copy) {
+      return m_values.insert(key, true).chars;
     }
+    m_values.insertView(key, true);
+    return key.chars;
+  }
+
+  // forgets every string, any pointer handed out before is dangling after
+  // this. reset keeps an arena chunk around for the next round, release
+  // gives all the string memory back
+  void reset() { m_values.clear(); }
+  void release() { m_values.release(); }
+
+  [[nodiscard]] uint32_t getStringCount() const {
+    return m_values.getUsedBins();
+  }
+  // chars copied in the arena, null terminators included, not copied
+  // strings don't count
+  [[nodiscard]] uint64_t getBytesUsed() const {
+    return m_values.getArena().getBytesUsed();
+  }
+  [[nodiscard]] uint64_t getBytesReserved() const {
+    return m_values.getArena().getBytesReserved();
+  }
+  [[nodiscard]] uint32_t getChunkCount() const {
+    return m_values.getArena().getChunkCount();
   }
 
  private:
-  memory::HashMap<const char *, const char *, hashString32> m_values;
+  StringMap<bool> m_values;
 };
 }  // namespace binder::memory
@@ -0,0 +1,221 @@
+#pragma once
+#include "binder/memory/hashMap.h"
+#include "binder/memory/hashing.h"
+#include "binder/memory/stringArena.h"
+#include <stdint.h>
+#include <string.h>
+
+namespace binder::memory {
+
+// a string as the maps see it, the chars don't need to be null terminated.
+// The hash is computed once when the key is made and travels with it
+struct StringKey {
+  const char *chars;
+  uint32_t length;
+  uint32_t hash;
+
+  StringKey() = default;
+  StringKey(const char *keyChars, const uint32_t keyLength)
+      : chars(keyChars), length(keyLength),
+        hash(hashString32(keyChars, keyLength)) {}
+  StringKey(const char *keyChars, const uint32_t keyLength,
+            const uint32_t keyHash)
+      : chars(keyChars), length(keyLength), hash(keyHash) {}
+  // null terminated chars
+  explicit StringKey(const char *keyChars)
+      : StringKey(keyChars, static_cast<uint32_t>(strlen(keyChars))) {}
+};
+
+// map keyed by StringKey, same control byte probing as HashMap. Keys are
+// compared by length, then hash, and only then by the chars, nothing
+// needs a null terminator. insert copies the chars in the arena owned by
+// the map, so they live as long as the map and go away in bulk. insertView
+// keeps the caller chars instead, for keys that already live somewhere
+// stable (the vm strings have their chars inline), the caller has to
+// remove the key before the chars go away
+template <typename VALUE> class StringMap {
+public:
+  explicit StringMap(const uint32_t bins,
+                     const float maxLoadFactor = HASHMAP_DEFAULT_MAX_LOAD_FACTOR)
+      : m_control(maxLoadFactor) {
+    allocateBins(HashMapControl::binCountFor(bins));
+  }
+
+  ~StringMap() {
+    delete[] m_keys;
+    delete[] m_values;
+  }
+
+  // returns the stored key, its chars are the arena copy, null terminated
+  const StringKey &insert(const StringKey &key, VALUE value) {
+    uint32_t bin = 0;
+    if (getBin(key, bin)) {
+      // key exists we just override the value
+      m_values[bin] = value;
+      return m_keys[bin];
+    }
+    const StringKey stored(m_arena.copy(key.chars, key.length), key.length,
+                           key.hash);
+    // addKey might rehash, m_keys has to be read after it
+    bin = addKey(stored, value);
+    return m_keys[bin];
+  }
+
+  // the map keeps pointing at the given chars
+  void insertView(const StringKey &key, VALUE value) {
+    uint32_t bin = 0;
+    if (getBin(key, bin)) {
+      m_values[bin] = value;
+      return;
+    }
+    addKey(key, value);
+  }
+
+  [[nodiscard]] bool containsKey(const StringKey &key) const {
+    uint32_t bin = 0;
+    return getBin(key, bin);
+  }
+
+  inline bool get(const StringKey &key, VALUE &value) const {
+    uint32_t bin = 0;
+    const bool result = getBin(key, bin);
+    value = m_values[bin];
+    return result;
+  }
+  // same, giving back the stored key as well
+  inline bool get(const StringKey &key, VALUE &value,
+                  const StringKey *&storedKey) const {
+    uint32_t bin = 0;
+    const bool result = getBin(key, bin);
+    value = m_values[bin];
+    storedKey = &m_keys[bin];
+    return result;
+  }
+  // looks for the key made of prefix followed by suffix, without having to
+  // put the two together first, the hash has to be the one of the whole key
+  inline bool get(const char *prefix, const uint32_t prefixLength,
+                  const char *suffix, const uint32_t suffixLength,
+                  const uint32_t hash, VALUE &value) const {
+    const uint32_t length = prefixLength + suffixLength;
+    uint32_t bin = 0;
+    const bool result = m_control.find(
+        hash,
+        [&](const uint32_t candidate) {
+          const StringKey &stored = m_keys[candidate];
+          return (stored.length == length) && (stored.hash == hash) &&
+                 memcmp(stored.chars, prefix, prefixLength) == 0 &&
+                 memcmp(stored.chars + prefixLength, suffix, suffixLength) ==
+                     0;
+        },
+        bin);
+    value = m_values[bin];
+    return result;
+  }
+
+  // the arena copy of the chars is only given back by clear or when the
+  // map goes away
+  inline bool remove(const StringKey &key) {
+    uint32_t bin = 0;
+    const bool result = getBin(key, bin);
+    if (result) {
+      m_control.markRemoved(bin);
+    }
+    return result;
+  }
+
+  // drops every key and the arena with them, the first arena chunk is kept
+  void clear() {
+    m_control.clear();
+    m_arena.reset();
+  }
+  // same as clear but the arena gives all its memory back
+  void release() {
+    m_control.clear();
+    m_arena.release();
+  }
+
+  [[nodiscard]] uint32_t getUsedBins() const { return m_control.getUsedBins(); }
+  [[nodiscard]] uint32_t getDeletedBins() const {
+    return m_control.getDeletedBins();
+  }
+  inline uint32_t binCount() const { return m_control.getBins(); }
+  inline bool isBinUsed(const uint32_t bin) const {
+    assert(bin < binCount());
+    return m_control.isBinUsed(bin);
+  }
+  const StringKey &getKeyAtBin(const uint32_t bin) const {
+    // no check done whether the bin is used or not, up to you kid
+    assert(bin < binCount());
+    return m_keys[bin];
+  }
+  VALUE getValueAtBin(const uint32_t bin) const {
+    assert(bin < binCount());
+    return m_values[bin];
+  }
+  [[nodiscard]] const StringArena &getArena() const { return m_arena; }
+
+  // deleted functions
+  StringMap(const StringMap &) = delete;
+  StringMap &operator=(const StringMap &) = delete;
+
+private:
+  void allocateBins(const uint32_t bins) {
+    m_control.allocate(bins);
+    m_keys = new StringKey[bins]();
+    m_values = new VALUE[bins]();
+  }
+
+  uint32_t addKey(const StringKey &key, VALUE value) {
+    if (m_control.isFull()) {
+      rehash();
+    }
+    const uint32_t bin = m_control.findWritableBin(key.hash);
+    m_keys[bin] = key;
+    m_values[bin] = value;
+    m_control.markUsed(bin, key.hash);
+    return bin;
+  }
+
+  // stop the world, keys are moved with their hash, the chars stay where
+  // they are
+  void rehash() {
+    const uint32_t oldBins = binCount();
+    const uint32_t newBins = m_control.rehashBinCount();
+    StringKey *oldKeys = m_keys;
+    VALUE *oldValues = m_values;
+    int8_t *oldControl = m_control.release();
+
+    allocateBins(newBins);
+    for (uint32_t i = 0; i < oldBins; ++i) {
+      if (HashMapControl::isUsedControl(oldControl[i])) {
+        const uint32_t bin = m_control.findWritableBin(oldKeys[i].hash);
+        m_keys[bin] = oldKeys[i];
+        m_values[bin] = oldValues[i];
+        m_control.markUsed(bin, oldKeys[i].hash);
+      }
+    }
+
+    delete[] oldKeys;
+    delete[] oldValues;
+    delete[] oldControl;
+  }
+
+  bool getBin(const StringKey &key, uint32_t &bin) const {
+    return m_control.find(
+        key.hash,
+        [&](const uint32_t candidate) {
+          const StringKey &stored = m_keys[candidate];
+          return (stored.length == key.length) && (stored.hash == key.hash) &&
+                 memcmp(stored.chars, key.chars, key.length) == 0;
+        },
+        bin);
+  }
+
+private:
+  HashMapControl m_control;
+  StringKey *m_keys;
+  VALUE *m_values;
+  StringArena m_arena;
+};
+
+} // namespace binder::memory
@@ -4,6 +4,10 @@
 
 #include "binder/memory/threeSizesPool.h"
 
+namespace binder::log {
+class Log;
+}
+
 namespace binder::memory {
 
 enum STRING_MANIPULATION_FLAGS {
@@ -130,6 +134,10 @@ class StringPool final {
 
   const char* subString(const char* source, const uint32_t startIdx, const uint32_t endIdx, const uint8_t flags=0);
 
+  // how fragmented the pool is, long running users can log it now and then
+  ThreeSizesPool::Report getReport() const { return m_pool.getReport(); }
+  void logReport(log::Log* logger) const;
+
  private:
   enum class STRING_TYPE { CHAR = 1, WCHAR = 2 };
 
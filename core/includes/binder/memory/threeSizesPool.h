@@ -1,97 +1,59 @@
 #pragma once
+#include "binder/memory/hashMapGroup.h"
 #include <cassert>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 
 namespace binder::memory {
 
 // This is memory pool, which allows any kind of size allocation.
-// Main feature is that allocations are bucketed based on 3 sizes, small ,medium
-// large. Three different linked lists keeps track of freed allocation, when a
-// new allocation is made a check in the linked list of the right bucket is
-// made, if there is any allocation to be recycled it will be used, otherwise
-// normal allocation will be made by increasing the stack pointer, to note stack
-// pointer can never be decreased.
+// Allocations are still counted in 3 sizes, small, medium and large, but the
+// freed memory goes in segregated bins by size: bins are 8 bytes apart up to
+// 256 bytes, then every power of two is split in 4 bins. A bitmap of the non
+// empty bins finds a bin with a block big enough in constant time, within the
+// bin of the requested size we look for the best fit.
+// Every block starts with a header, free blocks also have their size at the
+// end (boundary tag), so when a block is freed it is merged with the free
+// blocks right before and right after it, the pool does not slowly turn into
+// small unusable pieces. When no free block fits, memory is taken from the
+// top of the backing block, the top pointer never goes back. When the
+// backing block is full a new one is allocated, the memory handed out never
+// moves. Each backing block has its own bins, the free list links are 32 bit
+// offsets from the start of the backing block, so a free block fits in the
+// same 16 bytes the smallest allocation takes.
 class ThreeSizesPool final {
- private:
-// flags used to mark the headers and allocations
-#define SMALL_ALLOC_TAG 1;
-#define MEDIUM_ALLOC_TAG 2;
-#define LARGE_ALLOC_TAG 4;
-
-  // This struct is the node of the linked list, enough information are
-  // stored to keep track of the current memory block and the next,
-  // the smallest allocation possible is the same size of the NextAlloc
-  // otherwise we would not be able to store the node in the pool
-  struct NextAlloc {
-    uint32_t offset : 32;  // offset from the start of the pool in byte
-    uint32_t nextOffset;   // offset from the start of the pool in byte for the
-    uint32_t previousOffset;  // offset from the start of the pool in byte for
-                              // the previous node in the linked list, 0 if null
-    bool isNode : 1;     // a bit flag setting whether the data here refers to a
-                         // node or an alloc, mostly debugging purpose
-    uint32_t size : 28;  // size of the allocation in byte
-    uint32_t allocType : 3;  // type of allocation
-  };
-
-  // helpers
-  uint32_t getAllocationTypeFromSize(const uint32_t sizeInByte) const {
-    const int isInMediumRange =
-        (sizeInByte < m_mediumSize) & (sizeInByte >= m_smallSize);
-    const int isInLargeRange = sizeInByte >= m_mediumSize;
-
-    return isInMediumRange + isInLargeRange * 2;
-  }
-
-  void *allocateNew(const uint32_t sizeInByte, uint8_t flags) {
-    uint32_t totalAllocSize = sizeInByte + sizeof(AllocHeader);
-    totalAllocSize =
-        totalAllocSize < MIN_ALLOC_SIZE ? MIN_ALLOC_SIZE : totalAllocSize;
-
-    auto *header =
-        reinterpret_cast<AllocHeader *>(m_memory + m_stackPointerOffset);
-    header->size = totalAllocSize;
-    header->isNode = false;
-    header->type = getAllocationTypeFromSize(sizeInByte);
-    header->allocFlags = flags;
-
-    ++m_allocCount[header->type];
-    m_stackPointerOffset += totalAllocSize;
-
-    return reinterpret_cast<char *>(header) + sizeof(AllocHeader);
-  }
-
-  NextAlloc *findNextFreeAllocForSize(NextAlloc *start,
-                                      const uint32_t totalAllocSize) const {
-    if (totalAllocSize <= start->size) {
-      return start;
-    }
-    NextAlloc *current = start;
-    while (current->nextOffset != 0) {
-      current = reinterpret_cast<NextAlloc *>(m_memory + current->nextOffset);
-      if (totalAllocSize < current->size) {
-        return current;
-      }
-    }
-    return nullptr;
-  }
-
  public:
   // this is an allocation description, is always going to be present, so if we
   // ask to allocate a some memory we will always allocate that memory + the
   // header. It is public because some tools, like string pool can benefit from
   // this
-
-  // This class defines a memory allocation, the data will live before the
-  // actual reserved memory for the user
   struct AllocHeader {
-    uint32_t size : 20;       // size in byte of the allocation
+    uint32_t size : 22;  // size of the whole block, header included, in units
+                         // of 4 bytes
     uint32_t allocFlags : 8;  // user defined flags for the allocation, mostly
                               // useful for tools
-    uint32_t type : 3;    // type of allocation, either SMALL , MEDIUM or LARGE
-                          // depending of the bit set
-    uint32_t isNode : 1;  // for internal use, whether the memory is a linked
-                          // list node or not, mostly used for assertions
+    uint32_t isFree : 1;        // the block is in the free bins
+    uint32_t previousFree : 1;  // the block right before is free, its size is
+                                // in the 4 bytes before this header
+  };
+
+  // what the pool looks like, to keep an eye on fragmentation
+  struct Report {
+    uint32_t backingBlockCount;
+    uint64_t reservedBytes;
+    // headers and rounding included
+    uint64_t allocatedBytes;
+    uint32_t allocationCount;
+    // memory freed and waiting in the bins
+    uint64_t freeBytes;
+    uint32_t freeBlockCount;
+    uint32_t largestFreeBlock;
+    // never used yet memory at the top of the current backing block
+    uint64_t topBytes;
+    // 0 when the free memory is a single block, close to 1 when it is split
+    // in many small pieces
+    float fragmentation;
   };
 
   explicit ThreeSizesPool(const uint32_t poolSizeInByte,
@@ -100,26 +62,29 @@ class ThreeSizesPool final {
     m_poolSizeInByte = poolSizeInByte;
     m_smallSize = smallSize;
     m_mediumSize = mediumSize;
-    m_memory = new char[m_poolSizeInByte];
-
-    m_nextAlloc[0] = nullptr;
-    m_nextAlloc[1] = nullptr;
-    m_nextAlloc[2] = nullptr;
+    addBackingBlock(poolSizeInByte);
   };
 
-  ~ThreeSizesPool() { delete m_memory; }
+  ~ThreeSizesPool() {
+    BackingBlock *backing = m_backing;
+    while (backing != nullptr) {
+      BackingBlock *next = backing->next;
+      ::free(backing);
+      backing = next;
+    }
+  }
 
   // public interface
 
   // helpers
   int allocationInPool(const void *ptr) const {
-    const int64_t delta = reinterpret_cast<const char *>(ptr) - m_memory;
-    return (delta > 0) & (delta < m_poolSizeInByte);
+    return findBackingBlock(reinterpret_cast<const char *>(ptr)) != nullptr;
   }
 
   // getters
 
-  // returns the size of the "user" allocation ,meaning without the AllocHeader
+  // returns the size of the "user" allocation ,meaning without the AllocHeader,
+  // it can be a bit more than what was asked
   uint32_t getAllocSize(void *memoryPtr) const {
     return getRawAllocSize(memoryPtr) - sizeof(AllocHeader);
   }
@@ -128,12 +93,9 @@ class ThreeSizesPool final {
   uint32_t getRawAllocSize(void *memoryPtr) const {
     char *bytePtr = reinterpret_cast<char *>(memoryPtr);
     assert(allocationInPool(bytePtr) && "allocation not in pool");
-
-    const AllocHeader *header =
-        reinterpret_cast<AllocHeader *>(bytePtr - sizeof(AllocHeader));
-    assert(header->isNode == 0 &&
-           "allocation is a linked list node not an allocation");
-    return header->size;
+    const AllocHeader *block = header(bytePtr - sizeof(AllocHeader));
+    assert(block->isFree == 0 && "allocation has already been freed");
+    return blockSize(block);
   }
 
   uint32_t getSmallAllocCount() const { return m_allocCount[0]; }
@@ -142,128 +104,446 @@ class ThreeSizesPool final {
 
   static uint32_t getMinAllocSize() { return MIN_ALLOC_SIZE; }
 
+  Report getReport() const {
+    Report report{};
+    for (const BackingBlock *backing = m_backing; backing != nullptr;
+         backing = backing->next) {
+      ++report.backingBlockCount;
+      report.reservedBytes += backing->size;
+      const uint32_t largest = backing->largestFreeBlock();
+      report.largestFreeBlock =
+          largest > report.largestFreeBlock ? largest : report.largestFreeBlock;
+    }
+    report.allocatedBytes = m_allocatedBytes;
+    report.allocationCount =
+        m_allocCount[0] + m_allocCount[1] + m_allocCount[2];
+    report.freeBytes = m_freeBytes;
+    report.freeBlockCount = m_freeBlockCount;
+    report.topBytes = m_backing->end() - m_backing->top();
+    report.fragmentation =
+        m_freeBytes == 0 ? 0.0f
+                         : 1.0f - static_cast<float>(report.largestFreeBlock) /
+                                      static_cast<float>(m_freeBytes);
+    return report;
+  }
+
   // methods
   void free(void *memoryPtr) {
     char *bytePtr = reinterpret_cast<char *>(memoryPtr);
-    assert(allocationInPool(bytePtr));
-
-    auto *header =
-        reinterpret_cast<AllocHeader *>(bytePtr - sizeof(AllocHeader));
+    BackingBlock *backing = findBackingBlock(bytePtr);
+    assert(backing != nullptr && "allocation not in pool");
+    char *start = bytePtr - sizeof(AllocHeader);
+    const AllocHeader *freed = header(start);
+    assert(freed->isFree == 0 && "double free");
 
-    assert(header->isNode == 0);
+    uint32_t size = blockSize(freed);
+    bool previousFree = freed->previousFree;
+    --m_allocCount[getAllocationTypeFromSize(size - sizeof(AllocHeader))];
+    m_allocatedBytes -= size;
 
 #if SE_DEBUG
     // tagging the memory as freed
-    memset(memoryPtr, 0xff, allocSize - sizeof(AllocHeader));
+    memset(memoryPtr, 0xff, size - sizeof(AllocHeader));
 #endif
 
-    int allocType =
-        getAllocationTypeFromSize(header->size - sizeof(AllocHeader));
-    // lets create the node to dealloc
-    NextAlloc alloc{};
-    alloc.size = header->size;
-    alloc.isNode = true;
-    alloc.allocType = 1 << allocType;
-    alloc.nextOffset = 0;
-    alloc.previousOffset = 0;
-    alloc.offset = reinterpret_cast<char *>(header) - m_memory;
-
-    // reducing alloc count
-    --m_allocCount[allocType];
-
-    // lets add to the linked list
-    if (m_nextAlloc[allocType] != nullptr) {
-      // patching offset of the next, and for the next patching offset
-      // of this to keep a doubled linked list
-      alloc.nextOffset = m_nextAlloc[allocType]->offset;
-      m_nextAlloc[allocType]->previousOffset = alloc.offset;
+    // merging with the neighbours, the size in the header is limited so a
+    // merge that would not fit is skipped, the blocks stay side by side. The
+    // top of the backing block has a header too, it is never free
+    char *next = start + size;
+    if (header(next)->isFree) {
+      const uint32_t nextSize = blockSize(header(next));
+      if (size + nextSize <= MAX_BLOCK_SIZE) {
+        removeFromBin(backing, next);
+        size += nextSize;
+      }
     }
-
-    // now that the whole header is setup we commit it to memory
-    memcpy(header, &alloc, sizeof(NextAlloc));
-
-    m_nextAlloc[allocType] = reinterpret_cast<NextAlloc *>(header);
+    if (previousFree) {
+      const uint32_t previousSize = footer(start);
+      if (size + previousSize <= MAX_BLOCK_SIZE) {
+        char *previous = start - previousSize;
+        // the block before a free block is never free, unless a merge was
+        // skipped
+        previousFree = header(previous)->previousFree;
+        removeFromBin(backing, previous);
+        start = previous;
+        size += previousSize;
+      }
+    }
+    makeFreeBlock(backing, start, size, previousFree);
   };
 
   void *allocate(const uint32_t sizeInByte, uint8_t flags = 0) {
-    assert((m_stackPointerOffset + sizeInByte) < m_poolSizeInByte);
-    // first lets find out what kind of allocation has been requested
-    uint32_t allocType = getAllocationTypeFromSize(sizeInByte);
-
-    // next we check if we have any allocation we can recycle
-    NextAlloc *currentLinkedListTip = m_nextAlloc[allocType];
-    if (currentLinkedListTip != nullptr) {
-      // ok we have something in the cache let us try see if one slot is big
-      // enough
-      const uint32_t totalAllocSize = sizeInByte + sizeof(AllocHeader);
-      NextAlloc *found =
-          findNextFreeAllocForSize(currentLinkedListTip, totalAllocSize);
-
-      // if an allocation big enough in the bucket is not found we
-      // perform a new allocation
-      if (found == nullptr) {
-        return allocateNew(sizeInByte, flags);
+    const uint32_t size = rawSizeFor(sizeInByte);
+    // the most recent backing block first, it is the one with the top
+    for (BackingBlock *backing = m_backing; backing != nullptr;
+         backing = backing->next) {
+      char *start = takeFromBins(backing, size);
+      if (start != nullptr) {
+        return finishAllocation(start, flags);
       }
+    }
+    return finishAllocation(takeFromTop(size), flags);
+  }
+
+  // grows an allocation without moving it, possible when the block is right
+  // before the top of the current backing block, or before a free block big
+  // enough. Returns false when the memory has to move, in which case nothing
+  // changed
+  bool tryExtend(void *memoryPtr, const uint32_t newSizeInByte) {
+    char *bytePtr = reinterpret_cast<char *>(memoryPtr);
+    BackingBlock *backing = findBackingBlock(bytePtr);
+    assert(backing != nullptr && "allocation not in pool");
+    char *start = bytePtr - sizeof(AllocHeader);
+    AllocHeader *block = header(start);
+    assert(block->isFree == 0);
+
+    const uint32_t size = blockSize(block);
+    const uint32_t newSize = rawSizeFor(newSizeInByte);
+    if (newSize <= size) {
+      return true;
+    }
+    if (newSize > MAX_BLOCK_SIZE) {
+      return false;
+    }
 
-      assert(found->isNode == true);
-
-      // patching linked list
-      NextAlloc *nextInList =
-          found->nextOffset != 0
-              ? reinterpret_cast<NextAlloc *>(m_memory + found->nextOffset)
-              : nullptr;
-      NextAlloc *previousInList =
-          found->previousOffset != 0
-              ? reinterpret_cast<NextAlloc *>(m_memory + found->previousOffset)
-              : nullptr;
-
-      if (previousInList != nullptr) {
-        // if we have a previous node we need to update the offsets
-        previousInList->nextOffset =
-            nextInList != nullptr ? nextInList->offset : 0;
+    const uint8_t flags = block->allocFlags;
+    const bool previousFree = block->previousFree;
+    char *next = start + size;
+    // a free block between us and the top is taken along with the top
+    if (header(next)->isFree &&
+        next + blockSize(header(next)) == backing->top() &&
+        start + newSize <= backing->end()) {
+      removeFromBin(backing, next);
+      backing->topOffset = backing->offsetOf(next);
+    }
+
+    if (next == backing->top()) {
+      if (start + newSize > backing->end()) {
+        return false;
       }
+      writeHeader(start, newSize, false, previousFree);
+      backing->topOffset = backing->offsetOf(start + newSize);
+      writeHeader(backing->top(), sizeof(AllocHeader), false, false);
+    } else {
+      const AllocHeader *nextHeader = header(next);
+      const uint32_t available = size + blockSize(nextHeader);
+      if ((nextHeader->isFree == 0) | (available < newSize)) {
+        return false;
+      }
+      removeFromBin(backing, next);
+      // might take the whole free block if what is left is too small
+      splitOrTakeAll(backing, start, newSize, available, MIN_ALLOC_SIZE);
+    }
+    block->allocFlags = flags;
+
+    // the bigger allocation might fall in a different bucket
+    const uint32_t extendedSize = blockSize(block);
+    --m_allocCount[getAllocationTypeFromSize(size - sizeof(AllocHeader))];
+    ++m_allocCount[getAllocationTypeFromSize(extendedSize -
+                                             sizeof(AllocHeader))];
+    m_allocatedBytes += extendedSize - size;
+    return true;
+  }
+
+  // deleted copy constructors and assignment operator
+  ThreeSizesPool(const ThreeSizesPool &) = delete;
+  ThreeSizesPool &operator=(const ThreeSizesPool &) = delete;
 
-      if (nextInList != nullptr) {
-        nextInList->previousOffset =
-            previousInList != nullptr ? previousInList->offset : 0;
+ private:
+  static constexpr uint32_t SMALL_BIN_LIMIT = 256;
+  static constexpr uint32_t SMALL_BIN_COUNT = SMALL_BIN_LIMIT / 8;
+  // every power of two from 256 up to the biggest block gets 4 bins
+  static constexpr uint32_t BIN_COUNT = SMALL_BIN_COUNT + (24 - 8) * 4;
+  static constexpr uint32_t BITMAP_WORDS = (BIN_COUNT + 31) / 32;
+  // how many blocks of the right bin we look at for the best fit before
+  // going for a bigger bin
+  static constexpr uint32_t BEST_FIT_SEARCH = 16;
+  // offsets are from the start of the backing block, which is its header,
+  // no block lives there
+  static constexpr uint32_t NO_BLOCK = 0;
+
+  // memory got from the system, blocks are carved from data() up to the top,
+  // the last 4 bytes are always left for the header of the top
+  struct BackingBlock {
+    BackingBlock *next;
+    uint32_t size;
+    uint32_t topOffset;
+    uint32_t bins[BIN_COUNT];
+    uint32_t binBitmap[BITMAP_WORDS];
+
+    char *base() { return reinterpret_cast<char *>(this); }
+    const char *base() const { return reinterpret_cast<const char *>(this); }
+    char *data() { return reinterpret_cast<char *>(this + 1); }
+    const char *data() const {
+      return reinterpret_cast<const char *>(this + 1);
+    }
+    char *top() { return base() + topOffset; }
+    const char *top() const { return base() + topOffset; }
+    const char *end() const { return data() + size - sizeof(AllocHeader); }
+    char *at(const uint32_t offset) { return base() + offset; }
+    uint32_t offsetOf(const char *start) const {
+      return static_cast<uint32_t>(start - base());
+    }
+
+    uint32_t largestFreeBlock() const;
+  };
+
+  // a free block is header, next and previous free block in the same bin,
+  // ... , size of the block
+  static constexpr uint32_t NEXT_OFFSET = sizeof(AllocHeader);
+  static constexpr uint32_t PREVIOUS_OFFSET = NEXT_OFFSET + sizeof(uint32_t);
+  static constexpr uint32_t MIN_ALLOC_SIZE =
+      PREVIOUS_OFFSET + sizeof(uint32_t) + sizeof(uint32_t);
+  static constexpr uint32_t MAX_BLOCK_SIZE = ((1u << 22) - 1) * 4;
+
+  // helpers
+  uint32_t getAllocationTypeFromSize(const uint32_t sizeInByte) const {
+    const int isInMediumRange =
+        (sizeInByte < m_mediumSize) & (sizeInByte >= m_smallSize);
+    const int isInLargeRange = sizeInByte >= m_mediumSize;
+
+    return isInMediumRange + isInLargeRange * 2;
+  }
+
+  static uint32_t rawSizeFor(const uint32_t sizeInByte) {
+    uint32_t size = sizeInByte + sizeof(AllocHeader);
+    size = size < MIN_ALLOC_SIZE ? MIN_ALLOC_SIZE : size;
+    size = (size + 3) & ~3u;
+    assert(size <= MAX_BLOCK_SIZE && "allocation too big for the pool");
+    return size;
+  }
+
+  static uint32_t binFor(const uint32_t size) {
+    if (size < SMALL_BIN_LIMIT) {
+      return size / 8;
+    }
+    const uint32_t log2 = 31 - countLeadingZeros(size);
+    const uint32_t subBin = (size >> (log2 - 2)) & 3;
+    return SMALL_BIN_COUNT + (log2 - 8) * 4 + subBin;
+  }
+
+  static AllocHeader *header(char *start) {
+    return reinterpret_cast<AllocHeader *>(start);
+  }
+  static const AllocHeader *header(const char *start) {
+    return reinterpret_cast<const AllocHeader *>(start);
+  }
+  static uint32_t blockSize(const AllocHeader *block) {
+    return block->size * 4;
+  }
+  // size of the free block ending right before start
+  static uint32_t footer(const char *start) {
+    return *reinterpret_cast<const uint32_t *>(start - sizeof(uint32_t));
+  }
+  static uint32_t &nextFree(char *start) {
+    return *reinterpret_cast<uint32_t *>(start + NEXT_OFFSET);
+  }
+  static uint32_t nextFree(const char *start) {
+    return *reinterpret_cast<const uint32_t *>(start + NEXT_OFFSET);
+  }
+  static uint32_t &previousFree(char *start) {
+    return *reinterpret_cast<uint32_t *>(start + PREVIOUS_OFFSET);
+  }
+
+  static void writeHeader(char *start, const uint32_t size, const bool isFree,
+                          const bool previousFree) {
+    AllocHeader *block = header(start);
+    block->size = size / 4;
+    block->allocFlags = 0;
+    block->isFree = isFree;
+    block->previousFree = previousFree;
+  }
+
+  BackingBlock *findBackingBlock(const char *ptr) const {
+    for (BackingBlock *backing = m_backing; backing != nullptr;
+         backing = backing->next) {
+      const int64_t delta = ptr - backing->data();
+      if ((delta > 0) & (delta < static_cast<int64_t>(backing->size))) {
+        return backing;
       }
+    }
+    return nullptr;
+  }
 
-      // finally we set the head of the linked list
-      if (m_nextAlloc[allocType] == found) {
-        m_nextAlloc[allocType] = nextInList;
+  void addBackingBlock(const uint32_t minimumSize) {
+    // room for the header of the top
+    uint32_t size = minimumSize + sizeof(AllocHeader);
+    size = size < m_poolSizeInByte ? m_poolSizeInByte : size;
+    auto *backing = static_cast<BackingBlock *>(
+        malloc(sizeof(BackingBlock) + static_cast<size_t>(size)));
+    assert(backing != nullptr);
+    backing->size = size;
+    backing->next = m_backing;
+    backing->topOffset = backing->offsetOf(backing->data());
+    memset(backing->bins, 0, sizeof(backing->bins));
+    memset(backing->binBitmap, 0, sizeof(backing->binBitmap));
+    writeHeader(backing->top(), sizeof(AllocHeader), false, false);
+    m_backing = backing;
+  }
+
+  void makeFreeBlock(BackingBlock *backing, char *start, const uint32_t size,
+                     const bool previousFree) {
+    writeHeader(start, size, true, previousFree);
+    *reinterpret_cast<uint32_t *>(start + size - sizeof(uint32_t)) = size;
+    header(start + size)->previousFree = 1;
+    addToBin(backing, start, size);
+  }
+
+  void addToBin(BackingBlock *backing, char *start, const uint32_t size) {
+    const uint32_t bin = binFor(size);
+    const uint32_t head = backing->bins[bin];
+    previousFree(start) = NO_BLOCK;
+    nextFree(start) = head;
+    if (head != NO_BLOCK) {
+      previousFree(backing->at(head)) = backing->offsetOf(start);
+    }
+    backing->bins[bin] = backing->offsetOf(start);
+    backing->binBitmap[bin / 32] |= 1u << (bin % 32);
+    m_freeBytes += size;
+    ++m_freeBlockCount;
+  }
+
+  void removeFromBin(BackingBlock *backing, char *start) {
+    const uint32_t size = blockSize(header(start));
+    const uint32_t bin = binFor(size);
+    const uint32_t next = nextFree(start);
+    const uint32_t previous = previousFree(start);
+    if (previous != NO_BLOCK) {
+      nextFree(backing->at(previous)) = next;
+    } else {
+      backing->bins[bin] = next;
+      if (next == NO_BLOCK) {
+        backing->binBitmap[bin / 32] &= ~(1u << (bin % 32));
       }
+    }
+    if (next != NO_BLOCK) {
+      previousFree(backing->at(next)) = previous;
+    }
+    m_freeBytes -= size;
+    --m_freeBlockCount;
+  }
 
-      ++m_allocCount[allocType];
+  // first non empty bin at or after the given one, BIN_COUNT if none
+  static uint32_t firstBinFrom(const BackingBlock *backing,
+                               const uint32_t bin) {
+    if (bin >= BIN_COUNT) {
+      return BIN_COUNT;
+    }
+    uint32_t word = bin / 32;
+    uint32_t bits = backing->binBitmap[word] & (~0u << (bin % 32));
+    while (bits == 0) {
+      if (++word == BITMAP_WORDS) {
+        return BIN_COUNT;
+      }
+      bits = backing->binBitmap[word];
+    }
+    return word * 32 + countTrailingZeros(bits);
+  }
 
-      // lets now build the header
-      AllocHeader header;
-      header.size = found->size;
-      header.isNode = false;
-      header.type = allocType;
-      header.allocFlags = flags;
-      memcpy(found, &header, sizeof(header));
+  char *takeFromBins(BackingBlock *backing, const uint32_t size) {
+    // best fit among the blocks of the bin the size falls in, not all of
+    // them are big enough
+    const uint32_t bin = binFor(size);
+    char *best = nullptr;
+    uint32_t bestSize = 0;
+    uint32_t searched = 0;
+    for (uint32_t node = backing->bins[bin];
+         (node != NO_BLOCK) & (searched < BEST_FIT_SEARCH);
+         node = nextFree(backing->at(node)), ++searched) {
+      char *candidate = backing->at(node);
+      const uint32_t candidateSize = blockSize(header(candidate));
+      if ((candidateSize >= size) &
+          ((best == nullptr) | (candidateSize < bestSize))) {
+        best = candidate;
+        bestSize = candidateSize;
+        if (candidateSize == size) {
+          break;
+        }
+      }
+    }
+    // any block in a bigger bin fits
+    if (best == nullptr) {
+      const uint32_t biggerBin = firstBinFrom(backing, bin + 1);
+      if (biggerBin == BIN_COUNT) {
+        return nullptr;
+      }
+      best = backing->at(backing->bins[biggerBin]);
+      bestSize = blockSize(header(best));
+    }
+    removeFromBin(backing, best);
+    splitOrTakeAll(backing, best, size, bestSize, size);
+    return best;
+  }
 
-      return reinterpret_cast<char *>(found) + sizeof(AllocHeader);
+  // the block at start is not in the bins anymore, the part past the wanted
+  // size goes back in the bins if it is at least minimumRest big, otherwise
+  // it stays in the allocation. Allocations only split off a rest as big as
+  // themselves, or a big one, strings tend to come back at similar sizes and
+  // small slivers would just sit in the bins
+  void splitOrTakeAll(BackingBlock *backing, char *start, const uint32_t wanted,
+                      const uint32_t available, uint32_t minimumRest) {
+    minimumRest = minimumRest < SMALL_BIN_LIMIT ? minimumRest : SMALL_BIN_LIMIT;
+    minimumRest = minimumRest > MIN_ALLOC_SIZE ? minimumRest : MIN_ALLOC_SIZE;
+    const bool previousFree = header(start)->previousFree;
+    if (available - wanted >= minimumRest) {
+      writeHeader(start, wanted, false, previousFree);
+      makeFreeBlock(backing, start + wanted, available - wanted, false);
+    } else {
+      writeHeader(start, available, false, previousFree);
+      header(start + available)->previousFree = 0;
     }
+  }
 
-    // no hit in the cache, we need to allocate from the pool
-    return allocateNew(sizeInByte, flags);
+  char *takeFromTop(const uint32_t size) {
+    if (m_backing->top() + size > m_backing->end()) {
+      addBackingBlock(size);
+    }
+    char *start = m_backing->top();
+    // the header of the top knows whether the block before it is free
+    const bool previousFree = header(start)->previousFree;
+    writeHeader(start, size, false, previousFree);
+    m_backing->topOffset += size;
+    writeHeader(m_backing->top(), sizeof(AllocHeader), false, false);
+    return start;
   }
 
-  // deleted copy constructors and assignment operator
-  ThreeSizesPool(const ThreeSizesPool &) = delete;
-  ThreeSizesPool &operator=(const ThreeSizesPool &) = delete;
+  void *finishAllocation(char *start, const uint8_t flags) {
+    AllocHeader *block = header(start);
+    block->allocFlags = flags;
+    const uint32_t size = blockSize(block);
+    ++m_allocCount[getAllocationTypeFromSize(size - sizeof(AllocHeader))];
+    m_allocatedBytes += size;
+    return start + sizeof(AllocHeader);
+  }
 
  private:
-  static constexpr uint32_t MIN_ALLOC_SIZE = sizeof(NextAlloc);
-  char *m_memory = nullptr;
+  // the most recent first, it is the one allocations at the top come from
+  BackingBlock *m_backing = nullptr;
   uint32_t m_poolSizeInByte;
-  uint32_t m_stackPointerOffset = 0;
 
-  NextAlloc *m_nextAlloc[3];
+  uint64_t m_freeBytes = 0;
+  uint32_t m_freeBlockCount = 0;
+  uint64_t m_allocatedBytes = 0;
   uint32_t m_allocCount[3]{};
   uint32_t m_smallSize;
   uint32_t m_mediumSize;
 };
 
+inline uint32_t ThreeSizesPool::BackingBlock::largestFreeBlock() const {
+  // the biggest block is in the highest non empty bin
+  for (int word = BITMAP_WORDS - 1; word >= 0; --word) {
+    if (binBitmap[word] != 0) {
+      const uint32_t bin = word * 32 + 31 - countLeadingZeros(binBitmap[word]);
+      uint32_t largest = 0;
+      for (uint32_t node = bins[bin]; node != NO_BLOCK;
+           node = nextFree(base() + node)) {
+        const uint32_t size = blockSize(header(base() + node));
+        largest = size > largest ? size : largest;
+      }
+      return largest;
+    }
+  }
+  return 0;
+}
+
 }  // namespace binder::memory
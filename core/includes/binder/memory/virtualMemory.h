@@ -0,0 +1,41 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// not thread safe
+namespace binder::memory {
+
+// reserves a range of address space upfront and commits pages only when
+// needed. The base address never changes, so pointers into the range stay
+// valid while it grows, which is what we want for the vm value stack.
+// On platforms without a proper virtual memory api (emscripten) the whole
+// range is allocated at reserve time.
+class VirtualMemoryRange final {
+public:
+  VirtualMemoryRange() = default;
+  ~VirtualMemoryRange() { release(); }
+
+  // reserves the address space, no physical memory is used yet
+  bool reserve(size_t sizeInByte);
+  // makes sure at least the first sizeInByte bytes of the range are usable,
+  // rounded up to the page size, can't go past the reserved size
+  bool commit(size_t sizeInByte);
+  void release();
+
+  [[nodiscard]] void *data() const { return m_start; }
+  [[nodiscard]] size_t getReservedSize() const { return m_reserved; }
+  [[nodiscard]] size_t getCommittedSize() const { return m_committed; }
+
+  static size_t getPageSize();
+
+  // deleted functions
+  VirtualMemoryRange(const VirtualMemoryRange &) = delete;
+  VirtualMemoryRange &operator=(const VirtualMemoryRange &) = delete;
+
+private:
+  void *m_start = nullptr;
+  size_t m_reserved = 0;
+  size_t m_committed = 0;
+};
+
+} // namespace binder::memory
@@ -67,8 +67,11 @@ inline const char* getLexemeFromToken(const TOKEN_TYPE token) {
   return TOKEN_TO_LEXEME[static_cast<uint32_t>(token)];
 }
 
+// the lexeme is a view in the source, it is not null terminated, for
+// strings it is the content between the quotes
 struct Token {
   const char* m_lexeme{};
+  uint32_t m_length{};
   uint32_t m_line{};
   TOKEN_TYPE m_type = TOKEN_TYPE::END_OF_FILE;
 };
@@ -0,0 +1,44 @@
+#pragma once
+#include "binder/memory/resizableVector.h"
+#include "binder/vm/chunk.h"
+#include "binder/vm/globals.h"
+#include "binder/vm/heap.h"
+
+namespace binder::vm {
+
+// on disk format of a compiled chunk, so a script can skip the scanner and
+// the compiler the second time around. Everything is little endian:
+//
+// header     magic "BNDC", version, opcode count, code size, line runs,
+//            constants and globals, all uint32
+// code       raw bytecode
+// lines      run length encoded, uint16 line followed by uint32 run length
+// constants  one byte tag then the payload, numbers are the 8 bytes of the
+//            double, strings a uint32 length followed by the chars
+// globals    names of the global table the code was compiled against, same
+//            encoding as the string constants
+//
+// bump the version whenever the layout or the instruction set changes, old
+// caches are then rejected and the source needs to be compiled again.
+// The max stack depth is not stored, it gets computed again on load
+constexpr uint32_t BYTECODE_CACHE_VERSION = 2;
+
+// appends the chunk to out, the globals are the table the chunk was compiled
+// against, the slots in the code only make sense together with the names
+void serializeChunk(const Chunk *chunk, const GlobalTable *globals,
+                    memory::ResizableVector<uint8_t> &out);
+bool saveChunk(const Chunk *chunk, const GlobalTable *globals,
+               const char *path);
+
+// builds a new chunk, owned by the caller, from serialized data. Strings go
+// in the heap and the global slots are remapped to the given table, so the
+// chunk can run on a different vm than the one that compiled it. Returns
+// nullptr if the data is not a valid cache for this build, in which case
+// the source should just be compiled. Nothing in the data ties it to the
+// source, a cache of an older version of the script loads just fine, it is
+// up to the caller to drop the file when the script changes
+Chunk *deserializeChunk(const uint8_t *data, size_t size,
+                        GlobalTable *globals, Heap *heap);
+Chunk *loadChunk(const char *path, GlobalTable *globals, Heap *heap);
+
+} // namespace binder::vm
@@ -6,6 +6,11 @@
 
 namespace binder::vm {
 
+// instructions indexing the constant table or the globals come in two
+// flavours, a one byte operand and a long one of three bytes (high byte first)
+// used only when the index does not fit in one byte
+constexpr uint32_t MAX_LONG_OPERAND = (1u << 24) - 1;
+
 enum class OP_CODE {
   OP_CONSTANT,
   OP_NIL,
@@ -35,12 +40,43 @@ enum class OP_CODE {
   OP_JUMP_IF_FALSE,
   OP_LOOP,
   OP_RETURN,
+  // superinstructions, the compiler never emits them directly, the peephole
+  // pass fuses common sequences into them, see peephole.h
+  // EQUAL NOT
+  OP_NOT_EQUAL,
+  // LESS NOT and GREATER NOT, they keep the negated semantic of the sequence
+  // they replace, so comparisons with a NaN behave the same
+  OP_GREATER_EQUAL,
+  OP_LESS_EQUAL,
+  // GET_LOCAL CONSTANT ADD, with a number constant
+  OP_ADD_LOCAL_CONST,
+  // JUMP_IF_FALSE POP, pops the condition on both paths
+  OP_JUMP_IF_FALSE_POP,
+  // SET_LOCAL POP and SET_GLOBAL POP, plain assignment statements
+  OP_SET_LOCAL_POP,
+  OP_SET_GLOBAL_POP,
+  // three bytes operand version of the above
+  OP_CONSTANT_LONG,
+  OP_GET_GLOBAL_LONG,
+  OP_DEFINE_GLOBAL_LONG,
+  OP_SET_GLOBAL_LONG,
+  // not a real instruction, keep it last, used to size dispatch tables
+  COUNT,
 };
 
+// size in bytes of the instruction, opcode plus operands
+int getInstructionLength(OP_CODE op);
+// how many values the instruction leaves on the stack compared to before it
+// executed, negative means it pops
+int getStackEffect(OP_CODE op);
+
 struct Chunk {
   memory::ResizableVector<uint8_t> m_code;
   memory::ResizableVector<uint16_t> m_lines;
   memory::ResizableVector<Value> m_constants;
+  // the deepest the value stack can get while running this chunk, computed
+  // by the compiler, the vm uses it to size the stack upfront
+  uint32_t m_maxStackDepth = 0;
 
   void write(const OP_CODE op, const uint16_t line) {
     m_code.pushBack(static_cast<uint8_t>(op));
@@ -50,10 +86,32 @@ struct Chunk {
     m_code.pushBack(static_cast<uint8_t>(byte));
     m_lines.pushBack(line);
   };
+  // writes the three bytes of a long operand
+  void writeLong(const uint32_t value, const uint16_t line) {
+    assert(value <= MAX_LONG_OPERAND);
+    write(static_cast<uint8_t>((value >> 16) & 0xff), line);
+    write(static_cast<uint8_t>((value >> 8) & 0xff), line);
+    write(static_cast<uint8_t>(value & 0xff), line);
+  }
   int addConstant(const Value value) {
     m_constants.pushBack(value);
     return static_cast<int>(m_constants.size()) - 1;
   };
 };
 
+inline uint32_t readLongOperand(const uint8_t *operand) {
+  return (operand[0] << 16) | (operand[1] << 8) | operand[2];
+}
+
+// walks every path of the bytecode and returns the maximum stack depth it can
+// reach. If overflowOffset is given it gets the offset of the first
+// instruction going above the limit, or -1 if the limit is never crossed
+uint32_t computeMaxStackDepth(const Chunk *chunk, uint32_t limit = UINT32_MAX,
+                              int *overflowOffset = nullptr);
+// same walk for code that did not come out of the compiler, returns false if
+// the stack usage does not add up: paths disagreeing on the depth, pops on
+// an empty stack or locals not below the top. The instructions are expected
+// to be known and to fit in the chunk
+bool checkStackDepth(const Chunk *chunk, uint32_t &maxDepth);
+
 } // namespace binder::vm
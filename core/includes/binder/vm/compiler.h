@@ -1,7 +1,12 @@
 #pragma once
+#include "binder/charBlocks.h"
+#include "binder/memory/hashMap.h"
+#include "binder/memory/hashing.h"
 #include "binder/memory/stringIntern.h"
 #include "binder/tokens.h"
 #include "binder/vm/chunk.h"
+#include "binder/vm/globals.h"
+#include "binder/vm/heap.h"
 
 // not using c{header-name} mostly for size concern
 #include "assert.h"
@@ -16,9 +21,8 @@ namespace vm {
 
 struct Chunk;
 
-// TODO we have two token representation, the one here, in the vm is the correct
-// one, the one in the interpreter needs to be changed to not use string
-// directly but pointer + len, not null terminated strings
+// same idea of the legacy token, pointer + len in the source, not null
+// terminated, the string lexemes here keep the quotes though
 struct Token {
   TOKEN_TYPE type;
   const char *start;
@@ -29,11 +33,15 @@ struct Token {
 struct Scanner {
   const char *start;
   const char *current;
+  // the terminator, the runs of chars are skipped a block at the time and
+  // the blocks must not be loaded past it
+  const char *end;
   int line;
 
   void init(const char *source) {
     start = source;
     current = start;
+    end = source + strlen(source);
     line = 0;
   }
 
@@ -71,11 +79,8 @@ struct Scanner {
   }
 
   void skipWhiteSpace();
-  static bool isDigit(const char c) { return (c >= '0') & (c <= '9'); }
-
-  static bool isAlpha(const char c) {
-    return ((c >= 'a') & (c <= 'z')) | ((c >= 'A') & (c <= 'Z')) | (c == '_');
-  }
+  static bool isDigit(const char c) { return chars::isDigit(c); }
+  static bool isAlpha(const char c) { return chars::isAlpha(c); }
   TOKEN_TYPE identifierType() const;
   TOKEN_TYPE checkKeyword(int start, int length, const char *rest,
                           TOKEN_TYPE type) const;
@@ -152,7 +157,8 @@ enum PRECEDENCE {
 };
 
 struct Local {
-  Token name;
+  // interned, two locals have the same name if they have the same pointer
+  const char *name;
   int depth;
 };
 
@@ -164,9 +170,20 @@ struct LocalPool {
   int scopeDepth = 0;
 };
 
+struct CompilerConfig {
+  // fuses common instruction sequences into superinstructions once the
+  // chunk is compiled, tests turn it off to check the raw code generation
+  bool peephole = true;
+  // evaluates unary and binary operators on literal operands at compile time
+  bool constantFolding = true;
+};
+
 class Compiler {
  public:
-  explicit Compiler(memory::StringIntern *intern) : m_intern(intern) {}
+  Compiler(memory::StringIntern *intern, GlobalTable *globals, Heap *heap,
+           const CompilerConfig &config = CompilerConfig())
+      : m_intern(intern), m_globals(globals), m_heap(heap), m_config(config),
+        m_numberConstants(CONSTANT_BINS), m_stringConstants(CONSTANT_BINS) {}
   bool compile(const char *source, log::Log *logger);
   [[nodiscard]] const Chunk *getCompiledChunk() const { return m_chunk; };
 
@@ -183,12 +200,15 @@ class Compiler {
     assert(m_chunk != nullptr);
     m_chunk->write(byte, static_cast<const uint16_t>(parser.previous.line));
   }
-  void emitByte(const OP_CODE byte) const {
+  void emitByte(const OP_CODE byte) {
     assert(m_chunk != nullptr);
+    // operands go through the uint8_t overload, so here we only see the
+    // start of instructions, folding needs them to walk back the code
+    m_instructionStarts.pushBack(static_cast<int>(m_chunk->m_code.size()));
     m_chunk->write(byte, parser.previous.line);
   }
 
-  [[nodiscard]] int emitJump(const OP_CODE instruction) const;
+  [[nodiscard]] int emitJump(const OP_CODE instruction);
 
   void patchJump(const int offset);
 
@@ -207,39 +227,64 @@ class Compiler {
   // we are going to rely on the auto deduction of the template param
   // for using this, this should be used mostly for constants and OP_CODES
   template <typename T, typename P>
-  void emitBytes(T byte, P byte2) const {
+  void emitBytes(T byte, P byte2) {
     emitByte(byte);
     emitByte(byte2);
   }
 
-  void endCompilation(log::Log *) const { emitByte(OP_CODE::OP_RETURN); }
+  // picks the long version of the instruction only if the index does not
+  // fit in a byte
+  void emitIndexed(const OP_CODE op, const OP_CODE longOp,
+                   const uint32_t index) {
+    if (index <= UINT8_MAX) {
+      emitBytes(op, static_cast<uint8_t>(index));
+      return;
+    }
+    emitByte(longOp);
+    m_chunk->writeLong(index, static_cast<uint16_t>(parser.previous.line));
+  }
+
+  void endCompilation(log::Log *) { emitByte(OP_CODE::OP_RETURN); }
   // emit instructions
   void parsePrecedence(PRECEDENCE precedence);
 
   void number(bool canAssign);
   void emitConstant(Value value);
-  uint8_t makeConstant(Value value);
+  uint32_t makeConstant(Value value);
+  memory::HashMap<uint64_t, uint32_t, hashUint64> *
+  getConstantMap(Value value, uint64_t &key);
   void grouping(bool canAssign);
   void unary(bool canAssign);
   void binary(bool canAssign);
-  void literal(bool canAssign) const;
+  void literal(bool canAssign);
   void string(bool canAssign);
   void variable(bool canAssign);
   void parseAnd(bool canAssign);
   void parseOr(bool canAssign);
   void namedVariable(const Token &token, bool canAssign);
-  int resolveLocal(const Token &name);
+
+  // constant folding
+  int markJumpTarget() {
+    m_lastJumpTarget = static_cast<int>(m_chunk->m_code.size());
+    return m_lastJumpTarget;
+  }
+  bool readLiteral(int instruction, Value &value) const;
+  bool canFold(int count) const;
+  void replaceWithLiteral(int count, Value value);
+  bool foldUnary(TOKEN_TYPE operatorType);
+  bool foldBinary(TOKEN_TYPE operatorType);
+  int resolveLocal(const memory::StringKey &name);
 
   // statements
   void expression();
   void declaration();
   void varDeclaration();
-  uint8_t parseVariable(const char *error);
-  uint8_t identifierConstant(const Token *token);
-  void defineVariable(uint8_t globalId);
+  uint32_t parseVariable(const char *error);
+  uint32_t identifierSlot(const memory::StringKey &name);
+  void defineVariable(uint32_t globalId);
   void markInitialized();
-  void declareVariable();
-  void addLocal(const Token &token);
+  void declareVariable(const memory::StringKey &name);
+  void addLocal(const char *name);
   void statement();
   void printStatement();
   void expressionStatement();
@@ -252,12 +297,10 @@ class Compiler {
   void block();
   void endScope();
 
-  // identifiers
-  static bool identifierEqual(const Token &a, const Token &b) {
-    // first we check the len, and if it is the same then we can
-    // check the actual memory
-    if (a.length != b.length) return false;
-    return memcmp(a.start, b.start, a.length) == 0;
+  // identifiers, hashed once and then used for both the locals and the
+  // global table
+  static memory::StringKey identifierKey(const Token &token) {
+    return {token.start, static_cast<uint32_t>(token.length)};
   }
 
   void dispatchFunctionId(FUNCTION_ID id, bool canAssign);
@@ -277,7 +320,23 @@ class Compiler {
   Parser parser;
   LocalPool m_localPool;
   memory::StringIntern *m_intern;
+  GlobalTable *m_globals;
+  // string constants go there
+  Heap *m_heap;
+  CompilerConfig m_config;
   Chunk *m_chunk = nullptr;
+  // offset of every instruction emitted so far
+  memory::ResizableVector<int> m_instructionStarts;
+  // identical numbers and strings share a slot in the constant table, the
+  // maps go from the bits of the number, or the interned chars of the string,
+  // to the index in the table
+  static constexpr uint32_t CONSTANT_BINS = 1024;
+  memory::HashMap<uint64_t, uint32_t, hashUint64> m_numberConstants;
+  memory::HashMap<uint64_t, uint32_t, hashUint64> m_stringConstants;
+  // offset of the instruction that first used each constant
+  memory::ResizableVector<int> m_constantOrigins;
+  // the furthest offset something jumps to, code before it can't be folded
+  int m_lastJumpTarget = 0;
 };
 
 }  // namespace vm
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "binder/memory/resizableVector.h"
+#include "binder/memory/stringMap.h"
+#include "binder/vm/value.h"
+
+namespace binder::vm {
+
+// globals are resolved at compile time, the compiler asks the table for a
+// slot for every global name it finds and emits the slot index as operand.
+// At runtime the vm only indexes a flat array of values, no hashing. The
+// table is owned by the vm so slots stay valid across multiple compilations
+// done on the same vm.
+class GlobalTable {
+public:
+  explicit GlobalTable(const uint32_t bins) : m_slots(bins) {}
+
+  // the table keeps its own copy of the names, in the arena of the map, so
+  // they are around to report errors with the name of the variable no
+  // matter where the key chars came from
+  uint32_t getSlot(const memory::StringKey &name) {
+    uint32_t slot = 0;
+    if (m_slots.get(name, slot)) {
+      return slot;
+    }
+    slot = m_values.size();
+    const memory::StringKey &stored = m_slots.insert(name, slot);
+    // slots start undefined, so we can tell a read of a variable that has
+    // not been declared yet from a legit value
+    m_values.pushBack(makeUndefined());
+    m_names.pushBack(stored.chars);
+    return slot;
+  }
+  uint32_t getSlot(const char *name) {
+    return getSlot(memory::StringKey(name));
+  }
+
+  [[nodiscard]] Value *getValues() const { return m_values.data(); }
+  [[nodiscard]] const char *getName(const uint32_t slot) const {
+    return m_names[slot];
+  }
+  [[nodiscard]] uint32_t size() const { return m_values.size(); }
+
+  // deleted functions
+  GlobalTable(const GlobalTable &) = delete;
+  GlobalTable &operator=(const GlobalTable &) = delete;
+
+private:
+  memory::StringMap<uint32_t> m_slots;
+  memory::ResizableVector<Value> m_values;
+  memory::ResizableVector<const char *> m_names;
+};
+
+} // namespace binder::vm
@@ -0,0 +1,56 @@
+#pragma once
+#include "binder/memory/slabAllocator.h"
+#include "binder/memory/stringMap.h"
+#include "binder/vm/object.h"
+
+namespace binder::vm {
+
+// owns every object created for a vm, by the vm itself, its compilers and
+// the bytecode loader. Nothing is shared between heaps, so vms running on
+// different threads don't step on each other
+class Heap {
+public:
+  Heap() : m_strings(STRING_TABLE_BINS) {}
+  ~Heap() { freeObjects(); }
+
+  sObj *allocateObject(size_t size, OBJ_TYPE type);
+  // makes the string known to the heap, so it can be found by its chars
+  void addString(sObjString *string);
+  // nullptr if no string with those chars exists, the hash is the one
+  // stored in the strings, hashStringChars of the chars
+  sObjString *findString(const char *chars, int length, uint32_t hash) const;
+  // same for the string made of prefix followed by suffix, the hash is the
+  // one of the whole string
+  sObjString *findString(const char *prefix, int prefixLength,
+                         const char *suffix, int suffixLength,
+                         uint32_t hash) const;
+
+  // frees every object that is not marked and clears the marks
+  void sweep(GCStats *stats);
+  void freeObjects();
+  // bytes currently owned by objects, headers and chars
+  [[nodiscard]] size_t getAllocatedBytes() const { return m_allocatedBytes; }
+  [[nodiscard]] memory::SlabAllocator::Stats getAllocatorStats() const {
+    return m_allocator.getStats();
+  }
+
+  // deleted functions
+  Heap(const Heap &) = delete;
+  Heap &operator=(const Heap &) = delete;
+
+private:
+  void freeObject(sObj *object);
+
+private:
+  static constexpr uint32_t STRING_TABLE_BINS = 4096;
+  // objects are small and come in few sizes, a string is a single block
+  memory::SlabAllocator m_allocator;
+  sObj *m_objects = nullptr;
+  // every live string by content, it does not keep the strings alive, the
+  // sweep takes out the ones it frees. The keys point at the inline chars
+  // of the strings and carry the hash stored in them, nothing is copied
+  memory::StringMap<sObjString *> m_strings;
+  size_t m_allocatedBytes = 0;
+};
+
+} // namespace binder::vm
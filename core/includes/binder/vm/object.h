@@ -1,4 +1,6 @@
 #pragma once
+#include "binder/memory/hashing.h"
+#include "stdint.h"
 #include "stdlib.h"
 #include "string.h"
 
@@ -12,27 +14,69 @@ class Log;
 namespace vm {
 
 struct Value;
+class Heap;
 
 enum class OBJ_TYPE { OBJ_STRING };
 
 struct sObj {
   OBJ_TYPE type;
+  // set by the mark phase of the collector, cleared again by the sweep
+  bool isMarked;
   sObj* next;
 };
 
+// strings are unique, there is only one object for a given sequence of
+// chars, so equality is just a pointer compare. The chars are null
+// terminated and live right after the header, in the same allocation, use
+// stringChars() to get to them. The hash is computed once when the string
+// is created, the heap string table reuses it instead of hashing the chars
+// again, see hashStringChars
 struct sObjString {
   sObj obj;
   int length;
-  char *chars;
+  uint32_t hash;
 };
 
-extern sObj* ALLOCATIONS;
+inline char *stringChars(const sObjString *string) {
+  return reinterpret_cast<char *>(const_cast<sObjString *>(string) + 1);
+}
+inline size_t stringAllocationSize(const int length) {
+  return sizeof(sObjString) + length + 1;
+}
+// fnv-1a rather than the farmhash used by the other tables, the hash of a
+// concatenation can be computed from the hash of the left side, only the
+// chars of the right side need to be hashed
+inline uint32_t hashStringChars(const char *chars, const int length,
+                                const uint32_t seed = FNV1A_32_SEED) {
+  return hashFnv1a32(chars, static_cast<uint32_t>(length), seed);
+}
 
-void freeAllocations();
-sObjString *takeString(char* chars, int length);
-sObjString *copyString(const char *chars, int length);
-sObjString *allocateString(const char *chars, int length); 
+// the objects are owned by the heap, both return the existing object if
+// there is one, otherwise the chars are copied in a new one. takeString
+// frees the given chars in both cases
+sObjString *takeString(Heap *heap, char *chars, int length);
+sObjString *copyString(Heap *heap, const char *chars, int length);
+// same as copyString for callers that already hashed the chars, the hash has
+// to be hashStringChars of the length chars
+sObjString *copyString(Heap *heap, const char *chars, int length,
+                       uint32_t hash);
+// a followed by b, the existing string is found without building the result
+// first, memory is only allocated when the string does not exist yet
+sObjString *concatenateStrings(Heap *heap, const sObjString *a,
+                               const sObjString *b);
 void printObject(Value *value, log::Log* logger);
 
+// garbage collection, the vm marks its roots and then sweeps the heap,
+// strings do not reference other objects so there is no tracing past the
+// roots yet
+struct GCStats {
+  uint32_t collections = 0;
+  uint64_t objectsFreed = 0;
+  uint64_t bytesFreed = 0;
+};
+
+void markObject(sObj *object);
+void markValue(Value value);
+
 } // namespace vm
 } // namespace binder
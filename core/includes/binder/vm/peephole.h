@@ -0,0 +1,13 @@
+#pragma once
+#include "binder/vm/chunk.h"
+
+namespace binder::vm {
+
+// post compilation pass, walks the bytecode and fuses common instruction
+// sequences into superinstructions (OP_NOT_EQUAL, OP_ADD_LOCAL_CONST etc).
+// The code is rewritten in place, jump offsets and lines are patched to match
+// the new layout. A sequence is never fused if something jumps in the middle
+// of it
+void optimizeChunk(Chunk *chunk);
+
+} // namespace binder::vm
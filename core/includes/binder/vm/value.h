@@ -1,7 +1,9 @@
 #pragma once
 
 #include "binder/vm/object.h"
+#include "stdint.h"
 #include "stdio.h"
+#include "string.h"
 
 namespace binder {
 namespace log {
@@ -17,8 +19,92 @@ enum VALUE_TYPE {
   VAL_NIL,
   VAL_NUMBER,
   VAL_OBJ,
+  // internal only, marks a global slot that has not been defined yet, it is
+  // never visible to scripts
+  VAL_UNDEFINED,
 };
 
+#ifdef BINDER_VM_NAN_BOXING
+
+// NaN boxing, every value fits in 8 bytes. A double is stored as is, anything
+// else is hidden in the payload of a quiet NaN. Real NaNs produced by the
+// arithmetic never have all the bits of QNAN set so they do not clash.
+// Objects set the sign bit and store the pointer in the low 48 bits, nil
+// and booleans use the low two bits as a tag.
+struct Value {
+  uint64_t bits;
+};
+
+static constexpr uint64_t NAN_BOX_SIGN_BIT = 0x8000000000000000ull;
+static constexpr uint64_t NAN_BOX_QNAN = 0x7ffc000000000000ull;
+static constexpr uint64_t NAN_BOX_TAG_UNDEFINED = 0;
+static constexpr uint64_t NAN_BOX_TAG_NIL = 1;
+static constexpr uint64_t NAN_BOX_TAG_FALSE = 2;
+static constexpr uint64_t NAN_BOX_TAG_TRUE = 3;
+static constexpr uint64_t NAN_BOX_UNDEFINED =
+    NAN_BOX_QNAN | NAN_BOX_TAG_UNDEFINED;
+static constexpr uint64_t NAN_BOX_NIL = NAN_BOX_QNAN | NAN_BOX_TAG_NIL;
+static constexpr uint64_t NAN_BOX_FALSE = NAN_BOX_QNAN | NAN_BOX_TAG_FALSE;
+static constexpr uint64_t NAN_BOX_TRUE = NAN_BOX_QNAN | NAN_BOX_TAG_TRUE;
+static constexpr uint64_t NAN_BOX_OBJ = NAN_BOX_SIGN_BIT | NAN_BOX_QNAN;
+
+inline Value makeBool(bool value) {
+  return Value{value ? NAN_BOX_TRUE : NAN_BOX_FALSE};
+};
+inline Value makeNumber(double value) {
+  // memcpy is the only well defined way to type pun, compiles to a mov
+  Value outValue;
+  memcpy(&outValue.bits, &value, sizeof(double));
+  return outValue;
+};
+inline Value makeNIL() { return Value{NAN_BOX_NIL}; };
+inline Value makeUndefined() { return Value{NAN_BOX_UNDEFINED}; };
+inline Value makeObject(Obj *value) {
+  return Value{NAN_BOX_OBJ | static_cast<uint64_t>(uintptr_t(value))};
+};
+inline Value makeObject(ObjString *value) { return makeObject((Obj *)value); };
+
+inline bool valueAsBool(Value value) { return value.bits == NAN_BOX_TRUE; }
+inline double valueAsNumber(Value value) {
+  double outValue;
+  memcpy(&outValue, &value.bits, sizeof(double));
+  return outValue;
+}
+inline Obj *valueAsObj(Value value) {
+  return (Obj *)uintptr_t(value.bits & ~NAN_BOX_OBJ);
+}
+
+inline bool isValueBool(Value value) {
+  // true and false only differ in the lowest bit
+  return (value.bits | 1) == NAN_BOX_TRUE;
+}
+inline bool isValueNumber(Value value) {
+  return (value.bits & NAN_BOX_QNAN) != NAN_BOX_QNAN;
+}
+inline bool isValueObj(Value value) {
+  return (value.bits & NAN_BOX_OBJ) == NAN_BOX_OBJ;
+}
+inline bool isValueNIL(Value value) { return value.bits == NAN_BOX_NIL; }
+inline bool isValueUndefined(Value value) {
+  return value.bits == NAN_BOX_UNDEFINED;
+}
+
+inline VALUE_TYPE getValueType(Value value) {
+  if (isValueNumber(value)) {
+    return VALUE_TYPE::VAL_NUMBER;
+  }
+  if (isValueObj(value)) {
+    return VALUE_TYPE::VAL_OBJ;
+  }
+  if (isValueNIL(value)) {
+    return VALUE_TYPE::VAL_NIL;
+  }
+  return isValueUndefined(value) ? VALUE_TYPE::VAL_UNDEFINED
+                                 : VALUE_TYPE::VAL_BOOL;
+}
+
+#else
+
 struct Value {
   VALUE_TYPE type;
 
@@ -50,6 +136,12 @@ inline Value makeNIL() {
   outValue.as.number = 0;
   return outValue;
 };
+inline Value makeUndefined() {
+  Value outValue{};
+  outValue.type = VALUE_TYPE::VAL_UNDEFINED;
+  outValue.as.number = 0;
+  return outValue;
+};
 
 inline Value makeObject(Obj*value) {
   Value outValue{};
@@ -67,7 +159,6 @@ inline Value makeObject(ObjString*value) {
 inline bool valueAsBool(Value value) { return value.as.boolean; }
 inline double valueAsNumber(Value value) { return value.as.number; }
 inline Obj *valueAsObj(Value value) { return value.as.obj; }
-inline OBJ_TYPE getObjType(Value value) { return valueAsObj(value)->type; }
 
 inline bool isValueBool(Value value) {
   return value.type == VALUE_TYPE::VAL_BOOL;
@@ -82,6 +173,15 @@ inline bool isValueObj(Value value) {
 inline bool isValueNIL(Value value) {
   return value.type == VALUE_TYPE::VAL_NIL;
 }
+inline bool isValueUndefined(Value value) {
+  return value.type == VALUE_TYPE::VAL_UNDEFINED;
+}
+
+inline VALUE_TYPE getValueType(Value value) { return value.type; }
+
+#endif
+
+inline OBJ_TYPE getObjType(Value value) { return valueAsObj(value)->type; }
 inline bool isObjType(Value value, OBJ_TYPE type) {
   return isValueObj(value) && valueAsObj(value)->type == type;
 }
@@ -94,7 +194,13 @@ inline ObjString *valueAsString(Value value) {
   return (ObjString *)(valueAsObj(value));
 }
 inline char *valueAsCString(Value value) {
-  return ((ObjString *)(valueAsObj(value)))->chars;
+  return stringChars((ObjString *)(valueAsObj(value)));
+}
+
+inline bool isFalsey(Value value) {
+  // first we check wether the value is null, we also check if the value is bool
+  // then we also negate the bool value
+  return isValueNIL(value) | isValueBool(value) && (!valueAsBool(value));
 }
 
 void printValue(Value value, log::Log *logger);
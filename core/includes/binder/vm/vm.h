@@ -1,6 +1,10 @@
 #pragma once
 #include "binder/memory/stringIntern.h"
+#include "binder/memory/virtualMemory.h"
 #include "binder/vm/chunk.h"
+#include "binder/vm/compiler.h"
+#include "binder/vm/globals.h"
+#include "binder/vm/heap.h"
 #include "binder/vm/value.h"
 
 namespace binder {
@@ -17,18 +21,33 @@ enum INTERPRET_RESULT {
   INTERPRET_RUNTIME_ERROR,
 };
 
-#define DEBUG_TRACE_EXECUTION
+// when the collector runs, it gets triggered by the runtime allocations once
+// the bytes owned by objects pass the threshold, after a collection the
+// threshold becomes what survived times the grow factor
+struct GCConfig {
+  size_t initialThreshold = 1024 * 1024;
+  uint32_t growFactor = 2;
+  // collects on every runtime allocation, shakes out missing roots in tests
+  bool stress = false;
+};
+
+// computed goto dispatch relies on the labels as values extension, if the
+// compiler does not support it, or we explicitly ask for it, we fall back to
+// a plain switch
+#if !defined(BINDER_VM_SWITCH_DISPATCH) && (defined(__GNUC__) || defined(__clang__))
+#define BINDER_VM_COMPUTED_GOTO 1
+#else
+#define BINDER_VM_COMPUTED_GOTO 0
+#endif
 
 class VirtualMachine {
 public:
-  // TODO fix initial bucket and have hash map that can resize
-  VirtualMachine(log::Log *logger)
-      : m_logger(logger), m_intern(1024), m_globals(1024) {}
-#ifdef DEBUG_TRACE_EXECUTION
-  VirtualMachine(log::Log *logger, log::Log *debugLogger)
-      : m_logger(logger), m_intern(1024), m_globals(1024),
-        m_debugLogger(debugLogger) {}
-#endif
+  // max number of values the stack can hold, the address space for it is
+  // reserved upfront but memory is only committed when a chunk needs it
+  static constexpr uint32_t DEFAULT_STACK_LIMIT = 64 * 1024;
+
+  explicit VirtualMachine(log::Log *logger,
+                          uint32_t stackLimit = DEFAULT_STACK_LIMIT);
   ~VirtualMachine();
 
   void init();
@@ -36,10 +55,52 @@ public:
   INTERPRET_RESULT compile(const char *source);
   INTERPRET_RESULT interpret(const char *source);
   INTERPRET_RESULT interpret(const Chunk *chunk);
+  // same as above but the stack and every instruction are dumped to the
+  // trace logger before being executed, this runs a separately instantiated
+  // loop so the normal path does not pay anything for it
+  INTERPRET_RESULT interpret(const char *source, log::Log *traceLogger);
+  INTERPRET_RESULT interpret(const Chunk *chunk, log::Log *traceLogger);
+  // chunks given out by compile() and loadChunk() belong to the vm, their
+  // constants stay alive, and the chunk can be run, until it is released.
+  // The chunk compiled by interpret(source) is released by the next call,
+  // anything still around goes away with the vm
   const Chunk* getCompiledChunk()const {return m_chunk;}
+  void releaseChunk(const Chunk *chunk);
+  // bytecode cache, see bytecodeCache.h. Saving writes the current chunk,
+  // loading returns a chunk owned by the vm, same as the compiled ones, or
+  // nullptr if the file is missing, corrupt or from a different build.
+  // The file knows nothing about the source it came from, the caller has to
+  // throw the cache away when the script changes. The loaded chunk becomes
+  // the current one
+  bool saveCompiledChunk(const char *path) const;
+  const Chunk *loadChunk(const char *path);
+  void setCompilerConfig(const CompilerConfig &config) {
+    m_compilerConfig = config;
+  }
+  void setGCConfig(const GCConfig &config) {
+    m_gcConfig = config;
+    m_nextCollection = config.initialThreshold;
+  }
+  // marks everything reachable from the stack, the globals and the constants
+  // of the chunks not released yet and frees the rest, safe to call between
+  // runs
+  void collectGarbage();
+  [[nodiscard]] const GCStats &getGCStats() const { return m_gcStats; }
+  [[nodiscard]] const Heap &getHeap() const { return m_heap; }
+  // only holds the local names of the compile in progress, empty otherwise
+  [[nodiscard]] const memory::StringIntern &getIntern() const {
+    return m_intern;
+  }
+  [[nodiscard]] uint32_t getStackLimit() const { return m_stackLimit; }
+  [[nodiscard]] size_t getStackCommittedSize() const {
+    return m_stackMemory.getCommittedSize();
+  }
 
 private:
-  INTERPRET_RESULT run();
+  template <bool TRACE> INTERPRET_RESULT run();
+  void traceInstruction();
+  bool prepareStack();
+  INTERPRET_RESULT execute(const Chunk *chunk, log::Log *traceLogger);
 
   // stack
   void resetStack() { m_stackTop = m_stack; };
@@ -48,33 +109,42 @@ private:
 
   // runtime operations
   void concatenate();
+  // the only place the collector can kick in, called before the runtime
+  // allocates, while every value in use is still on the stack
+  void maybeCollectGarbage() {
+    if (m_gcConfig.stress | (m_heap.getAllocatedBytes() > m_nextCollection)) {
+      collectGarbage();
+    }
+  }
 
-  // instructions
-  inline uint8_t readByte() { return *m_ip++; }
-  inline Value readConstant() { return m_chunk->m_constants[readByte()]; };
-  inline uint16_t readShort() {
-    m_ip += 2;
-    return static_cast<uint16_t>(m_ip[-2] << 8 | m_ip[-1]);
-  };
-  inline ObjString *readString() { return valueAsString(readConstant()); };
+  // instructions are decoded directly in run(), see the VM_READ_* macros,
+  // so that the instruction pointer can live in a register
   //-1 gives us the first not freevalue and then we subtract the distance
   // since we want to go back in the stack
   inline Value peek(int distance) { return m_stackTop[-1 - distance]; }
   void runtimeError(const char *message);
+  void undefinedVariableError(uint32_t slot);
 
 private:
-  static constexpr uint32_t STACK_MAX = 256;
-  Value m_stack[STACK_MAX];
-  Value *m_stackTop;
+  memory::VirtualMemoryRange m_stackMemory;
+  Value *m_stack = nullptr;
+  Value *m_stackTop = nullptr;
+  uint32_t m_stackLimit;
   log::Log *m_logger;
-  const Chunk *m_chunk;
+  const Chunk *m_chunk = nullptr;
+  // every chunk we handed out and was not released, they are gc roots
+  memory::ResizableVector<const Chunk *> m_chunks;
+  // the last one compiled by interpret(source)
+  const Chunk *m_scriptChunk = nullptr;
   uint8_t *m_ip;
   memory::StringIntern m_intern;
-  memory::HashMap<const char *, Value, hashString32> m_globals;
-
-#ifdef DEBUG_TRACE_EXECUTION
-  log::Log *m_debugLogger = nullptr;
-#endif
+  GlobalTable m_globals;
+  Heap m_heap;
+  CompilerConfig m_compilerConfig;
+  log::Log *m_traceLogger = nullptr;
+  GCConfig m_gcConfig;
+  size_t m_nextCollection = GCConfig().initialThreshold;
+  GCStats m_gcStats;
 };
 
 } // namespace vm
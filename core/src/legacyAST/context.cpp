@@ -10,7 +10,8 @@ namespace binder {
 
 BinderContext::BinderContext(const ContextConfig &config)
     : m_config(config),
-      m_stringPool(m_config.m_stringPoolSizeInMb * MB_TO_BYTE) {
+      m_stringPool(m_config.m_stringPoolSizeInMb * MB_TO_BYTE),
+      m_scratch(m_config.scratchBlockSizeInKb * KB_TO_BYTE) {
 
   switch (config.loggerType) {
   case (LOGGER_TYPE::CONSOLE): {
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 
 #include <exception>
+#include <initializer_list>
 
 #include "binder/legacyAST/autogen/astgen.h"
 #include "binder/legacyAST/context.h"
@@ -11,9 +12,13 @@
 
 namespace binder {
 
-static const char *RUNTIME_TYPE_NAMES[] = {"NUMBER", "STRING", "NIL", "BOOLEAN",
-                                           "INVALID"};
+// same order as RuntimeValueType
+static const char *RUNTIME_TYPE_NAMES[] = {"INVALID", "NUMBER", "STRING", "NIL",
+                                           "BOOLEAN"};
 
+// the runtime values travel in the visitor as pool handles masked as void*,
+// the handle carries the generation of the slot so the pool can catch a
+// freed value being used
 inline void *toVoid(uint32_t index) {
   // using same type pointer rather than void* at least i am sure
   // alignment matches, next make sure the pointer is 0, otherwise
@@ -39,12 +44,30 @@ inline uint32_t toIndex(void *ptr) {
   return result;
 }
 
+// joins the strings in the scratch allocator, the result only lives until
+// the end of the statement being executed, so there is nothing to free
+const char *scratchJoin(BinderContext *context,
+                        std::initializer_list<const char *> parts) {
+  size_t length = 0;
+  for (const char *part : parts) {
+    length += strlen(part);
+  }
+  auto *result =
+      static_cast<char *>(context->getScratch().allocate(length + 1));
+  char *cursor = result;
+  for (const char *part : parts) {
+    const size_t partLength = strlen(part);
+    memcpy(cursor, part, partLength);
+    cursor += partLength;
+  }
+  *cursor = '\0';
+  return result;
+}
+
 // error handling
 const char *RuntimeValue::debugToString(BinderContext *context) const {
-  memory::StringPool &pool = context->getStringPool();
   char valueStr[50];
   const char *finalStrValue = valueStr;
-  bool shouldFreeValueStr = false;
   switch (type) {
     case (RuntimeValueType::NUMBER): {
       snprintf(valueStr, 50, "%f", number);
@@ -59,75 +82,44 @@ const char *RuntimeValue::debugToString(BinderContext *context) const {
       break;
     }
     case (RuntimeValueType::STRING): {
-      finalStrValue = pool.concatenate("\"", "\"", string);
-      shouldFreeValueStr = true;
-      break;
+      return scratchJoin(context, {"Runtime value with type ",
+                                   RUNTIME_TYPE_NAMES[(int)type],
+                                   " and value \"", string, "\""});
     }
     default:
       assert(0 &&
              "unhandled value in runtime type, it is INVALID, report as bug");
   }
 
-  char ff = memory::FREE_FIRST_AFTER_OPERATION;
-  char fs = memory::FREE_SECOND_AFTER_OPERATION;
-  char flags = shouldFreeValueStr ? fs | ff : ff;
-
   // ok now we have the value so we need to compose a message
-  const char *temp = pool.concatenate("Runtime value with type ", " and value ",
-                                      RUNTIME_TYPE_NAMES[(int)type]);
-  return pool.concatenate(temp, finalStrValue, nullptr, flags);
+  return scratchJoin(context, {"Runtime value with type ",
+                               RUNTIME_TYPE_NAMES[(int)type], " and value ",
+                               finalStrValue});
 }
 const char *RuntimeValue::toString(BinderContext *context,
                                    const bool trailingNewLine) const {
-  memory::StringPool &pool = context->getStringPool();
   // we might want to append a new line to force a flush in the printf,
   // done here it helps saving and extra concatenation
-  if (!trailingNewLine) {
-    switch (type) {
-      case (RuntimeValueType::NUMBER): {
-        char value[50];
-        snprintf(value, 50, "%02.*f", context->getConfig().printFloatPrecision,
-                 number);
-        return pool.allocate(value);
-      }
-      case (RuntimeValueType::BOOLEAN): {
-        const char *value = boolean ? "true" : "false";
-        return pool.allocate(value);
-      }
-      case (RuntimeValueType::NIL): {
-        const char *value = "nil";
-        return pool.allocate(value);
-      }
-      case (RuntimeValueType::STRING): {
-        return pool.concatenate("\"", "\"", string);
-      }
-      default:
-        assert(0 &&
-               "unhandled value in runtime type, it is INVALID, report as bug");
-    }
-  } else {
-    switch (type) {
-      case (RuntimeValueType::NUMBER): {
-        char value[50];
-        snprintf(value, 50, "%02.*f\n",
-                 context->getConfig().printFloatPrecision, number);
-        return pool.allocate(value);
-      }
-      case (RuntimeValueType::BOOLEAN): {
-        const char *value = boolean ? "true\n" : "false\n";
-        return pool.allocate(value);
-      }
-      case (RuntimeValueType::NIL): {
-        const char *value = "nil\n";
-        return pool.allocate(value);
-      }
-      case (RuntimeValueType::STRING): {
-        return pool.concatenate("\"", "\"\n", string);
-      }
-      default:
-        assert(0 &&
-               "unhandled value in runtime type, it is INVALID, report as bug");
+  const char *newLine = trailingNewLine ? "\n" : "";
+  switch (type) {
+    case (RuntimeValueType::NUMBER): {
+      char value[50];
+      snprintf(value, 50, "%02.*f%s", context->getConfig().printFloatPrecision,
+               number, newLine);
+      return scratchJoin(context, {value});
+    }
+    case (RuntimeValueType::BOOLEAN): {
+      return scratchJoin(context, {boolean ? "true" : "false", newLine});
+    }
+    case (RuntimeValueType::NIL): {
+      return scratchJoin(context, {"nil", newLine});
     }
+    case (RuntimeValueType::STRING): {
+      return scratchJoin(context, {"\"", string, "\"", newLine});
+    }
+    default:
+      assert(0 &&
+             "unhandled value in runtime type, it is INVALID, report as bug");
   }
   return nullptr;
 }
@@ -138,10 +130,9 @@ struct RuntimeException : public std::exception {
   }
 };
 
+// the message lives in the scratch allocator and goes away with the statement
 RuntimeException error(BinderContext *context, const char *message) {
   context->reportError(-1, message);
-  // freeing the message, must always be pool allocate
-  context->getStringPool().free(message);
   return RuntimeException();
 }
 
@@ -164,34 +155,24 @@ const char *buildLiteralErrorMessage(BinderContext *context,
       valueType = "UNEXPECTED";
   }
 
-  return context->getStringPool().concatenate(
-      "Expected NUMBER or STRING in literal operation got: ", valueType);
+  return scratchJoin(
+      context,
+      {"Expected NUMBER or STRING in literal operation got: ", valueType});
 }
 
 const char *buildBinaryOperationError(BinderContext *context,
                                       RuntimeValue *left, RuntimeValue *right,
                                       const TOKEN_TYPE op) {
-  memory::StringPool &pool = context->getStringPool();
-  const char *base = "Cannot perform binary operation with operator ";
   assert(left->type != RuntimeValueType::INVALID);
   assert(right->type != RuntimeValueType::INVALID);
 
   const char *leftValue = left->debugToString(context);
   const char *rightValue = right->debugToString(context);
 
-  const char ff = memory::FREE_FIRST_AFTER_OPERATION;
-  const char fj = memory::FREE_JOINER_AFTER_OPERATION;
-  const char fs = memory::FREE_SECOND_AFTER_OPERATION;
-
-  const char *temp = pool.concatenate(base, " and \n left value: \n\t",
-                                      getLexemeFromToken(op));
-  // we can free temp and joiner
-  temp = pool.concatenate(temp, "\n right value:\n\t", leftValue, ff | fj);
-  // we can free both sides since are result of concatenation or build
-  // by the debugToString (which result is in the pool)
-  temp = pool.concatenate(temp, "\n", rightValue, ff | fs);
-
-  return temp;
+  return scratchJoin(context,
+                     {"Cannot perform binary operation with operator ",
+                      getLexemeFromToken(op), " and \n left value: \n\t",
+                      leftValue, "\n right value:\n\t", rightValue, "\n"});
 }
 
 // TODO this will need to become graceful errors
@@ -244,9 +225,8 @@ class AstInterpreterVisitor final : public autogen::ExprVisitor,
 
     bool result = m_enviroment->assign(expr->name, value);
     if (!result) {
-      auto &pool = m_context->getStringPool();
-      const char *message =
-          pool.concatenate("Undefined variable: \"", "\"", expr->name);
+      const char *message = scratchJoin(
+          m_context, {"Undefined variable: \"", expr->name, "\""});
       error(m_context, message);
     }
     return value;
@@ -520,9 +500,8 @@ class AstInterpreterVisitor final : public autogen::ExprVisitor,
     bool result = m_enviroment->get(expr->name, &toReturn);
 
     if (!result) {
-      auto &pool = m_context->getStringPool();
-      const char *message =
-          pool.concatenate("Undefined variable: \"", "\"", expr->name);
+      const char *message = scratchJoin(
+          m_context, {"Undefined variable: \"", expr->name, "\""});
       error(m_context, message);
     }
     return toReturn;
@@ -555,7 +534,12 @@ class AstInterpreterVisitor final : public autogen::ExprVisitor,
     RuntimeValue *value = getRuntime(index);
 
     while (isTruthy(value)) {
-      stmt->body->accept(this);
+      // the body is not always a block, a loop of a single statement would
+      // otherwise pile up its scratch until the loop is done
+      {
+        memory::StackAllocator::Scope scratchScope(m_context->getScratch());
+        stmt->body->accept(this);
+      }
 
       // we can free the previous allocated value for the condition
       // and re -evaluate at the end of the loop, not super pretty
@@ -575,7 +559,6 @@ class AstInterpreterVisitor final : public autogen::ExprVisitor,
     if (!m_suppressPrints) {
       const char *str = value->toString(m_context, true);
       m_context->print(str);
-      m_context->getStringPool().free(str);
       // releaseRuntime(index);
     }
     return nullptr;
@@ -629,6 +612,7 @@ class AstInterpreterVisitor final : public autogen::ExprVisitor,
       m_enviroment = env;
       uint32_t count = stmts.size();
       for (uint32_t i = 0; i < count; ++i) {
+        memory::StackAllocator::Scope scratchScope(m_context->getScratch());
         stmts[i]->accept(this);
       }
     }
@@ -746,6 +730,8 @@ void ASTInterpreter::interpret(
     AstInterpreterVisitor visitor(m_context, &m_pool, &m_enviroment);
     visitor.setSuppressPrint(m_suppressPrints);
     for (uint32_t i = 0; i < count; ++i) {
+      // scratch memory, like error messages, only lives for the statement
+      memory::StackAllocator::Scope scratchScope(m_context->getScratch());
       stmts[i]->accept(&visitor);
     }
     // uint32_t index = toIndex(ASTRoot->accept(&visitor));
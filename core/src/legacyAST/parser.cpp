@@ -8,6 +8,10 @@ void Parser::parse(const memory::ResizableVector<Token> *tokens) {
   current = 0;
   m_tokens = tokens;
   m_stmts.clear();
+  // the nodes of the previous parse are gone, the strings are not, string
+  // literals become runtime values and variables can hold on to them past
+  // this parse. The intern only grows with strings it never saw
+  m_arena.reset();
 
   while (!isAtEnd()) {
     autogen::Stmt *stmt = declaration();
@@ -28,7 +32,7 @@ autogen::Expr *Parser::assignment() {
 
     if (expr->astType == autogen::AST_TYPE::VARIABLE) {
       const char *name = ((autogen::Variable *)expr)->name;
-      auto *toReturn = new autogen::Assign();
+      auto *toReturn = m_arena.make<autogen::Assign>();
       toReturn->astType = autogen::AST_TYPE::ASSIGN;
       toReturn->name = name;
       toReturn->value = value;
@@ -53,7 +57,7 @@ autogen::Expr *Parser::orExpr() {
     // every time we match a new logical expression
     // we chain it by wrapping the current one and the
     // right one, such that we are sort of building a linked list
-    auto *logical = new autogen::Logical();
+    auto *logical = m_arena.make<autogen::Logical>();
     logical->left = expr;
     logical->op = op.m_type;
     logical->right = right;
@@ -76,7 +80,7 @@ autogen::Expr *Parser::andExpr() {
     // every time we match a new logical expression
     // we chain it by wrapping the current one and the
     // right one, such that we are sort of building a linked list
-    auto *logical = new autogen::Logical();
+    auto *logical = m_arena.make<autogen::Logical>();
     logical->left = expr;
     logical->op = op.m_type;
     logical->right = right;
@@ -93,7 +97,7 @@ autogen::Expr *Parser::equality() {
     Token op = previous();
     autogen::Expr *right = comparison();
     // TODO  deal with this allocation
-    autogen::Binary *binary = new autogen::Binary();
+    autogen::Binary *binary = m_arena.make<autogen::Binary>();
     binary->astType = autogen::AST_TYPE::BINARY;
     binary->left = expr;
     binary->op = op.m_type;
@@ -112,7 +116,7 @@ autogen::Expr *Parser::comparison() {
     Token op = previous();
     autogen::Expr *right = addition();
 
-    autogen::Binary *binary = new autogen::Binary();
+    autogen::Binary *binary = m_arena.make<autogen::Binary>();
     binary->astType = autogen::AST_TYPE::BINARY;
     binary->left = expr;
     binary->op = op.m_type;
@@ -130,7 +134,7 @@ autogen::Expr *Parser::addition() {
     Token op = previous();
     autogen::Expr *right = addition();
 
-    autogen::Binary *binary = new autogen::Binary();
+    autogen::Binary *binary = m_arena.make<autogen::Binary>();
     binary->astType = autogen::AST_TYPE::BINARY;
     binary->left = expr;
     binary->op = op.m_type;
@@ -148,7 +152,7 @@ autogen::Expr *Parser::multiplication() {
     Token op = previous();
     autogen::Expr *right = addition();
 
-    autogen::Binary *binary = new autogen::Binary();
+    autogen::Binary *binary = m_arena.make<autogen::Binary>();
     binary->astType = autogen::AST_TYPE::BINARY;
     binary->left = expr;
     binary->op = op.m_type;
@@ -165,7 +169,7 @@ autogen::Expr *Parser::unary() {
     autogen::Expr *right = unary();
 
     // find a way for brace init
-    auto *unary = new autogen::Unary();
+    auto *unary = m_arena.make<autogen::Unary>();
     unary->astType = autogen::AST_TYPE::UNARY;
     unary->op = op.m_type;
     unary->right = right;
@@ -178,21 +182,21 @@ autogen::Expr *Parser::unary() {
 autogen::Expr *Parser::primary() {
 
   if (match(TOKEN_TYPE::BOOL_FALSE)) {
-    auto *expr = new autogen::Literal();
+    auto *expr = m_arena.make<autogen::Literal>();
     expr->astType = autogen::AST_TYPE::LITERAL;
     expr->value = "false";
     expr->type = TOKEN_TYPE::BOOL_FALSE;
     return expr;
   }
   if (match(TOKEN_TYPE::BOOL_TRUE)) {
-    auto *expr = new autogen::Literal();
+    auto *expr = m_arena.make<autogen::Literal>();
     expr->astType = autogen::AST_TYPE::LITERAL;
     expr->value = "true";
     expr->type = TOKEN_TYPE::BOOL_TRUE;
     return expr;
   }
   if (match(TOKEN_TYPE::NIL)) {
-    auto *expr = new autogen::Literal();
+    auto *expr = m_arena.make<autogen::Literal>();
     expr->astType = autogen::AST_TYPE::LITERAL;
     expr->value = nullptr;
     expr->type = TOKEN_TYPE::NIL;
@@ -202,17 +206,17 @@ autogen::Expr *Parser::primary() {
   TOKEN_TYPE types[] = {TOKEN_TYPE::NUMBER, TOKEN_TYPE::STRING};
   if (match(types, 2)) {
 
-    auto *expr = new autogen::Literal();
+    auto *expr = m_arena.make<autogen::Literal>();
     expr->astType = autogen::AST_TYPE::LITERAL;
-    expr->value = previous().m_lexeme;
+    expr->value = intern(previous());
     expr->type = previous().m_type;
     return expr;
   }
 
   if (match(TOKEN_TYPE::IDENTIFIER)) {
-    auto *expr = new autogen::Variable();
+    auto *expr = m_arena.make<autogen::Variable>();
     expr->astType = autogen::AST_TYPE::VARIABLE;
-    expr->name = previous().m_lexeme;
+    expr->name = intern(previous());
     return expr;
   }
 
@@ -220,7 +224,7 @@ autogen::Expr *Parser::primary() {
     autogen::Expr *expr = expression();
     consume(TOKEN_TYPE::RIGHT_PAREN, "Expected ')' after expresion.");
 
-    auto *grouping = new autogen::Grouping();
+    auto *grouping = m_arena.make<autogen::Grouping>();
     expr->astType = autogen::AST_TYPE::GROUPING;
     grouping->expr = expr;
     return grouping;
@@ -287,9 +291,9 @@ autogen::Stmt *Parser::forStatement() {
   // a while loop
   // increment happens after the body, so lets tie them together
   if (initializer != nullptr) {
-    auto *incrementStmt = new autogen::Expression();
+    auto *incrementStmt = m_arena.make<autogen::Expression>();
     incrementStmt->expression = increment;
-    auto *temp = new autogen::Block();
+    auto *temp = m_arena.make<autogen::Block>();
     temp->statements.pushBack(body);
     temp->statements.pushBack(incrementStmt);
     body = temp;
@@ -298,14 +302,14 @@ autogen::Stmt *Parser::forStatement() {
   // next we deal with the condition, if there is none we hardcode one to true
   // and can put it into the loop
   if (condition == nullptr) {
-    auto cnd = new autogen::Literal();
+    auto cnd = m_arena.make<autogen::Literal>();
     cnd->astType = autogen::AST_TYPE::LITERAL;
     cnd->value = "true";
     cnd->type = TOKEN_TYPE::BOOL_TRUE;
     condition = cnd;
   }
   // now we build the while statement
-  auto *whileStmt = new autogen::While();
+  auto *whileStmt = m_arena.make<autogen::While>();
   whileStmt->body = body;
   whileStmt->condition = condition;
   body = whileStmt;
@@ -313,7 +317,7 @@ autogen::Stmt *Parser::forStatement() {
   // finally we have the initializer, this runs once before the loop
   // so we chain it before the body
   if (initializer != nullptr) {
-    auto *finalStmt = new autogen::Block();
+    auto *finalStmt = m_arena.make<autogen::Block>();
     finalStmt->statements.pushBack(initializer);
     finalStmt->statements.pushBack(body);
     body = finalStmt;
@@ -344,7 +348,7 @@ autogen::Stmt *Parser::ifStatement() {
   }
 
   // TODO brace init
-  auto *toReturn = new autogen::If();
+  auto *toReturn = m_arena.make<autogen::If>();
   toReturn->condition = condition;
   toReturn->thenBranch = thenBranch;
   toReturn->elseBranch = elseBranch;
@@ -390,7 +394,7 @@ autogen::Stmt *Parser::function(const char *type) {
   m_context->getStringPool().free(errorStr);
 
   //parsing the arguments
-  auto *fun = new autogen::Function();
+  auto *fun = m_arena.make<autogen::Function>();
   memory::ResizableVector<Token> &parameters = fun->params;
   // checking for empty args
   if (!check(TOKEN_TYPE::RIGHT_PAREN)) {
@@ -402,8 +406,10 @@ autogen::Stmt *Parser::function(const char *type) {
       }
 
       //chew another identifier
-      parameters.pushBack(
-          consume(TOKEN_TYPE::IDENTIFIER, "Expected parameter name."));
+      Token parameter =
+          consume(TOKEN_TYPE::IDENTIFIER, "Expected parameter name.");
+      parameter.m_lexeme = intern(parameter);
+      parameters.pushBack(parameter);
 
     } while (match(TOKEN_TYPE::COMMA));
   }
@@ -428,9 +434,10 @@ autogen::Stmt *Parser::varDeclaration() {
     initializer = expression();
   }
   consume(TOKEN_TYPE::SEMICOLON, "Expected ';' after variable declaration.");
-  auto *var = new autogen::Var();
+  auto *var = m_arena.make<autogen::Var>();
   var->astType = autogen::AST_TYPE::VAR;
   var->token = name;
+  var->token.m_lexeme = intern(name);
   var->initializer = initializer;
   return var;
 }
@@ -438,7 +445,7 @@ autogen::Stmt *Parser::varDeclaration() {
 autogen::Stmt *Parser::printStatement() {
   autogen::Expr *value = expression();
   consume(TOKEN_TYPE::SEMICOLON, "Expected ';' after print expression.");
-  auto *stmt = new autogen::Print();
+  auto *stmt = m_arena.make<autogen::Print>();
   stmt->astType = autogen::AST_TYPE::PRINT;
   stmt->expression = value;
   return stmt;
@@ -450,7 +457,7 @@ autogen::Stmt *Parser::whileStatement() {
 
   autogen::Stmt *body = statement();
 
-  auto *stmt = new autogen::While();
+  auto *stmt = m_arena.make<autogen::While>();
   stmt->astType = autogen::AST_TYPE::WHILE;
   stmt->condition = condition;
   stmt->body = body;
@@ -458,7 +465,7 @@ autogen::Stmt *Parser::whileStatement() {
 }
 
 autogen::Stmt *Parser::blockStatement() {
-  auto *block = new autogen::Block();
+  auto *block = m_arena.make<autogen::Block>();
   // here we keep chewing until we find either a right brance or
   // we are at the end of the file
   while (!check(TOKEN_TYPE::RIGHT_BRACE) && !isAtEnd()) {
@@ -473,7 +480,7 @@ autogen::Stmt *Parser::blockStatement() {
 autogen::Stmt *Parser::expressionStatement() {
   autogen::Expr *value = expression();
   consume(TOKEN_TYPE::SEMICOLON, "Expect ';' after expression.");
-  auto *stmt = new autogen::Expression();
+  auto *stmt = m_arena.make<autogen::Expression>();
   stmt->astType = autogen::AST_TYPE::EXPRESSION;
   stmt->expression = value;
   return stmt;
@@ -517,6 +524,10 @@ const Token &Parser::advance() {
 const Token &Parser::peek() const { return (*m_tokens)[current]; };
 const Token &Parser::previous() const { return (*m_tokens)[current - 1]; };
 
+const char *Parser::intern(const Token &token) {
+  return m_intern.intern(token.m_lexeme, static_cast<int>(token.m_length));
+}
+
 ParserException Parser::error(const Token &token, const char *message) {
   m_context->reportError(token.m_line, message);
   return ParserException();
@@ -1,35 +1,11 @@
 #include "binder/legacyAST/scanner.h"
 
+#include "binder/charBlocks.h"
 #include "binder/legacyAST/context.h"
-#include "binder/memory/stringHashMap.h"
 
 namespace binder {
 
-static memory::HashMap<const char *, TOKEN_TYPE, hashString32>
-    STRING_TO_RESERVED(200);
-
-Scanner::Scanner(BinderContext *context) : m_tokens(1024), m_context(context) {
-  // populate the static map
-  if (STRING_TO_RESERVED.getUsedBins() != 0) {
-    return;
-  }
-  STRING_TO_RESERVED.insert("and", TOKEN_TYPE::AND);
-  STRING_TO_RESERVED.insert("class", TOKEN_TYPE::CLASS);
-  STRING_TO_RESERVED.insert("else", TOKEN_TYPE::ELSE);
-  STRING_TO_RESERVED.insert("false", TOKEN_TYPE::BOOL_FALSE);
-  STRING_TO_RESERVED.insert("for", TOKEN_TYPE::FOR);
-  STRING_TO_RESERVED.insert("fun", TOKEN_TYPE::FUN);
-  STRING_TO_RESERVED.insert("if", TOKEN_TYPE::IF);
-  STRING_TO_RESERVED.insert("nil", TOKEN_TYPE::NIL);
-  STRING_TO_RESERVED.insert("or", TOKEN_TYPE::OR);
-  STRING_TO_RESERVED.insert("print", TOKEN_TYPE::PRINT);
-  STRING_TO_RESERVED.insert("return", TOKEN_TYPE::RETURN);
-  STRING_TO_RESERVED.insert("super", TOKEN_TYPE::SUPER);
-  STRING_TO_RESERVED.insert("this", TOKEN_TYPE::THIS);
-  STRING_TO_RESERVED.insert("true", TOKEN_TYPE::BOOL_TRUE);
-  STRING_TO_RESERVED.insert("var", TOKEN_TYPE::VAR);
-  STRING_TO_RESERVED.insert("while", TOKEN_TYPE::WHILE);
-}
+Scanner::Scanner(BinderContext *context) : m_tokens(1024), m_context(context) {}
 
 void Scanner::scan(const char *source) {
   m_source = source;
@@ -37,7 +13,7 @@ void Scanner::scan(const char *source) {
 
   if (m_source == nullptr) {
     // adding EOF token
-    addToken(TOKEN_TYPE::END_OF_FILE);
+    m_tokens.pushBack({"", 0, line, TOKEN_TYPE::END_OF_FILE});
     return;
   }
   m_sourceLength = static_cast<uint32_t>(strlen(m_source));
@@ -53,6 +29,7 @@ void Scanner::scan(const char *source) {
   }
 
   // adding EOF token
+  start = current;
   addToken(TOKEN_TYPE::END_OF_FILE);
 }
 
@@ -110,21 +87,22 @@ void Scanner::scanToken() {
     break;
   case '/':
     if (match('/')) {
-      // comments start with / so we check  for an extra /
-      while (peek() != '\n' && !isAtEnd()) {
-        advance();
-      }
+      // comments start with / so we check  for an extra /, the new line is
+      // left for the next token
+      moveTo(chars::findNewLine(cursor(), sourceEnd()));
     } else {
       addToken(TOKEN_TYPE::SLASH);
     }
     break;
-  // whitespaces
+  // whitespaces, the rest of the run goes in one go
+  case '\n':
+    ++line;
+    skipWhiteSpace();
+    break;
   case ' ':
   case '\r':
   case '\t':
-    break;
-  case '\n':
-    ++line;
+    skipWhiteSpace();
     break;
   case '"':
     scanString();
@@ -142,7 +120,7 @@ void Scanner::scanToken() {
 }
 
 void Scanner::addToken(const TOKEN_TYPE token) {
-  m_tokens.pushBack({getLexemeFromToken(token), line, token});
+  m_tokens.pushBack({m_source + start, current - start, line, token});
 }
 
 bool Scanner::match(const char expected) {
@@ -167,13 +145,16 @@ char Scanner::peekNext() const {
   return m_source[current + 1];
 }
 
+void Scanner::skipWhiteSpace() {
+  uint32_t newLines = 0;
+  moveTo(chars::skipWhiteSpace(cursor(), sourceEnd(), newLines));
+  line += newLines;
+}
+
 void Scanner::scanString() {
-  while (peek() != '"' && !isAtEnd()) {
-    if (peek() == '\n') {
-      ++line;
-    }
-    advance();
-  }
+  uint32_t newLines = 0;
+  moveTo(chars::findQuote(cursor(), sourceEnd(), newLines));
+  line += newLines;
 
   if (isAtEnd()) {
     m_context->reportError(line, "Unterminated string");
@@ -183,77 +164,97 @@ void Scanner::scanString() {
   // eat the closing "
   advance();
 
-  // so,the minus two is because by now, the current points to the value
-  // after the ", so and the substring method of the pool takes the
-  // value up and included to end index, so we need to subtract two
-  // since we are passing an end index, m_source[endIdx].
-  // there is the edge case, as per the addNumberToken, where if the string
-  // is length one would fail, due to startIdx==endIdx, in that case
-  // we only subtract one, not ideal might need some refactor
-  addStringToken(start + 1, current - 2  );
+  // the lexeme is what is between the quotes
+  m_tokens.pushBack(
+      {m_source + start + 1, current - start - 2, line, TOKEN_TYPE::STRING});
 }
 
 void Scanner::scanNumber() {
   // keep chewing numbers until is done
-  while (isDigit(peek()))
-    advance();
+  moveTo(chars::skipDigits(cursor(), sourceEnd()));
 
   // lets check if we have a dot and after the dot we have another series
   // of number to swallow
   if (peek() == '.' && isDigit(peekNext())) {
-    advance();
-    while (isDigit(peek()))
-      advance();
+    moveTo(chars::skipDigits(cursor() + 1, sourceEnd()));
   }
 
-  // since the current is at the token past the number we subtract 1
-  // but there is the edge case where we have a single digit,
-  // which would give us start == current, in that case we bump by one
-  // not ideal, I would love to clean this up and have something more generic
-  addNumberToken(start, current - 1);
+  addToken(TOKEN_TYPE::NUMBER);
 }
 
 void Scanner::scanIdentifier() {
-  while (isAlphaNumeric(peek()))
-    advance();
+  moveTo(chars::skipIdentifier(cursor(), sourceEnd()));
 
-  uint32_t endIdx = current - 1;
-  const char *newString = nullptr;
-  if (endIdx >= start) {
-    newString = m_context->getStringPool().subString(m_source, start, endIdx);
-  }
-  assert(newString != nullptr);
-
-  // now that we have the string lets look it up in our map
-  TOKEN_TYPE type = TOKEN_TYPE::COUNT;
-  bool isReserved = STRING_TO_RESERVED.get(newString, type);
-  if (!isReserved) {
-    type = TOKEN_TYPE::IDENTIFIER;
-  }
-
-  m_tokens.pushBack({newString, line, type});
+  // no copy, the parser interns the names it keeps
+  addToken(identifierType());
 }
 
-bool Scanner::isDigit(const char c) { return (c >= '0') & (c <= '9'); }
-bool Scanner::isAlpha(const char c) {
-  return ((c >= 'a') & (c <= 'z')) | ((c >= 'A') & (c <= 'Z')) | (c == '_');
-}
-
-bool Scanner::isAlphaNumeric(const char c) { return isAlpha(c) | isDigit(c); }
+bool Scanner::isDigit(const char c) { return chars::isDigit(c); }
+bool Scanner::isAlpha(const char c) { return chars::isAlpha(c); }
 
-void Scanner::addStringToken(const uint32_t startIdx, const uint32_t endIdx) {
-  const char *newString = "";
-  // avoiding empty string
-  if (endIdx >= startIdx) {
-    newString =
-        m_context->getStringPool().subString(m_source, startIdx, endIdx);
+TOKEN_TYPE Scanner::checkKeyword(const uint32_t startIdx, const uint32_t length,
+                                 const char *rest,
+                                 const TOKEN_TYPE type) const {
+  // first we check if the length is the same second we check if the memory is
+  // the same
+  if ((current - start) == (startIdx + length) &&
+      memcmp(m_source + start + startIdx, rest, length) == 0) {
+    return type;
   }
-  m_tokens.pushBack({newString, line, TOKEN_TYPE::STRING});
+  return TOKEN_TYPE::IDENTIFIER;
 }
-void Scanner::addNumberToken(const uint32_t startIdx, const uint32_t endIdx) {
-  const char *number =
-      m_context->getStringPool().subString(m_source, startIdx, endIdx);
-  m_tokens.pushBack({number, line, TOKEN_TYPE::NUMBER});
+
+// keywords are found by walking a small trie of switches on the first
+// chars, no hashing and no copy of the identifier needed
+TOKEN_TYPE Scanner::identifierType() const {
+  const char *lexeme = m_source + start;
+  switch (lexeme[0]) {
+  case 'a':
+    return checkKeyword(1, 2, "nd", TOKEN_TYPE::AND);
+  case 'c':
+    return checkKeyword(1, 4, "lass", TOKEN_TYPE::CLASS);
+  case 'e':
+    return checkKeyword(1, 3, "lse", TOKEN_TYPE::ELSE);
+  case 'f':
+    if (current - start > 1) {
+      switch (lexeme[1]) {
+      case 'a':
+        return checkKeyword(2, 3, "lse", TOKEN_TYPE::BOOL_FALSE);
+      case 'o':
+        return checkKeyword(2, 1, "r", TOKEN_TYPE::FOR);
+      case 'u':
+        return checkKeyword(2, 1, "n", TOKEN_TYPE::FUN);
+      }
+    }
+    break;
+  case 'i':
+    return checkKeyword(1, 1, "f", TOKEN_TYPE::IF);
+  case 'n':
+    return checkKeyword(1, 2, "il", TOKEN_TYPE::NIL);
+  case 'o':
+    return checkKeyword(1, 1, "r", TOKEN_TYPE::OR);
+  case 'p':
+    return checkKeyword(1, 4, "rint", TOKEN_TYPE::PRINT);
+  case 'r':
+    return checkKeyword(1, 5, "eturn", TOKEN_TYPE::RETURN);
+  case 's':
+    return checkKeyword(1, 4, "uper", TOKEN_TYPE::SUPER);
+  case 't':
+    if (current - start > 1) {
+      switch (lexeme[1]) {
+      case 'h':
+        return checkKeyword(2, 2, "is", TOKEN_TYPE::THIS);
+      case 'r':
+        return checkKeyword(2, 2, "ue", TOKEN_TYPE::BOOL_TRUE);
+      }
+    }
+    break;
+  case 'v':
+    return checkKeyword(1, 2, "ar", TOKEN_TYPE::VAR);
+  case 'w':
+    return checkKeyword(1, 4, "hile", TOKEN_TYPE::WHILE);
+  }
+  return TOKEN_TYPE::IDENTIFIER;
 }
 
 } // namespace binder
@@ -1,13 +1,19 @@
 #include "memory/farmhash.cpp"
 #include "memory/stringPool.cpp"
+#include "memory/virtualMemory.cpp"
+#include "memory/mappedFile.cpp"
 
 #include "legacyAST/scanner.cpp"
 #include "legacyAST/context.cpp"
 #include "legacyAST/interpreter.cpp"
 #include "legacyAST/parser.cpp"
 #include "vm/value.cpp"
+#include "vm/chunk.cpp"
 #include "vm/debug.cpp"
+#include "vm/peephole.cpp"
 #include "vm/vm.cpp"
 #include "vm/compiler.cpp"
 #include "vm/object.cpp"
+#include "vm/heap.cpp"
+#include "vm/bytecodeCache.cpp"
 
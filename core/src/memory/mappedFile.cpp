@@ -0,0 +1,111 @@
+#include "binder/memory/mappedFile.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace binder::memory {
+
+bool MappedFile::open(const char *path) {
+  close();
+#if defined(_WIN32)
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+    // can't map an empty file
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+  void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (view == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  m_file = file;
+  m_mapping = mapping;
+  m_data = static_cast<const uint8_t *>(view);
+  m_size = static_cast<size_t>(fileSize.QuadPart);
+#elif defined(__EMSCRIPTEN__)
+  FILE *file = fopen(path, "rb");
+  if (file == nullptr) {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  const long fileSize = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (fileSize <= 0) {
+    fclose(file);
+    return false;
+  }
+  auto *buffer = static_cast<uint8_t *>(malloc(fileSize));
+  const size_t read = fread(buffer, 1, fileSize, file);
+  fclose(file);
+  if (read != static_cast<size_t>(fileSize)) {
+    free(buffer);
+    return false;
+  }
+  m_data = buffer;
+  m_size = static_cast<size_t>(fileSize);
+#else
+  const int file = ::open(path, O_RDONLY);
+  if (file == -1) {
+    return false;
+  }
+  struct stat info;
+  if (fstat(file, &info) != 0 || info.st_size == 0) {
+    ::close(file);
+    return false;
+  }
+  void *view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                    MAP_PRIVATE, file, 0);
+  // the mapping keeps its own reference to the file
+  ::close(file);
+  if (view == MAP_FAILED) {
+    return false;
+  }
+  m_data = static_cast<const uint8_t *>(view);
+  m_size = static_cast<size_t>(info.st_size);
+#endif
+  return true;
+}
+
+void MappedFile::close() {
+  if (m_data == nullptr) {
+    return;
+  }
+#if defined(_WIN32)
+  UnmapViewOfFile(m_data);
+  CloseHandle(m_mapping);
+  CloseHandle(m_file);
+  m_mapping = nullptr;
+  m_file = nullptr;
+#elif defined(__EMSCRIPTEN__)
+  free(const_cast<uint8_t *>(m_data));
+#else
+  munmap(const_cast<uint8_t *>(m_data), m_size);
+#endif
+  m_data = nullptr;
+  m_size = 0;
+}
+
+} // namespace binder::memory
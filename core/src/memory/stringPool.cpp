@@ -1,4 +1,5 @@
 #include "binder/memory/stringPool.h"
+#include "binder/log/log.h"
 
 #include <cstdio>
 #include <cstdlib>
@@ -223,4 +224,21 @@ const char* StringPool::subString(const char* source, const uint32_t startIdx,
   return newChar;
 }
 
+void StringPool::logReport(log::Log* logger) const {
+  const ThreeSizesPool::Report report = m_pool.getReport();
+  log::LOG(logger,
+           "string pool: %u backing blocks, %llu bytes reserved, %u "
+           "allocations %llu bytes, %u free blocks %llu bytes (largest %u), "
+           "%llu bytes untouched, fragmentation %.2f\n",
+           report.backingBlockCount,
+           static_cast<unsigned long long>(report.reservedBytes),
+           report.allocationCount,
+           static_cast<unsigned long long>(report.allocatedBytes),
+           report.freeBlockCount,
+           static_cast<unsigned long long>(report.freeBytes),
+           report.largestFreeBlock,
+           static_cast<unsigned long long>(report.topBytes),
+           static_cast<double>(report.fragmentation));
+}
+
 }  // namespace binder::memory
@@ -0,0 +1,103 @@
+#include "binder/memory/virtualMemory.h"
+
+#include <cassert>
+#include <cstdlib>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace binder::memory {
+
+static size_t roundToPage(const size_t sizeInByte) {
+  const size_t page = VirtualMemoryRange::getPageSize();
+  return ((sizeInByte + page - 1) / page) * page;
+}
+
+size_t VirtualMemoryRange::getPageSize() {
+#if defined(_WIN32)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return static_cast<size_t>(info.dwPageSize);
+#elif defined(__EMSCRIPTEN__)
+  return 64 * 1024;
+#else
+  return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+bool VirtualMemoryRange::reserve(const size_t sizeInByte) {
+  assert(m_start == nullptr);
+  const size_t size = roundToPage(sizeInByte);
+#if defined(_WIN32)
+  m_start = VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#elif defined(__EMSCRIPTEN__)
+  // no way to reserve without committing, we just grab the whole thing
+  m_start = malloc(size);
+#else
+  void *memory = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+  m_start = memory == MAP_FAILED ? nullptr : memory;
+#endif
+  if (m_start == nullptr) {
+    return false;
+  }
+  m_reserved = size;
+#if defined(__EMSCRIPTEN__)
+  m_committed = size;
+#endif
+  return true;
+}
+
+bool VirtualMemoryRange::commit(const size_t sizeInByte) {
+  assert(m_start != nullptr);
+  if (sizeInByte <= m_committed) {
+    return true;
+  }
+  const size_t size = roundToPage(sizeInByte);
+  if (size > m_reserved) {
+    return false;
+  }
+
+  // we only commit the new pages, from the end of the committed range
+  char *start = static_cast<char *>(m_start) + m_committed;
+  const size_t toCommit = size - m_committed;
+#if defined(_WIN32)
+  if (VirtualAlloc(start, toCommit, MEM_COMMIT, PAGE_READWRITE) == nullptr) {
+    return false;
+  }
+#elif defined(__EMSCRIPTEN__)
+  // everything is committed at reserve time, we can't get here
+  (void)start;
+  (void)toCommit;
+  return false;
+#else
+  if (mprotect(start, toCommit, PROT_READ | PROT_WRITE) != 0) {
+    return false;
+  }
+#endif
+  m_committed = size;
+  return true;
+}
+
+void VirtualMemoryRange::release() {
+  if (m_start == nullptr) {
+    return;
+  }
+#if defined(_WIN32)
+  VirtualFree(m_start, 0, MEM_RELEASE);
+#elif defined(__EMSCRIPTEN__)
+  free(m_start);
+#else
+  munmap(m_start, m_reserved);
+#endif
+  m_start = nullptr;
+  m_reserved = 0;
+  m_committed = 0;
+}
+
+} // namespace binder::memory
@@ -0,0 +1,446 @@
+#include "binder/vm/bytecodeCache.h"
+
+#include "binder/memory/mappedFile.h"
+#include "binder/vm/object.h"
+
+#include <cstdio>
+
+namespace binder::vm {
+
+static constexpr uint8_t CACHE_MAGIC[4] = {'B', 'N', 'D', 'C'};
+
+enum class CONSTANT_TAG : uint8_t { NUMBER, STRING, BOOL, NIL };
+
+static void writeU8(memory::ResizableVector<uint8_t> &out,
+                    const uint8_t value) {
+  out.pushBack(value);
+}
+static void writeU16(memory::ResizableVector<uint8_t> &out,
+                     const uint16_t value) {
+  out.pushBack(static_cast<uint8_t>(value & 0xff));
+  out.pushBack(static_cast<uint8_t>(value >> 8));
+}
+static void writeU32(memory::ResizableVector<uint8_t> &out,
+                     const uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out.pushBack(static_cast<uint8_t>((value >> (i * 8)) & 0xff));
+  }
+}
+static void writeU64(memory::ResizableVector<uint8_t> &out,
+                     const uint64_t value) {
+  for (int i = 0; i < 8; ++i) {
+    out.pushBack(static_cast<uint8_t>((value >> (i * 8)) & 0xff));
+  }
+}
+static void writeBytes(memory::ResizableVector<uint8_t> &out,
+                       const void *data, const uint32_t size) {
+  const uint32_t start = out.size();
+  out.resize(start + size);
+  memcpy(out.data() + start, data, size);
+}
+static void writeString(memory::ResizableVector<uint8_t> &out,
+                        const char *chars, const uint32_t length) {
+  writeU32(out, length);
+  writeBytes(out, chars, length);
+}
+
+// all reads are bounds checked, once something goes past the end the reader
+// is marked as failed and only returns zeros, so we check once at the end of
+// each section rather than after every read
+struct CacheReader {
+  const uint8_t *current;
+  const uint8_t *end;
+  bool failed = false;
+
+  bool canRead(const size_t size) {
+    if (failed || static_cast<size_t>(end - current) < size) {
+      failed = true;
+      return false;
+    }
+    return true;
+  }
+  uint8_t readU8() { return canRead(1) ? *current++ : 0; }
+  uint16_t readU16() {
+    if (!canRead(2)) {
+      return 0;
+    }
+    const auto value = static_cast<uint16_t>(current[0] | (current[1] << 8));
+    current += 2;
+    return value;
+  }
+  uint32_t readU32() {
+    if (!canRead(4)) {
+      return 0;
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+      value |= static_cast<uint32_t>(current[i]) << (i * 8);
+    }
+    current += 4;
+    return value;
+  }
+  uint64_t readU64() {
+    if (!canRead(8)) {
+      return 0;
+    }
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+      value |= static_cast<uint64_t>(current[i]) << (i * 8);
+    }
+    current += 8;
+    return value;
+  }
+  // returns a pointer in the source data, nullptr if there is not enough
+  const uint8_t *readBytes(const uint32_t size) {
+    if (!canRead(size)) {
+      return nullptr;
+    }
+    const uint8_t *bytes = current;
+    current += size;
+    return bytes;
+  }
+};
+
+void serializeChunk(const Chunk *chunk, const GlobalTable *globals,
+                    memory::ResizableVector<uint8_t> &out) {
+  const uint32_t codeSize = chunk->m_code.size();
+
+  // a chunk gets a new line only every few instructions, run length encoding
+  // takes the table from two bytes per code byte to a handful of runs
+  uint32_t runCount = 0;
+  for (uint32_t i = 0; i < codeSize; ++i) {
+    runCount += (i == 0) || (chunk->m_lines[i] != chunk->m_lines[i - 1]);
+  }
+
+  writeBytes(out, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+  writeU32(out, BYTECODE_CACHE_VERSION);
+  writeU32(out, static_cast<uint32_t>(OP_CODE::COUNT));
+  writeU32(out, codeSize);
+  writeU32(out, runCount);
+  writeU32(out, chunk->m_constants.size());
+  writeU32(out, globals->size());
+
+  writeBytes(out, chunk->m_code.data(), codeSize);
+
+  uint32_t i = 0;
+  while (i < codeSize) {
+    const uint16_t line = chunk->m_lines[i];
+    uint32_t run = 1;
+    while ((i + run < codeSize) && (chunk->m_lines[i + run] == line)) {
+      ++run;
+    }
+    writeU16(out, line);
+    writeU32(out, run);
+    i += run;
+  }
+
+  for (uint32_t c = 0; c < chunk->m_constants.size(); ++c) {
+    const Value value = chunk->m_constants[c];
+    switch (getValueType(value)) {
+    case VALUE_TYPE::VAL_NUMBER: {
+      writeU8(out, static_cast<uint8_t>(CONSTANT_TAG::NUMBER));
+      uint64_t bits;
+      const double number = valueAsNumber(value);
+      memcpy(&bits, &number, sizeof(bits));
+      writeU64(out, bits);
+      break;
+    }
+    case VALUE_TYPE::VAL_OBJ: {
+      // strings are the only objects we have so far
+      assert(isValueString(value));
+      const ObjString *string = valueAsString(value);
+      writeU8(out, static_cast<uint8_t>(CONSTANT_TAG::STRING));
+      writeString(out, stringChars(string), static_cast<uint32_t>(string->length));
+      break;
+    }
+    case VALUE_TYPE::VAL_BOOL:
+      writeU8(out, static_cast<uint8_t>(CONSTANT_TAG::BOOL));
+      writeU8(out, valueAsBool(value) ? 1 : 0);
+      break;
+    default:
+      writeU8(out, static_cast<uint8_t>(CONSTANT_TAG::NIL));
+      break;
+    }
+  }
+
+  for (uint32_t g = 0; g < globals->size(); ++g) {
+    const char *name = globals->getName(g);
+    writeString(out, name, static_cast<uint32_t>(strlen(name)));
+  }
+}
+
+bool saveChunk(const Chunk *chunk, const GlobalTable *globals,
+               const char *path) {
+  memory::ResizableVector<uint8_t> data;
+  serializeChunk(chunk, globals, data);
+
+  FILE *file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  const size_t written = fwrite(data.data(), 1, data.size(), file);
+  const bool closed = fclose(file) == 0;
+  return closed && (written == data.size());
+}
+
+static bool isGlobalInstruction(const OP_CODE op, bool &isLong) {
+  switch (op) {
+  case OP_CODE::OP_GET_GLOBAL:
+  case OP_CODE::OP_DEFINE_GLOBAL:
+  case OP_CODE::OP_SET_GLOBAL:
+  case OP_CODE::OP_SET_GLOBAL_POP:
+    isLong = false;
+    return true;
+  case OP_CODE::OP_GET_GLOBAL_LONG:
+  case OP_CODE::OP_DEFINE_GLOBAL_LONG:
+  case OP_CODE::OP_SET_GLOBAL_LONG:
+    isLong = true;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static bool isJumpInstruction(const OP_CODE op) {
+  switch (op) {
+  case OP_CODE::OP_JUMP:
+  case OP_CODE::OP_JUMP_IF_FALSE:
+  case OP_CODE::OP_JUMP_IF_FALSE_POP:
+  case OP_CODE::OP_LOOP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// walks the code making sure every instruction is known and fits in the
+// chunk, that constant operands are in the table, and are numbers for
+// ADD_LOCAL_CONST, that jumps land on an
+// instruction and that the code ends with a return, anything else would have
+// the vm read out of bounds. On the way it moves the global operands from the
+// slots of the table the code was compiled against to the slots of the table
+// we load into
+static bool checkAndRemapCode(Chunk *chunk, const uint32_t *slots,
+                              const uint32_t slotCount) {
+  const uint32_t size = chunk->m_code.size();
+  const uint32_t constantCount = chunk->m_constants.size();
+  uint8_t *code = chunk->m_code.data();
+
+  // jumps can go forward, so targets are checked once we know where every
+  // instruction starts
+  memory::ResizableVector<uint8_t> isStart;
+  isStart.resize(size);
+  memset(isStart.data(), 0, size);
+  memory::ResizableVector<uint32_t> targets;
+
+  OP_CODE lastOp = OP_CODE::COUNT;
+  uint32_t offset = 0;
+  while (offset < size) {
+    if (code[offset] >= static_cast<uint8_t>(OP_CODE::COUNT)) {
+      return false;
+    }
+    const auto op = static_cast<OP_CODE>(code[offset]);
+    const auto length = static_cast<uint32_t>(getInstructionLength(op));
+    if (offset + length > size) {
+      return false;
+    }
+    isStart[offset] = 1;
+    lastOp = op;
+
+    uint8_t *operand = code + offset + 1;
+    bool hasConstant = true;
+    uint32_t constant = 0;
+    switch (op) {
+    case OP_CODE::OP_CONSTANT:
+      constant = operand[0];
+      break;
+    case OP_CODE::OP_ADD_LOCAL_CONST:
+      constant = operand[1];
+      break;
+    case OP_CODE::OP_CONSTANT_LONG:
+      constant = readLongOperand(operand);
+      break;
+    default:
+      hasConstant = false;
+      break;
+    }
+    if (hasConstant && (constant >= constantCount)) {
+      return false;
+    }
+    // the vm adds it without checking, the peephole pass only fuses numbers
+    if ((op == OP_CODE::OP_ADD_LOCAL_CONST) &&
+        !isValueNumber(chunk->m_constants[constant])) {
+      return false;
+    }
+
+    if (isJumpInstruction(op)) {
+      const uint32_t jump = (operand[0] << 8) | operand[1];
+      const uint32_t next = offset + length;
+      if (op == OP_CODE::OP_LOOP) {
+        if (jump > next) {
+          return false;
+        }
+        targets.pushBack(next - jump);
+      } else {
+        targets.pushBack(next + jump);
+      }
+    }
+
+    bool isLong = false;
+    if (isGlobalInstruction(op, isLong)) {
+      const uint32_t slot = isLong ? readLongOperand(operand) : operand[0];
+      if (slot >= slotCount) {
+        return false;
+      }
+      const uint32_t newSlot = slots[slot];
+      if (isLong) {
+        operand[0] = static_cast<uint8_t>((newSlot >> 16) & 0xff);
+        operand[1] = static_cast<uint8_t>((newSlot >> 8) & 0xff);
+        operand[2] = static_cast<uint8_t>(newSlot & 0xff);
+      } else if (newSlot <= UINT8_MAX) {
+        operand[0] = static_cast<uint8_t>(newSlot);
+      } else {
+        // the slot grew out of the short operand, we would have to resize
+        // the instruction and fix every jump around it, at that point is
+        // simpler to compile the source again
+        return false;
+      }
+    }
+    offset += length;
+  }
+
+  if (lastOp != OP_CODE::OP_RETURN) {
+    return false;
+  }
+  for (uint32_t t = 0; t < targets.size(); ++t) {
+    if ((targets[t] >= size) || (isStart[targets[t]] == 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Chunk *deserializeChunk(const uint8_t *data, const size_t size,
+                        GlobalTable *globals, Heap *heap) {
+  CacheReader reader{data, data + size};
+
+  const uint8_t *magic = reader.readBytes(sizeof(CACHE_MAGIC));
+  if ((magic == nullptr) ||
+      (memcmp(magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)) {
+    return nullptr;
+  }
+  const uint32_t version = reader.readU32();
+  const uint32_t opCount = reader.readU32();
+  const uint32_t codeSize = reader.readU32();
+  const uint32_t runCount = reader.readU32();
+  const uint32_t constantCount = reader.readU32();
+  const uint32_t globalCount = reader.readU32();
+  if (reader.failed || (version != BYTECODE_CACHE_VERSION) ||
+      (opCount != static_cast<uint32_t>(OP_CODE::COUNT)) || (codeSize == 0) ||
+      (globalCount > MAX_LONG_OPERAND + 1)) {
+    return nullptr;
+  }
+
+  const uint8_t *code = reader.readBytes(codeSize);
+  if (code == nullptr) {
+    return nullptr;
+  }
+
+  auto *chunk = new Chunk;
+  chunk->m_code.resize(codeSize);
+  memcpy(chunk->m_code.data(), code, codeSize);
+
+  chunk->m_lines.resize(codeSize);
+  uint32_t lineOffset = 0;
+  for (uint32_t r = 0; r < runCount; ++r) {
+    const uint16_t line = reader.readU16();
+    const uint32_t run = reader.readU32();
+    if (reader.failed || (run > codeSize - lineOffset)) {
+      delete chunk;
+      return nullptr;
+    }
+    for (uint32_t i = 0; i < run; ++i) {
+      chunk->m_lines[lineOffset + i] = line;
+    }
+    lineOffset += run;
+  }
+  if (lineOffset != codeSize) {
+    delete chunk;
+    return nullptr;
+  }
+
+  for (uint32_t c = 0; c < constantCount; ++c) {
+    const auto tag = static_cast<CONSTANT_TAG>(reader.readU8());
+    switch (tag) {
+    case CONSTANT_TAG::NUMBER: {
+      const uint64_t bits = reader.readU64();
+      double number;
+      memcpy(&number, &bits, sizeof(number));
+      chunk->addConstant(makeNumber(number));
+      break;
+    }
+    case CONSTANT_TAG::STRING: {
+      const uint32_t length = reader.readU32();
+      const uint8_t *chars = reader.readBytes(length);
+      if (chars == nullptr) {
+        break;
+      }
+      // the data goes away after loading, the string keeps its own copy
+      ObjString *string = copyString(heap, reinterpret_cast<const char *>(chars),
+                                     static_cast<int>(length));
+      chunk->addConstant(makeObject(string));
+      break;
+    }
+    case CONSTANT_TAG::BOOL:
+      chunk->addConstant(makeBool(reader.readU8() != 0));
+      break;
+    case CONSTANT_TAG::NIL:
+      chunk->addConstant(makeNIL());
+      break;
+    default:
+      reader.failed = true;
+      break;
+    }
+    if (reader.failed) {
+      delete chunk;
+      return nullptr;
+    }
+  }
+
+  memory::ResizableVector<uint32_t> slots;
+  for (uint32_t g = 0; g < globalCount; ++g) {
+    const uint32_t length = reader.readU32();
+    const uint8_t *chars = reader.readBytes(length);
+    if (chars == nullptr) {
+      delete chunk;
+      return nullptr;
+    }
+    slots.pushBack(globals->getSlot(
+        memory::StringKey(reinterpret_cast<const char *>(chars), length)));
+  }
+
+  if (!checkAndRemapCode(chunk, slots.data(), globalCount)) {
+    delete chunk;
+    return nullptr;
+  }
+  // the vm sizes the stack out of this, it is not worth trusting the file
+  // for it, the code has been checked so we can walk it. Code that would
+  // pop below the stack or read locals past the top is rejected here
+  uint32_t maxStackDepth = 0;
+  if (!checkStackDepth(chunk, maxStackDepth)) {
+    delete chunk;
+    return nullptr;
+  }
+  chunk->m_maxStackDepth = maxStackDepth;
+  return chunk;
+}
+
+Chunk *loadChunk(const char *path, GlobalTable *globals, Heap *heap) {
+  memory::MappedFile file;
+  if (!file.open(path)) {
+    return nullptr;
+  }
+  return deserializeChunk(file.data(), file.size(), globals, heap);
+}
+
+} // namespace binder::vm
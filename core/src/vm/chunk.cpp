@@ -0,0 +1,224 @@
+#include "binder/vm/chunk.h"
+
+#include "assert.h"
+
+namespace binder::vm {
+
+int getInstructionLength(const OP_CODE op) {
+  switch (op) {
+  case OP_CODE::OP_CONSTANT:
+  case OP_CODE::OP_GET_LOCAL:
+  case OP_CODE::OP_SET_LOCAL:
+  case OP_CODE::OP_GET_GLOBAL:
+  case OP_CODE::OP_SET_GLOBAL:
+  case OP_CODE::OP_DEFINE_GLOBAL:
+  case OP_CODE::OP_SET_LOCAL_POP:
+  case OP_CODE::OP_SET_GLOBAL_POP:
+    return 2;
+  case OP_CODE::OP_JUMP:
+  case OP_CODE::OP_JUMP_IF_FALSE:
+  case OP_CODE::OP_JUMP_IF_FALSE_POP:
+  case OP_CODE::OP_LOOP:
+  case OP_CODE::OP_ADD_LOCAL_CONST:
+    return 3;
+  case OP_CODE::OP_CONSTANT_LONG:
+  case OP_CODE::OP_GET_GLOBAL_LONG:
+  case OP_CODE::OP_DEFINE_GLOBAL_LONG:
+  case OP_CODE::OP_SET_GLOBAL_LONG:
+    return 4;
+  case OP_CODE::OP_NIL:
+  case OP_CODE::OP_TRUE:
+  case OP_CODE::OP_FALSE:
+  case OP_CODE::OP_POP:
+  case OP_CODE::OP_EQUAL:
+  case OP_CODE::OP_GREATER:
+  case OP_CODE::OP_LESS:
+  case OP_CODE::OP_ADD:
+  case OP_CODE::OP_SUBTRACT:
+  case OP_CODE::OP_MULTIPLY:
+  case OP_CODE::OP_DIVIDE:
+  case OP_CODE::OP_NOT:
+  case OP_CODE::OP_NEGATE:
+  case OP_CODE::OP_PRINT:
+  case OP_CODE::OP_RETURN:
+  case OP_CODE::OP_NOT_EQUAL:
+  case OP_CODE::OP_GREATER_EQUAL:
+  case OP_CODE::OP_LESS_EQUAL:
+  case OP_CODE::COUNT:
+    return 1;
+  }
+  assert(0 && "unknown opcode");
+  return 1;
+}
+
+int getStackEffect(const OP_CODE op) {
+  switch (op) {
+  case OP_CODE::OP_CONSTANT:
+  case OP_CODE::OP_NIL:
+  case OP_CODE::OP_TRUE:
+  case OP_CODE::OP_FALSE:
+  case OP_CODE::OP_GET_LOCAL:
+  case OP_CODE::OP_GET_GLOBAL:
+  case OP_CODE::OP_ADD_LOCAL_CONST:
+  case OP_CODE::OP_CONSTANT_LONG:
+  case OP_CODE::OP_GET_GLOBAL_LONG:
+    return 1;
+  case OP_CODE::OP_POP:
+  case OP_CODE::OP_DEFINE_GLOBAL:
+  case OP_CODE::OP_EQUAL:
+  case OP_CODE::OP_GREATER:
+  case OP_CODE::OP_LESS:
+  case OP_CODE::OP_ADD:
+  case OP_CODE::OP_SUBTRACT:
+  case OP_CODE::OP_MULTIPLY:
+  case OP_CODE::OP_DIVIDE:
+  case OP_CODE::OP_PRINT:
+  case OP_CODE::OP_NOT_EQUAL:
+  case OP_CODE::OP_GREATER_EQUAL:
+  case OP_CODE::OP_LESS_EQUAL:
+  case OP_CODE::OP_JUMP_IF_FALSE_POP:
+  case OP_CODE::OP_SET_LOCAL_POP:
+  case OP_CODE::OP_SET_GLOBAL_POP:
+  case OP_CODE::OP_DEFINE_GLOBAL_LONG:
+    return -1;
+  case OP_CODE::OP_SET_LOCAL:
+  case OP_CODE::OP_SET_GLOBAL:
+  case OP_CODE::OP_SET_GLOBAL_LONG:
+  case OP_CODE::OP_NOT:
+  case OP_CODE::OP_NEGATE:
+  case OP_CODE::OP_JUMP:
+  case OP_CODE::OP_JUMP_IF_FALSE:
+  case OP_CODE::OP_LOOP:
+  case OP_CODE::OP_RETURN:
+  case OP_CODE::COUNT:
+    return 0;
+  }
+  assert(0 && "unknown opcode");
+  return 0;
+}
+
+static bool readsLocal(const OP_CODE op) {
+  switch (op) {
+  case OP_CODE::OP_GET_LOCAL:
+  case OP_CODE::OP_SET_LOCAL:
+  case OP_CODE::OP_SET_LOCAL_POP:
+  case OP_CODE::OP_ADD_LOCAL_CONST:
+    return true;
+  default:
+    return false;
+  }
+}
+
+// the walk behind computeMaxStackDepth and checkStackDepth, returns false
+// as soon as the code does not add up: two paths reaching an instruction
+// with a different depth, a pop on an empty stack or a local slot that is
+// not below the top of the stack
+static bool walkStack(const Chunk *chunk, const uint32_t limit,
+                      int *overflowOffset, uint32_t &maxDepthOut) {
+  const auto size = static_cast<int>(chunk->m_code.size());
+  maxDepthOut = 0;
+  if (overflowOffset != nullptr) {
+    *overflowOffset = -1;
+  }
+  if (size == 0) {
+    return true;
+  }
+
+  // depth of the stack before executing the instruction at a given offset,
+  // -1 means we did not reach it yet. The compiler only generates structured
+  // control flow, so every path reaching an instruction agrees on the depth
+  memory::ResizableVector<int> depthAt;
+  depthAt.resize(size);
+  for (int i = 0; i < size; ++i) {
+    depthAt[i] = -1;
+  }
+  memory::ResizableVector<int> toVisit;
+  depthAt[0] = 0;
+  toVisit.pushBack(0);
+
+  int maxDepth = 0;
+  while (toVisit.size() != 0) {
+    int offset = toVisit[toVisit.size() - 1];
+    toVisit.removeByPatchingFromLast(toVisit.size() - 1);
+
+    // we keep going down the fall through path until we find something we
+    // already visited or the path ends
+    for (;;) {
+      const auto op = static_cast<OP_CODE>(chunk->m_code[offset]);
+      if (readsLocal(op) && (chunk->m_code[offset + 1] >= depthAt[offset])) {
+        return false;
+      }
+      const int depth = depthAt[offset] + getStackEffect(op);
+      if (depth < 0) {
+        return false;
+      }
+      if (depth > maxDepth) {
+        maxDepth = depth;
+      }
+      const bool overflow = static_cast<uint32_t>(depth) > limit;
+      if (overflow && overflowOffset != nullptr && *overflowOffset == -1) {
+        *overflowOffset = offset;
+      }
+
+      const int next = offset + getInstructionLength(op);
+      int target = -1;
+      bool fallThrough = true;
+      switch (op) {
+      case OP_CODE::OP_JUMP:
+      case OP_CODE::OP_JUMP_IF_FALSE:
+      case OP_CODE::OP_JUMP_IF_FALSE_POP:
+      case OP_CODE::OP_LOOP: {
+        const int jump =
+            (chunk->m_code[offset + 1] << 8) | chunk->m_code[offset + 2];
+        target = op == OP_CODE::OP_LOOP ? next - jump : next + jump;
+        fallThrough =
+            (op != OP_CODE::OP_JUMP) & (op != OP_CODE::OP_LOOP);
+        break;
+      }
+      case OP_CODE::OP_RETURN:
+        fallThrough = false;
+        break;
+      default:
+        break;
+      }
+
+      if ((target >= 0) & (target < size)) {
+        if (depthAt[target] == -1) {
+          depthAt[target] = depth;
+          toVisit.pushBack(target);
+        }
+        if (depthAt[target] != depth) {
+          return false;
+        }
+      }
+      if ((!fallThrough) | (next >= size)) {
+        break;
+      }
+      if (depthAt[next] != -1) {
+        if (depthAt[next] != depth) {
+          return false;
+        }
+        break;
+      }
+      depthAt[next] = depth;
+      offset = next;
+    }
+  }
+  maxDepthOut = static_cast<uint32_t>(maxDepth);
+  return true;
+}
+
+uint32_t computeMaxStackDepth(const Chunk *chunk, const uint32_t limit,
+                              int *overflowOffset) {
+  uint32_t maxDepth = 0;
+  const bool valid = walkStack(chunk, limit, overflowOffset, maxDepth);
+  assert(valid && "inconsistent stack usage in the chunk");
+  (void)valid;
+  return maxDepth;
+}
+
+bool checkStackDepth(const Chunk *chunk, uint32_t &maxDepth) {
+  return walkStack(chunk, UINT32_MAX, nullptr, maxDepth);
+}
+
+} // namespace binder::vm
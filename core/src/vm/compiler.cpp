@@ -1,6 +1,8 @@
 #include "binder/log/log.h"
 #include "binder/vm/compiler.h"
+#include "binder/vm/memory.h"
 #include "binder/vm/object.h"
+#include "binder/vm/peephole.h"
 
 #include "stdlib.h"
 
@@ -99,7 +101,7 @@ void Compiler::dispatchFunctionId(const FUNCTION_ID id, const bool canAssign) {
   }
 }
 
-int Compiler::emitJump(const OP_CODE instruction) const
+int Compiler::emitJump(const OP_CODE instruction)
 {
 	// first we emit our normal jump
 	emitByte(instruction);
@@ -119,6 +121,7 @@ void Compiler::patchJump(const int offset)
 	// two bytes, which is the offset itself, since the offset will be
 	// eaten by the instruction
 	int jump = static_cast<int>(m_chunk->m_code.size() - offset - 2);
+	markJumpTarget();
 
 	if (jump > UINT16_MAX)
 	{
@@ -166,16 +169,44 @@ void Compiler::number(bool) {
 }
 
 void Compiler::emitConstant(const Value value) {
-  emitBytes(OP_CODE::OP_CONSTANT, makeConstant(value));
+  const uint32_t constant = makeConstant(value);
+  emitIndexed(OP_CODE::OP_CONSTANT, OP_CODE::OP_CONSTANT_LONG, constant);
 }
 
-uint8_t Compiler::makeConstant(const Value value) {
-  int constant = m_chunk->addConstant(value);
-  if (constant > UINT8_MAX) {
+memory::HashMap<uint64_t, uint32_t, hashUint64> *
+Compiler::getConstantMap(const Value value, uint64_t &key) {
+  if (isValueNumber(value)) {
+    // the bits and not the value, 0 and -0 are different constants
+    const double number = valueAsNumber(value);
+    memcpy(&key, &number, sizeof(double));
+    return &m_numberConstants;
+  }
+  if (isValueString(value)) {
+    // strings are unique, same chars same object
+    key = reinterpret_cast<uint64_t>(valueAsString(value));
+    return &m_stringConstants;
+  }
+  return nullptr;
+}
+
+uint32_t Compiler::makeConstant(const Value value) {
+  uint64_t key = 0;
+  auto *constants = getConstantMap(value, key);
+  uint32_t constant = 0;
+  if (constants != nullptr && constants->get(key, constant)) {
+    return constant;
+  }
+
+  constant = static_cast<uint32_t>(m_chunk->addConstant(value));
+  if (constant > MAX_LONG_OPERAND) {
     parser.error("Too many constants in one chunk.");
     return 0;
   }
-  return static_cast<uint8_t>(constant);
+  m_constantOrigins.pushBack(static_cast<int>(m_chunk->m_code.size()));
+  if (constants != nullptr) {
+    constants->insert(key, constant);
+  }
+  return constant;
 }
 
 void Compiler::grouping(bool) {
@@ -189,6 +220,10 @@ void Compiler::unary(bool) {
   // compiler the operand
   parsePrecedence(PREC_UNARY);
 
+  if (m_config.constantFolding && foldUnary(operatorType)) {
+    return;
+  }
+
   switch (operatorType) {
   case TOKEN_TYPE::BANG: {
     emitByte(OP_CODE::OP_NOT);
@@ -210,11 +245,14 @@ void Compiler::binary(bool) {
   const ParseRule *rule = getRule(operatorType);
   parsePrecedence(static_cast<PRECEDENCE>(rule->precedence + 1));
 
+  if (m_config.constantFolding && foldBinary(operatorType)) {
+    return;
+  }
+
   // emit the operator instruction
   switch (operatorType) {
   case TOKEN_TYPE::BANG_EQUAL:
-    // a != b is the same as !(a == b)
-    // TODO we might want to optimize this with dedicated instructions
+    // a != b is the same as !(a == b), the peephole pass fuses the two
     emitBytes(OP_CODE::OP_EQUAL, OP_CODE::OP_NOT);
     break;
   case TOKEN_TYPE::EQUAL_EQUAL:
@@ -224,8 +262,7 @@ void Compiler::binary(bool) {
     emitByte(OP_CODE::OP_GREATER);
     break;
   case TOKEN_TYPE::GREATER_EQUAL:
-    // a >= b is the same as !(a<b)
-    // TODO as != we might want to optimize with dedicated instructions
+    // a >= b is the same as !(a<b), fused as for !=
     emitBytes(OP_CODE::OP_LESS, OP_CODE::OP_NOT);
     break;
   case TOKEN_TYPE::LESS:
@@ -264,7 +301,7 @@ void Compiler::declaration() {
 }
 
 void Compiler::varDeclaration() {
-  uint8_t global = parseVariable("Expected variable name");
+  uint32_t global = parseVariable("Expected variable name");
 
   if (match(TOKEN_TYPE::EQUAL)) {
     expression();
@@ -275,26 +312,24 @@ void Compiler::varDeclaration() {
   defineVariable(global);
 }
 
-void Compiler::addLocal(const Token &token) {
+void Compiler::addLocal(const char *name) {
   if (m_localPool.localCount == UINT8_COUNT) {
     parser.error("Too many local variables in function.");
     return;
   }
   //"allocating" a new local
   Local &local = m_localPool.locals[m_localPool.localCount++];
-  // TODO do we need the full token here? ideally we just need the name
-  // and the rest can possibly be separated debug information?
-  local.name = token;
+  local.name = name;
   local.depth = -1;
 }
 
-void Compiler::declareVariable() {
+void Compiler::declareVariable(const memory::StringKey &key) {
   // here we declare the existence of local variables,
   // this only happens outside global scope, so we
   // get out if we are in global scope
   if (m_localPool.scopeDepth == 0)
     return;
-  const Token &name = parser.previous;
+  const char *name = m_intern->intern(key);
 
   // here we need to check if the variable has not been declared in the local
   // scope already
@@ -306,7 +341,7 @@ void Compiler::declareVariable() {
       break;
     }
 
-    if (identifierEqual(name, local.name)) {
+    if (name == local.name) {
       parser.error("Variable with this name already declared in this scope.");
     }
   }
@@ -314,36 +349,43 @@ void Compiler::declareVariable() {
   addLocal(name);
 }
 
-uint8_t Compiler::parseVariable(const char *error) {
+uint32_t Compiler::parseVariable(const char *error) {
   consume(TOKEN_TYPE::IDENTIFIER, error);
 
-  declareVariable();
+  const memory::StringKey name = identifierKey(parser.previous);
+  declareVariable(name);
   // so if we have a scope greater than zero it means is not
   // a global variable, this means we can return a dummy id value
   if (m_localPool.scopeDepth > 0)
     return 0;
 
-  return identifierConstant(&parser.previous);
+  return identifierSlot(name);
 }
 
-uint8_t Compiler::identifierConstant(const Token *token) {
-  // so here we build the constant, which is allocated as a string into an
-  // object this goes in the constant array, this will allow us to do the look
-  // up easily with an index
-  return makeConstant(makeObject(copyString(token->start, token->length)));
+uint32_t Compiler::identifierSlot(const memory::StringKey &name) {
+  // globals are resolved here once and for all, the name is mapped to a
+  // slot in the vm global table, the instruction will carry the slot index
+  // and the vm will not need to hash anything at runtime
+  const uint32_t slot = m_globals->getSlot(name);
+  if (slot > MAX_LONG_OPERAND) {
+    parser.error("Too many global variables.");
+    return 0;
+  }
+  return slot;
 }
 void Compiler::markInitialized() {
   m_localPool.locals[m_localPool.localCount - 1].depth = m_localPool.scopeDepth;
 }
 
-void Compiler::defineVariable(uint8_t globalId) {
+void Compiler::defineVariable(const uint32_t globalId) {
   // if we are a local variable we don't store anything since local
   // variables are pushed and popped on the stack at runtime
   if (m_localPool.scopeDepth > 0) {
     markInitialized();
     return;
   }
-  emitBytes(OP_CODE::OP_DEFINE_GLOBAL, globalId);
+  emitIndexed(OP_CODE::OP_DEFINE_GLOBAL, OP_CODE::OP_DEFINE_GLOBAL_LONG,
+              globalId);
 }
 
 void Compiler::statement() {
@@ -439,7 +481,7 @@ void Compiler::ifStatement() {
 void Compiler::whileStatement() {
 
   // setting a marker for the loop
-  int loopStart = m_chunk->m_code.size();
+  int loopStart = markJumpTarget();
 
   // as usual we parse the condition, which will deposit a bool
   // value on the stack
@@ -484,7 +526,7 @@ void Compiler::forStatement() {
     expressionStatement();
   }
 
-  int loopStart = m_chunk->m_code.size();
+  int loopStart = markJumpTarget();
 
   //conditional clause
   int exitJump = -1;
@@ -506,7 +548,7 @@ void Compiler::forStatement() {
   if(!match(TOKEN_TYPE::RIGHT_PAREN)){
       int bodyJump = emitJump(OP_CODE::OP_JUMP);
 
-      int incrementStart = m_chunk->m_code.size();
+      int incrementStart = markJumpTarget();
       expression();
       emitByte(OP_CODE::OP_POP);
       consume(TOKEN_TYPE::RIGHT_PAREN, "Expected ')' after 'for' clauses.");
@@ -541,7 +583,7 @@ void Compiler::forStatement() {
   endScope();
 }
 
-void Compiler::literal(bool) const
+void Compiler::literal(bool)
 {
   // since parse precedence already consumed the token, we just need to look
   // into previous and emit the instruction
@@ -563,15 +605,176 @@ void Compiler::literal(bool) const
 
 void Compiler::string(bool) {
 
-  // let us intern the string
+  // strings are unique, if the vm already has it we get the same object
   int len = parser.previous.length - 2;
-  const char *interned =
-      m_intern->intern(parser.previous.start + 1, parser.previous.length - 2);
-  sObjString *obj = allocateString(interned, len);
+  sObjString *obj = copyString(m_heap, parser.previous.start + 1, len);
   Value value = makeObject((sObj *)obj);
   emitConstant(value);
 }
 
+bool Compiler::readLiteral(const int instruction, Value &value) const {
+  const int offset = m_instructionStarts[instruction];
+  switch (static_cast<OP_CODE>(m_chunk->m_code[offset])) {
+  case OP_CODE::OP_CONSTANT:
+    value = m_chunk->m_constants[m_chunk->m_code[offset + 1]];
+    return true;
+  case OP_CODE::OP_CONSTANT_LONG:
+    value =
+        m_chunk->m_constants[readLongOperand(m_chunk->m_code.data() + offset + 1)];
+    return true;
+  case OP_CODE::OP_TRUE:
+    value = makeBool(true);
+    return true;
+  case OP_CODE::OP_FALSE:
+    value = makeBool(false);
+    return true;
+  case OP_CODE::OP_NIL:
+    value = makeNIL();
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool Compiler::canFold(const int count) const {
+  // the last count instructions need to be literals, and nothing can jump
+  // past the first one, something like (a and 1) + 2 lands on the 2 with
+  // either a or 1 on the stack
+  const int size = static_cast<int>(m_instructionStarts.size());
+  if (size < count || m_instructionStarts[size - count] < m_lastJumpTarget) {
+    return false;
+  }
+  Value value;
+  for (int i = size - count; i < size; ++i) {
+    if (!readLiteral(i, value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void Compiler::replaceWithLiteral(const int count, const Value value) {
+  const int first = static_cast<int>(m_instructionStarts.size()) - count;
+  const auto start = static_cast<uint32_t>(m_instructionStarts[first]);
+
+  // constants first used by the instructions we are dropping have no other
+  // user, the code being folded is the tail of the chunk, so we can reclaim
+  // them, they are the last ones in the table
+  while (m_chunk->m_constants.size() != 0 &&
+         m_constantOrigins[m_chunk->m_constants.size() - 1] >=
+             static_cast<int>(start)) {
+    const uint32_t last = m_chunk->m_constants.size() - 1;
+    uint64_t key = 0;
+    auto *constants = getConstantMap(m_chunk->m_constants[last], key);
+    if (constants != nullptr && constants->containsKey(key)) {
+      constants->remove(key);
+    }
+    m_chunk->m_constants.resize(last);
+    m_constantOrigins.resize(last);
+  }
+
+  m_chunk->m_code.resize(start);
+  m_chunk->m_lines.resize(start);
+  m_instructionStarts.resize(first);
+
+  if (isValueBool(value)) {
+    emitByte(valueAsBool(value) ? OP_CODE::OP_TRUE : OP_CODE::OP_FALSE);
+  } else if (isValueNIL(value)) {
+    emitByte(OP_CODE::OP_NIL);
+  } else {
+    emitConstant(value);
+  }
+}
+
+bool Compiler::foldUnary(const TOKEN_TYPE operatorType) {
+  if (!canFold(1)) {
+    return false;
+  }
+  Value operand;
+  readLiteral(static_cast<int>(m_instructionStarts.size()) - 1, operand);
+
+  switch (operatorType) {
+  case TOKEN_TYPE::BANG:
+    replaceWithLiteral(1, makeBool(isFalsey(operand)));
+    return true;
+  case TOKEN_TYPE::MINUS:
+    // anything but a number is a runtime error, we leave it to the vm
+    if (!isValueNumber(operand)) {
+      return false;
+    }
+    replaceWithLiteral(1, makeNumber(-valueAsNumber(operand)));
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool Compiler::foldBinary(const TOKEN_TYPE operatorType) {
+  if (!canFold(2)) {
+    return false;
+  }
+  const int size = static_cast<int>(m_instructionStarts.size());
+  Value a;
+  Value b;
+  readLiteral(size - 2, a);
+  readLiteral(size - 1, b);
+
+  // equality never fails at runtime, whatever the operands
+  if (operatorType == TOKEN_TYPE::EQUAL_EQUAL) {
+    replaceWithLiteral(2, makeBool(valuesEqual(a, b)));
+    return true;
+  }
+  if (operatorType == TOKEN_TYPE::BANG_EQUAL) {
+    replaceWithLiteral(2, makeBool(!valuesEqual(a, b)));
+    return true;
+  }
+
+  if (isValueString(a) & isValueString(b) &
+      (operatorType == TOKEN_TYPE::PLUS)) {
+    ObjString *result =
+        concatenateStrings(m_heap, valueAsString(a), valueAsString(b));
+    replaceWithLiteral(2, makeObject(result));
+    return true;
+  }
+
+  // from here on only numbers, anything else is a runtime error and the vm
+  // has to be the one reporting it
+  if (!(isValueNumber(a) & isValueNumber(b))) {
+    return false;
+  }
+  const double left = valueAsNumber(a);
+  const double right = valueAsNumber(b);
+  switch (operatorType) {
+  case TOKEN_TYPE::PLUS:
+    replaceWithLiteral(2, makeNumber(left + right));
+    return true;
+  case TOKEN_TYPE::MINUS:
+    replaceWithLiteral(2, makeNumber(left - right));
+    return true;
+  case TOKEN_TYPE::STAR:
+    replaceWithLiteral(2, makeNumber(left * right));
+    return true;
+  case TOKEN_TYPE::SLASH:
+    replaceWithLiteral(2, makeNumber(left / right));
+    return true;
+  case TOKEN_TYPE::GREATER:
+    replaceWithLiteral(2, makeBool(left > right));
+    return true;
+  case TOKEN_TYPE::LESS:
+    replaceWithLiteral(2, makeBool(left < right));
+    return true;
+  // same negated form the runtime uses, matters for NaN
+  case TOKEN_TYPE::GREATER_EQUAL:
+    replaceWithLiteral(2, makeBool(!(left < right)));
+    return true;
+  case TOKEN_TYPE::LESS_EQUAL:
+    replaceWithLiteral(2, makeBool(!(left > right)));
+    return true;
+  default:
+    return false;
+  }
+}
+
 void Compiler::variable(const bool canAssign) {
   namedVariable(parser.previous, canAssign);
 }
@@ -627,15 +830,21 @@ void Compiler::parseOr(bool) {
 void Compiler::namedVariable(const Token &token, const bool canAssign) {
   OP_CODE getOp;
   OP_CODE setOp;
+  // locals are at most 256, only globals can need the long form
+  OP_CODE getLongOp = OP_CODE::OP_GET_GLOBAL_LONG;
+  OP_CODE setLongOp = OP_CODE::OP_SET_GLOBAL_LONG;
 
   // we first try to resolve the variable locally
   // if we don't find one we resolve it globally
-  int arg = resolveLocal(token);
-  if (arg != -1) {
+  uint32_t arg = 0;
+  const memory::StringKey name = identifierKey(token);
+  const int local = resolveLocal(name);
+  if (local != -1) {
+    arg = static_cast<uint32_t>(local);
     getOp = OP_CODE::OP_GET_LOCAL;
     setOp = OP_CODE::OP_SET_LOCAL;
   } else {
-    arg = identifierConstant(&token);
+    arg = identifierSlot(name);
     getOp = OP_CODE::OP_GET_GLOBAL;
     setOp = OP_CODE::OP_SET_GLOBAL;
   }
@@ -645,19 +854,24 @@ void Compiler::namedVariable(const Token &token, const bool canAssign) {
   // it means we want to set  such variable not get it
   if (canAssign & match(TOKEN_TYPE::EQUAL)) {
     expression();
-    emitBytes(setOp, arg);
+    emitIndexed(setOp, setLongOp, arg);
   } else {
-    emitBytes(getOp, arg);
+    emitIndexed(getOp, getLongOp, arg);
   }
 }
 
-int Compiler::resolveLocal(const Token &name) {
+int Compiler::resolveLocal(const memory::StringKey &key) {
+  // no locals at global scope, no need to intern the name
+  if (m_localPool.localCount == 0) {
+    return -1;
+  }
   // local resolution is fairly straight forward, we walk back
   // until we find a matching variable or we are on a lower level scope
-  // aka parent scope
+  // aka parent scope, names are interned so comparing is a pointer compare
+  const char *name = m_intern->intern(key);
   for (int i = m_localPool.localCount - 1; i >= 0; --i) {
     const Local &local = m_localPool.locals[i];
-    if (identifierEqual(name, local.name)) {
+    if (name == local.name) {
       if (local.depth == -1) {
         parser.error("Cannot read local variable in its own initializer");
       }
@@ -668,46 +882,28 @@ int Compiler::resolveLocal(const Token &name) {
 }
 
 void Scanner::skipWhiteSpace() {
-  // we keep chew until we find a non white space
-
-  // TODO would be interesting to see if we can use
-  // avx to speed this up
+  // we keep chew until we find a non white space, the runs of blanks and the
+  // comments are walked a block of chars at the time
   for (;;) {
-    char c = peek();
-    switch (c) {
-    case ' ':
-    case '\r':
-    case '\t':
-      advance();
-      break;
-    case '\n':
-      line++;
-      advance();
-      break;
-    case '/':
-      // checking for double /
-      if (peekNext() == '/') { // we need to skip until end of the line
-        while ((peek() != '\n') & (!isAtEnd()))
-          advance();
-      } else {
-        return;
-      }
-      break;
+    uint32_t newLines = 0;
+    current = chars::skipWhiteSpace(current, end, newLines);
+    line += static_cast<int>(newLines);
 
-    default:
+    // checking for double /
+    if ((peek() != '/') || (peekNext() != '/')) {
       return;
     }
+    // we need to skip until end of the line, the new line is eaten by the
+    // next round
+    current = chars::findNewLine(current + 2, end);
   }
 }
 
 Token Scanner::string() {
   // keep eating until we get a closing quote
-  while (peek() != '"' && !isAtEnd()) {
-    if (peek() == '\n') {
-      line++;
-    }
-    advance();
-  }
+  uint32_t newLines = 0;
+  current = chars::findQuote(current, end, newLines);
+  line += static_cast<int>(newLines);
 
   if (isAtEnd())
     return errorToken("Unterminated string.");
@@ -719,16 +915,12 @@ Token Scanner::string() {
 
 Token Scanner::number() {
   // keep eating until we find numbers
-  while (isDigit(peek()))
-    advance();
+  current = chars::skipDigits(current, end);
 
   // if we find a dot there might be a fractional part
   if ((peek() == '.') & isDigit(peekNext())) {
     // we eat the dot and parse as many numbers as we can
-    advance();
-
-    while (isDigit(peek()))
-      advance();
+    current = chars::skipDigits(current + 1, end);
   }
 
   return makeToken(TOKEN_TYPE::NUMBER);
@@ -805,9 +997,7 @@ TOKEN_TYPE Scanner::identifierType() const
 Token Scanner::identifier() {
   // here this works because we already matched an alpha, so we
   // know the the the first value aint a digit
-  while (isAlpha(peek()) | isDigit(peek())) {
-    advance();
-  }
+  current = chars::skipIdentifier(current, end);
   return makeToken(identifierType());
 }
 
@@ -872,6 +1062,17 @@ Token Scanner::scanToken() {
 bool Compiler::compile(const char *source, log::Log *logger) {
 
   m_chunk = new Chunk;
+  // roughly a byte of code every few chars of source, reserving upfront
+  // saves most of the reallocations while emitting, the vectors still grow
+  // if the guess is short
+  const auto codeEstimate = static_cast<uint32_t>(strlen(source) / 4);
+  m_chunk->m_code.reserve(codeEstimate);
+  m_chunk->m_lines.reserve(codeEstimate);
+  m_instructionStarts.clear();
+  m_lastJumpTarget = 0;
+  m_numberConstants.clear();
+  m_stringConstants.clear();
+  m_constantOrigins.clear();
 
   scanner.init(source);
   // setup the pump
@@ -887,6 +1088,11 @@ bool Compiler::compile(const char *source, log::Log *logger) {
   if (gotError) {
     delete m_chunk;
     m_chunk = nullptr;
+  } else {
+    if (m_config.peephole) {
+      optimizeChunk(m_chunk);
+    }
+    m_chunk->m_maxStackDepth = computeMaxStackDepth(m_chunk);
   }
 
   return !gotError;
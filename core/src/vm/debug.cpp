@@ -17,12 +17,35 @@ static int constantInstruction(const char *name, const Chunk *chunk, const int o
   log::LOG(logger, "\n");
   return offset + 2;
 }
+static int constantLongInstruction(const char *name, const Chunk *chunk,
+                                   const int offset, log::Log *logger) {
+  const uint32_t constant = readLongOperand(chunk->m_code.data() + offset + 1);
+  log::LOG(logger, "%-16s %4d '", name, constant);
+  printValue(chunk->m_constants[constant], logger);
+  log::LOG(logger, "\n");
+  return offset + 4;
+}
+static int longInstruction(const char *name, const Chunk *chunk,
+                           const int offset, log::Log *logger) {
+  const uint32_t slot = readLongOperand(chunk->m_code.data() + offset + 1);
+  log::LOG(logger, "%-16s %4d\n", name, slot);
+  return offset + 4;
+}
 static int byteInstruction(const char *name, const Chunk *chunk, const int offset,
                            log::Log *logger) {
   const uint8_t slot = chunk->m_code[offset + 1];
   log::LOG(logger, "%-16s %4d\n", name, slot);
   return offset + 2;
 }
+static int localConstantInstruction(const char *name, const Chunk *chunk,
+                                    const int offset, log::Log *logger) {
+  const uint8_t slot = chunk->m_code[offset + 1];
+  const uint8_t constant = chunk->m_code[offset + 2];
+  log::LOG(logger, "%-16s %4d %4d '", name, slot, constant);
+  printValue(chunk->m_constants[constant], logger);
+  log::LOG(logger, "\n");
+  return offset + 3;
+}
 static int jumpInstruction(const char *name, const int sign, const Chunk *chunk,
                            const int offset, log::Log *logger) {
   auto jump = static_cast<uint16_t>(chunk->m_code[offset + 1] << 8);
@@ -65,15 +88,15 @@ int disassambleInstruction(const Chunk *chunk, const int offset, log::Log *logge
   case OP_CODE::OP_POP:
     return simpleInstruction("OP_POP", offset, logger);
   case OP_CODE::OP_DEFINE_GLOBAL:
-    return constantInstruction("OP_DEFINE_GLOBAL", chunk, offset, logger);
+    return byteInstruction("OP_DEFINE_GLOBAL", chunk, offset, logger);
   case OP_CODE::OP_GET_LOCAL:
     return byteInstruction("OP_GET_LOCAL", chunk, offset, logger);
   case OP_CODE::OP_SET_LOCAL:
     return byteInstruction("OP_SET_LOCAL", chunk, offset, logger);
   case OP_CODE::OP_GET_GLOBAL:
-    return constantInstruction("OP_GET_GLOBAL", chunk, offset, logger);
+    return byteInstruction("OP_GET_GLOBAL", chunk, offset, logger);
   case OP_CODE::OP_SET_GLOBAL:
-    return constantInstruction("OP_SET_GLOBAL", chunk, offset, logger);
+    return byteInstruction("OP_SET_GLOBAL", chunk, offset, logger);
   case OP_CODE::OP_EQUAL:
     return simpleInstruction("OP_EQUAL", offset, logger);
   case OP_CODE::OP_GREATER:
@@ -90,6 +113,8 @@ int disassambleInstruction(const Chunk *chunk, const int offset, log::Log *logge
     return simpleInstruction("OP_MULTIPLY", offset, logger);
   case OP_CODE::OP_DIVIDE:
     return simpleInstruction("OP_DIVIDE", offset, logger);
+  case OP_CODE::OP_NOT:
+    return simpleInstruction("OP_NOT", offset, logger);
   case OP_CODE::OP_NEGATE:
     return simpleInstruction("OP_NEGATE", offset, logger);
   case OP_CODE::OP_PRINT:
@@ -102,6 +127,29 @@ int disassambleInstruction(const Chunk *chunk, const int offset, log::Log *logge
     return jumpInstruction("OP_LOOP", -1, chunk, offset, logger);
   case OP_CODE::OP_RETURN:
     return simpleInstruction("OP_RETURN", offset, logger);
+  case OP_CODE::OP_NOT_EQUAL:
+    return simpleInstruction("OP_NOT_EQUAL", offset, logger);
+  case OP_CODE::OP_GREATER_EQUAL:
+    return simpleInstruction("OP_GREATER_EQUAL", offset, logger);
+  case OP_CODE::OP_LESS_EQUAL:
+    return simpleInstruction("OP_LESS_EQUAL", offset, logger);
+  case OP_CODE::OP_ADD_LOCAL_CONST:
+    return localConstantInstruction("OP_ADD_LOCAL_CONST", chunk, offset,
+                                    logger);
+  case OP_CODE::OP_JUMP_IF_FALSE_POP:
+    return jumpInstruction("OP_JUMP_IF_FALSE_POP", 1, chunk, offset, logger);
+  case OP_CODE::OP_SET_LOCAL_POP:
+    return byteInstruction("OP_SET_LOCAL_POP", chunk, offset, logger);
+  case OP_CODE::OP_SET_GLOBAL_POP:
+    return byteInstruction("OP_SET_GLOBAL_POP", chunk, offset, logger);
+  case OP_CODE::OP_CONSTANT_LONG:
+    return constantLongInstruction("OP_CONSTANT_LONG", chunk, offset, logger);
+  case OP_CODE::OP_GET_GLOBAL_LONG:
+    return longInstruction("OP_GET_GLOBAL_LONG", chunk, offset, logger);
+  case OP_CODE::OP_DEFINE_GLOBAL_LONG:
+    return longInstruction("OP_DEFINE_GLOBAL_LONG", chunk, offset, logger);
+  case OP_CODE::OP_SET_GLOBAL_LONG:
+    return longInstruction("OP_SET_GLOBAL_LONG", chunk, offset, logger);
   default:
     log::LOG(logger, "Unknown opcode %d\n", instruction);
     return offset + 1;
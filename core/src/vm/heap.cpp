@@ -0,0 +1,104 @@
+#include "binder/vm/heap.h"
+
+namespace binder::vm {
+
+static memory::StringKey stringKey(const sObjString *string) {
+  return {stringChars(string), static_cast<uint32_t>(string->length),
+          string->hash};
+}
+
+static size_t getObjectSize(const sObj *object) {
+  switch (object->type) {
+  case OBJ_TYPE::OBJ_STRING: {
+    const auto *string = reinterpret_cast<const sObjString *>(object);
+    return stringAllocationSize(string->length);
+  }
+  }
+  return 0;
+}
+
+sObj *Heap::allocateObject(const size_t size, const OBJ_TYPE type) {
+  auto *object =
+      static_cast<sObj *>(m_allocator.allocate(static_cast<uint32_t>(size)));
+  object->type = type;
+  object->isMarked = false;
+  object->next = m_objects;
+  m_objects = object;
+  m_allocatedBytes += size;
+  return object;
+}
+
+void Heap::addString(sObjString *string) {
+  m_strings.insertView(stringKey(string), string);
+}
+
+sObjString *Heap::findString(const char *chars, const int length,
+                             const uint32_t hash) const {
+  sObjString *known = nullptr;
+  if (m_strings.get(memory::StringKey(chars, length, hash), known)) {
+    return known;
+  }
+  return nullptr;
+}
+
+sObjString *Heap::findString(const char *prefix, const int prefixLength,
+                             const char *suffix, const int suffixLength,
+                             const uint32_t hash) const {
+  sObjString *known = nullptr;
+  if (m_strings.get(prefix, prefixLength, suffix, suffixLength, hash, known)) {
+    return known;
+  }
+  return nullptr;
+}
+
+void Heap::freeObject(sObj *object) {
+  const size_t size = getObjectSize(object);
+  m_allocatedBytes -= size;
+  switch (object->type) {
+  case OBJ_TYPE::OBJ_STRING: {
+    auto *string = reinterpret_cast<sObjString *>(object);
+    m_strings.remove(stringKey(string));
+    break;
+  }
+  }
+  m_allocator.free(object, static_cast<uint32_t>(size));
+}
+
+void Heap::freeObjects() {
+  sObj *object = m_objects;
+  while (object != nullptr) {
+    sObj *next = object->next;
+    freeObject(object);
+    object = next;
+  }
+  m_objects = nullptr;
+  // gets rid of the deleted bins left behind by the removals
+  m_strings.clear();
+}
+
+void Heap::sweep(GCStats *stats) {
+  sObj *previous = nullptr;
+  sObj *object = m_objects;
+  while (object != nullptr) {
+    if (object->isMarked) {
+      object->isMarked = false;
+      previous = object;
+      object = object->next;
+      continue;
+    }
+
+    sObj *unreached = object;
+    object = object->next;
+    if (previous != nullptr) {
+      previous->next = object;
+    } else {
+      m_objects = object;
+    }
+    ++stats->objectsFreed;
+    stats->bytesFreed += getObjectSize(unreached);
+    freeObject(unreached);
+  }
+  ++stats->collections;
+}
+
+} // namespace binder::vm
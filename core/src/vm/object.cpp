@@ -1,75 +1,64 @@
 #include "binder/log/log.h"
+#include "binder/vm/heap.h"
 #include "binder/vm/memory.h"
 #include "binder/vm/object.h"
 #include "binder/vm/value.h"
 
 namespace binder ::vm {
 
-sObj *ALLOCATIONS = nullptr;
-
-#define ALLOCATE_OBJ(type, objectType)                                         \
-  (type *)allocateObject(sizeof(type), objectType);
-
-sObj *allocateObject(const size_t size, const OBJ_TYPE type) {
-  sObj *object = static_cast<sObj*>(reallocate(nullptr, 0, size));
-  if (ALLOCATIONS == nullptr) {
-    ALLOCATIONS = object;
-    object->next = nullptr;
-  } else {
-    object->next = ALLOCATIONS;
-    ALLOCATIONS = object;
-  }
-
-  object->type = type;
-  return object;
+// the caller makes sure the heap does not know the string yet, fills in the
+// chars and then hands the string to heap->addString
+static sObjString *allocateString(Heap *heap, const int length,
+                                  const uint32_t hash) {
+  auto *string = reinterpret_cast<sObjString *>(heap->allocateObject(
+      stringAllocationSize(length), OBJ_TYPE::OBJ_STRING));
+  string->length = length;
+  string->hash = hash;
+  // we don't know exactly where the chars come from and if they are null
+  // terminated, so we set it manually
+  stringChars(string)[length] = '\0';
+  return string;
 }
 
-void freeObject(sObj *object) {
-  switch (object->type) {
-  case OBJ_TYPE::OBJ_STRING: {
-    //string is interned, meaning won't be freed here but from the vm
-    FREE(sObjString, object);
-    break;
-  }
-  }
+sObjString *takeString(Heap *heap, char *chars, const int length) {
+  sObjString *string = copyString(heap, chars, length);
+  FREE_ARRAY(char, chars, length + 1);
+  return string;
 }
 
-void freeAllocations() {
-  if (ALLOCATIONS == nullptr) {
-
-    return;
-  }
-  sObj *obj = ALLOCATIONS;
-  while (obj != nullptr) {
-    sObj *next = obj->next;
-    freeObject(obj);
-    obj = next;
-  }
-  ALLOCATIONS = nullptr;
+sObjString *copyString(Heap *heap, const char *chars, int length) {
+  return copyString(heap, chars, length, hashStringChars(chars, length));
 }
 
-sObjString *allocateString(const char *chars, int length) {
-  sObjString *string = ALLOCATE_OBJ(sObjString, OBJ_TYPE::OBJ_STRING);
-  string->length = length;
-  //TODO here we move the cast away mostly because we use the re-alloc workflow,
-  //need to clean this up
-  string->chars = const_cast<char*>(chars);
+sObjString *copyString(Heap *heap, const char *chars, const int length,
+                       const uint32_t hash) {
+  sObjString *known = heap->findString(chars, length, hash);
+  if (known != nullptr) {
+    return known;
+  }
+  sObjString *string = allocateString(heap, length, hash);
+  memcpy(stringChars(string), chars, length);
+  heap->addString(string);
   return string;
 }
 
-sObjString *takeString(char *chars, const int length) {
-  // here we take ownership of the chars, they have been already copied to
-  // memory we can own
-  return allocateString(chars, length);
-}
-
-sObjString *copyString(const char *chars, int length) {
-  char *heapChars = ALLOCATE(char, length + 1);
-  // we don't know exactly where this string comes from and
-  // if is nullterminated, so we set it manually;
-  memcpy(heapChars, chars, length);
-  heapChars[length] = '\0';
-  return allocateString(heapChars, length);
+sObjString *concatenateStrings(Heap *heap, const sObjString *a,
+                               const sObjString *b) {
+  const char *left = stringChars(a);
+  const char *right = stringChars(b);
+  const uint32_t hash = hashStringChars(right, b->length, a->hash);
+  sObjString *known =
+      heap->findString(left, a->length, right, b->length, hash);
+  if (known != nullptr) {
+    return known;
+  }
+  const int length = a->length + b->length;
+  sObjString *string = allocateString(heap, length, hash);
+  char *chars = stringChars(string);
+  memcpy(chars, left, a->length);
+  memcpy(chars + a->length, right, b->length);
+  heap->addString(string);
+  return string;
 }
 
 void printObject(Value *value, log::Log *logger) {
@@ -80,4 +69,12 @@ void printObject(Value *value, log::Log *logger) {
   }
 }
 
+void markObject(sObj *object) { object->isMarked = true; }
+
+void markValue(const Value value) {
+  if (isValueObj(value)) {
+    markObject(valueAsObj(value));
+  }
+}
+
 } // namespace binder::vm
@@ -0,0 +1,164 @@
+#include "binder/vm/peephole.h"
+
+#include "assert.h"
+
+namespace binder::vm {
+
+struct JumpFixup {
+  // where the jump instruction ended up in the optimized code
+  int offset;
+  // where the jump was going in the original code
+  int oldTarget;
+};
+
+static bool isJump(const OP_CODE op) {
+  return (op == OP_CODE::OP_JUMP) | (op == OP_CODE::OP_JUMP_IF_FALSE) |
+         (op == OP_CODE::OP_JUMP_IF_FALSE_POP) | (op == OP_CODE::OP_LOOP);
+}
+
+static int readJumpTarget(const Chunk *chunk, const int offset) {
+  const auto op = static_cast<OP_CODE>(chunk->m_code[offset]);
+  const int jump = (chunk->m_code[offset + 1] << 8) | chunk->m_code[offset + 2];
+  const int next = offset + 3;
+  return op == OP_CODE::OP_LOOP ? next - jump : next + jump;
+}
+
+void optimizeChunk(Chunk *chunk) {
+  const auto size = static_cast<int>(chunk->m_code.size());
+  uint8_t *code = chunk->m_code.data();
+  uint16_t *lines = chunk->m_lines.data();
+
+  // first we find every instruction something jumps to, we can only fuse a
+  // sequence if the only way into it is from its first instruction
+  memory::ResizableVector<uint8_t> isTarget;
+  isTarget.resize(size + 1);
+  memset(isTarget.data(), 0, size + 1);
+  for (int offset = 0; offset < size;) {
+    const auto op = static_cast<OP_CODE>(code[offset]);
+    if (isJump(op)) {
+      const int target = readJumpTarget(chunk, offset);
+      isTarget[target] = 1;
+      // a fused conditional jump lands one instruction after its target
+      if (target < size &&
+          code[target] == static_cast<uint8_t>(OP_CODE::OP_POP)) {
+        isTarget[target + 1] = 1;
+      }
+    }
+    offset += getInstructionLength(op);
+  }
+
+  auto opAt = [&](const int offset) {
+    return offset < size ? static_cast<OP_CODE>(code[offset]) : OP_CODE::COUNT;
+  };
+  // the instruction at offset exists and can be part of a fused sequence
+  auto canFuse = [&](const int offset, const OP_CODE op) {
+    return (offset < size) && (isTarget[offset] == 0) && (opAt(offset) == op);
+  };
+
+  // the rewrite happens in place, fused instructions are never longer than
+  // what they replace, so the write head never overtakes the read one
+  memory::ResizableVector<int> newOffset;
+  newOffset.resize(size + 1);
+  memory::ResizableVector<JumpFixup> fixups;
+  int read = 0;
+  int write = 0;
+  while (read < size) {
+    const OP_CODE op = opAt(read);
+    const int length = getInstructionLength(op);
+    const int next = read + length;
+    newOffset[read] = write;
+
+    // everything is read before writing, the output can overlap the input
+    uint8_t out[4] = {code[read], 0, 0, 0};
+    int outLength = length;
+    int consumed = length;
+    uint16_t line = lines[read];
+    int oldTarget = isJump(op) ? readJumpTarget(chunk, read) : -1;
+    for (int i = 1; i < length; ++i) {
+      out[i] = code[read + i];
+    }
+
+    switch (op) {
+    case OP_CODE::OP_EQUAL:
+    case OP_CODE::OP_LESS:
+    case OP_CODE::OP_GREATER: {
+      if (canFuse(next, OP_CODE::OP_NOT)) {
+        OP_CODE fused = OP_CODE::OP_NOT_EQUAL;
+        fused = op == OP_CODE::OP_LESS ? OP_CODE::OP_GREATER_EQUAL : fused;
+        fused = op == OP_CODE::OP_GREATER ? OP_CODE::OP_LESS_EQUAL : fused;
+        out[0] = static_cast<uint8_t>(fused);
+        consumed = 2;
+      }
+      break;
+    }
+    case OP_CODE::OP_GET_LOCAL: {
+      // only number constants, the handler can then skip the string path
+      const int constant = next;
+      const int add = next + 2;
+      if (canFuse(constant, OP_CODE::OP_CONSTANT) &&
+          canFuse(add, OP_CODE::OP_ADD) &&
+          isValueNumber(chunk->m_constants[code[constant + 1]])) {
+        out[0] = static_cast<uint8_t>(OP_CODE::OP_ADD_LOCAL_CONST);
+        out[2] = code[constant + 1];
+        outLength = 3;
+        consumed = 5;
+        // errors are reported by the add
+        line = lines[add];
+      }
+      break;
+    }
+    case OP_CODE::OP_JUMP_IF_FALSE: {
+      // both if and while pop the condition at the start of the two branches,
+      // so we pop in the jump and skip the pop at the target
+      if (canFuse(next, OP_CODE::OP_POP) && oldTarget < size &&
+          opAt(oldTarget) == OP_CODE::OP_POP) {
+        out[0] = static_cast<uint8_t>(OP_CODE::OP_JUMP_IF_FALSE_POP);
+        oldTarget += 1;
+        consumed = 4;
+      }
+      break;
+    }
+    case OP_CODE::OP_SET_LOCAL:
+    case OP_CODE::OP_SET_GLOBAL: {
+      if (canFuse(next, OP_CODE::OP_POP)) {
+        out[0] = static_cast<uint8_t>(op == OP_CODE::OP_SET_LOCAL
+                                          ? OP_CODE::OP_SET_LOCAL_POP
+                                          : OP_CODE::OP_SET_GLOBAL_POP);
+        consumed = 3;
+      }
+      break;
+    }
+    default:
+      break;
+    }
+
+    if (oldTarget != -1) {
+      fixups.pushBack({write, oldTarget});
+    }
+    for (int i = 0; i < outLength; ++i) {
+      code[write + i] = out[i];
+      lines[write + i] = line;
+    }
+    write += outLength;
+    read += consumed;
+  }
+  newOffset[size] = write;
+
+  // now that we know where every instruction landed we can patch the jumps,
+  // the code only shrinks so every offset still fits in 16 bits
+  for (uint32_t i = 0; i < fixups.size(); ++i) {
+    const JumpFixup &fixup = fixups[i];
+    const auto op = static_cast<OP_CODE>(code[fixup.offset]);
+    const int next = fixup.offset + 3;
+    const int target = newOffset[fixup.oldTarget];
+    const int jump = op == OP_CODE::OP_LOOP ? next - target : target - next;
+    assert((jump >= 0) & (jump <= UINT16_MAX));
+    code[fixup.offset + 1] = static_cast<uint8_t>((jump >> 8) & 0xff);
+    code[fixup.offset + 2] = static_cast<uint8_t>(jump & 0xff);
+  }
+
+  chunk->m_code.resize(write);
+  chunk->m_lines.resize(write);
+}
+
+} // namespace binder::vm
@@ -7,7 +7,7 @@ namespace binder::vm {
 
 void printValue(Value value, log::Log *logger) {
   char valueBuffer[64];
-  switch (value.type) {
+  switch (getValueType(value)) {
   case VALUE_TYPE::VAL_NUMBER: {
     sprintf(valueBuffer, "%g", valueAsNumber(value));
     logger->print(valueBuffer);
@@ -27,25 +27,31 @@ void printValue(Value value, log::Log *logger) {
     printObject(&value,logger);
     break;
   }
+  case VALUE_TYPE::VAL_UNDEFINED: {
+    // should never reach a script, but the debug output might show it
+    sprintf(valueBuffer, "undefined");
+    logger->print(valueBuffer);
+    break;
+  }
   }
 }
 
 bool valuesEqual(Value a, Value b) {
-  if (a.type != b.type)
+  const VALUE_TYPE type = getValueType(a);
+  if (type != getValueType(b))
     return false;
 
-  switch (a.type) {
+  switch (type) {
   case VALUE_TYPE::VAL_BOOL:
     return valueAsBool(a) == valueAsBool(b);
   case VALUE_TYPE::VAL_NIL:
+  case VALUE_TYPE::VAL_UNDEFINED:
     return true;
   case VALUE_TYPE::VAL_NUMBER:
     return valueAsNumber(a) == valueAsNumber(b);
   case VALUE_TYPE::VAL_OBJ: {
-    // temporary string cast, we need to check proper type
-    ObjString *aString = valueAsString(a);
-    ObjString *bString = valueAsString(b);
-    return aString->chars == bString->chars;
+    // strings are unique, so same object same string
+    return valueAsObj(a) == valueAsObj(b);
   }
   default: // unreacheable
     assert(0);
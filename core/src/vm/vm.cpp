@@ -1,4 +1,5 @@
 #include "binder/log/log.h"
+#include "binder/vm/bytecodeCache.h"
 #include "binder/vm/compiler.h"
 #include "binder/vm/debug.h"
 #include "binder/vm/memory.h"
@@ -12,6 +13,7 @@ namespace binder::vm {
 #define BINARY_OP(valueType, op)                                               \
   do {                                                                         \
     if ((!isValueNumber(peek(0))) | (!isValueNumber(peek(1)))) {               \
+      VM_STORE_IP();                                                           \
       runtimeError("Operands must be numbers.");                               \
       return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;                        \
     }                                                                          \
@@ -20,10 +22,29 @@ namespace binder::vm {
     stackPush(valueType(a op b));                                              \
   } while (false)
 
+VirtualMachine::VirtualMachine(log::Log *logger, const uint32_t stackLimit)
+    : m_stackLimit(stackLimit), m_logger(logger), m_intern(1024),
+      m_globals(1024) {
+  const bool reserved = m_stackMemory.reserve(stackLimit * sizeof(Value));
+  assert(reserved);
+  (void)reserved;
+  m_stack = static_cast<Value *>(m_stackMemory.data());
+  resetStack();
+}
+
 void VirtualMachine::init() { resetStack(); }
-VirtualMachine::~VirtualMachine() { freeAllocations(); }
+VirtualMachine::~VirtualMachine() {
+  for (uint32_t i = 0; i < m_chunks.size(); ++i) {
+    delete m_chunks[i];
+  }
+}
 
 void VirtualMachine::stackPush(Value value) {
+  // no bounds check here, prepareStack() made sure the chunk can't go past
+  // the committed memory before we started running
+  assert(reinterpret_cast<char *>(m_stackTop + 1) <=
+         static_cast<char *>(m_stackMemory.data()) +
+             m_stackMemory.getCommittedSize());
   *m_stackTop = value;
   ++m_stackTop;
 }
@@ -34,19 +55,41 @@ Value VirtualMachine::stackPop() {
 }
 
 void VirtualMachine::concatenate() {
+  maybeCollectGarbage();
   ObjString *b = valueAsString(stackPop());
   ObjString *a = valueAsString(stackPop());
+  stackPush(makeObject(concatenateStrings(&m_heap, a, b)));
+}
+
+void VirtualMachine::collectGarbage() {
+  for (Value *slot = m_stack; slot < m_stackTop; ++slot) {
+    markValue(*slot);
+  }
+  const Value *globals = m_globals.getValues();
+  for (uint32_t i = 0; i < m_globals.size(); ++i) {
+    markValue(globals[i]);
+  }
+  // the constants of every chunk we handed out and was not released yet,
+  // the caller can run any of them at any point. Chunks built outside the
+  // vm have no way to reference our heap, there is nothing to mark for them
+  for (uint32_t c = 0; c < m_chunks.size(); ++c) {
+    const Chunk *chunk = m_chunks[c];
+    for (uint32_t i = 0; i < chunk->m_constants.size(); ++i) {
+      markValue(chunk->m_constants[i]);
+    }
+  }
+  m_heap.sweep(&m_gcStats);
 
-  int length = a->length + b->length;
-  char *chars = ALLOCATE(char, length + 1);
-  memcpy(chars, a->chars, a->length);
-  memcpy(chars + a->length, b->chars, b->length);
-  chars[length] = '\0';
+  const size_t grown = m_heap.getAllocatedBytes() * m_gcConfig.growFactor;
+  m_nextCollection =
+      grown > m_gcConfig.initialThreshold ? grown : m_gcConfig.initialThreshold;
+}
 
-  // interning the characters
-  chars = (char *)m_intern.intern(chars, length, false);
-  ObjString *result = allocateString(chars, length);
-  stackPush(makeObject(result));
+void VirtualMachine::undefinedVariableError(const uint32_t slot) {
+  char message[1024];
+  snprintf(message, sizeof(message), "Undefined variable '%s'.",
+           m_globals.getName(slot));
+  runtimeError(message);
 }
 
 void VirtualMachine::runtimeError(const char *message) {
@@ -56,141 +99,315 @@ void VirtualMachine::runtimeError(const char *message) {
   resetStack();
 }
 
-bool isFalsey(Value value) {
-  // first we check wether the value is null, we also check if the value is bool
-  // then we also negate the bool value
-  return isValueNIL(value) | isValueBool(value) && (!valueAsBool(value));
-}
+// used by the fused comparisons, builds the negated result of the comparison
+// so BINARY_OP can be reused as is
+inline Value makeNotBool(const bool value) { return makeBool(!value); }
 
 INTERPRET_RESULT VirtualMachine::compile(const char *source) {
-  Compiler compiler(&m_intern);
+  Compiler compiler(&m_intern, &m_globals, &m_heap, m_compilerConfig);
 
-  if (!compiler.compile(source, m_logger)) {
+  const bool compiled = compiler.compile(source, m_logger);
+  // the intern only holds the names of the locals, nothing past the compile
+  // points at them, globals own their names and strings live in the heap.
+  // Dropping them all at once keeps a long lived vm from piling up names
+  m_intern.reset();
+  if (!compiled) {
     return INTERPRET_RESULT::INTERPRET_COMPILE_ERROR;
   }
   m_chunk = compiler.getCompiledChunk();
+  m_chunks.pushBack(m_chunk);
   return INTERPRET_RESULT::INTERPRET_OK;
 }
 
-INTERPRET_RESULT VirtualMachine::interpret(const char *source) {
+void VirtualMachine::releaseChunk(const Chunk *chunk) {
+  if (chunk == nullptr) {
+    return;
+  }
+  uint32_t index = 0;
+  while ((index < m_chunks.size()) && (m_chunks[index] != chunk)) {
+    ++index;
+  }
+  assert(index < m_chunks.size() && "chunk not owned by this vm");
+  if (index == m_chunks.size()) {
+    return;
+  }
+  m_chunks.removeByPatchingFromLast(index);
+  if (m_chunk == chunk) {
+    m_chunk = nullptr;
+  }
+  if (m_scriptChunk == chunk) {
+    m_scriptChunk = nullptr;
+  }
+  delete chunk;
+}
 
-  if (compile(source) != INTERPRET_RESULT::INTERPRET_OK) {
-    return INTERPRET_RESULT::INTERPRET_COMPILE_ERROR;
+bool VirtualMachine::saveCompiledChunk(const char *path) const {
+  if (m_chunk == nullptr) {
+    return false;
   }
+  return saveChunk(m_chunk, &m_globals, path);
+}
 
-  m_ip = m_chunk->m_code.data();
-  resetStack();
-  return run();
+const Chunk *VirtualMachine::loadChunk(const char *path) {
+  const Chunk *chunk = vm::loadChunk(path, &m_globals, &m_heap);
+  if (chunk != nullptr) {
+    m_chunk = chunk;
+    m_chunks.pushBack(chunk);
+  }
+  return chunk;
+}
+
+bool VirtualMachine::prepareStack() {
+  // the compiler knows how deep the stack can get for the chunk, so we check
+  // the limit once here rather than on every push, then we make sure enough
+  // memory is committed. The base of the stack never moves.
+  // A chunk built by hand never went through the compiler, a depth of zero
+  // can't be trusted so we walk the code ourselves
+  uint32_t depth = m_chunk->m_maxStackDepth;
+  if (depth == 0) {
+    depth = computeMaxStackDepth(m_chunk);
+  }
+  if (depth > m_stackLimit) {
+    // slow path, we walk the code again to find where we would blow up, so
+    // the error points at the right line
+    int offset = 0;
+    computeMaxStackDepth(m_chunk, m_stackLimit, &offset);
+    m_ip = m_chunk->m_code.data() + offset + 1;
+    runtimeError("Stack overflow.");
+    return false;
+  }
+  if (!m_stackMemory.commit(depth * sizeof(Value))) {
+    m_ip = m_chunk->m_code.data() + 1;
+    runtimeError("Could not allocate memory for the stack.");
+    return false;
+  }
+  return true;
+}
+
+INTERPRET_RESULT VirtualMachine::interpret(const char *source) {
+  return interpret(source, nullptr);
 }
 
 INTERPRET_RESULT VirtualMachine::interpret(const Chunk *chunk) {
+  return interpret(chunk, nullptr);
+}
 
+INTERPRET_RESULT VirtualMachine::interpret(const char *source,
+                                           log::Log *traceLogger) {
+
+  if (compile(source) != INTERPRET_RESULT::INTERPRET_OK) {
+    return INTERPRET_RESULT::INTERPRET_COMPILE_ERROR;
+  }
+  // the caller never sees the chunk of a script, it only has to live until
+  // the next one, otherwise a vm fed source over and over would keep every
+  // chunk and their literals around
+  releaseChunk(m_scriptChunk);
+  m_scriptChunk = m_chunk;
+  return execute(m_chunk, traceLogger);
+}
+
+INTERPRET_RESULT VirtualMachine::interpret(const Chunk *chunk,
+                                           log::Log *traceLogger) {
   assert(chunk != nullptr);
-  m_chunk = chunk;
+  return execute(chunk, traceLogger);
+}
 
+INTERPRET_RESULT VirtualMachine::execute(const Chunk *chunk,
+                                         log::Log *traceLogger) {
+  m_chunk = chunk;
   m_ip = m_chunk->m_code.data();
   resetStack();
-  return run();
+  if (!prepareStack()) {
+    return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;
+  }
+
+  // the choice of the loop is made once here, the tracing one is a different
+  // instantiation of run() so the default one has no trace check at all
+  if (traceLogger != nullptr) {
+    m_traceLogger = traceLogger;
+    INTERPRET_RESULT result = run<true>();
+    m_traceLogger = nullptr;
+    return result;
+  }
+  return run<false>();
 }
 
-//#define DEBUG_TRACE_EXECUTION
+void VirtualMachine::traceInstruction() {
+  assert(m_traceLogger != nullptr);
+  // show the stack  before each instruction
+  // this is going to spam!
+  m_traceLogger->print("          ");
+  for (Value *slot = m_stack; slot < m_stackTop; slot++) {
+    m_traceLogger->print("[ ");
+    printValue(*slot, m_traceLogger);
+    m_traceLogger->print(" ]");
+  }
+  m_traceLogger->print("\n");
 
-INTERPRET_RESULT VirtualMachine::run() {
-  for (;;) {
+  disassambleInstruction(m_chunk, (int)(m_ip - m_chunk->m_code.data()),
+                         m_traceLogger);
+}
 
-#ifdef DEBUG_TRACE_EXECUTION
-    assert(m_debugLogger != nullptr);
-    // show the stack  before each instruction
-    // this is going to spam!
-    // TODO wrap this into another ifdef so we can turn it on/off independnetly
-    m_debugLogger->print("          ");
-    for (Value *slot = m_stack; slot < m_stackTop; slot++) {
-      m_debugLogger->print("[ ");
-      printValue(*slot, m_debugLogger);
-      m_debugLogger->print(" ]");
-    }
-    m_debugLogger->print("\n");
+// The dispatch loop comes in two flavours. When the compiler supports labels
+// as values (GCC and Clang) every instruction jumps straight to the handler of
+// the next one through a table, this gives each handler its own indirect
+// branch and the predictor a chance to learn the opcode sequences of the
+// script. On other compilers, or when BINDER_VM_SWITCH_DISPATCH is defined, we
+// fall back to the classic loop + switch. Handlers are written once and the
+// macros below take care of the plumbing.
+#if BINDER_VM_COMPUTED_GOTO
+#define VM_INTERPRET_LOOP VM_DISPATCH();
+#define VM_CASE(op) LABEL_##op
+#define VM_DISPATCH()                                                          \
+  do {                                                                         \
+    VM_TRACE_INSTRUCTION();                                                    \
+    goto *DISPATCH_TABLE[VM_READ_BYTE()];                                       \
+  } while (false)
+#else
+#define VM_INTERPRET_LOOP                                                      \
+  loop:                                                                        \
+  VM_TRACE_INSTRUCTION();                                                      \
+  switch (static_cast<OP_CODE>(VM_READ_BYTE()))
+#define VM_CASE(op) case OP_CODE::op
+#define VM_DISPATCH() goto loop
+#endif
+
+#define VM_READ_BYTE() (*ip++)
+#define VM_READ_SHORT()                                                        \
+  (ip += 2, static_cast<uint16_t>((ip[-2] << 8) | ip[-1]))
+#define VM_READ_LONG() (ip += 3, readLongOperand(ip - 3))
+#define VM_READ_CONSTANT() (m_chunk->m_constants[VM_READ_BYTE()])
+#define VM_READ_CONSTANT_LONG() (m_chunk->m_constants[VM_READ_LONG()])
+#define VM_STORE_IP() m_ip = ip
+
+// TRACE is a template parameter of run(), the check is resolved at compile
+// time and vanishes from the non tracing loop
+#define VM_TRACE_INSTRUCTION()                                                 \
+  do {                                                                         \
+    if constexpr (TRACE) {                                                     \
+      VM_STORE_IP();                                                           \
+      traceInstruction();                                                      \
+    }                                                                          \
+  } while (false)
+
+#if BINDER_VM_COMPUTED_GOTO && defined(__GNUC__)
+// taking the address of a label is a GNU extension, we know
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+// gcc happily merges the tails of the handlers back into a handful of shared
+// indirect jumps, which defeats the whole point of threading the dispatch,
+// same trick used by cpython for its eval loop
+#if BINDER_VM_COMPUTED_GOTO && defined(__GNUC__) && !defined(__clang__)
+#define VM_RUN_ATTRIBUTES __attribute__((optimize("no-gcse", "no-crossjumping")))
+#else
+#define VM_RUN_ATTRIBUTES
+#endif
 
-    disassambleInstruction(m_chunk, (int)(m_ip - m_chunk->m_code.data()),
-                           m_debugLogger);
+template <bool TRACE>
+VM_RUN_ATTRIBUTES INTERPRET_RESULT VirtualMachine::run() {
+#if BINDER_VM_COMPUTED_GOTO
+  // NOTE: this table needs to be kept in the same order of the OP_CODE enum
+  static void *DISPATCH_TABLE[] = {
+      &&LABEL_OP_CONSTANT,   &&LABEL_OP_NIL,        &&LABEL_OP_TRUE,
+      &&LABEL_OP_FALSE,      &&LABEL_OP_POP,        &&LABEL_OP_GET_LOCAL,
+      &&LABEL_OP_GET_GLOBAL, &&LABEL_OP_DEFINE_GLOBAL,
+      &&LABEL_OP_SET_LOCAL,  &&LABEL_OP_SET_GLOBAL, &&LABEL_OP_EQUAL,
+      &&LABEL_OP_GREATER,    &&LABEL_OP_LESS,       &&LABEL_OP_ADD,
+      &&LABEL_OP_SUBTRACT,   &&LABEL_OP_MULTIPLY,   &&LABEL_OP_DIVIDE,
+      &&LABEL_OP_NOT,        &&LABEL_OP_NEGATE,     &&LABEL_OP_PRINT,
+      &&LABEL_OP_JUMP,       &&LABEL_OP_JUMP_IF_FALSE,
+      &&LABEL_OP_LOOP,       &&LABEL_OP_RETURN,
+      &&LABEL_OP_NOT_EQUAL,  &&LABEL_OP_GREATER_EQUAL,
+      &&LABEL_OP_LESS_EQUAL, &&LABEL_OP_ADD_LOCAL_CONST,
+      &&LABEL_OP_JUMP_IF_FALSE_POP,
+      &&LABEL_OP_SET_LOCAL_POP, &&LABEL_OP_SET_GLOBAL_POP,
+      &&LABEL_OP_CONSTANT_LONG, &&LABEL_OP_GET_GLOBAL_LONG,
+      &&LABEL_OP_DEFINE_GLOBAL_LONG, &&LABEL_OP_SET_GLOBAL_LONG,
+  };
+  static_assert(sizeof(DISPATCH_TABLE) / sizeof(DISPATCH_TABLE[0]) ==
+                    static_cast<size_t>(OP_CODE::COUNT),
+                "dispatch table is out of sync with the OP_CODE enum");
 #endif
 
-    OP_CODE instruction;
-    switch (instruction = static_cast<OP_CODE>(readByte())) {
-    case OP_CODE::OP_PRINT: {
+  // the instruction pointer lives in a local for the whole loop so the
+  // compiler can keep it in a register, it is written back to the member only
+  // when something outside the loop needs it (errors and tracing)
+  uint8_t *ip = m_ip;
+  // no new global can be added while running, the pointer is stable
+  Value *globals = m_globals.getValues();
+
+  VM_INTERPRET_LOOP {
+    VM_CASE(OP_PRINT) : {
       printValue(stackPop(), m_logger);
       m_logger->print("\n");
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_JUMP: {
+    VM_CASE(OP_JUMP) : {
       // unconditional jump
-      uint16_t offset = readShort();
-      m_ip += offset;
-      break;
+      uint16_t offset = VM_READ_SHORT();
+      ip += offset;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_JUMP_IF_FALSE: {
-      uint16_t offset = readShort();
+    VM_CASE(OP_JUMP_IF_FALSE) : {
+      uint16_t offset = VM_READ_SHORT();
       if (isFalsey(peek(0))) {
         // let us perform the jump
-        m_ip += offset;
+        ip += offset;
       }
-      break;
-    }
-    case OP_CODE::OP_LOOP: {
-      uint16_t offset = readShort();
-      m_ip -= offset;
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_RETURN: {
-      return INTERPRET_RESULT::INTERPRET_OK;
+    VM_CASE(OP_LOOP) : {
+      uint16_t offset = VM_READ_SHORT();
+      ip -= offset;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_CONSTANT: {
-      Value constant = readConstant();
+    VM_CASE(OP_RETURN) : { return INTERPRET_RESULT::INTERPRET_OK; }
+    VM_CASE(OP_CONSTANT) : {
+      Value constant = VM_READ_CONSTANT();
       stackPush(constant);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_NIL: {
+    VM_CASE(OP_NIL) : {
       stackPush(makeNIL());
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_TRUE: {
+    VM_CASE(OP_TRUE) : {
       stackPush(makeBool(true));
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_FALSE: {
+    VM_CASE(OP_FALSE) : {
       stackPush(makeBool(false));
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_POP: {
+    VM_CASE(OP_POP) : {
       stackPop();
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_SET_LOCAL: {
+    VM_CASE(OP_SET_LOCAL) : {
       // here we expect the value on top of the stack
       // so we read it and assign it to the corresponiding stack slot
-      uint8_t slot = readByte();
+      uint8_t slot = VM_READ_BYTE();
       m_stack[slot] = peek(0);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_GET_LOCAL: {
+    VM_CASE(OP_GET_LOCAL) : {
       // hear on top of the stack we have the slot where the variable
       // we want is, so we just read it from it and pop it on top of the stack
       // this is how the stack based machine dances, register machine avoid this
       // by loading and referring registers
-      uint8_t slot = readByte();
+      uint8_t slot = VM_READ_BYTE();
       stackPush(m_stack[slot]);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_GET_GLOBAL: {
-      // reading the identifier from the
-      // top of the stack
-      ObjString *name = readString();
-      Value value;
-      // look up the value
-      bool result = m_globals.get(name->chars, value);
-      if (!result) {
-        sprintf(log::tempLogBuffer1, "Undefined variable '%s'.", name->chars);
-        runtimeError(log::tempLogBuffer1);
+    VM_CASE(OP_GET_GLOBAL) : {
+      // the compiler already resolved the name to a slot, we just index
+      uint8_t slot = VM_READ_BYTE();
+      Value value = globals[slot];
+      if (isValueUndefined(value)) {
+        VM_STORE_IP();
+        undefinedVariableError(slot);
         return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;
       }
 
@@ -198,88 +415,192 @@ INTERPRET_RESULT VirtualMachine::run() {
       // up value on the stack
       stackPush(value);
 
-      break;
+      VM_DISPATCH();
     }
 
-    case OP_CODE::OP_DEFINE_GLOBAL: {
-
-      sObjString *name = readString();
-      m_globals.insert(name->chars, peek(0));
+    VM_CASE(OP_DEFINE_GLOBAL) : {
+      uint8_t slot = VM_READ_BYTE();
+      globals[slot] = peek(0);
       stackPop();
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_SET_GLOBAL: {
-      // reading the identifier from the
-      // top of the stack
-      ObjString *name = readString();
-      // look up the value
-      bool result = m_globals.containsKey(name->chars);
-      if (!result) {
-        sprintf(log::tempLogBuffer1, "Undefined variable '%s'.", name->chars);
-        runtimeError(log::tempLogBuffer1);
+    VM_CASE(OP_SET_GLOBAL) : {
+      uint8_t slot = VM_READ_BYTE();
+      // assigning to a variable that has never been declared is an error
+      if (isValueUndefined(globals[slot])) {
+        VM_STORE_IP();
+        undefinedVariableError(slot);
         return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;
-      } else {
-        // if the value already exists, meaning the variable has been declared
-        // already we insert it
-        m_globals.insert(name->chars, peek(0));
       }
+      globals[slot] = peek(0);
 
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_EQUAL: {
+    VM_CASE(OP_EQUAL) : {
       Value b = stackPop();
       Value a = stackPop();
       Value res = makeBool(valuesEqual(a, b));
       stackPush(res);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_GREATER: {
+    VM_CASE(OP_GREATER) : {
       BINARY_OP(makeBool, >);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_LESS: {
+    VM_CASE(OP_LESS) : {
       BINARY_OP(makeBool, <);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_ADD: {
+    VM_CASE(OP_ADD) : {
       if (isValueString(peek(0)) & isValueString(peek(1))) {
         concatenate();
       } else if (isValueNumber(peek(0)) & isValueNumber(peek(1))) {
         BINARY_OP(makeNumber, +);
       } else {
+        VM_STORE_IP();
         runtimeError("Operands must be two numbers of two strings");
         return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;
       }
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_SUBTRACT: {
+    VM_CASE(OP_SUBTRACT) : {
       BINARY_OP(makeNumber, -);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_MULTIPLY: {
+    VM_CASE(OP_MULTIPLY) : {
       BINARY_OP(makeNumber, *);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_DIVIDE: {
+    VM_CASE(OP_DIVIDE) : {
       BINARY_OP(makeNumber, /);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_NOT: {
+    VM_CASE(OP_NOT) : {
       Value result = makeBool(isFalsey(stackPop()));
       stackPush(result);
-      break;
+      VM_DISPATCH();
     }
-    case OP_CODE::OP_NEGATE: {
+    VM_CASE(OP_NEGATE) : {
       if (!isValueNumber(peek(0))) {
+        VM_STORE_IP();
         runtimeError("Operand must be a number.");
         return INTERPRET_RUNTIME_ERROR;
       }
       double negated = -valueAsNumber(stackPop());
       stackPush(makeNumber(negated));
-      break;
+      VM_DISPATCH();
+    }
+    // superinstructions, see peephole.h
+    VM_CASE(OP_NOT_EQUAL) : {
+      Value b = stackPop();
+      Value a = stackPop();
+      stackPush(makeBool(!valuesEqual(a, b)));
+      VM_DISPATCH();
     }
+    VM_CASE(OP_GREATER_EQUAL) : {
+      // written as !(a < b) on purpose, same result as the LESS NOT it
+      // replaces even when a NaN is involved, this needs finite math off,
+      // see core/CMakeLists.txt
+      BINARY_OP(makeNotBool, <);
+      VM_DISPATCH();
     }
+    VM_CASE(OP_LESS_EQUAL) : {
+      BINARY_OP(makeNotBool, >);
+      VM_DISPATCH();
+    }
+    VM_CASE(OP_ADD_LOCAL_CONST) : {
+      // the peephole pass only fuses number constants, so a number local is
+      // the only valid case
+      Value a = m_stack[VM_READ_BYTE()];
+      Value b = VM_READ_CONSTANT();
+      if (!isValueNumber(a)) {
+        VM_STORE_IP();
+        runtimeError("Operands must be two numbers of two strings");
+        return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;
+      }
+      stackPush(makeNumber(valueAsNumber(a) + valueAsNumber(b)));
+      VM_DISPATCH();
+    }
+    VM_CASE(OP_JUMP_IF_FALSE_POP) : {
+      uint16_t offset = VM_READ_SHORT();
+      if (isFalsey(stackPop())) {
+        ip += offset;
+      }
+      VM_DISPATCH();
+    }
+    VM_CASE(OP_SET_LOCAL_POP) : {
+      uint8_t slot = VM_READ_BYTE();
+      m_stack[slot] = stackPop();
+      VM_DISPATCH();
+    }
+    VM_CASE(OP_SET_GLOBAL_POP) : {
+      uint8_t slot = VM_READ_BYTE();
+      if (isValueUndefined(globals[slot])) {
+        VM_STORE_IP();
+        undefinedVariableError(slot);
+        return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;
+      }
+      globals[slot] = stackPop();
+      VM_DISPATCH();
+    }
+    // long operand versions, same as the short ones
+    VM_CASE(OP_CONSTANT_LONG) : {
+      Value constant = VM_READ_CONSTANT_LONG();
+      stackPush(constant);
+      VM_DISPATCH();
+    }
+    VM_CASE(OP_GET_GLOBAL_LONG) : {
+      uint32_t slot = VM_READ_LONG();
+      Value value = globals[slot];
+      if (isValueUndefined(value)) {
+        VM_STORE_IP();
+        undefinedVariableError(slot);
+        return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;
+      }
+      stackPush(value);
+      VM_DISPATCH();
+    }
+    VM_CASE(OP_DEFINE_GLOBAL_LONG) : {
+      uint32_t slot = VM_READ_LONG();
+      globals[slot] = peek(0);
+      stackPop();
+      VM_DISPATCH();
+    }
+    VM_CASE(OP_SET_GLOBAL_LONG) : {
+      uint32_t slot = VM_READ_LONG();
+      if (isValueUndefined(globals[slot])) {
+        VM_STORE_IP();
+        undefinedVariableError(slot);
+        return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;
+      }
+      globals[slot] = peek(0);
+      VM_DISPATCH();
+    }
+#if !BINDER_VM_COMPUTED_GOTO
+    default:
+      break;
+#endif
   }
-} // namespace binder::vm
+
+  // we only get here if the switch got fed garbage
+  assert(0 && "unknown opcode in bytecode stream");
+  return INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR;
+}
+
+#if BINDER_VM_COMPUTED_GOTO && defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#undef VM_INTERPRET_LOOP
+#undef VM_CASE
+#undef VM_DISPATCH
+#undef VM_TRACE_INSTRUCTION
+#undef VM_RUN_ATTRIBUTES
+#undef VM_READ_BYTE
+#undef VM_READ_SHORT
+#undef VM_READ_LONG
+#undef VM_READ_CONSTANT
+#undef VM_READ_CONSTANT_LONG
+#undef VM_STORE_IP
 
 } // namespace binder::vm
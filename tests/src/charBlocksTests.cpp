@@ -0,0 +1,109 @@
+#include "binder/charBlocks.h"
+#include "catch.h"
+
+#include <string>
+
+// the plain one char at the time versions, the block ones must agree with
+// them on every length and every alignment
+namespace charBlocksReference {
+template <typename KEEP>
+const char *skip(const char *p, const char *end, uint32_t &newLines,
+                 KEEP keep) {
+  while ((p < end) && keep(*p)) {
+    newLines += *p == '\n';
+    ++p;
+  }
+  return p;
+}
+} // namespace charBlocksReference
+
+TEST_CASE("char blocks skip runs of every length", "[char-blocks]") {
+  // runs from 0 to well past two blocks, starting at every offset in a
+  // block, the char after the run is one that stops it
+  const char *fillers[] = {" \t\r\n", "aZ_09", "0123456789", "xyz\n\"",
+                           "comment text\r"};
+  for (const char *filler : fillers) {
+    const size_t fillerLength = strlen(filler);
+    for (uint32_t length = 0; length < 80; ++length) {
+      for (uint32_t offset = 0; offset < 33; ++offset) {
+        std::string text(offset, '!');
+        for (uint32_t i = 0; i < length; ++i) {
+          text += filler[i % fillerLength];
+        }
+        text += "!\"\n-";
+        const char *start = text.c_str() + offset;
+        const char *end = text.c_str() + text.size();
+
+        uint32_t expectedLines = 0;
+        uint32_t lines = 0;
+        REQUIRE(binder::chars::skipWhiteSpace(start, end, lines) ==
+                charBlocksReference::skip(start, end, expectedLines,
+                                          binder::chars::isWhiteSpace));
+        REQUIRE(lines == expectedLines);
+
+        uint32_t unused = 0;
+        REQUIRE(binder::chars::skipIdentifier(start, end) ==
+                charBlocksReference::skip(start, end, unused,
+                                          binder::chars::isIdentifier));
+        REQUIRE(binder::chars::skipDigits(start, end) ==
+                charBlocksReference::skip(start, end, unused,
+                                          binder::chars::isDigit));
+        REQUIRE(binder::chars::findNewLine(start, end) ==
+                charBlocksReference::skip(start, end, unused,
+                                          [](char c) { return c != '\n'; }));
+
+        expectedLines = 0;
+        lines = 0;
+        REQUIRE(binder::chars::findQuote(start, end, lines) ==
+                charBlocksReference::skip(start, end, expectedLines,
+                                          [](char c) { return c != '"'; }));
+        REQUIRE(lines == expectedLines);
+      }
+    }
+  }
+}
+
+TEST_CASE("char blocks never walk past end", "[char-blocks]") {
+  // the buffers are exactly as long as the run, under asan a block loaded
+  // past end is caught
+  for (uint32_t length = 0; length < 100; ++length) {
+    char *start = new char[length];
+    memset(start, 'a', length);
+    uint32_t lines = 0;
+    REQUIRE(binder::chars::skipIdentifier(start, start + length) ==
+            start + length);
+    REQUIRE(binder::chars::findQuote(start, start + length, lines) ==
+            start + length);
+    REQUIRE(lines == 0);
+    delete[] start;
+  }
+
+  std::string lines(70, '\n');
+  uint32_t count = 0;
+  REQUIRE(binder::chars::skipWhiteSpace(lines.c_str(), lines.c_str() + 65,
+                                        count) == lines.c_str() + 65);
+  REQUIRE(count == 65);
+}
+
+TEST_CASE("char blocks classify only ascii", "[char-blocks]") {
+  // bytes with the high bit set are not letters, neither are the ones right
+  // around the ranges
+  std::string text(40, 'a');
+  const char stoppers[] = {'\x80', '\xc1', '\xe1', '\xff', '@', '[',
+                           '`',    '{',    '/',    ':',    '\0'};
+  for (const char stopper : stoppers) {
+    for (uint32_t at = 0; at < 40; ++at) {
+      std::string copy = text;
+      copy[at] = stopper;
+      const char *start = copy.c_str();
+      REQUIRE(binder::chars::skipIdentifier(start, start + copy.size()) ==
+              start + at);
+    }
+  }
+
+  std::string digits(40, '5');
+  digits[35] = '\xb0';
+  REQUIRE(binder::chars::skipDigits(digits.c_str(),
+                                    digits.c_str() + digits.size()) ==
+          digits.c_str() + 35);
+}
@@ -157,6 +157,177 @@ TEST_CASE("hashmap remove key", "[memory]") {
   REQUIRE(alloc.getUsedBins() == 0);
 }
 
+TEST_CASE("hashmap find key past removed one", "[memory]") {
+  // with so few bins keys collide and get probed past each other, removing
+  // one must not hide the ones after it
+  binder::memory::HashMap<uint32_t, uint32_t, binder::hashUint32> alloc(4);
+  const uint32_t keys[] = {22, 99, 1024, 90238409};
+  for (uint32_t key : keys) {
+    REQUIRE(alloc.insert(key, key + 1));
+  }
+  for (uint32_t key : keys) {
+    REQUIRE(alloc.remove(key));
+    REQUIRE(alloc.containsKey(key) == false);
+    for (uint32_t other : keys) {
+      if (other > key) {
+        uint32_t value = 0;
+        REQUIRE(alloc.get(other, value));
+        REQUIRE(value == other + 1);
+      }
+    }
+  }
+
+  binder::memory::HashMap<const char *, uint32_t, binder::hashString32>
+      strings(2);
+  REQUIRE(strings.insert("first", 1));
+  REQUIRE(strings.insert("second", 2));
+  REQUIRE(strings.remove("first"));
+  uint32_t value = 0;
+  REQUIRE(strings.get("second", value));
+  REQUIRE(value == 2);
+}
+
+TEST_CASE("hashmap grows past the initial bins", "[memory]") {
+  binder::memory::HashMap<uint32_t, uint32_t, binder::hashUint32> alloc(8);
+  const uint32_t count = 10000;
+  for (uint32_t i = 0; i < count; ++i) {
+    REQUIRE(alloc.insert(i * 7, i));
+  }
+  REQUIRE(alloc.getUsedBins() == count);
+  REQUIRE(alloc.binCount() >= count);
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t value = 0;
+    REQUIRE(alloc.get(i * 7, value));
+    REQUIRE(value == i);
+  }
+  REQUIRE_FALSE(alloc.containsKey(count * 7));
+
+  // overriding does not take new bins
+  REQUIRE(alloc.insert(7, 42));
+  REQUIRE(alloc.getUsedBins() == count);
+  uint32_t value = 0;
+  REQUIRE(alloc.get(7, value));
+  REQUIRE(value == 42);
+}
+
+TEST_CASE("hashmap churn does not grow the table", "[memory]") {
+  // a steady amount of live keys with lots of insertions and removals, the
+  // deleted bins have to be cleaned up instead of filling the table
+  binder::memory::HashMap<uint32_t, uint32_t, binder::hashUint32> alloc(64);
+  const uint32_t live = 16;
+  for (uint32_t i = 0; i < 100000; ++i) {
+    REQUIRE(alloc.insert(i, i));
+    if (i >= live) {
+      REQUIRE(alloc.remove(i - live));
+    }
+  }
+  REQUIRE(alloc.getUsedBins() == live);
+  REQUIRE(alloc.binCount() == 64);
+  REQUIRE(alloc.getUsedBins() + alloc.getDeletedBins() <
+          alloc.binCount());
+  for (uint32_t i = 100000 - live; i < 100000; ++i) {
+    REQUIRE(alloc.containsKey(i));
+  }
+}
+
+// every key lands on the same bin with the same control byte, lookups have
+// to walk through several groups
+static uint32_t collidingHash(const uint32_t &) { return 0; }
+
+TEST_CASE("hashmap keys with the same hash", "[memory]") {
+  binder::memory::HashMap<uint32_t, uint32_t, collidingHash> alloc(8);
+  const uint32_t count = 300;
+  for (uint32_t i = 0; i < count; ++i) {
+    REQUIRE(alloc.insert(i, i + 1));
+  }
+  for (uint32_t i = 0; i < count; i += 3) {
+    REQUIRE(alloc.remove(i));
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t value = 0;
+    REQUIRE(alloc.get(i, value) == (i % 3 != 0));
+    if (i % 3 != 0) {
+      REQUIRE(value == i + 1);
+    }
+  }
+  // reinserting goes in the deleted bins
+  for (uint32_t i = 0; i < count; i += 3) {
+    REQUIRE(alloc.insert(i, i));
+  }
+  REQUIRE(alloc.getUsedBins() == count);
+  REQUIRE(alloc.containsKey(count) == false);
+}
+
+TEST_CASE("string hashmap grows", "[memory]") {
+  binder::memory::HashMap<const char *, uint32_t, binder::hashString32>
+      strings(8);
+  const uint32_t count = 5000;
+  char key[32];
+  for (uint32_t i = 0; i < count; ++i) {
+    snprintf(key, sizeof(key), "key%u", i);
+    REQUIRE(strings.insert(key, i));
+  }
+  REQUIRE(strings.getUsedBins() == count);
+  for (uint32_t i = 0; i < count; ++i) {
+    snprintf(key, sizeof(key), "key%u", i);
+    uint32_t value = 0;
+    REQUIRE(strings.get(key, value));
+    REQUIRE(value == i);
+  }
+  for (uint32_t i = 0; i < count; i += 2) {
+    snprintf(key, sizeof(key), "key%u", i);
+    REQUIRE(strings.remove(key));
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    snprintf(key, sizeof(key), "key%u", i);
+    REQUIRE(strings.containsKey(key) == ((i & 1) == 1));
+  }
+}
+
+TEST_CASE("string hashmap grows with a custom hash", "[memory]") {
+  // the map never computes the hash of the stored keys itself, when it
+  // grows it has to keep using the hashes it was given
+  binder::memory::HashMap<const char *, uint32_t, binder::hashString32>
+      strings(8);
+  const uint32_t count = 2000;
+  char key[32];
+  for (uint32_t i = 0; i < count; ++i) {
+    const int length = snprintf(key, sizeof(key), "key%u", i);
+    REQUIRE(strings.insert(key, length, binder::hashFnv1a32(key, length), i));
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    const int length = snprintf(key, sizeof(key), "key%u", i);
+    uint32_t value = 0;
+    REQUIRE(strings.get(key, length, binder::hashFnv1a32(key, length), value));
+    REQUIRE(value == i);
+  }
+}
+
+TEST_CASE("hashmap string keys with a precomputed hash", "[memory]") {
+  binder::memory::HashMap<const char *, uint32_t, binder::hashString32>
+      strings(16);
+  // the key does not need to be null terminated when the length is given
+  const char *source = "first second";
+  const uint32_t hash = binder::hashString32(source, 5);
+  REQUIRE(strings.insert(source, 5, hash, 1));
+  uint32_t value = 0;
+  REQUIRE(strings.get("first", value));
+  REQUIRE(value == 1);
+  value = 0;
+  REQUIRE(strings.get(source, 5, hash, value));
+  REQUIRE(value == 1);
+  REQUIRE(strings.remove(source, 5, hash));
+  REQUIRE_FALSE(strings.get("first", value));
+
+  // keys split in two parts
+  REQUIRE(strings.insert("first second", 2));
+  const uint32_t fullHash = binder::hashString32("first second", 12);
+  value = 0;
+  REQUIRE(strings.get("first ", 6, "second", 6, fullHash, value));
+  REQUIRE(value == 2);
+  REQUIRE_FALSE(strings.get("first ", 6, "sec", 3, fullHash, value));
+}
+
 TEST_CASE("hashmap empty 1000", "[memory]") {
   binder::memory::HashMap<uint64_t, uint32_t, binder::hashUint64> alloc(200);
   const int count = 1000;
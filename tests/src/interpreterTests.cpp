@@ -1127,3 +1127,63 @@ TEST_CASE_METHOD(SetupInterpreterTestFixture, "simple for loop", "[interpreter]"
 
 
 
+
+TEST_CASE_METHOD(SetupInterpreterTestFixture, "runtime error message uses the scratch", "[interpreter]") {
+  const uint32_t allocations =
+      context.getStringPool().getReport().allocationCount;
+  interpret("var err = 12 - \"hello\";");
+  REQUIRE(context.hadError() == true);
+  const char *out = getOutput();
+  REQUIRE(strstr(out, "Cannot perform binary operation with operator -") != nullptr);
+  REQUIRE(strstr(out, "Runtime value with type STRING and value \"hello\"") != nullptr);
+  // the message went in the scratch and got rewound with the statement and
+  // the lexemes are in the parser intern, nothing is left in the pool
+  REQUIRE(context.getScratch().getBytesUsed() == 0);
+  REQUIRE(context.getStringPool().getReport().allocationCount == allocations);
+}
+
+TEST_CASE_METHOD(SetupInterpreterTestFixture, "string literal outlives the parse", "[interpreter]") {
+  // the literal is stored in the variable, the next parse must not take the
+  // memory it points to
+  interpret("var s = \"hello world string\";");
+  REQUIRE(context.hadError() == false);
+  interpret("var other = \"another string here\"; print s;");
+  REQUIRE(context.hadError() == false);
+  binder::RuntimeValue *s = interpreter.getRuntimeVariable("s");
+  REQUIRE(s->type == binder::RuntimeValueType::STRING);
+  REQUIRE(strcmp(s->string, "hello world string") == 0);
+  REQUIRE(strstr(getOutput(), "hello world string") != nullptr);
+}
+
+TEST_CASE_METHOD(SetupInterpreterTestFixture, "print in a loop does not grow the scratch", "[interpreter]") {
+  // every print is bigger than 200 chars, without the rewind after each
+  // statement of the loop body the scratch would need a second block
+  interpret("for(var i=0; i < 100; i=i+1){ print \"some text to print, some "
+            "text to print, some text to print, some text to print, some text "
+            "to print, some text to print, some text to print, some text to "
+            "print, some text to print, some text to print, some text\";}");
+  REQUIRE(context.hadError() == false);
+  REQUIRE(context.getScratch().getBytesUsed() == 0);
+  REQUIRE(context.getScratch().getBlockCount() == 1);
+
+  // same with a body that is a single statement rather than a block, and a
+  // for without initializer, which is not wrapped in a block either
+  interpret("var t = \"some text to print, some text to print, some text to "
+            "print, some text to print, some text to print, some text to "
+            "print, some text to print, some text to print, some text\";"
+            "var j = 0; while (j < 100) if ((j = j + 1) > 0) print t;"
+            "for (; j < 200;) if ((j = j + 1) > 0) print t;");
+  REQUIRE(context.hadError() == false);
+  REQUIRE(context.getScratch().getBytesUsed() == 0);
+  REQUIRE(context.getScratch().getBlockCount() == 1);
+}
+
+TEST_CASE_METHOD(SetupInterpreterTestFixture, "long loop grows the value pool", "[interpreter]") {
+  // every iteration leaves a few values in the pool, way more than the
+  // default 1000
+  interpret("var a=0; for(var i=0; i < 5000; i=i+1){ a = a + 1;}");
+  REQUIRE(context.hadError() == false);
+  binder::RuntimeValue *a = interpreter.getRuntimeVariable("a");
+  REQUIRE(a->type == binder::RuntimeValueType::NUMBER);
+  REQUIRE(a->number == Approx(5000.0));
+}
@@ -3,11 +3,13 @@
 
 #include "resizableVectorTests.cpp"
 #include "scannerTests.cpp"
+#include "charBlocksTests.cpp"
 #include "stackAllocatorTests.cpp"
 #include "stringPoolAllocatorTests.cpp"
 #include "sparseMemoryPoolTests.cpp"
 #include "tokenTests.cpp"
 #include "treeSizesAllocatorTests.cpp"
+#include "slabAllocatorTests.cpp"
 #include "hashMapTests.cpp"
 #include "basicASTPrinterTests.cpp"
 #include "parserTests.cpp"
@@ -17,7 +19,12 @@
 #include "vm/vmCompileTests.cpp"
 #include "vm/vmScanTests.cpp"
 #include "vm/vmExecutionTests.cpp"
+#include "vm/vmValueTests.cpp"
+#include "vm/vmPeepholeTests.cpp"
+#include "vm/vmBytecodeCacheTests.cpp"
+#include "vm/vmGCTests.cpp"
 #include "stringInternTests.cpp"
+#include "stringMapTests.cpp"
 
 
 
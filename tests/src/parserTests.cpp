@@ -375,3 +375,77 @@ TEST_CASE_METHOD(SetupParserTestFixture, "if only branch", "[parser]") {
   compareLiteral(init, binder::TOKEN_TYPE::NUMBER, "1");
 
 }
+
+TEST_CASE_METHOD(SetupParserTestFixture, "nodes live in the parser arena", "[parser]") {
+  const binder::memory::ResizableVector<binder::autogen::Stmt *> &stmts =
+      parse("if ( x or y){ var x = 1;}");
+  REQUIRE(context.hadError() == false);
+  // if, logical, two variables, block, var and literal
+  binder::AstArena::Report report = parser.getArenaReport();
+  REQUIRE(report.nodeCount == 7);
+  REQUIRE(report.blockCount == 1);
+
+  // nodes are laid out in the order the parser made them, children first
+  auto *ifstmt = dynamic_cast<binder::autogen::If *>(stmts[0]);
+  REQUIRE(ifstmt != nullptr);
+  auto *logical = dynamic_cast<binder::autogen::Logical *>(ifstmt->condition);
+  REQUIRE(logical != nullptr);
+  REQUIRE((void *)logical->left < (void *)logical->right);
+  REQUIRE((void *)logical->right < (void *)logical);
+  REQUIRE((void *)ifstmt->thenBranch < (void *)ifstmt);
+
+  // a new parse starts over in the same memory
+  parse("print 1;");
+  report = parser.getArenaReport();
+  REQUIRE(report.nodeCount == 2);
+  REQUIRE(report.blockCount == 1);
+}
+
+TEST_CASE_METHOD(SetupParserTestFixture, "parser arena grows", "[parser]") {
+  // way more nodes than a single block of the arena can hold
+  const int count = 5000;
+  char *source = new char[count * 32];
+  char *cursor = source;
+  for (int i = 0; i < count; ++i) {
+    cursor += sprintf(cursor, "var v%i = %i + 2 * x;", i, i);
+  }
+  const binder::memory::ResizableVector<binder::autogen::Stmt *> &stmts =
+      parse(source);
+  REQUIRE(context.hadError() == false);
+  REQUIRE(stmts.size() == count);
+  const binder::AstArena::Report report = parser.getArenaReport();
+  // var, two binaries, two literals and a variable
+  REQUIRE(report.nodeCount == count * 6);
+  REQUIRE(report.blockCount > 1);
+  REQUIRE(report.reservedBytes >= report.nodeBytes);
+
+  auto *last = dynamic_cast<binder::autogen::Var *>(stmts[count - 1]);
+  REQUIRE(last != nullptr);
+  compareLiteral(
+      dynamic_cast<binder::autogen::Binary *>(last->initializer)->left,
+      binder::TOKEN_TYPE::NUMBER, "4999");
+  delete[] source;
+}
+
+TEST_CASE_METHOD(SetupParserTestFixture, "parser interns the names", "[parser]") {
+  const binder::memory::ResizableVector<binder::autogen::Stmt *> &stmts =
+      parse("var abc = 1; abc = abc + 1;");
+  REQUIRE(context.hadError() == false);
+  REQUIRE(stmts.size() == 2);
+
+  auto *var = dynamic_cast<binder::autogen::Var *>(stmts[0]);
+  REQUIRE(var != nullptr);
+  REQUIRE(strcmp(var->token.m_lexeme, "abc") == 0);
+
+  auto *stmt = dynamic_cast<binder::autogen::Expression *>(stmts[1]);
+  auto *assign = dynamic_cast<binder::autogen::Assign *>(stmt->expression);
+  REQUIRE(assign != nullptr);
+  auto *sum = dynamic_cast<binder::autogen::Binary *>(assign->value);
+  REQUIRE(sum != nullptr);
+  auto *variable = dynamic_cast<binder::autogen::Variable *>(sum->left);
+  REQUIRE(variable != nullptr);
+  // same name, same interned string
+  REQUIRE(assign->name == var->token.m_lexeme);
+  REQUIRE(variable->name == var->token.m_lexeme);
+  compareLiteral(sum->right, binder::TOKEN_TYPE::NUMBER, "1");
+}
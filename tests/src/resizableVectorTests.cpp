@@ -196,7 +196,7 @@ TEST_CASE("Vector resize", "[memory]") {
   REQUIRE(vec[5] == 6.0f);
   REQUIRE(vec[6] == 7.0f);
   REQUIRE(vec.size() == 20);
-  REQUIRE(vec.reservedSize() == 40);
+  REQUIRE(vec.reservedSize() == 20);
 
   vec.resize(5);
   REQUIRE(vec[0] == 1.0f);
@@ -205,7 +205,7 @@ TEST_CASE("Vector resize", "[memory]") {
   REQUIRE(vec[3] == 4.0f);
   REQUIRE(vec[4] == 5.0f);
   REQUIRE(vec.size() == 5);
-  REQUIRE(vec.reservedSize() == 40);
+  REQUIRE(vec.reservedSize() == 20);
 }
 
 TEST_CASE("Vector resize allocator", "[memory]") {
@@ -229,7 +229,7 @@ TEST_CASE("Vector resize allocator", "[memory]") {
   REQUIRE(vec[5] == 6.0f);
   REQUIRE(vec[6] == 7.0f);
   REQUIRE(vec.size() == 20);
-  REQUIRE(vec.reservedSize() == 40);
+  REQUIRE(vec.reservedSize() == 20);
 
   vec.resize(5);
   REQUIRE(vec[0] == 1.0f);
@@ -238,7 +238,7 @@ TEST_CASE("Vector resize allocator", "[memory]") {
   REQUIRE(vec[3] == 4.0f);
   REQUIRE(vec[4] == 5.0f);
   REQUIRE(vec.size() == 5);
-  REQUIRE(vec.reservedSize() == 40);
+  REQUIRE(vec.reservedSize() == 20);
 }
 
 TEST_CASE("Vector resize with no initialization", "[memory]"){
@@ -248,7 +248,7 @@ TEST_CASE("Vector resize with no initialization", "[memory]"){
   REQUIRE(vec.reservedSize() == 0);
   vec.resize(10);
   REQUIRE(vec.size() == 10);
-  REQUIRE(vec.reservedSize() == 20);
+  REQUIRE(vec.reservedSize() == 10);
 
 }
 
@@ -260,7 +260,7 @@ TEST_CASE("Vector resize with no initialization allocator", "[memory]"){
   REQUIRE(vec.reservedSize() == 0);
   vec.resize(10);
   REQUIRE(vec.size() == 10);
-  REQUIRE(vec.reservedSize() == 20);
+  REQUIRE(vec.reservedSize() == 10);
 
 }
 TEST_CASE("Vector remove by patching", "[memory]") {
@@ -321,3 +321,123 @@ TEST_CASE("double resize with bigger reserve", "[memory]") {
   vec.resize(15);
   REQUIRE(vec.size()==15);
 }
+
+TEST_CASE("Vector resize grows geometrically", "[memory]") {
+
+  binder::memory::ResizableVector<float> vec(10);
+  // a little past the reserve still doubles it
+  vec.resize(12);
+  REQUIRE(vec.reservedSize() == 20);
+  // way past it reserves just what is asked
+  vec.resize(100);
+  REQUIRE(vec.reservedSize() == 100);
+}
+
+TEST_CASE("Vector reserve", "[memory]") {
+
+  binder::memory::ResizableVector<float> vec;
+  vec.reserve(100);
+  REQUIRE(vec.size() == 0);
+  REQUIRE(vec.reservedSize() == 100);
+  for (int i = 0; i < 100; ++i) {
+    vec.pushBack(static_cast<float>(i));
+  }
+  REQUIRE(vec.reservedSize() == 100);
+  // never shrinks
+  vec.reserve(10);
+  REQUIRE(vec.reservedSize() == 100);
+  vec.reserve(150);
+  REQUIRE(vec.reservedSize() == 150);
+  for (int i = 0; i < 100; ++i) {
+    REQUIRE(vec[i] == static_cast<float>(i));
+  }
+}
+
+TEST_CASE("Vector shrink to fit", "[memory]") {
+
+  binder::memory::ThreeSizesPool pool(1024, 64, 256);
+  binder::memory::ResizableVector<float> vec(40, &pool);
+  vec.pushBack(1.0f);
+  vec.pushBack(2.0f);
+  vec.pushBack(3.0f);
+  vec.shrinkToFit();
+  REQUIRE(vec.size() == 3);
+  REQUIRE(vec.reservedSize() == 3);
+  REQUIRE(vec[0] == 1.0f);
+  REQUIRE(vec[1] == 2.0f);
+  REQUIRE(vec[2] == 3.0f);
+
+  vec.clear();
+  vec.shrinkToFit();
+  REQUIRE(vec.reservedSize() == 0);
+  REQUIRE(vec.data() == nullptr);
+  REQUIRE(pool.getSmallAllocCount() + pool.getMediumAllocCount() +
+              pool.getLargeAllocCount() ==
+          0);
+  vec.pushBack(4.0f);
+  REQUIRE(vec[0] == 4.0f);
+}
+
+TEST_CASE("Vector growth factor", "[memory]") {
+
+  binder::memory::ResizableVector<int> vec(10);
+  REQUIRE(vec.getGrowthFactor() == 2.0f);
+  vec.setGrowthFactor(1.5f);
+  for (int i = 0; i < 11; ++i) {
+    vec.pushBack(i);
+  }
+  REQUIRE(vec.reservedSize() == 15);
+
+  // a factor too small to move a small reserve still grows by one
+  binder::memory::ResizableVector<int> small(1);
+  small.setGrowthFactor(1.1f);
+  small.pushBack(0);
+  small.pushBack(1);
+  REQUIRE(small.reservedSize() == 2);
+  REQUIRE(small[1] == 1);
+}
+
+TEST_CASE("Vector emplace back", "[memory]") {
+
+  struct Pair {
+    int first;
+    float second;
+  };
+  binder::memory::ResizableVector<Pair> vec;
+  for (int i = 0; i < 20; ++i) {
+    Pair &pair = vec.emplaceBack(i, static_cast<float>(i) * 0.5f);
+    REQUIRE(pair.first == i);
+  }
+  REQUIRE(vec.size() == 20);
+  for (int i = 0; i < 20; ++i) {
+    REQUIRE(vec[i].first == i);
+    REQUIRE(vec[i].second == static_cast<float>(i) * 0.5f);
+  }
+}
+
+TEST_CASE("Vector grows in place in the pool", "[memory]") {
+
+  binder::memory::ThreeSizesPool pool(4096, 64, 256);
+  binder::memory::ResizableVector<int> vec(8, &pool);
+  const int *start = vec.data();
+  for (int i = 0; i < 200; ++i) {
+    vec.pushBack(i);
+  }
+  // last allocation in the pool, never had to move
+  REQUIRE(vec.data() == start);
+  REQUIRE(pool.getLargeAllocCount() == 1);
+  for (int i = 0; i < 200; ++i) {
+    REQUIRE(vec[i] == i);
+  }
+
+  // something allocated after it, now it has to move
+  void *other = pool.allocate(16);
+  for (int i = 200; i < 300; ++i) {
+    vec.pushBack(i);
+  }
+  REQUIRE(vec.data() != start);
+  for (int i = 0; i < 300; ++i) {
+    REQUIRE(vec[i] == i);
+  }
+  pool.free(other);
+}
@@ -2,6 +2,12 @@
 #include "binder/legacyAST/scanner.h"
 #include "catch.h"
 
+// lexemes are views in the source, not null terminated
+inline bool lexemeEquals(const binder::Token &token, const char *expected) {
+  return (token.m_length == strlen(expected)) &&
+         (strncmp(token.m_lexeme, expected, token.m_length) == 0);
+}
+
 class SetupScannerTestFixture {
 public:
   SetupScannerTestFixture() : context({}), scanner(&context) {}
@@ -105,7 +111,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan string", "[scan]") {
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::MINUS);
   REQUIRE(tokens[2].m_type == binder::TOKEN_TYPE::MINUS);
   REQUIRE(tokens[3].m_type == binder::TOKEN_TYPE::STRING);
-  REQUIRE(strcmp(tokens[3].m_lexeme, "helloworld") == 0);
+  REQUIRE(lexemeEquals(tokens[3], "helloworld"));
   REQUIRE(tokens[4].m_type == binder::TOKEN_TYPE::BANG);
   REQUIRE(tokens[5].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
@@ -120,7 +126,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan empty string", "[scan]") {
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::MINUS);
   REQUIRE(tokens[2].m_type == binder::TOKEN_TYPE::MINUS);
   REQUIRE(tokens[3].m_type == binder::TOKEN_TYPE::STRING);
-  REQUIRE(strcmp(tokens[3].m_lexeme, "") == 0);
+  REQUIRE(lexemeEquals(tokens[3], ""));
   REQUIRE(tokens[4].m_type == binder::TOKEN_TYPE::BANG);
   REQUIRE(tokens[5].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
@@ -132,7 +138,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan parse integer", "[scan]") {
 
   REQUIRE(tokens.size() == 3);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::NUMBER);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "1234") == 0);
+  REQUIRE(lexemeEquals(tokens[0], "1234"));
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::BANG);
   REQUIRE(tokens[2].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
@@ -145,7 +151,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan parse float", "[scan]") {
   REQUIRE(tokens.size() == 4);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::NUMBER);
   REQUIRE(tokens[0].m_line == 1);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "1234.123333") == 0);
+  REQUIRE(lexemeEquals(tokens[0], "1234.123333"));
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::LEFT_PAREN);
   REQUIRE(tokens[2].m_type == binder::TOKEN_TYPE::BANG);
   REQUIRE(tokens[1].m_line == 2);
@@ -158,7 +164,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan parse float", "[scan]") {
   REQUIRE(tokens2.size() == 3);
   REQUIRE(tokens2[1].m_type == binder::TOKEN_TYPE::NUMBER);
   REQUIRE(tokens2[1].m_line == 0);
-  REQUIRE(strcmp(tokens2[1].m_lexeme, "3.1") == 0);
+  REQUIRE(lexemeEquals(tokens2[1], "3.1"));
   REQUIRE(tokens2[0].m_type == binder::TOKEN_TYPE::BANG);
   REQUIRE(tokens2[2].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
@@ -169,11 +175,11 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan identifiers 1", "[scan]") {
 
   REQUIRE(tokens.size() == 5);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::IDENTIFIER);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "chicago") == 0);
+  REQUIRE(lexemeEquals(tokens[0], "chicago"));
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::IDENTIFIER);
-  REQUIRE(strcmp(tokens[1].m_lexeme, "woa") == 0);
+  REQUIRE(lexemeEquals(tokens[1], "woa"));
   REQUIRE(tokens[2].m_type == binder::TOKEN_TYPE::NUMBER);
-  REQUIRE(strcmp(tokens[2].m_lexeme, "123") == 0);
+  REQUIRE(lexemeEquals(tokens[2], "123"));
   REQUIRE(tokens[3].m_type == binder::TOKEN_TYPE::BANG);
   REQUIRE(tokens[4].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
@@ -185,12 +191,12 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan identifiers 2", "[scan]") {
 
   REQUIRE(tokens.size() == 5);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::VAR);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "var") == 0);
+  REQUIRE(lexemeEquals(tokens[0], "var"));
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::IDENTIFIER);
-  REQUIRE(strcmp(tokens[1].m_lexeme, "helloWorld") == 0);
+  REQUIRE(lexemeEquals(tokens[1], "helloWorld"));
   REQUIRE(tokens[2].m_type == binder::TOKEN_TYPE::EQUAL);
   REQUIRE(tokens[3].m_type == binder::TOKEN_TYPE::NUMBER);
-  REQUIRE(strcmp(tokens[3].m_lexeme, "123") == 0);
+  REQUIRE(lexemeEquals(tokens[3], "123"));
   REQUIRE(tokens[4].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
 
@@ -201,7 +207,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan single digit", "[scan]") {
 
   REQUIRE(tokens.size() == 2);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::NUMBER);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "1") == 0);
+  REQUIRE(lexemeEquals(tokens[0], "1"));
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
 
@@ -212,8 +218,8 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan single char string", "[scan]") {
 
   REQUIRE(tokens.size() == 2);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::STRING);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "c") == 0);
-  REQUIRE(strlen(tokens[0].m_lexeme) == 1);
+  REQUIRE(lexemeEquals(tokens[0], "c"));
+  REQUIRE(tokens[0].m_length == 1);
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
 TEST_CASE_METHOD(SetupScannerTestFixture, "scan double char string", "[scan]") {
@@ -223,7 +229,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan double char string", "[scan]") {
 
   REQUIRE(tokens.size() == 2);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::STRING);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "ci") == 0);
+  REQUIRE(lexemeEquals(tokens[0], "ci"));
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
 TEST_CASE_METHOD(SetupScannerTestFixture, "scan string with number1",
@@ -234,7 +240,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan string with number1",
 
   REQUIRE(tokens.size() == 2);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::STRING);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "c5") == 0);
+  REQUIRE(lexemeEquals(tokens[0], "c5"));
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
 TEST_CASE_METHOD(SetupScannerTestFixture, "scan string with number2",
@@ -245,7 +251,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan string with number2",
 
   REQUIRE(tokens.size() == 2);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::STRING);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "hello521world") == 0);
+  REQUIRE(lexemeEquals(tokens[0], "hello521world"));
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
 
@@ -257,7 +263,7 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan single char number string",
 
   REQUIRE(tokens.size() == 2);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::STRING);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "3") == 0);
+  REQUIRE(lexemeEquals(tokens[0], "3"));
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
 
@@ -268,12 +274,12 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "scan mad single digit", "[scan]") {
 
   REQUIRE(tokens.size() == 4);
   REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::NUMBER);
-  REQUIRE(strcmp(tokens[0].m_lexeme, "1") == 0);
-  REQUIRE(strlen(tokens[0].m_lexeme) == 1);
+  REQUIRE(lexemeEquals(tokens[0], "1"));
+  REQUIRE(tokens[0].m_length == 1);
   REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::STAR);
   REQUIRE(tokens[2].m_type == binder::TOKEN_TYPE::NUMBER);
-  REQUIRE(strcmp(tokens[2].m_lexeme, "3.14") == 0);
-  REQUIRE(strlen(tokens[2].m_lexeme) == 4);
+  REQUIRE(lexemeEquals(tokens[2], "3.14"));
+  REQUIRE(tokens[2].m_length == 4);
   REQUIRE(tokens[3].m_type == binder::TOKEN_TYPE::END_OF_FILE);
 }
 
@@ -288,3 +294,66 @@ TEST_CASE_METHOD(SetupScannerTestFixture, "unterminated string", "[scan]") {
   context.setErrorReportingEnabled(true);
 
 }
+
+TEST_CASE_METHOD(SetupScannerTestFixture, "scan keywords", "[scan]") {
+  const binder::memory::ResizableVector<binder::Token> &tokens =
+      scan("and class else false fun for if nil or print return super this "
+           "true var while fo forx an thisx t");
+
+  const binder::TOKEN_TYPE expected[] = {
+      binder::TOKEN_TYPE::AND,        binder::TOKEN_TYPE::CLASS,
+      binder::TOKEN_TYPE::ELSE,       binder::TOKEN_TYPE::BOOL_FALSE,
+      binder::TOKEN_TYPE::FUN,        binder::TOKEN_TYPE::FOR,
+      binder::TOKEN_TYPE::IF,         binder::TOKEN_TYPE::NIL,
+      binder::TOKEN_TYPE::OR,         binder::TOKEN_TYPE::PRINT,
+      binder::TOKEN_TYPE::RETURN,     binder::TOKEN_TYPE::SUPER,
+      binder::TOKEN_TYPE::THIS,       binder::TOKEN_TYPE::BOOL_TRUE,
+      binder::TOKEN_TYPE::VAR,        binder::TOKEN_TYPE::WHILE,
+      binder::TOKEN_TYPE::IDENTIFIER, binder::TOKEN_TYPE::IDENTIFIER,
+      binder::TOKEN_TYPE::IDENTIFIER, binder::TOKEN_TYPE::IDENTIFIER,
+      binder::TOKEN_TYPE::IDENTIFIER, binder::TOKEN_TYPE::END_OF_FILE};
+  REQUIRE(tokens.size() == 22);
+  for (uint32_t i = 0; i < 22; ++i) {
+    REQUIRE(tokens[i].m_type == expected[i]);
+  }
+  REQUIRE(lexemeEquals(tokens[17], "forx"));
+}
+
+TEST_CASE_METHOD(SetupScannerTestFixture, "scan lexemes are views in the source", "[scan]") {
+  const char *source = "var name = \"text\" + 12.5;";
+  const binder::memory::ResizableVector<binder::Token> &tokens = scan(source);
+
+  REQUIRE(tokens.size() == 8);
+  REQUIRE(tokens[1].m_lexeme == source + 4);
+  REQUIRE(tokens[1].m_length == 4);
+  REQUIRE(tokens[3].m_lexeme == source + 12);
+  REQUIRE(tokens[3].m_length == 4);
+  REQUIRE(lexemeEquals(tokens[4], "+"));
+  REQUIRE(lexemeEquals(tokens[5], "12.5"));
+  REQUIRE(tokens[7].m_length == 0);
+  // nothing got copied in the pool
+  REQUIRE(context.getStringPool().getReport().allocationCount == 0);
+}
+
+TEST_CASE_METHOD(SetupScannerTestFixture, "scan long runs", "[scan]") {
+  // every run is longer than a block of chars, lines are still counted
+  const binder::memory::ResizableVector<binder::Token> &tokens =
+      scan("    \n\t\t  \r\n// a comment long enough to need more than one "
+           "block\n"
+           "a_very_long_identifier_that_keeps_going_past_a_block_2 = "
+           "123456789012345678901234567890123456.25;\n"
+           "\"a string that goes on\nand on for more than a block\" end");
+
+  REQUIRE(tokens.size() == 7);
+  REQUIRE(tokens[0].m_type == binder::TOKEN_TYPE::IDENTIFIER);
+  REQUIRE(tokens[0].m_length == 54);
+  REQUIRE(tokens[0].m_line == 3);
+  REQUIRE(tokens[1].m_type == binder::TOKEN_TYPE::EQUAL);
+  REQUIRE(lexemeEquals(tokens[2], "123456789012345678901234567890123456.25"));
+  REQUIRE(tokens[3].m_type == binder::TOKEN_TYPE::SEMICOLON);
+  REQUIRE(lexemeEquals(tokens[4],
+                       "a string that goes on\nand on for more than a block"));
+  REQUIRE(tokens[4].m_line == 5);
+  REQUIRE(lexemeEquals(tokens[5], "end"));
+  REQUIRE(tokens[6].m_type == binder::TOKEN_TYPE::END_OF_FILE);
+}
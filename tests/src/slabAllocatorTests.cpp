@@ -0,0 +1,69 @@
+#include "binder/memory/slabAllocator.h"
+#include "catch.h"
+
+TEST_CASE("slab allocator size classes", "[memory]") {
+  using binder::memory::SlabAllocator;
+  REQUIRE(SlabAllocator::getSlotSize(1) == 16);
+  REQUIRE(SlabAllocator::getSlotSize(16) == 16);
+  REQUIRE(SlabAllocator::getSlotSize(17) == 32);
+  REQUIRE(SlabAllocator::getSlotSize(65) == 96);
+  REQUIRE(SlabAllocator::getSlotSize(129) == 192);
+  REQUIRE(SlabAllocator::getSlotSize(256) == 256);
+  REQUIRE(SlabAllocator::getSlotSize(257) == 257);
+}
+
+TEST_CASE("slab allocator reuses freed slots", "[memory]") {
+  binder::memory::SlabAllocator alloc;
+  void *first = alloc.allocate(24);
+  void *second = alloc.allocate(30);
+  REQUIRE(first != second);
+  // same class, so the slots are next to each other in the slab
+  REQUIRE(static_cast<char *>(second) - static_cast<char *>(first) == 32);
+  REQUIRE(reinterpret_cast<uintptr_t>(first) % 16 == 0);
+
+  alloc.free(first, 24);
+  void *third = alloc.allocate(20);
+  REQUIRE(third == first);
+
+  binder::memory::SlabAllocator::Stats stats = alloc.getStats();
+  REQUIRE(stats.allocations == 3);
+  REQUIRE(stats.frees == 1);
+  REQUIRE(stats.classes[1].slotSize == 32);
+  REQUIRE(stats.classes[1].slotsInUse == 2);
+  REQUIRE(stats.classes[1].slabs == 1);
+  REQUIRE(stats.bytesInUse == 64);
+  REQUIRE(stats.bytesReserved == binder::memory::SlabAllocator::SLAB_SIZE);
+  alloc.free(second, 30);
+  alloc.free(third, 20);
+  REQUIRE(alloc.getStats().bytesInUse == 0);
+}
+
+TEST_CASE("slab allocator many allocations", "[memory]") {
+  binder::memory::SlabAllocator alloc;
+  const uint32_t count = 10000;
+  binder::memory::ResizableVector<char *> blocks;
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint32_t size = 8 + (i % 300);
+    auto *block = static_cast<char *>(alloc.allocate(size));
+    // writing the whole block, the sanitizers catch overlaps
+    memset(block, static_cast<int>(i & 0xff), size);
+    blocks.pushBack(block);
+  }
+  binder::memory::SlabAllocator::Stats stats = alloc.getStats();
+  REQUIRE(stats.largeInUse > 0);
+  uint32_t slots = stats.largeInUse;
+  for (uint32_t c = 0; c < binder::memory::SlabAllocator::CLASS_COUNT; ++c) {
+    slots += stats.classes[c].slotsInUse;
+  }
+  REQUIRE(slots == count);
+
+  for (uint32_t i = 0; i < count; ++i) {
+    const uint32_t size = 8 + (i % 300);
+    REQUIRE(blocks[i][size - 1] == static_cast<char>(i & 0xff));
+    alloc.free(blocks[i], size);
+  }
+  stats = alloc.getStats();
+  REQUIRE(stats.bytesInUse == 0);
+  REQUIRE(stats.largeInUse == 0);
+  REQUIRE(stats.frees == count);
+}
@@ -53,6 +53,87 @@ TEST_CASE("MemoryPool mixed deletion and addition", "[memory]") {
   for (uint32_t i = 0; i < 5; ++i) {
     uint32_t idx;
     pool.getFreeMemoryData(idx);
-    REQUIRE(idx == indices[5 - i - 1]);
+    // same slot, but a new generation so the handle differs
+    REQUIRE(pool.getSlotFromHandle(idx) == indices[5 - i - 1]);
+    REQUIRE(idx != indices[5 - i - 1]);
   }
 }
+
+TEST_CASE("MemoryPool stale handles", "[memory]") {
+  binder::memory::SparseMemoryPool<DummyAlloc> pool(20);
+  uint32_t first;
+  pool.getFreeMemoryData(first).value2 = 1;
+  REQUIRE(pool.isValid(first));
+  pool.free(first);
+  REQUIRE(!pool.isValid(first));
+
+  // the slot is reused, the old handle stays stale
+  uint32_t second;
+  pool.getFreeMemoryData(second).value2 = 2;
+  REQUIRE(pool.getSlotFromHandle(second) == pool.getSlotFromHandle(first));
+  REQUIRE(!pool.isValid(first));
+  REQUIRE(pool.isValid(second));
+  REQUIRE(pool[second].value2 == 2);
+
+  // never handed out
+  REQUIRE(!pool.isValid(5));
+}
+
+TEST_CASE("MemoryPool out of range handles", "[memory]") {
+  using Pool = binder::memory::SparseMemoryPool<DummyAlloc>;
+  Pool pool(16);
+  uint32_t handle;
+  pool.getFreeMemoryData(handle);
+  REQUIRE(pool.getPageCount() == 1);
+
+  // slots past every page, with and without a generation, must be rejected
+  // without touching the pages
+  REQUIRE(!pool.isValid(pool.getCapacity()));
+  REQUIRE(!pool.isValid(pool.getCapacity() * 4));
+  REQUIRE(!pool.isValid(Pool::SLOT_MASK));
+  REQUIRE(!pool.isValid(0xFFFFFFFF));
+  REQUIRE(!pool.isValid((1u << Pool::SLOT_BITS) | Pool::SLOT_MASK));
+  REQUIRE(pool.isValid(handle));
+}
+
+TEST_CASE("MemoryPool grows without moving", "[memory]") {
+  binder::memory::SparseMemoryPool<DummyAlloc> pool(16);
+  REQUIRE(pool.getCapacity() == 16);
+  uint32_t handles[100];
+  DummyAlloc *pointers[100];
+  for (uint32_t i = 0; i < 100; ++i) {
+    DummyAlloc &data = pool.getFreeMemoryData(handles[i]);
+    data.value2 = i;
+    pointers[i] = &data;
+  }
+  REQUIRE(pool.getPageCount() == 7);
+  REQUIRE(pool.getCapacity() == 112);
+  REQUIRE(pool.getAllocatedCount() == 100);
+  for (uint32_t i = 0; i < 100; ++i) {
+    REQUIRE(handles[i] == i);
+    REQUIRE(&pool[handles[i]] == pointers[i]);
+    REQUIRE(pool[handles[i]].value2 == i);
+  }
+}
+
+TEST_CASE("MemoryPool clear", "[memory]") {
+  binder::memory::SparseMemoryPool<DummyAlloc> pool(16);
+  uint32_t handles[40];
+  for (uint32_t i = 0; i < 40; ++i) {
+    pool.getFreeMemoryData(handles[i]);
+  }
+  pool.free(handles[3]);
+  pool.clear();
+  REQUIRE(pool.getAllocatedCount() == 0);
+  REQUIRE(pool.getPageCount() == 3);
+  for (uint32_t i = 0; i < 40; ++i) {
+    REQUIRE(!pool.isValid(handles[i]));
+  }
+
+  // starts again from the first slot, pages are kept
+  uint32_t idx;
+  pool.getFreeMemoryData(idx);
+  REQUIRE(pool.getSlotFromHandle(idx) == 0);
+  REQUIRE(pool.isValid(idx));
+  REQUIRE(pool.getPageCount() == 3);
+}
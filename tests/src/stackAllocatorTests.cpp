@@ -42,3 +42,104 @@ TEST_CASE("StackAllocator  multiple alloc/free", "[memory]") {
   mem = alloc.free(8);
   REQUIRE(mem == alloc.getStartPtr());
 }
+
+TEST_CASE("StackAllocator alignment", "[memory]") {
+  binder::memory::StackAllocator alloc;
+  alloc.initialize(256);
+  char *start = static_cast<char *>(alloc.getStartPtr());
+  alloc.allocate(3);
+  void *mem = alloc.allocate(8, 8);
+  REQUIRE(reinterpret_cast<uintptr_t>(mem) % 8 == 0);
+  REQUIRE(mem >= start + 3);
+  REQUIRE(mem < start + 3 + 8);
+
+  mem = alloc.allocate(1, 64);
+  REQUIRE(reinterpret_cast<uintptr_t>(mem) % 64 == 0);
+
+  double *value = alloc.create<double>(2.5);
+  REQUIRE(reinterpret_cast<uintptr_t>(value) % alignof(double) == 0);
+  REQUIRE(*value == 2.5);
+}
+
+TEST_CASE("StackAllocator chains blocks when full", "[memory]") {
+  binder::memory::StackAllocator alloc;
+  alloc.initialize(64);
+  void *first = alloc.allocate(48);
+  REQUIRE(first == alloc.getStartPtr());
+  REQUIRE(alloc.getBlockCount() == 1);
+
+  // does not fit in what is left of the first block
+  char *second = static_cast<char *>(alloc.allocate(32));
+  REQUIRE(alloc.getBlockCount() == 2);
+  REQUIRE(alloc.getBytesReserved() == 128);
+  REQUIRE(alloc.getStackPtr() == second + 32);
+
+  // bigger than a block gets a block big enough
+  alloc.allocate(200);
+  REQUIRE(alloc.getBlockCount() == 3);
+  REQUIRE(alloc.getBytesReserved() == 128 + 200);
+
+  // the blocks are kept after a reset and reused in the same order
+  alloc.reset();
+  REQUIRE(alloc.getBytesUsed() == 0);
+  REQUIRE(alloc.allocate(48) == first);
+  REQUIRE(alloc.allocate(32) == second);
+  REQUIRE(alloc.getBlockCount() == 3);
+}
+
+TEST_CASE("StackAllocator markers", "[memory]") {
+  binder::memory::StackAllocator alloc;
+  alloc.initialize(64);
+  alloc.allocate(16);
+  const binder::memory::StackAllocator::Marker marker = alloc.getMarker();
+  void *mem = alloc.allocate(16);
+  for (int i = 0; i < 10; ++i) {
+    alloc.allocate(40);
+  }
+  REQUIRE(alloc.getBlockCount() == 11);
+
+  alloc.rewind(marker);
+  REQUIRE(alloc.getBytesUsed() == 16);
+  REQUIRE(alloc.allocate(16) == mem);
+  REQUIRE(alloc.getBlockCount() == 11);
+}
+
+TEST_CASE("StackAllocator scope", "[memory]") {
+  binder::memory::StackAllocator alloc;
+  alloc.initialize(64);
+  alloc.allocate(8);
+  void *top = alloc.getStackPtr();
+  {
+    binder::memory::StackAllocator::Scope scope(alloc);
+    alloc.allocate(32);
+    {
+      binder::memory::StackAllocator::Scope inner(alloc);
+      alloc.allocate(128);
+    }
+    REQUIRE(alloc.getBytesUsed() == 40);
+  }
+  REQUIRE(alloc.getStackPtr() == top);
+
+  // the scope also rewinds when unwinding
+  try {
+    binder::memory::StackAllocator::Scope scope(alloc);
+    alloc.allocate(256);
+    throw 1;
+  } catch (int) {
+  }
+  REQUIRE(alloc.getStackPtr() == top);
+}
+
+TEST_CASE("StackAllocator not owned memory", "[memory]") {
+  char buffer[32];
+  binder::memory::StackAllocator alloc;
+  alloc.setMemoryStartEnd(buffer, buffer + 32);
+  REQUIRE(alloc.allocate(32) == buffer);
+  // the buffer is full, the next block is allocated and owned
+  void *mem = alloc.allocate(16);
+  REQUIRE(mem != nullptr);
+  REQUIRE(alloc.getBlockCount() == 2);
+  alloc.release();
+  REQUIRE(alloc.getBlockCount() == 0);
+  REQUIRE(alloc.getBytesReserved() == 0);
+}
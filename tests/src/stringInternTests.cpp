@@ -21,3 +21,52 @@ TEST_CASE( "simple intern test with length", "[string-intern]") {
   const char* hello2 = intern.intern("hello world");
   REQUIRE(hello1 == hello2);
 }
+
+TEST_CASE( "intern with length does not match a longer string", "[string-intern]") {
+
+  // a single bin forces every key to be probed, so "ab" would be compared
+  // against "abc"
+  binder::memory::StringIntern intern(2);
+  const char* abc = intern.intern("abc");
+  const char* ab = intern.intern("abc",2);
+  REQUIRE(ab != abc);
+  REQUIRE(strcmp(ab, "ab") == 0);
+}
+
+TEST_CASE( "intern with a precomputed hash", "[string-intern]") {
+
+  binder::memory::StringIntern intern(32);
+  const char* source = "hello world dammm";
+  const uint32_t hash = binder::hashString32(source, 11);
+  const char* hello1 = intern.intern(source, 11, hash, true);
+  const char* hello2 = intern.intern("hello world");
+  REQUIRE(hello1 == hello2);
+  REQUIRE(intern.intern(source, 11, hash, true) == hello1);
+}
+
+TEST_CASE( "intern reset and release", "[string-intern]") {
+
+  binder::memory::StringIntern intern(32);
+  const char* hello = intern.intern("hello");
+  intern.intern("world");
+  const char* view = "not copied";
+  intern.intern(view, false);
+  REQUIRE(intern.getStringCount() == 3);
+  // only the copies go in the arena
+  REQUIRE(intern.getBytesUsed() == 12);
+  REQUIRE(intern.getChunkCount() == 1);
+
+  intern.reset();
+  REQUIRE(intern.getStringCount() == 0);
+  REQUIRE(intern.getBytesUsed() == 0);
+  REQUIRE(intern.getChunkCount() == 1);
+  // the arena memory is reused
+  REQUIRE(intern.intern("hello") == hello);
+  REQUIRE(intern.intern(view) != view);
+
+  intern.release();
+  REQUIRE(intern.getStringCount() == 0);
+  REQUIRE(intern.getBytesReserved() == 0);
+  REQUIRE(intern.getChunkCount() == 0);
+  REQUIRE(strcmp(intern.intern("again"), "again") == 0);
+}
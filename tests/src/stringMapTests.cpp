@@ -0,0 +1,171 @@
+#include "binder/memory/stringMap.h"
+
+#include "catch.h"
+
+TEST_CASE("string map insert and get", "[string-map]") {
+  binder::memory::StringMap<int> map(32);
+  map.insert(binder::memory::StringKey("hello"), 1);
+  map.insert(binder::memory::StringKey("world"), 2);
+
+  int value = 0;
+  REQUIRE(map.get(binder::memory::StringKey("hello"), value));
+  REQUIRE(value == 1);
+  REQUIRE(map.get(binder::memory::StringKey("world"), value));
+  REQUIRE(value == 2);
+  REQUIRE(!map.get(binder::memory::StringKey("hell"), value));
+  REQUIRE(map.getUsedBins() == 2);
+
+  // same key again only overrides the value
+  map.insert(binder::memory::StringKey("hello"), 3);
+  REQUIRE(map.get(binder::memory::StringKey("hello"), value));
+  REQUIRE(value == 3);
+  REQUIRE(map.getUsedBins() == 2);
+}
+
+TEST_CASE("string map keys don't need a null terminator", "[string-map]") {
+  binder::memory::StringMap<int> map(32);
+  const char *source = "helloworld";
+  const binder::memory::StringKey &stored =
+      map.insert(binder::memory::StringKey(source, 5), 1);
+
+  // the stored key is a copy in the arena, null terminated
+  REQUIRE(stored.chars != source);
+  REQUIRE(strcmp(stored.chars, "hello") == 0);
+  REQUIRE(stored.length == 5);
+
+  int value = 0;
+  REQUIRE(map.get(binder::memory::StringKey("hello"), value));
+  REQUIRE(value == 1);
+  REQUIRE(!map.get(binder::memory::StringKey(source, 10), value));
+  REQUIRE(!map.get(binder::memory::StringKey(source, 4), value));
+
+  const binder::memory::StringKey *found = nullptr;
+  REQUIRE(map.get(binder::memory::StringKey(source, 5), value, found));
+  REQUIRE(found->chars == stored.chars);
+}
+
+TEST_CASE("string map same hash different length", "[string-map]") {
+  // forcing the same hash on every key, only length and chars tell them apart
+  binder::memory::StringMap<int> map(32);
+  map.insert(binder::memory::StringKey("ab", 2, 7), 1);
+  map.insert(binder::memory::StringKey("abc", 3, 7), 2);
+  map.insert(binder::memory::StringKey("ac", 2, 7), 3);
+
+  int value = 0;
+  REQUIRE(map.get(binder::memory::StringKey("ab", 2, 7), value));
+  REQUIRE(value == 1);
+  REQUIRE(map.get(binder::memory::StringKey("abc", 3, 7), value));
+  REQUIRE(value == 2);
+  REQUIRE(map.get(binder::memory::StringKey("ac", 2, 7), value));
+  REQUIRE(value == 3);
+  REQUIRE(!map.get(binder::memory::StringKey("ad", 2, 7), value));
+}
+
+TEST_CASE("string map insert view keeps the caller chars", "[string-map]") {
+  binder::memory::StringMap<int> map(32);
+  const char *source = "viewed";
+  map.insertView(binder::memory::StringKey(source, 6), 1);
+
+  REQUIRE(map.getArena().getBytesUsed() == 0);
+  int value = 0;
+  const binder::memory::StringKey *found = nullptr;
+  REQUIRE(map.get(binder::memory::StringKey("viewed"), value, found));
+  REQUIRE(found->chars == source);
+
+  REQUIRE(map.remove(binder::memory::StringKey("viewed")));
+  REQUIRE(!map.containsKey(binder::memory::StringKey("viewed")));
+  REQUIRE(map.getUsedBins() == 0);
+}
+
+TEST_CASE("string map two part get", "[string-map]") {
+  binder::memory::StringMap<int> map(32);
+  map.insert(binder::memory::StringKey("helloworld"), 1);
+
+  int value = 0;
+  const uint32_t hash = binder::hashString32("helloworld", 10);
+  REQUIRE(map.get("hello", 5, "world", 5, hash, value));
+  REQUIRE(value == 1);
+  REQUIRE(map.get("helloworld", 10, "", 0, hash, value));
+  REQUIRE(!map.get("hello", 5, "worl", 4, hash, value));
+}
+
+TEST_CASE("string map grows", "[string-map]") {
+  binder::memory::StringMap<int> map(16);
+  char buffer[32];
+  const int count = 2000;
+  for (int i = 0; i < count; ++i) {
+    const int length = snprintf(buffer, sizeof(buffer), "key%i", i);
+    map.insert(binder::memory::StringKey(buffer, length), i);
+  }
+  REQUIRE(map.getUsedBins() == count);
+  REQUIRE(map.binCount() > 16);
+
+  for (int i = 0; i < count; ++i) {
+    const int length = snprintf(buffer, sizeof(buffer), "key%i", i);
+    int value = -1;
+    REQUIRE(map.get(binder::memory::StringKey(buffer, length), value));
+    REQUIRE(value == i);
+  }
+}
+
+TEST_CASE("string map clear resets the arena", "[string-map]") {
+  binder::memory::StringMap<int> map(16);
+  map.insert(binder::memory::StringKey("hello"), 1);
+  map.insert(binder::memory::StringKey("world"), 2);
+  REQUIRE(map.getArena().getBytesUsed() == 12);
+  REQUIRE(map.getArena().getChunkCount() == 1);
+
+  map.clear();
+  REQUIRE(map.getUsedBins() == 0);
+  REQUIRE(map.getArena().getBytesUsed() == 0);
+  REQUIRE(map.getArena().getChunkCount() == 1);
+  int value = 0;
+  REQUIRE(!map.get(binder::memory::StringKey("hello"), value));
+
+  map.insert(binder::memory::StringKey("hello"), 3);
+  REQUIRE(map.get(binder::memory::StringKey("hello"), value));
+  REQUIRE(value == 3);
+}
+
+TEST_CASE("string arena chunks", "[string-map]") {
+  binder::memory::StringArena arena(64);
+  const char *small = arena.copy("small", 5);
+  REQUIRE(strcmp(small, "small") == 0);
+  REQUIRE(arena.getChunkCount() == 1);
+  REQUIRE(arena.getBytesReserved() == 64);
+
+  // bigger than a quarter of a chunk, gets its own
+  const char *big = arena.copy("this string is too big to share", 31);
+  REQUIRE(strcmp(big, "this string is too big to share") == 0);
+  REQUIRE(arena.getChunkCount() == 2);
+  REQUIRE(arena.getBytesReserved() == 64 + 32);
+
+  // small strings keep going in the first chunk
+  const char *next = arena.copy("next", 4);
+  REQUIRE(next == small + 6);
+  REQUIRE(arena.getChunkCount() == 2);
+  REQUIRE(arena.getBytesUsed() == 6 + 32 + 5);
+
+  arena.reset();
+  REQUIRE(arena.getChunkCount() == 1);
+  REQUIRE(arena.getBytesUsed() == 0);
+  REQUIRE(arena.copy("again", 5) == small);
+
+  arena.release();
+  REQUIRE(arena.getChunkCount() == 0);
+  REQUIRE(arena.getBytesReserved() == 0);
+}
+
+TEST_CASE("string map insert returns the key when growing", "[string-map]") {
+  binder::memory::StringMap<int> map(16);
+  char buffer[32];
+  for (int i = 0; i < 200; ++i) {
+    const int length = snprintf(buffer, sizeof(buffer), "key%i", i);
+    // the insert that triggers a rehash must hand back the key in the new
+    // bins
+    const binder::memory::StringKey &stored =
+        map.insert(binder::memory::StringKey(buffer, length), i);
+    REQUIRE(stored.length == static_cast<uint32_t>(length));
+    REQUIRE(strcmp(stored.chars, buffer) == 0);
+  }
+}
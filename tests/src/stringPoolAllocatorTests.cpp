@@ -1,4 +1,5 @@
 #include "catch.h"
+#include "binder/log/bufferLog.h"
 #include "binder/memory/stringPool.h"
 
 TEST_CASE("String pool basic alloc 1 static", "[memory]") {
@@ -177,7 +178,9 @@ TEST_CASE("String pool basic concatenation 1", "[memory]") {
           binder::memory::STRING_MANIPULATION_FLAGS::FREE_SECOND_AFTER_OPERATION);
   REQUIRE(strcmp(res5, compare) == 0);
   REQUIRE(strcmp(mem1, original) != 0);
-  REQUIRE(strcmp(mem2, original2) != 0);
+  // mem2 got merged in the free block mem1 became, nothing is written over
+  // it, the pool tells us it was freed: res1 to res5 are left
+  REQUIRE(alloc.getReport().allocationCount == 5);
 
   // realloc mem1 and mem2
   mem1 = alloc.allocate(original);
@@ -190,7 +193,8 @@ TEST_CASE("String pool basic concatenation 1", "[memory]") {
   // nothing should happen since the joiner is not in the pool
   REQUIRE(strcmp(res6, compare) == 0);
   REQUIRE(strcmp(mem1, original) != 0);
-  REQUIRE(strcmp(mem2, original2) != 0);
+  // merged with mem1 again, res1 to res6 are left
+  REQUIRE(alloc.getReport().allocationCount == 6);
 
   // alloc and free everything
   mem1 = alloc.allocate(original);
@@ -204,8 +208,8 @@ TEST_CASE("String pool basic concatenation 1", "[memory]") {
   // nothing should happen since the joiner is not in the pool
   REQUIRE(strcmp(res7, compare) == 0);
   REQUIRE(strcmp(mem1, original) != 0);
-  REQUIRE(strcmp(mem2, original2) != 0);
-  REQUIRE(strcmp(joiner2, joiner1) != 0);
+  // mem2 and the joiner got merged with mem1, res1 to res7 are left
+  REQUIRE(alloc.getReport().allocationCount == 7);
 }
 
 TEST_CASE("String pool basic concatenation 2", "[memory]") {
@@ -468,3 +472,21 @@ TEST_CASE("String pool substring", "[memory]") {
 
 
 
+
+TEST_CASE("String pool report", "[memory]") {
+  binder::memory::StringPool alloc(2 << 16);
+  const char *first = alloc.allocate("hello");
+  const char *second = alloc.allocate("world");
+  alloc.allocate("!");
+  alloc.free(first);
+  alloc.free(second);
+
+  const binder::memory::ThreeSizesPool::Report report = alloc.getReport();
+  REQUIRE(report.allocationCount == 1);
+  // the two freed strings got merged
+  REQUIRE(report.freeBlockCount == 1);
+
+  binder::log::BufferedLog log;
+  alloc.logReport(&log);
+  REQUIRE(strstr(log.getBuffer(), "1 free blocks") != nullptr);
+}
@@ -140,9 +140,13 @@ TEST_CASE("Tree sizes pool delete alloc 2", "[memory]") {
   }
 #endif
 
+  // mem2 and mem3 were merged when freed, mem5 only took the front of it,
+  // the rest is right after mem5
   void *mem6 = alloc.allocate(70);
   REQUIRE(alloc.getMediumAllocCount() == 4);
-  REQUIRE(mem6 == mem3);
+  REQUIRE(mem6 == reinterpret_cast<char *>(mem5) + alloc.getRawAllocSize(mem5));
+  REQUIRE(reinterpret_cast<char *>(mem6) + alloc.getAllocSize(mem6) <=
+          reinterpret_cast<char *>(mem4));
   // checking memory is properly written and not overrun
   memSizeInBtye = alloc.getAllocSize(mem6);
   memset(mem6, 6, memSizeInBtye);
@@ -160,3 +164,171 @@ TEST_CASE("Tree sizes pool delete alloc 2", "[memory]") {
   alloc.allocate(200);
   REQUIRE(alloc.getMediumAllocCount() == 5);
 }
+
+TEST_CASE("Tree sizes pool extend last alloc", "[memory]") {
+  binder::memory::ThreeSizesPool alloc(2048, 64, 256);
+  void *mem1 = alloc.allocate(16);
+  void *mem2 = alloc.allocate(32);
+  memset(mem2, 2, 32);
+
+  // only the last allocation can grow in place
+  REQUIRE(!alloc.tryExtend(mem1, 48));
+  REQUIRE(alloc.getAllocSize(mem1) == 16);
+
+  REQUIRE(alloc.tryExtend(mem2, 100));
+  REQUIRE(alloc.getAllocSize(mem2) == 100);
+  // moved from the small to the medium bucket
+  REQUIRE(alloc.getSmallAllocCount() == 1);
+  REQUIRE(alloc.getMediumAllocCount() == 1);
+  auto *bytePtr = reinterpret_cast<unsigned char *>(mem2);
+  for (uint32_t i = 0; i < 32; ++i) {
+    REQUIRE(bytePtr[i] == 2);
+  }
+
+  // the next allocation starts past the extended one
+  void *mem3 = alloc.allocate(16);
+  REQUIRE(reinterpret_cast<char *>(mem3) >=
+          reinterpret_cast<char *>(mem2) + 100);
+  REQUIRE(!alloc.tryExtend(mem2, 200));
+
+  // not enough pool left
+  REQUIRE(!alloc.tryExtend(mem3, 4096));
+
+  // freeing the extended allocation puts it in the medium bucket
+  alloc.free(mem2);
+  REQUIRE(alloc.getMediumAllocCount() == 0);
+  void *mem4 = alloc.allocate(90);
+  REQUIRE(mem4 == mem2);
+}
+
+TEST_CASE("Tree sizes pool merges freed neighbours", "[memory]") {
+  binder::memory::ThreeSizesPool alloc(4096);
+  void *mem1 = alloc.allocate(100);
+  void *mem2 = alloc.allocate(100);
+  void *mem3 = alloc.allocate(100);
+  void *mem4 = alloc.allocate(100);
+  void *keep = alloc.allocate(16);
+
+  // freed out of order, the three end up as a single block
+  alloc.free(mem1);
+  alloc.free(mem3);
+  REQUIRE(alloc.getReport().freeBlockCount == 2);
+  alloc.free(mem2);
+  binder::memory::ThreeSizesPool::Report report = alloc.getReport();
+  REQUIRE(report.freeBlockCount == 1);
+  REQUIRE(report.freeBytes == 3 * 104);
+  REQUIRE(report.largestFreeBlock == 3 * 104);
+  REQUIRE(report.fragmentation == 0.0f);
+
+  // something that needs the three of them together
+  void *big = alloc.allocate(300);
+  REQUIRE(big == mem1);
+  REQUIRE(alloc.getReport().freeBlockCount == 0);
+
+  // the top never goes back, everything freed ends up in a single block
+  const uint64_t topBytes = alloc.getReport().topBytes;
+  alloc.free(big);
+  alloc.free(keep);
+  REQUIRE(alloc.getReport().freeBlockCount == 2);
+  alloc.free(mem4);
+  report = alloc.getReport();
+  REQUIRE(report.freeBlockCount == 1);
+  REQUIRE(report.allocationCount == 0);
+  REQUIRE(report.allocatedBytes == 0);
+  REQUIRE(report.freeBytes == 4 * 104 + 20);
+  REQUIRE(report.topBytes == topBytes);
+
+  // and it can all be handed out again
+  REQUIRE(alloc.allocate(4 * 104 + 16) == mem1);
+}
+
+TEST_CASE("Tree sizes pool best fit", "[memory]") {
+  binder::memory::ThreeSizesPool alloc(4096);
+  void *sizes[3];
+  void *guards[3];
+  // all three land in the same bin
+  const uint32_t requested[3] = {600, 520, 560};
+  for (int i = 0; i < 3; ++i) {
+    sizes[i] = alloc.allocate(requested[i]);
+    guards[i] = alloc.allocate(16);
+  }
+  for (int i = 0; i < 3; ++i) {
+    alloc.free(sizes[i]);
+  }
+  REQUIRE(alloc.getReport().freeBlockCount == 3);
+  REQUIRE(alloc.getReport().fragmentation > 0.0f);
+
+  // the smallest block that fits
+  REQUIRE(alloc.allocate(530) == sizes[2]);
+  REQUIRE(alloc.allocate(516) == sizes[1]);
+  REQUIRE(alloc.allocate(590) == sizes[0]);
+  for (int i = 0; i < 3; ++i) {
+    alloc.free(guards[i]);
+  }
+}
+
+TEST_CASE("Tree sizes pool grows when exhausted", "[memory]") {
+  binder::memory::ThreeSizesPool alloc(512);
+  void *memory[64];
+  for (int i = 0; i < 64; ++i) {
+    memory[i] = alloc.allocate(60);
+    memset(memory[i], i, 60);
+  }
+  binder::memory::ThreeSizesPool::Report report = alloc.getReport();
+  REQUIRE(report.backingBlockCount > 1);
+  REQUIRE(report.allocationCount == 64);
+  for (int i = 0; i < 64; ++i) {
+    REQUIRE(alloc.allocationInPool(memory[i]));
+    auto *bytePtr = reinterpret_cast<unsigned char *>(memory[i]);
+    for (int b = 0; b < 60; ++b) {
+      REQUIRE(bytePtr[b] == i);
+    }
+  }
+
+  // bigger than a backing block
+  void *huge = alloc.allocate(4000);
+  REQUIRE(alloc.getAllocSize(huge) >= 4000);
+  memset(huge, 1, 4000);
+
+  for (int i = 0; i < 64; ++i) {
+    alloc.free(memory[i]);
+  }
+  alloc.free(huge);
+  REQUIRE(alloc.getReport().allocationCount == 0);
+  REQUIRE(alloc.getReport().allocatedBytes == 0);
+}
+
+TEST_CASE("Tree sizes pool random churn", "[memory]") {
+  // the pattern of a long running string pool, if the freed memory did not
+  // get merged the pool would keep growing
+  binder::memory::ThreeSizesPool alloc(64 * 1024);
+  static constexpr int SLOTS = 256;
+  void *memory[SLOTS] = {};
+  uint32_t sizes[SLOTS] = {};
+  uint32_t seed = 12345;
+  for (int i = 0; i < 100000; ++i) {
+    seed = seed * 1664525u + 1013904223u;
+    const int slot = static_cast<int>((seed >> 8) % SLOTS);
+    if (memory[slot] != nullptr) {
+      auto *bytePtr = reinterpret_cast<unsigned char *>(memory[slot]);
+      REQUIRE(bytePtr[0] == static_cast<unsigned char>(slot));
+      REQUIRE(bytePtr[sizes[slot] - 1] == static_cast<unsigned char>(slot));
+      alloc.free(memory[slot]);
+      memory[slot] = nullptr;
+    } else {
+      sizes[slot] = 1 + (seed >> 20) % 400;
+      memory[slot] = alloc.allocate(sizes[slot]);
+      memset(memory[slot], slot, sizes[slot]);
+    }
+  }
+  REQUIRE(alloc.getReport().backingBlockCount == 1);
+  for (int slot = 0; slot < SLOTS; ++slot) {
+    if (memory[slot] != nullptr) {
+      alloc.free(memory[slot]);
+    }
+  }
+  const binder::memory::ThreeSizesPool::Report report = alloc.getReport();
+  REQUIRE(report.freeBlockCount == 1);
+  REQUIRE(report.fragmentation == 0.0f);
+  REQUIRE(report.allocatedBytes == 0);
+}
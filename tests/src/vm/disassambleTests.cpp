@@ -89,7 +89,12 @@ TEST_CASE_METHOD(SetupDisassamblerTestFixture, "temp", "[disassambler]") {
   const char *source = "1 + 2 * 4;";
 
   binder::memory::StringIntern intern(1024);
-  binder::vm::Compiler comp(&intern);
+  binder::vm::GlobalTable globals(1024);
+  binder::vm::Heap heap;
+  // no folding, we want to see the arithmetic
+  binder::vm::CompilerConfig config;
+  config.constantFolding = false;
+  binder::vm::Compiler comp(&intern, &globals, &heap, config);
   bool result= comp.compile(source, &m_log);
   REQUIRE(result == true);
   const binder::vm::Chunk* chunk= comp.getCompiledChunk();
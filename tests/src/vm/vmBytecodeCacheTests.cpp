@@ -0,0 +1,264 @@
+#include "binder/log/bufferLog.h"
+#include "binder/vm/bytecodeCache.h"
+#include "binder/vm/vm.h"
+
+#include "../catch.h"
+#include <cstdio>
+#include <string>
+
+static const char *CACHE_TEST_PATH = "bytecodeCacheTest.bnc";
+// magic plus the six uint32 of the header, see bytecodeCache.h
+static constexpr uint32_t CACHE_CODE_OFFSET = 28;
+
+class SetupVmBytecodeCacheTestFixture {
+public:
+  SetupVmBytecodeCacheTestFixture()
+      : m_compileVm(&m_compileLog), m_loadVm(&m_loadLog) {}
+  // the chunks belong to the vms
+  ~SetupVmBytecodeCacheTestFixture() { remove(CACHE_TEST_PATH); }
+
+  // compiles and runs the source on the first vm, then saves the chunk and
+  // loads it back on the second one
+  bool compileAndLoad(const char *source) {
+    if (m_compileVm.interpret(source) == binder::vm::INTERPRET_RESULT::
+                                             INTERPRET_COMPILE_ERROR) {
+      return false;
+    }
+    m_chunk = m_compileVm.getCompiledChunk();
+    if (!m_compileVm.saveCompiledChunk(CACHE_TEST_PATH)) {
+      return false;
+    }
+    m_loaded = m_loadVm.loadChunk(CACHE_TEST_PATH);
+    return m_loaded != nullptr;
+  }
+
+  bool sameCode() const {
+    if (m_chunk->m_code.size() != m_loaded->m_code.size()) {
+      return false;
+    }
+    return memcmp(m_chunk->m_code.data(), m_loaded->m_code.data(),
+                  m_chunk->m_code.size()) == 0;
+  }
+
+protected:
+  binder::log::BufferedLog m_compileLog;
+  binder::log::BufferedLog m_loadLog;
+  binder::vm::VirtualMachine m_compileVm;
+  binder::vm::VirtualMachine m_loadVm;
+  const binder::vm::Chunk *m_chunk = nullptr;
+  const binder::vm::Chunk *m_loaded = nullptr;
+};
+
+TEST_CASE_METHOD(SetupVmBytecodeCacheTestFixture, "vm cache round trip",
+                 "[vm-cache]") {
+  const char *source = "var a = \"hello\"; var b = 2.5;\n"
+                       "{ var i = 0; while (i < 3) { b = b + i; i = i + 1; } }\n"
+                       "print a + \" world\"; print b; print !nil == true;\n"
+                       "if (b >= 5.5) print \"big\"; else print \"small\";";
+  REQUIRE(compileAndLoad(source));
+  REQUIRE(sameCode());
+  REQUIRE(m_loaded->m_maxStackDepth == m_chunk->m_maxStackDepth);
+  REQUIRE(m_loaded->m_constants.size() == m_chunk->m_constants.size());
+  for (uint32_t i = 0; i < m_chunk->m_lines.size(); ++i) {
+    REQUIRE(m_loaded->m_lines[i] == m_chunk->m_lines[i]);
+  }
+
+  binder::vm::INTERPRET_RESULT result = m_loadVm.interpret(m_loaded);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(strcmp(m_loadLog.getBuffer(), "hello world\n5.5\ntrue\nbig\n") == 0);
+  REQUIRE(strcmp(m_loadLog.getBuffer(), m_compileLog.getBuffer()) == 0);
+}
+
+TEST_CASE_METHOD(SetupVmBytecodeCacheTestFixture, "vm cache remap globals",
+                 "[vm-cache]") {
+  // the loading vm already has globals, so the names of the cached chunk end
+  // up in different slots
+  REQUIRE(m_loadVm.interpret("var z = 10; var b = 20;") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compileAndLoad("var a = 1; var b = 2; a = a + b; print a;"));
+  REQUIRE(!sameCode());
+
+  binder::vm::INTERPRET_RESULT result = m_loadVm.interpret(m_loaded);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  m_loadLog.flush();
+  result = m_loadVm.interpret("print z; print b; print a;");
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(strcmp(m_loadLog.getBuffer(), "10\n2\n3\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmBytecodeCacheTestFixture, "vm cache error line",
+                 "[vm-cache]") {
+  REQUIRE(compileAndLoad("var a = 1;\nprint a;\n\nprint -\"nope\";"));
+  binder::vm::INTERPRET_RESULT result = m_loadVm.interpret(m_loaded);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR);
+  REQUIRE(strcmp(m_loadLog.getBuffer(),
+                 "1\nOperand must be a number.\n[line 3] in script\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmBytecodeCacheTestFixture, "vm cache long operands",
+                 "[vm-cache]") {
+  std::string source;
+  for (int i = 0; i < 300; ++i) {
+    source += "var g" + std::to_string(i) + " = " + std::to_string(i) + ";";
+  }
+  source += "print g299 + g1;";
+  REQUIRE(compileAndLoad(source.c_str()));
+  REQUIRE(sameCode());
+  binder::vm::INTERPRET_RESULT result = m_loadVm.interpret(m_loaded);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(strcmp(m_loadLog.getBuffer(), "300\n") == 0);
+}
+
+// round trips a chunk built by hand through the cache format, true if the
+// loader takes it
+static bool loadsBack(const binder::vm::Chunk &chunk) {
+  binder::vm::GlobalTable globals(16);
+  binder::vm::Heap heap;
+  binder::memory::ResizableVector<uint8_t> data;
+  binder::vm::serializeChunk(&chunk, &globals, data);
+  binder::vm::Chunk *loaded =
+      binder::vm::deserializeChunk(data.data(), data.size(), &globals, &heap);
+  delete loaded;
+  return loaded != nullptr;
+}
+
+TEST_CASE("vm cache rejects bad stack usage", "[vm-cache]") {
+  using binder::vm::OP_CODE;
+  binder::vm::Chunk chunk;
+
+  SECTION("pop on empty stack") {
+    chunk.write(OP_CODE::OP_POP, 1);
+    chunk.write(OP_CODE::OP_RETURN, 1);
+    REQUIRE(!loadsBack(chunk));
+  }
+  SECTION("local past the top") {
+    chunk.write(OP_CODE::OP_NIL, 1);
+    chunk.write(OP_CODE::OP_GET_LOCAL, 1);
+    chunk.write(static_cast<uint8_t>(0), 1);
+    chunk.write(OP_CODE::OP_POP, 1);
+    chunk.write(OP_CODE::OP_POP, 1);
+    chunk.write(OP_CODE::OP_RETURN, 1);
+    REQUIRE(loadsBack(chunk));
+    chunk.m_code[2] = 1;
+    REQUIRE(!loadsBack(chunk));
+  }
+  SECTION("paths disagree") {
+    // the jump skips the NIL, so the return is reached with two depths
+    chunk.write(OP_CODE::OP_TRUE, 1);
+    chunk.write(OP_CODE::OP_JUMP_IF_FALSE, 1);
+    chunk.write(static_cast<uint8_t>(0), 1);
+    chunk.write(static_cast<uint8_t>(1), 1);
+    chunk.write(OP_CODE::OP_NIL, 1);
+    chunk.write(OP_CODE::OP_RETURN, 1);
+    REQUIRE(!loadsBack(chunk));
+  }
+  SECTION("add local constant type") {
+    chunk.write(OP_CODE::OP_NIL, 1);
+    chunk.write(OP_CODE::OP_ADD_LOCAL_CONST, 1);
+    chunk.write(static_cast<uint8_t>(0), 1);
+    chunk.write(static_cast<uint8_t>(0), 1);
+    chunk.write(OP_CODE::OP_POP, 1);
+    chunk.write(OP_CODE::OP_POP, 1);
+    chunk.write(OP_CODE::OP_RETURN, 1);
+    chunk.addConstant(binder::vm::makeNumber(1.0));
+    REQUIRE(loadsBack(chunk));
+    chunk.m_constants[0] = binder::vm::makeBool(true);
+    REQUIRE(!loadsBack(chunk));
+  }
+}
+
+TEST_CASE_METHOD(SetupVmBytecodeCacheTestFixture, "vm cache rejects bad data",
+                 "[vm-cache]") {
+  REQUIRE(m_loadVm.loadChunk("notThere.bnc") == nullptr);
+  REQUIRE(m_compileVm.compile("var a = \"text\"; print a;") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  m_chunk = m_compileVm.getCompiledChunk();
+
+  binder::log::BufferedLog log;
+  binder::vm::GlobalTable globals(1024);
+  binder::vm::Heap heap;
+  binder::memory::ResizableVector<uint8_t> data;
+  binder::vm::GlobalTable compileGlobals(1024);
+  compileGlobals.getSlot("a");
+  binder::vm::serializeChunk(m_chunk, &compileGlobals, data);
+
+  binder::vm::Chunk *chunk =
+      binder::vm::deserializeChunk(data.data(), data.size(), &globals,
+                                   &heap);
+  REQUIRE(chunk != nullptr);
+  delete chunk;
+
+  SECTION("truncated") {
+    for (uint32_t size = 0; size < data.size(); ++size) {
+      REQUIRE(binder::vm::deserializeChunk(data.data(), size,
+                                           &globals, &heap) == nullptr);
+    }
+  }
+  SECTION("magic") {
+    data[0] = 'X';
+    REQUIRE(binder::vm::deserializeChunk(data.data(), data.size(),
+                                         &globals, &heap) == nullptr);
+  }
+  SECTION("version") {
+    data[4] = static_cast<uint8_t>(binder::vm::BYTECODE_CACHE_VERSION + 1);
+    REQUIRE(binder::vm::deserializeChunk(data.data(), data.size(),
+                                         &globals, &heap) == nullptr);
+  }
+  SECTION("strings freed on failure") {
+    // the string constant loads fine, the global names after it are cut
+    binder::vm::Heap failHeap;
+    REQUIRE(binder::vm::deserializeChunk(data.data(), data.size() - 1,
+                                         &globals, &failHeap) == nullptr);
+    REQUIRE(failHeap.getAllocatedBytes() != 0);
+    binder::vm::GCStats stats;
+    failHeap.sweep(&stats);
+    REQUIRE(stats.objectsFreed == 1);
+    REQUIRE(failHeap.getAllocatedBytes() == 0);
+  }
+  SECTION("constant index") {
+    REQUIRE(data[CACHE_CODE_OFFSET] ==
+            static_cast<uint8_t>(binder::vm::OP_CODE::OP_CONSTANT));
+    data[CACHE_CODE_OFFSET + 1] =
+        static_cast<uint8_t>(m_chunk->m_constants.size());
+    REQUIRE(binder::vm::deserializeChunk(data.data(), data.size(),
+                                         &globals, &heap) == nullptr);
+  }
+  SECTION("missing return") {
+    const uint32_t last = CACHE_CODE_OFFSET + m_chunk->m_code.size() - 1;
+    REQUIRE(data[last] == static_cast<uint8_t>(binder::vm::OP_CODE::OP_RETURN));
+    data[last] = static_cast<uint8_t>(binder::vm::OP_CODE::OP_NIL);
+    REQUIRE(binder::vm::deserializeChunk(data.data(), data.size(),
+                                         &globals, &heap) == nullptr);
+  }
+  SECTION("jump offset") {
+    // JUMP over a NIL, then RETURN
+    binder::vm::Chunk jumps;
+    jumps.write(binder::vm::OP_CODE::OP_JUMP, 1);
+    jumps.write(static_cast<uint8_t>(0), 1);
+    jumps.write(static_cast<uint8_t>(1), 1);
+    jumps.write(binder::vm::OP_CODE::OP_NIL, 1);
+    jumps.write(binder::vm::OP_CODE::OP_RETURN, 1);
+    binder::memory::ResizableVector<uint8_t> jumpData;
+    binder::vm::serializeChunk(&jumps, &compileGlobals, jumpData);
+    chunk = binder::vm::deserializeChunk(jumpData.data(), jumpData.size(),
+                                         &globals, &heap);
+    REQUIRE(chunk != nullptr);
+    delete chunk;
+
+    // past the end of the code
+    jumpData[CACHE_CODE_OFFSET + 2] = 2;
+    REQUIRE(binder::vm::deserializeChunk(jumpData.data(), jumpData.size(),
+                                         &globals, &heap) == nullptr);
+    // in the middle of an instruction
+    jumps.m_code[0] = static_cast<uint8_t>(binder::vm::OP_CODE::OP_LOOP);
+    jumps.m_code[2] = 2;
+    jumpData.clear();
+    binder::vm::serializeChunk(&jumps, &compileGlobals, jumpData);
+    REQUIRE(binder::vm::deserializeChunk(jumpData.data(), jumpData.size(),
+                                         &globals, &heap) == nullptr);
+    // before the start of the code
+    jumpData[CACHE_CODE_OFFSET + 2] = 4;
+    REQUIRE(binder::vm::deserializeChunk(jumpData.data(), jumpData.size(),
+                                         &globals, &heap) == nullptr);
+  }
+}
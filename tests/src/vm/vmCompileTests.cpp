@@ -5,11 +5,20 @@
 #include "binder/vm/object.h"
 
 #include "../catch.h"
+#include <string>
 
 class SetupVmParserTestFixture {
 public:
-  SetupVmParserTestFixture() : intern(1024), compiler(&intern) {}
-  ~SetupVmParserTestFixture() { binder::vm::freeAllocations(); }
+  SetupVmParserTestFixture()
+      : intern(1024), globals(1024),
+        compiler(&intern, &globals, &heap, rawConfig()) {}
+  // these tests check the code generation, the optimizations have their own
+  static binder::vm::CompilerConfig rawConfig() {
+    binder::vm::CompilerConfig config;
+    config.peephole = false;
+    config.constantFolding = false;
+    return config;
+  }
   const binder::vm::Chunk *compile(const char *source, bool debug = false) {
     result = compiler.compile(source, &m_log);
 
@@ -34,24 +43,29 @@ public:
   }
   void compareConstantValue(uint32_t offset, int idx, double value) {
     REQUIRE(m_chunk->m_code[offset] == idx);
-    REQUIRE(m_chunk->m_constants[idx].as.number == Approx(value));
+    REQUIRE(binder::vm::valueAsNumber(m_chunk->m_constants[idx]) ==
+            Approx(value));
   }
   void compareConstant(uint32_t offset, int idx, double value) {
     compareInstruction(offset, binder::vm::OP_CODE::OP_CONSTANT);
     compareConstantValue(offset + 1, idx, value);
   }
 
-  void compareDefineGlobal(uint32_t offset, int idx, const char *value) {
+  void compareGlobalSlot(uint32_t offset, int slot, const char *name) {
+    REQUIRE(m_chunk->m_code[offset] == slot);
+    REQUIRE(strcmp(globals.getName(slot), name) == 0);
+  }
+  void compareDefineGlobal(uint32_t offset, int slot, const char *name) {
     compareInstruction(offset, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-    compareConstantValue(offset + 1, idx, value);
+    compareGlobalSlot(offset + 1, slot, name);
   }
-  void compareGetGlobal(uint32_t offset, int idx, const char *value) {
+  void compareGetGlobal(uint32_t offset, int slot, const char *name) {
     compareInstruction(offset, binder::vm::OP_CODE::OP_GET_GLOBAL);
-    compareConstantValue(offset + 1, idx, value);
+    compareGlobalSlot(offset + 1, slot, name);
   }
-  void compareSetGlobal(uint32_t offset, int idx, const char *value) {
+  void compareSetGlobal(uint32_t offset, int slot, const char *name) {
     compareInstruction(offset, binder::vm::OP_CODE::OP_SET_GLOBAL);
-    compareConstantValue(offset + 1, idx, value);
+    compareGlobalSlot(offset + 1, slot, name);
   }
   void compareGetLocal(uint32_t offset, int idx) {
     compareInstruction(offset, binder::vm::OP_CODE::OP_GET_LOCAL);
@@ -65,7 +79,7 @@ public:
 
   void compareConstantValue(uint32_t offset, int idx, bool value) {
     REQUIRE(m_chunk->m_code[offset] == idx);
-    REQUIRE(m_chunk->m_constants[idx].as.boolean == value);
+    REQUIRE(binder::vm::valueAsBool(m_chunk->m_constants[idx]) == value);
   }
 
 
@@ -111,6 +125,8 @@ protected:
   binder::log::BufferedLog m_log;
   binder::log::ConsoleLog m_debugLog;
   binder::memory::StringIntern intern;
+  binder::vm::GlobalTable globals;
+  binder::vm::Heap heap;
 
   binder::vm::Compiler compiler;
   const binder::vm::Chunk *m_chunk;
@@ -277,7 +293,9 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm str cmp", "[vm-parser]") {
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
   compareConstantValue(1, 0, "hello world");
   compareInstruction(2, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(3, 1, "hello world");
+  // same string, same constant
+  compareConstantValue(3, 0, "hello world");
+  REQUIRE(chunk->m_constants.size() == 1);
   compareInstruction(4, binder::vm::OP_CODE::OP_EQUAL);
   compareInstruction(5, binder::vm::OP_CODE::OP_POP);
   compareInstruction(6, binder::vm::OP_CODE::OP_RETURN);
@@ -285,7 +303,7 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm str cmp", "[vm-parser]") {
   /*
     == debug ==
     0000    0 OP_CONSTANT         0 'hello world
-    0002    | OP_CONSTANT         1 'hello world
+    0002    | OP_CONSTANT         0 'hello world
     0004    | OP_EQUAL
     0005    | OP_RETURN
   */
@@ -301,7 +319,7 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm str cmp  false", "[vm-parser]") {
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
   compareConstantValue(1, 0, "hello world");
   compareInstruction(2, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(3, 1, "hello world");
+  compareConstantValue(3, 0, "hello world");
   compareInstruction(4, binder::vm::OP_CODE::OP_EQUAL);
   compareInstruction(5, binder::vm::OP_CODE::OP_NOT);
   compareInstruction(6, binder::vm::OP_CODE::OP_POP);
@@ -335,16 +353,15 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm define global empty",
   REQUIRE(chunk->m_code.size() == 4);
   // first the value of the variable is put on the stack, in this case nil
   compareInstruction(0, binder::vm::OP_CODE::OP_NIL);
-  // then we have a global definition, which behaves as a constant,
-  // first the opcode then the uin8_t pointing to where it is stored
-  compareInstruction(1, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(2, 0, "test");
+  // then we have a global definition, first the opcode then the uin8_t
+  // slot in the global table where it is stored
+  compareDefineGlobal(1, 0, "test");
   compareInstruction(3, binder::vm::OP_CODE::OP_RETURN);
 
   /*
 == debug ==
 0000    0 OP_NIL
-0001    | OP_DEFINE_GLOBAL    0 'test
+0001    | OP_DEFINE_GLOBAL    0
 0003    | OP_RETURN
    */
 }
@@ -358,21 +375,19 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm define global string",
   REQUIRE(result == true);
   REQUIRE(chunk->m_code.size() == 5);
 
-  // first the value of the variable is put on the stack, in this case nil
-  // to not that the during the paring the variable name is set first on the
-  // stack hence the 1 index of "my first var"
+  // first the value of the variable is put on the stack, the variable name
+  // does not end up in the constants, it is resolved to a global slot
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, "my first var");
-  // then we have a global definition, which behaves as a constant,
-  // first the opcode then the uin8_t pointing to where it is stored
-  compareInstruction(2, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(3, 0, "myVar");
+  compareConstantValue(1, 0, "my first var");
+  // then we have a global definition, first the opcode then the uin8_t
+  // slot in the global table where it is stored
+  compareDefineGlobal(2, 0, "myVar");
   compareInstruction(4, binder::vm::OP_CODE::OP_RETURN);
 
   /*
   == debug ==
-  0000    0 OP_CONSTANT         1 'my first var
-  0002    | OP_DEFINE_GLOBAL    0 'myVar
+  0000    0 OP_CONSTANT         0 'my first var
+  0002    | OP_DEFINE_GLOBAL    0
   0004    | OP_RETURN
   */
 }
@@ -387,9 +402,8 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm define global int",
   REQUIRE(chunk->m_code.size() == 5);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, 10.0);
-  compareInstruction(2, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(3, 0, "myVar");
+  compareConstantValue(1, 0, 10.0);
+  compareDefineGlobal(2, 0, "myVar");
   compareInstruction(4, binder::vm::OP_CODE::OP_RETURN);
 }
 
@@ -403,8 +417,7 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm define global bool",
   REQUIRE(chunk->m_code.size() == 4);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_FALSE);
-  compareInstruction(1, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(2, 0, "myVar");
+  compareDefineGlobal(1, 0, "myVar");
   compareInstruction(3, binder::vm::OP_CODE::OP_RETURN);
 }
 
@@ -418,8 +431,7 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm define global bool 2",
   REQUIRE(chunk->m_code.size() == 4);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_TRUE);
-  compareInstruction(1, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(2, 0, "myVar");
+  compareDefineGlobal(1, 0, "myVar");
   compareInstruction(3, binder::vm::OP_CODE::OP_RETURN);
 }
 
@@ -433,20 +445,19 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm define global expr 1",
   REQUIRE(chunk->m_code.size() == 8);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, 1.0);
+  compareConstantValue(1, 0, 1.0);
   compareInstruction(2, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(3, 2, 2.0);
+  compareConstantValue(3, 1, 2.0);
   compareInstruction(4, binder::vm::OP_CODE::OP_ADD);
-  compareInstruction(5, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(6, 0, "init1");
+  compareDefineGlobal(5, 0, "init1");
   compareInstruction(7, binder::vm::OP_CODE::OP_RETURN);
 
   /*
 == debug ==
-0000    0 OP_CONSTANT         1 '1
-0002    | OP_CONSTANT         2 '2
+0000    0 OP_CONSTANT         0 '1
+0002    | OP_CONSTANT         1 '2
 0004    | OP_ADD
-0005    | OP_DEFINE_GLOBAL    0 'init1
+0005    | OP_DEFINE_GLOBAL    0
 0007    | OP_RETURN
 */
 }
@@ -460,19 +471,17 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm get global", "[vm-parser]") {
   REQUIRE(chunk->m_code.size() == 8);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, 10.0);
-  compareInstruction(2, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(3, 0, "myVar");
-  compareInstruction(4, binder::vm::OP_CODE::OP_GET_GLOBAL);
-  compareConstantValue(5, 2, "myVar");
+  compareConstantValue(1, 0, 10.0);
+  compareDefineGlobal(2, 0, "myVar");
+  compareGetGlobal(4, 0, "myVar");
   compareInstruction(6, binder::vm::OP_CODE::OP_PRINT);
   compareInstruction(7, binder::vm::OP_CODE::OP_RETURN);
 
   /*
   == debug ==
-  0000    0 OP_CONSTANT         1 '10
-  0002    | OP_DEFINE_GLOBAL    0 'myVar
-  0004    1 OP_GET_GLOBAL       2 'myVar
+  0000    0 OP_CONSTANT         0 '10
+  0002    | OP_DEFINE_GLOBAL    0
+  0004    1 OP_GET_GLOBAL       0
   0006    | OP_PRINT
   0007    | OP_RETURN
   */
@@ -491,29 +500,25 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile assigment edge case",
 
   // defining the first global variable
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, "beignets");
-  compareInstruction(2, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(3, 0, "breakfast");
+  compareConstantValue(1, 0, "beignets");
+  compareDefineGlobal(2, 0, "breakfast");
 
   // defining the second global variable
   compareInstruction(4, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(5, 3, "cafe au lait");
-  compareInstruction(6, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(7, 2, "beverage");
+  compareConstantValue(5, 1, "cafe au lait");
+  compareDefineGlobal(6, 1, "beverage");
 
   // now that wehave the twovariables we need to perform the assigment
   // which is between first a constant
   compareInstruction(8, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(9, 5, "beignets with ");
+  compareConstantValue(9, 2, "beignets with ");
 
   // then the global variable  which we pop on the stack now
-  compareInstruction(10, binder::vm::OP_CODE::OP_GET_GLOBAL);
-  compareConstantValue(11, 6, "beverage");
+  compareGetGlobal(10, 1, "beverage");
 
   // doing the addition
   compareInstruction(12, binder::vm::OP_CODE::OP_ADD);
-  compareInstruction(13, binder::vm::OP_CODE::OP_SET_GLOBAL);
-  compareConstantValue(14, 4, "breakfast");
+  compareSetGlobal(13, 0, "breakfast");
   compareInstruction(15, binder::vm::OP_CODE::OP_POP);
   compareInstruction(16, binder::vm::OP_CODE::OP_RETURN);
 }
@@ -529,11 +534,10 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile basic scope",
   REQUIRE(chunk->m_code.size() == 14);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, 12.0);
-  compareInstruction(2, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(3, 0, "a");
+  compareConstantValue(1, 0, 12.0);
+  compareDefineGlobal(2, 0, "a");
   compareInstruction(4, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(5, 2, 20.0);
+  compareConstantValue(5, 1, 20.0);
   compareInstruction(6, binder::vm::OP_CODE::OP_GET_LOCAL);
   // comparing the get local slot
   compareInstruction(7, 0);
@@ -542,20 +546,19 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile basic scope",
   compareInstruction(9, binder::vm::OP_CODE::OP_POP);
 
   // then the global variable
-  compareInstruction(10, binder::vm::OP_CODE::OP_GET_GLOBAL);
-  compareConstantValue(11, 3, "a");
+  compareGetGlobal(10, 0, "a");
   compareInstruction(12, binder::vm::OP_CODE::OP_PRINT);
   compareInstruction(13, binder::vm::OP_CODE::OP_RETURN);
 
   /*
   == debug ==
-  0000    0 OP_CONSTANT         1 '12
-  0002    | OP_DEFINE_GLOBAL    0 'a
-  0004    2 OP_CONSTANT         2 '20
+  0000    0 OP_CONSTANT         0 '12
+  0002    | OP_DEFINE_GLOBAL    0
+  0004    2 OP_CONSTANT         1 '20
   0006    3 OP_GET_LOCAL        0
   0008    | OP_PRINT
   0009    4 OP_POP
-  0010    | OP_GET_GLOBAL       3 'a
+  0010    | OP_GET_GLOBAL       0
   0012    | OP_PRINT
   0013    | OP_RETURN
   */
@@ -573,11 +576,10 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile shadowing scope",
   REQUIRE(chunk->m_code.size() == 14);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, 12.0);
-  compareInstruction(2, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(3, 0, "a");
+  compareConstantValue(1, 0, 12.0);
+  compareDefineGlobal(2, 0, "a");
   compareInstruction(4, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(5, 2, 20.0);
+  compareConstantValue(5, 1, 20.0);
   compareInstruction(6, binder::vm::OP_CODE::OP_GET_LOCAL);
   // comparing the get local slot
   compareInstruction(7, 0);
@@ -586,20 +588,19 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile shadowing scope",
   compareInstruction(9, binder::vm::OP_CODE::OP_POP);
 
   // then the global variable
-  compareInstruction(10, binder::vm::OP_CODE::OP_GET_GLOBAL);
-  compareConstantValue(11, 3, "a");
+  compareGetGlobal(10, 0, "a");
   compareInstruction(12, binder::vm::OP_CODE::OP_PRINT);
   compareInstruction(13, binder::vm::OP_CODE::OP_RETURN);
 
   /*
     == debug ==
-    0000    0 OP_CONSTANT         1 '12
-    0002    | OP_DEFINE_GLOBAL    0 'a
-    0004    2 OP_CONSTANT         2 '20
+    0000    0 OP_CONSTANT         0 '12
+    0002    | OP_DEFINE_GLOBAL    0
+    0004    2 OP_CONSTANT         1 '20
     0006    3 OP_GET_LOCAL        0
     0008    | OP_PRINT
     0009    4 OP_POP
-    0010    | OP_GET_GLOBAL       3 'a
+    0010    | OP_GET_GLOBAL       0
     0012    | OP_PRINT
     0013    | OP_RETURN
   */
@@ -614,19 +615,17 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile simple if",
   REQUIRE(chunk->m_code.size() == 21);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, 5.0);
-  compareInstruction(2, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(3, 0, "a");
-  compareInstruction(4, binder::vm::OP_CODE::OP_GET_GLOBAL);
-  compareConstantValue(5, 2, "a");
+  compareConstantValue(1, 0, 5.0);
+  compareDefineGlobal(2, 0, "a");
+  compareGetGlobal(4, 0, "a");
   compareInstruction(6, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(7, 3, 3.0);
+  compareConstantValue(7, 1, 3.0);
   compareInstruction(8, binder::vm::OP_CODE::OP_GREATER);
   compareInstruction(9, binder::vm::OP_CODE::OP_JUMP_IF_FALSE);
   compareJumpOffset(10, 7);
   compareInstruction(12, binder::vm::OP_CODE::OP_POP);
   compareInstruction(13, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(14, 4, 10.0);
+  compareConstantValue(14, 2, 10.0);
   compareInstruction(15, binder::vm::OP_CODE::OP_PRINT);
   compareInstruction(16, binder::vm::OP_CODE::OP_JUMP);
   compareJumpOffset(17, 1);
@@ -634,14 +633,14 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile simple if",
 
   /*
     == debug ==
-    0000    0 OP_CONSTANT         1 '5
-    0002    | OP_DEFINE_GLOBAL    0 'a
-    0004    1 OP_GET_GLOBAL       2 'a
-    0006    | OP_CONSTANT         3 '3
+    0000    0 OP_CONSTANT         0 '5
+    0002    | OP_DEFINE_GLOBAL    0
+    0004    1 OP_GET_GLOBAL       0
+    0006    | OP_CONSTANT         1 '3
     0008    | OP_GREATER
     0009    | OP_JUMP_IF_FALSE    9 -> 19
     0012    | OP_POP
-    0013    2 OP_CONSTANT         4 '10
+    0013    2 OP_CONSTANT         2 '10
     0015    | OP_PRINT
     0016    3 OP_JUMP            16 -> 20
     0019    | OP_POP
@@ -659,40 +658,38 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile simple if else",
   REQUIRE(chunk->m_code.size() == 24);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, 5.0);
-  compareInstruction(2, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(3, 0, "a");
-  compareInstruction(4, binder::vm::OP_CODE::OP_GET_GLOBAL);
-  compareConstantValue(5, 2, "a");
+  compareConstantValue(1, 0, 5.0);
+  compareDefineGlobal(2, 0, "a");
+  compareGetGlobal(4, 0, "a");
   compareInstruction(6, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(7, 3, 3.0);
+  compareConstantValue(7, 1, 3.0);
   compareInstruction(8, binder::vm::OP_CODE::OP_GREATER);
   compareInstruction(9, binder::vm::OP_CODE::OP_JUMP_IF_FALSE);
   compareJumpOffset(10, 7);
   compareInstruction(12, binder::vm::OP_CODE::OP_POP);
   compareInstruction(13, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(14, 4, 10.0);
+  compareConstantValue(14, 2, 10.0);
   compareInstruction(15, binder::vm::OP_CODE::OP_PRINT);
   compareInstruction(16, binder::vm::OP_CODE::OP_JUMP);
   compareJumpOffset(17, 4);
   compareInstruction(20, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(21, 5, 20.0);
+  compareConstantValue(21, 3, 20.0);
   compareInstruction(22, binder::vm::OP_CODE::OP_PRINT);
   compareInstruction(23, binder::vm::OP_CODE::OP_RETURN);
   /*
     == debug ==
-    0000    0 OP_CONSTANT         1 '5
-    0002    | OP_DEFINE_GLOBAL    0 'a
-    0004    1 OP_GET_GLOBAL       2 'a
-    0006    | OP_CONSTANT         3 '3
+    0000    0 OP_CONSTANT         0 '5
+    0002    | OP_DEFINE_GLOBAL    0
+    0004    1 OP_GET_GLOBAL       0
+    0006    | OP_CONSTANT         1 '3
     0008    | OP_GREATER
     0009    | OP_JUMP_IF_FALSE    9 -> 19
     0012    | OP_POP
-    0013    2 OP_CONSTANT         4 '10
+    0013    2 OP_CONSTANT         2 '10
     0015    | OP_PRINT
     0016    3 OP_JUMP            16 -> 23
     0019    | OP_POP
-    0020    4 OP_CONSTANT         5 '20
+    0020    4 OP_CONSTANT         3 '20
     0022    | OP_PRINT
     0023    5 OP_RETURN
   */
@@ -709,33 +706,33 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile simple and",
   REQUIRE(chunk->m_code.size() == 17);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, 3.0);
+  compareConstantValue(1, 0, 3.0);
   compareInstruction(2, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(3, 2, 1.0);
+  compareConstantValue(3, 1, 1.0);
   compareInstruction(4, binder::vm::OP_CODE::OP_GREATER);
   compareInstruction(5, binder::vm::OP_CODE::OP_JUMP_IF_FALSE);
   compareJumpOffset(6, 6);
   compareInstruction(8, binder::vm::OP_CODE::OP_POP);
   compareInstruction(9, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(10, 3, 5.0);
+  compareConstantValue(10, 2, 5.0);
   compareInstruction(11, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(12, 4, 3.0);
+  // the 3 is already in the table
+  compareConstantValue(12, 0, 3.0);
   compareInstruction(13, binder::vm::OP_CODE::OP_GREATER);
-  compareInstruction(14, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(15, 0, "a");
+  compareDefineGlobal(14, 0, "a");
   compareInstruction(16, binder::vm::OP_CODE::OP_RETURN);
 
   /*
     == debug ==
-    0000    0 OP_CONSTANT         1 '3
-    0002    | OP_CONSTANT         2 '1
+    0000    0 OP_CONSTANT         0 '3
+    0002    | OP_CONSTANT         1 '1
     0004    | OP_GREATER
     0005    | OP_JUMP_IF_FALSE    5 -> 14
     0008    | OP_POP
-    0009    | OP_CONSTANT         3 '5
-    0011    | OP_CONSTANT         4 '3
+    0009    | OP_CONSTANT         2 '5
+    0011    | OP_CONSTANT         0 '3
     0013    | OP_GREATER
-    0014    | OP_DEFINE_GLOBAL    0 'a
+    0014    | OP_DEFINE_GLOBAL    0
     0016    | OP_RETURN
   */
 }
@@ -751,9 +748,9 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile simple or",
   REQUIRE(chunk->m_code.size() == 20);
 
   compareInstruction(0, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(1, 1, 3.0);
+  compareConstantValue(1, 0, 3.0);
   compareInstruction(2, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(3, 2, 1.0);
+  compareConstantValue(3, 1, 1.0);
   compareInstruction(4, binder::vm::OP_CODE::OP_LESS);
   compareInstruction(5, binder::vm::OP_CODE::OP_JUMP_IF_FALSE);
   compareJumpOffset(6, 3);
@@ -761,26 +758,25 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile simple or",
   compareJumpOffset(9, 6);
   compareInstruction(11, binder::vm::OP_CODE::OP_POP);
   compareInstruction(12, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(13, 3, 5.0);
+  compareConstantValue(13, 2, 5.0);
   compareInstruction(14, binder::vm::OP_CODE::OP_CONSTANT);
-  compareConstantValue(15, 4, 3.0);
+  compareConstantValue(15, 0, 3.0);
   compareInstruction(16, binder::vm::OP_CODE::OP_GREATER);
-  compareInstruction(17, binder::vm::OP_CODE::OP_DEFINE_GLOBAL);
-  compareConstantValue(18, 0, "a");
+  compareDefineGlobal(17, 0, "a");
   compareInstruction(19, binder::vm::OP_CODE::OP_RETURN);
 
   /*
     == debug ==
-    0000    0 OP_CONSTANT         1 '3
-    0002    | OP_CONSTANT         2 '1
+    0000    0 OP_CONSTANT         0 '3
+    0002    | OP_CONSTANT         1 '1
     0004    | OP_LESS
     0005    | OP_JUMP_IF_FALSE    5 -> 11
     0008    | OP_JUMP             8 -> 17
     0011    | OP_POP
-    0012    | OP_CONSTANT         3 '5
-    0014    | OP_CONSTANT         4 '3
+    0012    | OP_CONSTANT         2 '5
+    0014    | OP_CONSTANT         0 '3
     0016    | OP_GREATER
-    0017    | OP_DEFINE_GLOBAL    0 'a
+    0017    | OP_DEFINE_GLOBAL    0
     0019    | OP_RETURN
   */
 }
@@ -792,36 +788,37 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile simple while",
   REQUIRE(chunk != nullptr);
   REQUIRE(result == true);
 
-  compareConstant(0, 1, 0.0);
+  // globals do not go through the constant table, the operand is the slot
+  compareConstant(0, 0, 0.0);
   compareDefineGlobal(2, 0, "a");
-  compareGetGlobal(4, 2, "a");
-  compareConstant(6, 3, 5.0);
+  compareGetGlobal(4, 0, "a");
+  compareConstant(6, 1, 5.0);
   compareInstruction(8, binder::vm::OP_CODE::OP_LESS);
   compareJumpFalse(9, 15, true);
-  compareGetGlobal(13, 4, "a");
+  compareGetGlobal(13, 0, "a");
   compareInstruction(15, binder::vm::OP_CODE::OP_PRINT);
-  compareGetGlobal(16, 6, "a");
-  compareConstant(18, 7, 1.0);
+  compareGetGlobal(16, 0, "a");
+  compareConstant(18, 2, 1.0);
   compareInstruction(20, binder::vm::OP_CODE::OP_ADD);
-  compareSetGlobal(21, 5, "a");
+  compareSetGlobal(21, 0, "a");
   compareInstruction(23, binder::vm::OP_CODE::OP_POP);
   compareLoop(24, 23, true);
   compareInstruction(28, binder::vm::OP_CODE::OP_RETURN);
   /*
     == debug ==
-    0000    0 OP_CONSTANT         1 '0
-    0002    | OP_DEFINE_GLOBAL    0 'a
-    0004    | OP_GET_GLOBAL       2 'a
-    0006    | OP_CONSTANT         3 '5
+    0000    0 OP_CONSTANT         0 '0
+    0002    | OP_DEFINE_GLOBAL    0
+    0004    | OP_GET_GLOBAL       0
+    0006    | OP_CONSTANT         1 '5
     0008    | OP_LESS
     0009    | OP_JUMP_IF_FALSE    9 -> 27
     0012    | OP_POP
-    0013    | OP_GET_GLOBAL       4 'a
+    0013    | OP_GET_GLOBAL       0
     0015    | OP_PRINT
-    0016    | OP_GET_GLOBAL       6 'a
-    0018    | OP_CONSTANT         7 '1
+    0016    | OP_GET_GLOBAL       0
+    0018    | OP_CONSTANT         2 '1
     0020    | OP_ADD
-    0021    | OP_SET_GLOBAL       5 'a
+    0021    | OP_SET_GLOBAL       0
     0023    | OP_POP
     0024    | OP_LOOP            24 -> 4
     0027    | OP_POP
@@ -902,3 +899,254 @@ TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile simple for",
     0033    | OP_RETURN
   */
 }
+
+TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile max stack depth",
+                 "[vm-parser]") {
+  // 1 is pushed, then 2 and 3, the multiply brings us back to 2
+  auto *chunk = compile("var a = 1 + 2 * 3;", false);
+  REQUIRE(chunk != nullptr);
+  REQUIRE(chunk->m_maxStackDepth == 3);
+
+  // locals stay on the stack for the whole scope, a b and the two copies
+  // pushed for the add
+  chunk = compile("{ var a = 1; var b = 2; { var c = a + b; print c; } }",
+                  false);
+  REQUIRE(chunk != nullptr);
+  REQUIRE(chunk->m_maxStackDepth == 4);
+
+  // the analysis walks into the if and the loop body, the deepest point is
+  // a a 1 inside the print
+  chunk = compile("var a = 0; while(a < 5){ if (a > 2) { print a * (a + 1); } "
+                  "a = a + 1; }",
+                  false);
+  REQUIRE(chunk != nullptr);
+  REQUIRE(chunk->m_maxStackDepth == 3);
+}
+
+class SetupVmFoldingTestFixture {
+public:
+  SetupVmFoldingTestFixture()
+      : intern(1024), globals(1024),
+        compiler(&intern, &globals, &heap, config()) {}
+  ~SetupVmFoldingTestFixture() { delete m_chunk; }
+  // folding only, so we don't see superinstructions
+  static binder::vm::CompilerConfig config() {
+    binder::vm::CompilerConfig config;
+    config.peephole = false;
+    return config;
+  }
+
+  const char *disassemble(const char *source) {
+    delete m_chunk;
+    m_chunk = nullptr;
+    m_log.flush();
+    if (!compiler.compile(source, &m_log)) {
+      return "";
+    }
+    m_chunk = compiler.getCompiledChunk();
+    binder::vm::disassambleChunk(m_chunk, "code", &m_log);
+    return m_log.getBuffer();
+  }
+
+protected:
+  binder::log::BufferedLog m_log;
+  binder::memory::StringIntern intern;
+  binder::vm::GlobalTable globals;
+  binder::vm::Heap heap;
+  binder::vm::Compiler compiler;
+  const binder::vm::Chunk *m_chunk = nullptr;
+};
+
+TEST_CASE_METHOD(SetupVmFoldingTestFixture, "vm fold arithmetic",
+                 "[vm-parser]") {
+  REQUIRE(strcmp(disassemble("print 1 + 2 * 3;"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '7\n"
+                 "0002    | OP_PRINT\n"
+                 "0003    | OP_RETURN\n") == 0);
+  // the operands are dropped from the constant table too
+  REQUIRE(m_chunk->m_constants.size() == 1);
+
+  REQUIRE(strcmp(disassemble("print -(1 - 3) / 2;"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '1\n"
+                 "0002    | OP_PRINT\n"
+                 "0003    | OP_RETURN\n") == 0);
+  REQUIRE(m_chunk->m_constants.size() == 1);
+}
+
+TEST_CASE_METHOD(SetupVmFoldingTestFixture, "vm fold logic", "[vm-parser]") {
+  REQUIRE(strcmp(disassemble("print !nil; print 1 == 1; print \"a\" != \"b\";"
+                             "print 1 >= 2; print !(2 <= 1);"),
+                 "== code ==\n"
+                 "0000    0 OP_TRUE\n"
+                 "0001    | OP_PRINT\n"
+                 "0002    | OP_TRUE\n"
+                 "0003    | OP_PRINT\n"
+                 "0004    | OP_TRUE\n"
+                 "0005    | OP_PRINT\n"
+                 "0006    | OP_FALSE\n"
+                 "0007    | OP_PRINT\n"
+                 "0008    | OP_TRUE\n"
+                 "0009    | OP_PRINT\n"
+                 "0010    | OP_RETURN\n") == 0);
+  REQUIRE(m_chunk->m_constants.size() == 0);
+}
+
+TEST_CASE_METHOD(SetupVmFoldingTestFixture, "vm fold strings", "[vm-parser]") {
+  REQUIRE(strcmp(disassemble("print \"a\" + \"b\" + \"c\";"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 'abc\n"
+                 "0002    | OP_PRINT\n"
+                 "0003    | OP_RETURN\n") == 0);
+  REQUIRE(m_chunk->m_constants.size() == 1);
+}
+
+TEST_CASE_METHOD(SetupVmFoldingTestFixture, "vm fold runtime errors",
+                 "[vm-parser]") {
+  // these fail at runtime, the vm needs to see them
+  REQUIRE(strcmp(disassemble("print -\"a\";"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 'a\n"
+                 "0002    | OP_NEGATE\n"
+                 "0003    | OP_PRINT\n"
+                 "0004    | OP_RETURN\n") == 0);
+  REQUIRE(strcmp(disassemble("print 1 + \"a\";"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '1\n"
+                 "0002    | OP_CONSTANT         1 'a\n"
+                 "0004    | OP_ADD\n"
+                 "0005    | OP_PRINT\n"
+                 "0006    | OP_RETURN\n") == 0);
+  REQUIRE(strcmp(disassemble("print \"a\" < \"b\";"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 'a\n"
+                 "0002    | OP_CONSTANT         1 'b\n"
+                 "0004    | OP_LESS\n"
+                 "0005    | OP_PRINT\n"
+                 "0006    | OP_RETURN\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmFoldingTestFixture, "vm fold partial", "[vm-parser]") {
+  // left associative, a + 1 is not a literal
+  REQUIRE(strcmp(disassemble("var a = 1; print a + 1 + 2;"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '1\n"
+                 "0002    | OP_DEFINE_GLOBAL    0\n"
+                 "0004    | OP_GET_GLOBAL       0\n"
+                 "0006    | OP_CONSTANT         0 '1\n"
+                 "0008    | OP_ADD\n"
+                 "0009    | OP_CONSTANT         1 '2\n"
+                 "0011    | OP_ADD\n"
+                 "0012    | OP_PRINT\n"
+                 "0013    | OP_RETURN\n") == 0);
+  REQUIRE(strcmp(disassemble("var a = 1; print a + (1 + 2);"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '1\n"
+                 "0002    | OP_DEFINE_GLOBAL    0\n"
+                 "0004    | OP_GET_GLOBAL       0\n"
+                 "0006    | OP_CONSTANT         1 '3\n"
+                 "0008    | OP_ADD\n"
+                 "0009    | OP_PRINT\n"
+                 "0010    | OP_RETURN\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmFoldingTestFixture, "vm fold jump target",
+                 "[vm-parser]") {
+  // the and jumps on the 2, it can't be folded with the 1
+  REQUIRE(strcmp(disassemble("var a = 1; print (a and 1) + 2;"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '1\n"
+                 "0002    | OP_DEFINE_GLOBAL    0\n"
+                 "0004    | OP_GET_GLOBAL       0\n"
+                 "0006    | OP_JUMP_IF_FALSE    6 -> 12\n"
+                 "0009    | OP_POP\n"
+                 "0010    | OP_CONSTANT         0 '1\n"
+                 "0012    | OP_CONSTANT         1 '2\n"
+                 "0014    | OP_ADD\n"
+                 "0015    | OP_PRINT\n"
+                 "0016    | OP_RETURN\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile constant dedup",
+                 "[vm-parser]") {
+  auto *chunk = compile("print 1; print 1; print \"a\"; print \"a\"; print 2;");
+  REQUIRE(chunk != nullptr);
+  REQUIRE(chunk->m_constants.size() == 3);
+  compareConstant(0, 0, 1.0);
+  compareConstant(3, 0, 1.0);
+  compareInstruction(6, binder::vm::OP_CODE::OP_CONSTANT);
+  compareConstantValue(7, 1, "a");
+  compareInstruction(9, binder::vm::OP_CODE::OP_CONSTANT);
+  compareConstantValue(10, 1, "a");
+  compareConstant(12, 2, 2.0);
+}
+
+TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile constant long",
+                 "[vm-parser]") {
+  std::string source;
+  for (int i = 0; i < 300; ++i) {
+    source += "print " + std::to_string(i) + ";";
+  }
+  auto *chunk = compile(source.c_str());
+  REQUIRE(chunk != nullptr);
+  REQUIRE(chunk->m_constants.size() == 300);
+  // the first 256 use the short form, 3 bytes each with the print
+  compareConstant(255 * 3, 255, 255.0);
+  const uint32_t offset = 256 * 3;
+  compareInstruction(offset, binder::vm::OP_CODE::OP_CONSTANT_LONG);
+  REQUIRE(binder::vm::readLongOperand(chunk->m_code.data() + offset + 1) ==
+          256);
+  compareInstruction(offset + 4, binder::vm::OP_CODE::OP_PRINT);
+
+  binder::log::BufferedLog log;
+  binder::vm::disassambleInstruction(chunk, offset, &log);
+  REQUIRE(strcmp(log.getBuffer(),
+                 "0768    | OP_CONSTANT_LONG  256 '256\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmParserTestFixture, "vm compile global long",
+                 "[vm-parser]") {
+  std::string source;
+  for (int i = 0; i < 300; ++i) {
+    source += "var g" + std::to_string(i) + ";";
+  }
+  source += "g299 = g0;";
+  auto *chunk = compile(source.c_str());
+  REQUIRE(chunk != nullptr);
+  // nil + define, the short form is 3 bytes the long one 5
+  uint32_t offset = 256 * 3;
+  compareInstruction(offset, binder::vm::OP_CODE::OP_NIL);
+  compareInstruction(offset + 1, binder::vm::OP_CODE::OP_DEFINE_GLOBAL_LONG);
+  REQUIRE(binder::vm::readLongOperand(chunk->m_code.data() + offset + 2) ==
+          256);
+  REQUIRE(strcmp(globals.getName(256), "g256") == 0);
+
+  offset = 256 * 3 + 44 * 5;
+  compareGetGlobal(offset, 0, "g0");
+  compareInstruction(offset + 2, binder::vm::OP_CODE::OP_SET_GLOBAL_LONG);
+  REQUIRE(binder::vm::readLongOperand(chunk->m_code.data() + offset + 3) ==
+          299);
+}
+
+TEST_CASE_METHOD(SetupVmFoldingTestFixture, "vm fold constant reuse",
+                 "[vm-parser]") {
+  // the 3 is shared with the first print, only the 1 is reclaimed
+  REQUIRE(strcmp(disassemble("print 3; print 1 + 3;"),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '3\n"
+                 "0002    | OP_PRINT\n"
+                 "0003    | OP_CONSTANT         1 '4\n"
+                 "0005    | OP_PRINT\n"
+                 "0006    | OP_RETURN\n") == 0);
+  REQUIRE(m_chunk->m_constants.size() == 2);
+
+  // reclaimed constants are out of the dedup table too
+  disassemble("print 1 + 2; print 1;");
+  REQUIRE(m_chunk->m_constants.size() == 2);
+  REQUIRE(binder::vm::valueAsNumber(m_chunk->m_constants[1]) == Approx(1.0));
+
+  // 0 and -0 are different constants
+  disassemble("print 0; print -0;");
+  REQUIRE(m_chunk->m_constants.size() == 2);
+}
@@ -5,18 +5,11 @@
 #include "binder/vm/vm.h"
 
 #include "../catch.h"
+#include <string>
 
 class SetupVmExecuteTestFixture {
 public:
-  SetupVmExecuteTestFixture()
-      : m_log(),
-#ifdef DEBUG_TRACE_EXECUTION
-        m_debugLog(), m_vm(&m_log, &m_debugLog)
-#else
-        m_vm(&m_log)
-#endif
-  {
-  }
+  SetupVmExecuteTestFixture() : m_log(), m_vm(&m_log) {}
 
   binder::vm::INTERPRET_RESULT interpret(const char *source) {
     binder::vm::INTERPRET_RESULT result = m_vm.interpret(source);
@@ -307,3 +300,247 @@ TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec simple for loop",
   REQUIRE(compareLog("0\n1\n2\n3\n4\n") == 0);
 }
 
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec long while loop",
+                 "[vm-parser]") {
+  const char *source =
+      "var i = 0; var a = 0; while(i < 1000){ a = a + i*2; i = i+1;} print a;";
+  binder::vm::INTERPRET_RESULT result = interpret(source);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("999000\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec nested loops locals",
+                 "[vm-parser]") {
+  const char *source = "{ var count = 0;"
+                       "for(var i = 0; i < 10; i = i+1){"
+                       "  for(var j = 0; j < 10; j = j+1){"
+                       "    if(!(i == j)) count = count + 1;"
+                       "  }"
+                       "} print count; }";
+  binder::vm::INTERPRET_RESULT result = interpret(source);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("90\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec runtime error in loop",
+                 "[vm-parser]") {
+  const char *source = "var i = 0; while(i < 10){ i = i + 1; if(i == 5) "
+                       "print -\"a\";}";
+  binder::vm::INTERPRET_RESULT result = interpret(source);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec undefined global get",
+                 "[vm-parser]") {
+  const char *source = "var a = 1; print missing;";
+  binder::vm::INTERPRET_RESULT result = interpret(source);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR);
+  REQUIRE(compareLog("Undefined variable 'missing'.\n[line 0] in script\n") ==
+          0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec undefined global set",
+                 "[vm-parser]") {
+  const char *source = "var a = 1; missing = a;";
+  binder::vm::INTERPRET_RESULT result = interpret(source);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR);
+  REQUIRE(compareLog("Undefined variable 'missing'.\n[line 0] in script\n") ==
+          0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec globals across runs",
+                 "[vm-parser]") {
+  // slots live in the vm, a second script sees the globals of the first one
+  REQUIRE(interpret("var a = 2; var ab = 3;") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(interpret("var c = a * ab; print c;") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("6\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec deep expression",
+                 "[vm-parser]") {
+  // more than the 256 values the old fixed stack could hold, using a local
+  // so the compiler can't fold the expression away
+  const int depth = 600;
+  std::string source = "{ var one = 1; print ";
+  for (int i = 0; i < depth; ++i) {
+    source += "one + (";
+  }
+  source += "0";
+  for (int i = 0; i < depth; ++i) {
+    source += ")";
+  }
+  source += "; }";
+  binder::vm::INTERPRET_RESULT result = interpret(source.c_str());
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("600\n") == 0);
+}
+
+TEST_CASE("vm exec stack overflow", "[vm-parser]") {
+  binder::log::BufferedLog log;
+  binder::vm::VirtualMachine vm(&log, 4);
+  // literals would be folded into a single constant otherwise
+  binder::vm::CompilerConfig config;
+  config.constantFolding = false;
+  vm.setCompilerConfig(config);
+  REQUIRE(vm.getStackLimit() == 4);
+
+  // fits exactly
+  REQUIRE(vm.interpret("print 1 + (2 + (3 + 4));") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(strcmp(log.getBuffer(), "10\n") == 0);
+  log.flush();
+
+  const char *source = "var a = 1;\nprint 1 + (2 + (3 + (4 + 5)));";
+  REQUIRE(vm.interpret(source) ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR);
+  REQUIRE(strcmp(log.getBuffer(), "Stack overflow.\n[line 1] in script\n") ==
+          0);
+}
+
+TEST_CASE("vm exec hand built chunk", "[vm-parser]") {
+  binder::log::BufferedLog log;
+  binder::vm::VirtualMachine vm(&log, 4);
+
+  // never went through the compiler, so the max stack depth is not set
+  binder::vm::Chunk chunk;
+  chunk.write(binder::vm::OP_CODE::OP_CONSTANT, 1);
+  chunk.write(static_cast<uint8_t>(chunk.addConstant(binder::vm::makeNumber(1.0))), 1);
+  chunk.write(binder::vm::OP_CODE::OP_PRINT, 1);
+  chunk.write(binder::vm::OP_CODE::OP_RETURN, 1);
+  REQUIRE(chunk.m_maxStackDepth == 0);
+
+  REQUIRE(vm.interpret(&chunk) == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(strcmp(log.getBuffer(), "1\n") == 0);
+  REQUIRE(vm.getStackCommittedSize() >= sizeof(binder::vm::Value));
+  log.flush();
+
+  // the limit is still enforced on the computed depth
+  binder::vm::Chunk deep;
+  for (int i = 0; i < 5; ++i) {
+    deep.write(binder::vm::OP_CODE::OP_NIL, 2);
+  }
+  deep.write(binder::vm::OP_CODE::OP_RETURN, 2);
+  REQUIRE(vm.interpret(&deep) ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR);
+  REQUIRE(strcmp(log.getBuffer(), "Stack overflow.\n[line 2] in script\n") ==
+          0);
+}
+
+TEST_CASE("vm exec trace", "[vm-parser]") {
+  binder::log::BufferedLog log;
+  binder::log::BufferedLog traceLog;
+  binder::vm::VirtualMachine vm(&log);
+
+  // the plain loop does not trace and does not need a trace logger
+  REQUIRE(vm.interpret("print 1;") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(strcmp(log.getBuffer(), "1\n") == 0);
+  log.flush();
+
+  REQUIRE(vm.interpret("print 1;", &traceLog) ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(strcmp(log.getBuffer(), "1\n") == 0);
+  const char *expected = "          \n"
+                         "0000    0 OP_CONSTANT         0 '1\n"
+                         "          [ 1 ]\n"
+                         "0002    | OP_PRINT\n"
+                         "          \n"
+                         "0003    | OP_RETURN\n";
+  REQUIRE(strcmp(traceLog.getBuffer(), expected) == 0);
+
+  // tracing is per call, the next run is back on the plain loop and the
+  // trace log is left untouched
+  REQUIRE(vm.interpret("print 2;") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(strcmp(traceLog.getBuffer(), expected) == 0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec folded constants",
+                 "[vm-parser]") {
+  const char *source = "print 1 + 2 * 3; print \"a\" + \"b\" == \"ab\";"
+                       "print -(4 / 2) >= -2; var a = 1;"
+                       "while (a < 10 / 2) { a = a + 2 - 1; } print a;";
+  binder::vm::INTERPRET_RESULT result = interpret(source);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("7\ntrue\ntrue\n5\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec folded negate error",
+                 "[vm-parser]") {
+  binder::vm::INTERPRET_RESULT result = interpret("print 1;\nprint -\"a\";");
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR);
+  REQUIRE(compareLog("1\nOperand must be a number.\n[line 1] in script\n") ==
+          0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec folded add error",
+                 "[vm-parser]") {
+  binder::vm::INTERPRET_RESULT result = interpret("print 1 + \"a\";");
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR);
+  REQUIRE(compareLog("Operands must be two numbers of two strings\n"
+                     "[line 0] in script\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec many constants",
+                 "[vm-parser]") {
+  std::string source = "var a = 0;";
+  for (int i = 0; i < 400; ++i) {
+    source += "a = a + " + std::to_string(i) + ".5;";
+  }
+  source += "print a;";
+  binder::vm::INTERPRET_RESULT result = interpret(source.c_str());
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  // sum of 0..399 plus 400 halves
+  REQUIRE(compareLog("80000\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec many globals",
+                 "[vm-parser]") {
+  std::string source;
+  for (int i = 0; i < 300; ++i) {
+    source += "var g" + std::to_string(i) + " = " + std::to_string(i) + ";";
+  }
+  source += "g299 = g299 + g1; print g299; print g280;";
+  binder::vm::INTERPRET_RESULT result = interpret(source.c_str());
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("300\n280\n") == 0);
+
+  m_log.flush();
+  result = interpret("print g2 + g290;\nprint g301;");
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_RUNTIME_ERROR);
+  REQUIRE(compareLog("292\nUndefined variable 'g301'.\n[line 1] in script\n") ==
+          0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture, "vm exec more globals than bins",
+                 "[vm-parser]") {
+  // the global and intern tables start with 1024 bins, they have to grow
+  std::string source;
+  for (int i = 0; i < 3000; ++i) {
+    source += "var g" + std::to_string(i) + " = " + std::to_string(i) + ";";
+  }
+  source += "print g2999 + g1;";
+  binder::vm::INTERPRET_RESULT result = interpret(source.c_str());
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("3000\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmExecuteTestFixture,
+                 "vm exec local names are dropped after compile",
+                 "[vm-parser]") {
+  const char *source = "{ var a = 1; var b = 2; { var a = 3; print a + b; } "
+                       "print a; }";
+  binder::vm::INTERPRET_RESULT result = interpret(source);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("5\n1\n") == 0);
+  REQUIRE(m_vm.getIntern().getStringCount() == 0);
+  REQUIRE(m_vm.getIntern().getBytesUsed() == 0);
+
+  // a failed compile drops them as well
+  result = interpret("{ var c = 1; print c }");
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_COMPILE_ERROR);
+  REQUIRE(m_vm.getIntern().getStringCount() == 0);
+}
@@ -0,0 +1,200 @@
+#include "binder/log/bufferLog.h"
+#include "binder/vm/object.h"
+#include "binder/vm/vm.h"
+
+#include "../catch.h"
+#include <string>
+
+class SetupVmGCTestFixture {
+public:
+  SetupVmGCTestFixture() : m_log(), m_vm(&m_log) {}
+
+  binder::vm::INTERPRET_RESULT interpret(const char *source) {
+    return m_vm.interpret(source);
+  }
+  int compareLog(const char *expected) {
+    return strcmp(m_log.getBuffer(), expected);
+  }
+
+protected:
+  binder::log::BufferedLog m_log;
+  binder::vm::VirtualMachine m_vm;
+};
+
+static const char *GC_STRINGS_SCRIPT =
+    "var a = \"start\"; var b = \"\";\n"
+    "{ var i = 0; var local = \"l\";\n"
+    "  while (i < 50) { local = local + \"l\"; b = a + \"-\" + local; "
+    "i = i + 1; }\n"
+    "  print local == \"llll\" + \"l\"; }\n"
+    "print b == a + \"-\" + \"lll\";\n"
+    "var c = \"ab\"; var d = \"a\"; d = d + \"b\"; print c == d; print d;\n";
+
+TEST_CASE_METHOD(SetupVmGCTestFixture, "vm gc stress", "[vm-gc]") {
+  binder::vm::GCConfig config;
+  config.stress = true;
+  m_vm.setGCConfig(config);
+
+  binder::vm::INTERPRET_RESULT result = interpret(GC_STRINGS_SCRIPT);
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("false\nfalse\ntrue\nab\n") == 0);
+  const binder::vm::GCStats &stats = m_vm.getGCStats();
+  // one collection per concatenation done at runtime, three in the loop, two
+  // for b and one for d, the one in the block is folded by the compiler
+  REQUIRE(stats.collections == 50 * 3 + 3);
+  REQUIRE(stats.objectsFreed > 0);
+  REQUIRE(stats.bytesFreed > 0);
+}
+
+TEST_CASE_METHOD(SetupVmGCTestFixture, "vm gc keeps globals alive",
+                 "[vm-gc]") {
+  REQUIRE(interpret("var b = \"x\"; var a = b + \"y\"; b + \"z\";") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  const size_t before = m_vm.getHeap().getAllocatedBytes();
+  m_vm.collectGarbage();
+  // only the "xz" temporary is gone
+  const binder::vm::GCStats &stats = m_vm.getGCStats();
+  REQUIRE(stats.collections == 1);
+  REQUIRE(stats.objectsFreed == 1);
+  REQUIRE(stats.bytesFreed == sizeof(binder::vm::ObjString) + 3);
+  REQUIRE(m_vm.getHeap().getAllocatedBytes() == before - stats.bytesFreed);
+
+  REQUIRE(interpret("print a; print a == b + \"y\"; print b + \"z\";") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("xy\ntrue\nxz\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmGCTestFixture, "vm gc bounded heap", "[vm-gc]") {
+  binder::vm::GCConfig config;
+  config.initialThreshold = 4 * 1024;
+  m_vm.setGCConfig(config);
+
+  const size_t before = m_vm.getHeap().getAllocatedBytes();
+  // every iteration leaves the previous string behind, about 2MB in total
+  binder::vm::INTERPRET_RESULT result =
+      interpret("var s = \"\"; { var i = 0; while (i < 2000) { s = s + \"c\"; "
+                "i = i + 1; } }");
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  const binder::vm::GCStats &stats = m_vm.getGCStats();
+  REQUIRE(stats.collections > 0);
+  REQUIRE(stats.objectsFreed > 1900);
+  REQUIRE(m_vm.getHeap().getAllocatedBytes() - before < 32 * 1024);
+}
+
+TEST_CASE("vm heaps are isolated", "[vm-gc]") {
+  binder::log::BufferedLog firstLog;
+  binder::log::BufferedLog secondLog;
+  auto *first = new binder::vm::VirtualMachine(&firstLog);
+  binder::vm::VirtualMachine second(&secondLog);
+  binder::vm::GCConfig config;
+  config.stress = true;
+  first->setGCConfig(config);
+
+  const char *source = "var a = \"shared\"; var b = a + \" text\";";
+  REQUIRE(second.interpret(source) ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  // collecting on the first vm does not see the roots of the second one, it
+  // must not touch its objects
+  REQUIRE(first->interpret(source) ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  first->collectGarbage();
+  REQUIRE(first->getGCStats().collections == 2);
+  REQUIRE(first->getHeap().getAllocatedBytes() ==
+          second.getHeap().getAllocatedBytes());
+
+  // neither does tearing it down
+  delete first;
+  REQUIRE(second.interpret("print b; print b == \"shared text\";") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(strcmp(secondLog.getBuffer(), "shared text\ntrue\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmGCTestFixture, "vm heap allocator stats", "[vm-gc]") {
+  binder::vm::GCConfig config;
+  config.stress = true;
+  m_vm.setGCConfig(config);
+
+  // strings up to 200 chars, all in the slab classes, every iteration frees
+  // the previous one so the slots keep being recycled
+  binder::vm::INTERPRET_RESULT result =
+      interpret("var s = \"\"; { var i = 0; while (i < 200) { s = s + \"c\"; "
+                "i = i + 1; } }");
+  REQUIRE(result == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+
+  const binder::memory::SlabAllocator::Stats stats =
+      m_vm.getHeap().getAllocatorStats();
+  REQUIRE(stats.largeInUse == 0);
+  // the two constants, s and the string before it, the collection runs
+  // before the concatenation so that one is still around
+  REQUIRE(stats.allocations - stats.frees == 4);
+  uint32_t slabs = 0;
+  for (uint32_t c = 0; c < binder::memory::SlabAllocator::CLASS_COUNT; ++c) {
+    slabs += stats.classes[c].slabs;
+  }
+  REQUIRE(slabs <= binder::memory::SlabAllocator::CLASS_COUNT);
+  REQUIRE(stats.bytesInUse >= m_vm.getHeap().getAllocatedBytes());
+}
+
+TEST_CASE_METHOD(SetupVmGCTestFixture, "vm gc repeated compiles",
+                 "[vm-gc]") {
+  // every run brings new literals and a folded concatenation, once the chunk
+  // is replaced they are garbage like anything else, so a vm compiling over
+  // and over does not keep piling them up
+  uint64_t liveObjects = 0;
+  for (int i = 0; i < 100; ++i) {
+    const std::string index = std::to_string(i);
+    const std::string source = "var s = \"run " + index + "\" + \" folded " +
+                               index + "\"; print s == \"run " + index +
+                               " folded " + index + "\";";
+    REQUIRE(interpret(source.c_str()) ==
+            binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+    m_vm.collectGarbage();
+
+    const binder::memory::SlabAllocator::Stats stats =
+        m_vm.getHeap().getAllocatorStats();
+    if (i == 0) {
+      liveObjects = stats.allocations - stats.frees;
+    }
+    REQUIRE(stats.allocations - stats.frees == liveObjects);
+  }
+  std::string expected;
+  for (int i = 0; i < 100; ++i) {
+    expected += "true\n";
+  }
+  REQUIRE(compareLog(expected.c_str()) == 0);
+
+  // the current chunk keeps its constants, running it again is fine
+  m_log.flush();
+  REQUIRE(m_vm.interpret(m_vm.getCompiledChunk()) ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("true\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmGCTestFixture, "vm gc keeps compiled chunks alive",
+                 "[vm-gc]") {
+  binder::vm::GCConfig config;
+  config.stress = true;
+  m_vm.setGCConfig(config);
+
+  REQUIRE(m_vm.compile("print \"first chunk string constant\";") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  const binder::vm::Chunk *first = m_vm.getCompiledChunk();
+  REQUIRE(m_vm.compile("print \"second\";") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  m_vm.collectGarbage();
+  // collects on its own on every concatenation, the strings of the first
+  // chunk would be reused by the new ones if they had been freed
+  REQUIRE(interpret("var s = \"\"; { var i = 0; while (i < 40) {"
+                    "s = s + \"z\"; i = i + 1; } }") ==
+          binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(m_vm.interpret(first) == binder::vm::INTERPRET_RESULT::INTERPRET_OK);
+  REQUIRE(compareLog("first chunk string constant\n") == 0);
+
+  // once released the constants are garbage like anything else, the first
+  // collection takes the leftovers of the loop out of the way
+  m_vm.collectGarbage();
+  const uint64_t freed = m_vm.getGCStats().objectsFreed;
+  m_vm.releaseChunk(first);
+  m_vm.collectGarbage();
+  REQUIRE(m_vm.getGCStats().objectsFreed == freed + 1);
+}
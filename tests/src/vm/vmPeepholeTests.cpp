@@ -0,0 +1,221 @@
+#include "binder/log/bufferLog.h"
+#include "binder/memory/stringIntern.h"
+#include "binder/vm/compiler.h"
+#include "binder/vm/debug.h"
+#include "binder/vm/object.h"
+#include "binder/vm/peephole.h"
+#include "binder/vm/vm.h"
+
+#include "../catch.h"
+
+class SetupVmPeepholeTestFixture {
+public:
+  SetupVmPeepholeTestFixture()
+      : intern(1024), globals(1024), compiler(&intern, &globals, &heap) {}
+  ~SetupVmPeepholeTestFixture() { delete m_chunk; }
+
+  // compiles with the default config, so the peephole pass runs, and returns
+  // the disassembly
+  const char *disassemble(const char *source) {
+    delete m_chunk;
+    m_chunk = nullptr;
+    m_log.flush();
+    if (!compiler.compile(source, &m_log)) {
+      return "";
+    }
+    m_chunk = compiler.getCompiledChunk();
+    binder::vm::disassambleChunk(m_chunk, "code", &m_log);
+    return m_log.getBuffer();
+  }
+
+protected:
+  binder::log::BufferedLog m_log;
+  binder::memory::StringIntern intern;
+  binder::vm::GlobalTable globals;
+  binder::vm::Heap heap;
+  binder::vm::Compiler compiler;
+  const binder::vm::Chunk *m_chunk = nullptr;
+};
+
+TEST_CASE_METHOD(SetupVmPeepholeTestFixture, "vm peephole comparisons",
+                 "[vm-peephole]") {
+  const char *source = "var a = 1; print a != 2; print a >= 2; print a <= 2;";
+  REQUIRE(strcmp(disassemble(source), "== code ==\n"
+                                      "0000    0 OP_CONSTANT         0 '1\n"
+                                      "0002    | OP_DEFINE_GLOBAL    0\n"
+                                      "0004    | OP_GET_GLOBAL       0\n"
+                                      "0006    | OP_CONSTANT         1 '2\n"
+                                      "0008    | OP_NOT_EQUAL\n"
+                                      "0009    | OP_PRINT\n"
+                                      "0010    | OP_GET_GLOBAL       0\n"
+                                      "0012    | OP_CONSTANT         1 '2\n"
+                                      "0014    | OP_GREATER_EQUAL\n"
+                                      "0015    | OP_PRINT\n"
+                                      "0016    | OP_GET_GLOBAL       0\n"
+                                      "0018    | OP_CONSTANT         1 '2\n"
+                                      "0020    | OP_LESS_EQUAL\n"
+                                      "0021    | OP_PRINT\n"
+                                      "0022    | OP_RETURN\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmPeepholeTestFixture, "vm peephole local increment",
+                 "[vm-peephole]") {
+  const char *source = "{ var a = 1; a = a + 1; print a; }";
+  REQUIRE(strcmp(disassemble(source),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '1\n"
+                 "0002    | OP_ADD_LOCAL_CONST    0    0 '1\n"
+                 "0005    | OP_SET_LOCAL_POP    0\n"
+                 "0007    | OP_GET_LOCAL        0\n"
+                 "0009    | OP_PRINT\n"
+                 "0010    | OP_POP\n"
+                 "0011    | OP_RETURN\n") == 0);
+
+  // string constants are left alone, the add might be a concatenation
+  source = "{ var a = \"a\"; print a + \"b\"; }";
+  REQUIRE(strcmp(disassemble(source),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 'a\n"
+                 "0002    | OP_GET_LOCAL        0\n"
+                 "0004    | OP_CONSTANT         1 'b\n"
+                 "0006    | OP_ADD\n"
+                 "0007    | OP_PRINT\n"
+                 "0008    | OP_POP\n"
+                 "0009    | OP_RETURN\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmPeepholeTestFixture, "vm peephole if else",
+                 "[vm-peephole]") {
+  const char *source = "var a = 1; if (a > 0) { print 1; } else { print 2; }";
+  // the pop at 18 is now dead, the conditional jump skips it
+  REQUIRE(strcmp(disassemble(source),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '1\n"
+                 "0002    | OP_DEFINE_GLOBAL    0\n"
+                 "0004    | OP_GET_GLOBAL       0\n"
+                 "0006    | OP_CONSTANT         1 '0\n"
+                 "0008    | OP_GREATER\n"
+                 "0009    | OP_JUMP_IF_FALSE_POP    9 -> 19\n"
+                 "0012    | OP_CONSTANT         0 '1\n"
+                 "0014    | OP_PRINT\n"
+                 "0015    | OP_JUMP            15 -> 22\n"
+                 "0018    | OP_POP\n"
+                 "0019    | OP_CONSTANT         2 '2\n"
+                 "0021    | OP_PRINT\n"
+                 "0022    | OP_RETURN\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmPeepholeTestFixture, "vm peephole while",
+                 "[vm-peephole]") {
+  const char *source = "var a = 0; while (a < 3) { a = a + 1; }";
+  REQUIRE(strcmp(disassemble(source),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '0\n"
+                 "0002    | OP_DEFINE_GLOBAL    0\n"
+                 "0004    | OP_GET_GLOBAL       0\n"
+                 "0006    | OP_CONSTANT         1 '3\n"
+                 "0008    | OP_LESS\n"
+                 "0009    | OP_JUMP_IF_FALSE_POP    9 -> 23\n"
+                 "0012    | OP_GET_GLOBAL       0\n"
+                 "0014    | OP_CONSTANT         2 '1\n"
+                 "0016    | OP_ADD\n"
+                 "0017    | OP_SET_GLOBAL_POP    0\n"
+                 "0019    | OP_LOOP            19 -> 4\n"
+                 "0022    | OP_POP\n"
+                 "0023    | OP_RETURN\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmPeepholeTestFixture, "vm peephole jump in sequence",
+                 "[vm-peephole]") {
+  // the and jumps straight on the not, the equal in front of it can't be
+  // fused with it
+  const char *source =
+      "var a = 1; var b = 2; var c = true; print !(a and b == c);";
+  REQUIRE(strcmp(disassemble(source),
+                 "== code ==\n"
+                 "0000    0 OP_CONSTANT         0 '1\n"
+                 "0002    | OP_DEFINE_GLOBAL    0\n"
+                 "0004    | OP_CONSTANT         1 '2\n"
+                 "0006    | OP_DEFINE_GLOBAL    1\n"
+                 "0008    | OP_TRUE\n"
+                 "0009    | OP_DEFINE_GLOBAL    2\n"
+                 "0011    | OP_GET_GLOBAL       0\n"
+                 "0013    | OP_JUMP_IF_FALSE   13 -> 22\n"
+                 "0016    | OP_POP\n"
+                 "0017    | OP_GET_GLOBAL       1\n"
+                 "0019    | OP_GET_GLOBAL       2\n"
+                 "0021    | OP_EQUAL\n"
+                 "0022    | OP_NOT\n"
+                 "0023    | OP_PRINT\n"
+                 "0024    | OP_RETURN\n") == 0);
+}
+
+TEST_CASE_METHOD(SetupVmPeepholeTestFixture, "vm peephole lines",
+                 "[vm-peephole]") {
+  const char *source = "{ var a = 1;\n"
+                       "a = a\n"
+                       "+ 1;\n"
+                       "if (a >= 2)\n"
+                       "print a; }";
+  disassemble(source);
+  REQUIRE(m_chunk != nullptr);
+  REQUIRE(m_chunk->m_code.size() == m_chunk->m_lines.size());
+  // the fused add takes the line of the add, that is where errors point
+  REQUIRE(m_chunk->m_code[2] ==
+          static_cast<uint8_t>(binder::vm::OP_CODE::OP_ADD_LOCAL_CONST));
+  REQUIRE(m_chunk->m_lines[2] == 2);
+  REQUIRE(m_chunk->m_lines[4] == 2);
+  REQUIRE(m_chunk->m_code[5] ==
+          static_cast<uint8_t>(binder::vm::OP_CODE::OP_SET_LOCAL_POP));
+  REQUIRE(m_chunk->m_lines[5] == 2);
+  REQUIRE(m_chunk->m_code[11] ==
+          static_cast<uint8_t>(binder::vm::OP_CODE::OP_GREATER_EQUAL));
+  REQUIRE(m_chunk->m_lines[11] == 3);
+}
+
+// runs the same scripts with and without the peephole pass, the output has
+// to match
+static void compareOptimizedRun(const char *source, const char *expected) {
+  binder::log::BufferedLog rawLog;
+  binder::log::BufferedLog optimizedLog;
+  binder::vm::VirtualMachine raw(&rawLog);
+  binder::vm::VirtualMachine optimized(&optimizedLog);
+  binder::vm::CompilerConfig config;
+  config.peephole = false;
+  raw.setCompilerConfig(config);
+
+  binder::vm::INTERPRET_RESULT rawResult = raw.interpret(source);
+  binder::vm::INTERPRET_RESULT optimizedResult = optimized.interpret(source);
+  REQUIRE(rawResult == optimizedResult);
+  REQUIRE(strcmp(rawLog.getBuffer(), optimizedLog.getBuffer()) == 0);
+  REQUIRE(strcmp(optimizedLog.getBuffer(), expected) == 0);
+}
+
+TEST_CASE("vm peephole exec", "[vm-peephole]") {
+  compareOptimizedRun("var a = 1; print a != 2; print a >= 1; print a <= 0;",
+                      "true\ntrue\nfalse\n");
+  compareOptimizedRun("print \"a\" != \"a\"; print nil != false;",
+                      "false\ntrue\n");
+  compareOptimizedRun("{ var a = 0; for (var i = 0; i < 5; i = i + 1) {"
+                      "a = a + 2; } print a; }",
+                      "10\n");
+  compareOptimizedRun("var a = 0; while (a < 3) { if (a >= 1) { print a; } "
+                      "else { print -1; } a = a + 1; }",
+                      "-1\n1\n2\n");
+  compareOptimizedRun("var a = 1; var b = 2; var c = true; "
+                      "print !(a and b == c); print !(nil and b == c);",
+                      "true\ntrue\n");
+  // comparisons with a NaN keep the semantic of the negated sequence
+  compareOptimizedRun("var n = 0 / 0; print n >= 1; print n <= 1;",
+                      "true\ntrue\n");
+}
+
+TEST_CASE("vm peephole exec errors", "[vm-peephole]") {
+  compareOptimizedRun("{ var a = \"x\";\nprint a + 1; }",
+                      "Operands must be two numbers of two strings\n"
+                      "[line 1] in script\n");
+  compareOptimizedRun("var a = 1;\nprint a >= \"x\";",
+                      "Operands must be numbers.\n[line 1] in script\n");
+  compareOptimizedRun("b = 1;",
+                      "Undefined variable 'b'.\n[line 0] in script\n");
+}
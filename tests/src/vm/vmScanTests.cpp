@@ -291,3 +291,28 @@ TEST_CASE_METHOD(SetupVmScanTestFixture, "vm unterminated string", "[vm-scan]")
   compareNextEOF();
 
 }
+
+TEST_CASE_METHOD(SetupVmScanTestFixture, "vm scan long runs", "[vm-scan]") {
+  // every run is longer than a block of chars, lines are still counted
+  const char *source =
+      "    \n\t\t  \r\n// a comment long enough to need more than one block\n"
+      "a_very_long_identifier_that_keeps_going_past_a_block_2 = "
+      "123456789012345678901234567890123456.25;\n"
+      "\"a string that goes on\nand on for more than a block\" end";
+  initScanner(source);
+
+  binder::vm::Token tok = scanner.scanToken();
+  REQUIRE(tok.type == binder::TOKEN_TYPE::IDENTIFIER);
+  REQUIRE(tok.length == 54);
+  REQUIRE(tok.line == 3);
+  compareNextTokenSimple(binder::TOKEN_TYPE::EQUAL);
+  compareNextTokenSimpleNumber("123456789012345678901234567890123456.25");
+  compareNextTokenSimple(binder::TOKEN_TYPE::SEMICOLON);
+  tok = scanner.scanToken();
+  REQUIRE(tok.type == binder::TOKEN_TYPE::STRING);
+  REQUIRE(tok.length == 52);
+  // the line is the one where the string ends
+  REQUIRE(tok.line == 5);
+  compareNextTokenSimpleIdentifier("end");
+  compareNextEOF();
+}
@@ -0,0 +1,112 @@
+#include "binder/vm/heap.h"
+#include "binder/vm/object.h"
+#include "binder/vm/value.h"
+
+#include "../catch.h"
+
+// these tests run against whatever value representation the build has been
+// configured with, tagged union or nan boxing
+
+TEST_CASE("vm value number round trip", "[vm-value]") {
+  const double numbers[] = {0.0, -0.0, 1.0, -1.0, 3.14159, 1e300, -1e-300};
+  for (double number : numbers) {
+    binder::vm::Value value = binder::vm::makeNumber(number);
+    REQUIRE(binder::vm::isValueNumber(value));
+    REQUIRE_FALSE(binder::vm::isValueBool(value));
+    REQUIRE_FALSE(binder::vm::isValueNIL(value));
+    REQUIRE_FALSE(binder::vm::isValueObj(value));
+    REQUIRE(binder::vm::valueAsNumber(value) == number);
+    REQUIRE(binder::vm::getValueType(value) ==
+            binder::vm::VALUE_TYPE::VAL_NUMBER);
+  }
+}
+
+TEST_CASE("vm value bool and nil", "[vm-value]") {
+  binder::vm::Value t = binder::vm::makeBool(true);
+  binder::vm::Value f = binder::vm::makeBool(false);
+  binder::vm::Value nil = binder::vm::makeNIL();
+
+  REQUIRE(binder::vm::isValueBool(t));
+  REQUIRE(binder::vm::isValueBool(f));
+  REQUIRE_FALSE(binder::vm::isValueBool(nil));
+  REQUIRE(binder::vm::valueAsBool(t));
+  REQUIRE_FALSE(binder::vm::valueAsBool(f));
+
+  REQUIRE(binder::vm::isValueNIL(nil));
+  REQUIRE_FALSE(binder::vm::isValueNIL(t));
+  REQUIRE_FALSE(binder::vm::isValueNIL(f));
+  REQUIRE_FALSE(binder::vm::isValueNumber(nil));
+  REQUIRE_FALSE(binder::vm::isValueNumber(t));
+
+  REQUIRE(binder::vm::getValueType(t) == binder::vm::VALUE_TYPE::VAL_BOOL);
+  REQUIRE(binder::vm::getValueType(nil) == binder::vm::VALUE_TYPE::VAL_NIL);
+}
+
+TEST_CASE("vm value object round trip", "[vm-value]") {
+  binder::vm::Heap heap;
+  binder::vm::ObjString *string = binder::vm::copyString(&heap, "hello", 5);
+  binder::vm::Value value = binder::vm::makeObject(string);
+
+  REQUIRE(binder::vm::isValueObj(value));
+  REQUIRE(binder::vm::isValueString(value));
+  REQUIRE_FALSE(binder::vm::isValueNumber(value));
+  REQUIRE_FALSE(binder::vm::isValueNIL(value));
+  REQUIRE(binder::vm::valueAsString(value) == string);
+  REQUIRE(strcmp(binder::vm::valueAsCString(value), "hello") == 0);
+  REQUIRE(binder::vm::copyString(&heap, "hello world", 5) == string);
+}
+
+TEST_CASE("vm string caches its hash", "[vm-value]") {
+  binder::vm::Heap heap;
+  binder::vm::ObjString *string = binder::vm::copyString(&heap, "hello", 5);
+  REQUIRE(string->hash == binder::vm::hashStringChars("hello", 5));
+  REQUIRE(heap.findString("hello", 5, string->hash) == string);
+  REQUIRE(binder::vm::copyString(&heap, "hello world", 5, string->hash) ==
+          string);
+}
+
+TEST_CASE("vm string concatenation", "[vm-value]") {
+  binder::vm::Heap heap;
+  binder::vm::ObjString *hello = binder::vm::copyString(&heap, "hello", 5);
+  binder::vm::ObjString *world = binder::vm::copyString(&heap, " world", 6);
+  binder::vm::ObjString *result =
+      binder::vm::concatenateStrings(&heap, hello, world);
+  REQUIRE(result->length == 11);
+  REQUIRE(strcmp(binder::vm::stringChars(result), "hello world") == 0);
+  REQUIRE(result->hash == binder::vm::hashStringChars("hello world", 11));
+  REQUIRE(binder::vm::copyString(&heap, "hello world", 11) == result);
+
+  // a different split of the same chars finds the existing string without
+  // allocating
+  binder::vm::ObjString *hel = binder::vm::copyString(&heap, "hel", 3);
+  binder::vm::ObjString *loWorld =
+      binder::vm::copyString(&heap, "lo world", 8);
+  const uint64_t allocations = heap.getAllocatorStats().allocations;
+  REQUIRE(binder::vm::concatenateStrings(&heap, hel, loWorld) == result);
+  REQUIRE(heap.getAllocatorStats().allocations == allocations);
+
+  // a prefix of an existing string is not a match
+  binder::vm::ObjString *empty = binder::vm::copyString(&heap, "", 0);
+  REQUIRE(binder::vm::concatenateStrings(&heap, hel, empty) == hel);
+  REQUIRE(binder::vm::concatenateStrings(&heap, empty, hel) == hel);
+  binder::vm::ObjString *hell =
+      binder::vm::concatenateStrings(&heap, hel, binder::vm::copyString(&heap, "l", 1));
+  REQUIRE(hell != result);
+  REQUIRE(strcmp(binder::vm::stringChars(hell), "hell") == 0);
+}
+
+TEST_CASE("vm value equality", "[vm-value]") {
+  REQUIRE(binder::vm::valuesEqual(binder::vm::makeNumber(2.0),
+                                  binder::vm::makeNumber(2.0)));
+  REQUIRE_FALSE(binder::vm::valuesEqual(binder::vm::makeNumber(2.0),
+                                        binder::vm::makeNumber(3.0)));
+  REQUIRE(binder::vm::valuesEqual(binder::vm::makeNIL(),
+                                  binder::vm::makeNIL()));
+  REQUIRE_FALSE(binder::vm::valuesEqual(binder::vm::makeBool(false),
+                                        binder::vm::makeNIL()));
+  REQUIRE_FALSE(binder::vm::valuesEqual(binder::vm::makeBool(true),
+                                        binder::vm::makeNumber(1.0)));
+  // zero and negative zero compare equal as numbers even if the bits differ
+  REQUIRE(binder::vm::valuesEqual(binder::vm::makeNumber(0.0),
+                                  binder::vm::makeNumber(-0.0)));
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "binder/log/log.h"
+
+namespace binder::benchmark {
+
+// minimal benchmark harness, we don't want to pull in an external dependency
+// just to time a few loops. Every benchmark registers itself at static init
+// time and main runs all of them (or the ones matching the filter)
+using BenchmarkFunction = void (*)();
+
+struct BenchmarkEntry {
+  const char *name;
+  BenchmarkFunction function;
+  BenchmarkEntry *next;
+};
+
+inline BenchmarkEntry *&getBenchmarkList() {
+  static BenchmarkEntry *head = nullptr;
+  return head;
+}
+
+struct BenchmarkRegister {
+  BenchmarkRegister(BenchmarkEntry *entry) {
+    // appending at the end so we run in declaration order
+    BenchmarkEntry **tail = &getBenchmarkList();
+    while (*tail != nullptr) {
+      tail = &(*tail)->next;
+    }
+    *tail = entry;
+  }
+};
+
+#define BINDER_BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BINDER_BENCHMARK_CONCAT(a, b) BINDER_BENCHMARK_CONCAT_IMPL(a, b)
+#define BINDER_BENCHMARK(functionName, benchmarkName)                          \
+  static void functionName();                                                  \
+  static binder::benchmark::BenchmarkEntry BINDER_BENCHMARK_CONCAT(            \
+      functionName, Entry){benchmarkName, functionName, nullptr};              \
+  static binder::benchmark::BenchmarkRegister BINDER_BENCHMARK_CONCAT(         \
+      functionName, Register)(&BINDER_BENCHMARK_CONCAT(functionName, Entry));  \
+  static void functionName()
+
+class Timer {
+public:
+  Timer() : m_start(std::chrono::high_resolution_clock::now()) {}
+  void reset() { m_start = std::chrono::high_resolution_clock::now(); }
+  double elapsedSeconds() const {
+    std::chrono::duration<double> delta =
+        std::chrono::high_resolution_clock::now() - m_start;
+    return delta.count();
+  }
+
+private:
+  std::chrono::high_resolution_clock::time_point m_start;
+};
+
+// runs the function the requested amount of times and returns the best time
+// in seconds, the minimum is the least noisy estimate we can get on a busy
+// machine
+template <typename FUNC>
+double bestOf(uint32_t repetitions, FUNC function) {
+  double best = 1e30;
+  for (uint32_t i = 0; i < repetitions; ++i) {
+    Timer timer;
+    function();
+    double elapsed = timer.elapsedSeconds();
+    best = elapsed < best ? elapsed : best;
+  }
+  return best;
+}
+
+// swallows everything, we want to measure the vm not the console
+class NullLog : public log::Log {
+public:
+  void print(const char *) override {}
+  void flush() override {}
+};
+
+} // namespace binder::benchmark
@@ -0,0 +1,79 @@
+#include "benchmark.h"
+
+#include "binder/constants.h"
+#include "binder/legacyAST/context.h"
+#include "binder/legacyAST/scanner.h"
+#include "binder/vm/compiler.h"
+
+#include <cstdio>
+
+namespace binder::benchmark {
+
+static constexpr uint32_t LEXER_REPETITIONS = 5;
+static constexpr uint32_t LEXER_SOURCE_SIZE = 16 * 1024 * 1024;
+
+// fills a big buffer with the given statement over and over, the statement
+// gets the line number so the identifiers are not all the same
+static char *makeLexerSource(const char *statement, uint32_t &lines) {
+  char *source = new char[LEXER_SOURCE_SIZE + 1024];
+  char *cursor = source;
+  lines = 0;
+  while (cursor - source < LEXER_SOURCE_SIZE) {
+    cursor += sprintf(cursor, statement, lines, lines);
+    ++lines;
+  }
+  return source;
+}
+
+static void runLexerBenchmark(const char *statement) {
+  uint32_t lines = 0;
+  char *source = makeLexerSource(statement, lines);
+  const double megaBytes = strlen(source) * BYTE_TO_MB_D;
+
+  uint32_t vmTokens = 0;
+  const double vmSeconds = bestOf(LEXER_REPETITIONS, [&]() {
+    vm::Scanner scanner{};
+    scanner.init(source);
+    vmTokens = 0;
+    while (scanner.scanToken().type != TOKEN_TYPE::END_OF_FILE) {
+      ++vmTokens;
+    }
+  });
+
+  ContextConfig config{};
+  config.loggerType = LOGGER_TYPE::BUFFERED;
+  BinderContext context(config);
+  Scanner legacy(&context);
+  const double legacySeconds =
+      bestOf(LEXER_REPETITIONS, [&]() { legacy.scan(source); });
+
+  printf("    %.1f MB, %u lines, best of %u\n", megaBytes, lines,
+         LEXER_REPETITIONS);
+  printf("    vm scanner: %u tokens, %.3f ms, %.0f MB/s\n", vmTokens,
+         vmSeconds * 1000.0, megaBytes / vmSeconds);
+  // the legacy one keeps the end of file token too
+  printf("    legacy scanner: %u tokens, %.3f ms, %.0f MB/s\n",
+         legacy.getTokens().size() - 1, legacySeconds * 1000.0,
+         megaBytes / legacySeconds);
+  delete[] source;
+}
+
+// what a script mostly looks like, short names and numbers, some
+// indentation and the odd comment
+BINDER_BENCHMARK(lexerCode, "lexer throughput code") {
+  runLexerBenchmark("    var counter_%u = other + 1234.5 * (value - 7);\n"
+                    "    if (counter_%u > limit) { print \"over\"; } // check\n");
+}
+
+// the runs the scanner has to walk through, deep indentation, long
+// comments, long strings and long names
+BINDER_BENCHMARK(lexerLongRuns, "lexer throughput long runs") {
+  runLexerBenchmark(
+      "                // the accumulator for the line %u needs a few more "
+      "words in here\n"
+      "                var a_rather_long_descriptive_variable_name_%u = "
+      "\"a string literal that goes on for a while before it ends\" + "
+      "123456789012345.678901;\n");
+}
+
+} // namespace binder::benchmark
@@ -0,0 +1,37 @@
+#include "benchmark.h"
+
+// same trick of the core library, all the benchmarks live in a single
+// translation unit
+#include "vmBenchmarks.cpp"
+#include "memoryBenchmarks.cpp"
+#include "lexerBenchmarks.cpp"
+
+int main(int argc, char **argv) {
+  // optional filter, only benchmarks with a name containing the given string
+  // are executed
+  const char *filter = argc > 1 ? argv[1] : nullptr;
+
+#if BINDER_VM_COMPUTED_GOTO
+  printf("vm dispatch: computed goto\n");
+#else
+  printf("vm dispatch: switch\n");
+#endif
+#ifdef BINDER_VM_NAN_BOXING
+  printf("vm values: nan boxing, %u bytes\n",
+         static_cast<uint32_t>(sizeof(binder::vm::Value)));
+#else
+  printf("vm values: tagged union, %u bytes\n",
+         static_cast<uint32_t>(sizeof(binder::vm::Value)));
+#endif
+
+  binder::benchmark::BenchmarkEntry *entry =
+      binder::benchmark::getBenchmarkList();
+  while (entry != nullptr) {
+    if ((filter == nullptr) || (strstr(entry->name, filter) != nullptr)) {
+      printf("[%s]\n", entry->name);
+      entry->function();
+    }
+    entry = entry->next;
+  }
+  return 0;
+}
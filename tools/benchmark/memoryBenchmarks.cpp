@@ -0,0 +1,315 @@
+#include "benchmark.h"
+
+#include "binder/constants.h"
+#include "binder/legacyAST/context.h"
+#include "binder/legacyAST/parser.h"
+#include "binder/legacyAST/scanner.h"
+#include "binder/memory/hashMap.h"
+#include "binder/memory/hashing.h"
+#include "binder/memory/resizableVector.h"
+#include "binder/memory/slabAllocator.h"
+
+#include <cstdlib>
+#include <type_traits>
+
+namespace binder::benchmark {
+
+static constexpr uint32_t MEMORY_REPETITIONS = 5;
+
+// the pattern the vm heap sees with small strings, a burst of objects of
+// close sizes allocated and then freed together
+template <typename ALLOCATE, typename FREE>
+static void objectChurn(ALLOCATE allocate, FREE release) {
+  static constexpr uint32_t BURST = 16;
+  static constexpr uint32_t COUNT = 2000000;
+  void *burst[BURST];
+  for (uint32_t i = 0; i < COUNT; ++i) {
+    const uint32_t index = i % BURST;
+    const uint32_t size = 25 + index;
+    burst[index] = allocate(size);
+    memset(burst[index], static_cast<int>(i & 0xff), size);
+    if (index == BURST - 1) {
+      for (uint32_t b = 0; b < BURST; ++b) {
+        release(burst[b], 25 + b);
+      }
+    }
+  }
+}
+
+BINDER_BENCHMARK(memorySlabAllocator, "memory slab allocator") {
+  memory::SlabAllocator slab;
+  const double slabSeconds = bestOf(MEMORY_REPETITIONS, [&]() {
+    objectChurn([&](uint32_t size) { return slab.allocate(size); },
+                [&](void *memory, uint32_t size) { slab.free(memory, size); });
+  });
+  const double mallocSeconds = bestOf(MEMORY_REPETITIONS, [&]() {
+    objectChurn([](uint32_t size) { return malloc(size); },
+                [](void *memory, uint32_t) { free(memory); });
+  });
+  printf("    2M objects, best of %u: slab %.3f ms, malloc %.3f ms\n",
+         MEMORY_REPETITIONS, slabSeconds * 1000.0, mallocSeconds * 1000.0);
+}
+
+// the probing of the map as it was before the control bytes, 2 bits of
+// metadata per bin checked one bin at the time, kept here as the reference
+// the group probing is measured against. Bins are a power of two, no growing
+// and no removal, the workload does not need them
+class LinearProbeMap {
+public:
+  explicit LinearProbeMap(const uint32_t bins)
+      : m_keys(new uint32_t[bins]), m_values(new uint32_t[bins]),
+        m_metadata(new uint32_t[bins / 16 + 1]), m_mask(bins - 1) {
+    memset(m_metadata, 0x55, (bins / 16 + 1) * sizeof(uint32_t));
+  }
+  ~LinearProbeMap() {
+    delete[] m_keys;
+    delete[] m_values;
+    delete[] m_metadata;
+  }
+  bool insert(const uint32_t key, const uint32_t value) {
+    uint32_t bin = hashUint32(key) & m_mask;
+    while (getMetadata(bin) == USED) {
+      bin = (bin + 1) & m_mask;
+    }
+    m_keys[bin] = key;
+    m_values[bin] = value;
+    setMetadata(bin, USED);
+    return true;
+  }
+  bool get(const uint32_t key, uint32_t &value) const {
+    uint32_t bin = hashUint32(key) & m_mask;
+    while (true) {
+      const uint32_t meta = getMetadata(bin);
+      if ((meta == USED) && (m_keys[bin] == key)) {
+        value = m_values[bin];
+        return true;
+      }
+      if (meta == FREE) {
+        return false;
+      }
+      bin = (bin + 1) & m_mask;
+    }
+  }
+
+  LinearProbeMap(const LinearProbeMap &) = delete;
+  LinearProbeMap &operator=(const LinearProbeMap &) = delete;
+
+private:
+  static constexpr uint32_t FREE = 1;
+  static constexpr uint32_t USED = 3;
+  uint32_t getMetadata(const uint32_t bin) const {
+    return (m_metadata[bin / 16] >> ((bin % 16) * 2)) & 3;
+  }
+  void setMetadata(const uint32_t bin, const uint32_t flag) {
+    const uint32_t shift = (bin % 16) * 2;
+    m_metadata[bin / 16] = (m_metadata[bin / 16] & ~(3u << shift)) |
+                           (flag << shift);
+  }
+
+  uint32_t *m_keys;
+  uint32_t *m_values;
+  uint32_t *m_metadata;
+  uint32_t m_mask;
+};
+
+struct HashMapTimings {
+  double insert;
+  double hit;
+  double miss;
+};
+
+// the random keys workload of the hashmap tests, fill the table up to the
+// given amount of keys, then look up all of them and as many keys that are
+// not there
+template <typename MAP>
+static HashMapTimings hashMapWorkload(const uint32_t bins, const uint32_t count,
+                                      const uint32_t *keys,
+                                      const uint32_t *missing) {
+  HashMapTimings timings{1e30, 1e30, 1e30};
+  uint32_t found = 0;
+  for (uint32_t r = 0; r < MEMORY_REPETITIONS; ++r) {
+    MAP *map = nullptr;
+    if constexpr (std::is_same_v<MAP, LinearProbeMap>) {
+      map = new MAP(bins);
+    } else {
+      // no growing in the middle of the measure
+      map = new MAP(bins, 0.95f);
+    }
+    Timer timer;
+    for (uint32_t i = 0; i < count; ++i) {
+      map->insert(keys[i], i);
+    }
+    double elapsed = timer.elapsedSeconds();
+    timings.insert = elapsed < timings.insert ? elapsed : timings.insert;
+
+    timer.reset();
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      found += map->get(keys[i], value);
+    }
+    elapsed = timer.elapsedSeconds();
+    timings.hit = elapsed < timings.hit ? elapsed : timings.hit;
+
+    timer.reset();
+    for (uint32_t i = 0; i < count; ++i) {
+      found += map->get(missing[i], value);
+    }
+    elapsed = timer.elapsedSeconds();
+    timings.miss = elapsed < timings.miss ? elapsed : timings.miss;
+    delete map;
+  }
+  // keeps the lookups from being optimized away
+  if (found != count * MEMORY_REPETITIONS) {
+    printf("    unexpected lookup results\n");
+  }
+  return timings;
+}
+
+BINDER_BENCHMARK(memoryHashMapLoad, "memory hashmap load factor") {
+  static constexpr uint32_t BINS = 1 << 18;
+  const float loads[] = {0.5f, 0.75f, 0.9f};
+  auto *keys = new uint32_t[BINS];
+  auto *missing = new uint32_t[BINS];
+  // multiplying by an odd constant shuffles the numbers without repeating
+  // any, odd keys are in the table, even ones are not
+  for (uint32_t i = 0; i < BINS; ++i) {
+    keys[i] = (2 * i + 1) * 0x9e3779b1u;
+    missing[i] = (2 * i + 2) * 0x9e3779b1u;
+  }
+  printf("    %u bins, ns per operation, group width %u\n", BINS,
+         memory::Group::WIDTH);
+  for (const float load : loads) {
+    const auto count = static_cast<uint32_t>(BINS * load);
+    const HashMapTimings linear =
+        hashMapWorkload<LinearProbeMap>(BINS, count, keys, missing);
+    const HashMapTimings group =
+        hashMapWorkload<memory::HashMap<uint32_t, uint32_t, hashUint32>>(
+            BINS, count, keys, missing);
+    const double scale = 1.0e9 / count;
+    printf("    load %2.0f%%: insert %6.1f -> %6.1f, hit %6.1f -> %6.1f, miss "
+           "%6.1f -> %6.1f\n",
+           load * 100.0f, linear.insert * scale, group.insert * scale,
+           linear.hit * scale, group.hit * scale, linear.miss * scale,
+           group.miss * scale);
+  }
+  delete[] keys;
+  delete[] missing;
+}
+
+// what the compiler does when emitting a chunk, code and lines pushed one at
+// the time into two vectors growing side by side
+template <typename SETUP>
+static double chunkEmission(const uint32_t count, SETUP setup,
+                            memory::ThreeSizesPool *pool) {
+  return bestOf(MEMORY_REPETITIONS, [&]() {
+    memory::ResizableVector<uint8_t> code(0, pool);
+    memory::ResizableVector<uint16_t> lines(0, pool);
+    setup(code, lines);
+    for (uint32_t i = 0; i < count; ++i) {
+      code.pushBack(static_cast<uint8_t>(i));
+      lines.pushBack(static_cast<uint16_t>(i >> 4));
+    }
+    if (code[count - 1] != static_cast<uint8_t>(count - 1)) {
+      printf("    unexpected vector content\n");
+    }
+  });
+}
+
+BINDER_BENCHMARK(memoryVectorGrowth, "memory vector growth") {
+  static constexpr uint32_t COUNT = 1 << 22;
+  auto noSetup = [](memory::ResizableVector<uint8_t> &,
+                    memory::ResizableVector<uint16_t> &) {};
+  const double heap = chunkEmission(COUNT, noSetup, nullptr);
+  const double reserved = chunkEmission(
+      COUNT,
+      [](memory::ResizableVector<uint8_t> &code,
+         memory::ResizableVector<uint16_t> &lines) {
+        code.reserve(COUNT);
+        lines.reserve(COUNT);
+      },
+      nullptr);
+  printf("    %u pushes, best of %u: grown %.3f ms, reserved %.3f ms\n", COUNT,
+         MEMORY_REPETITIONS, heap * 1000.0, reserved * 1000.0);
+
+  // in the pool a vector grows in place only while it is the last
+  // allocation, the two vectors growing side by side keep moving
+  static constexpr uint32_t POOL_COUNT = 1 << 17;
+  auto pooled = [&](const bool withLines) {
+    return bestOf(MEMORY_REPETITIONS, [&]() {
+      memory::ThreeSizesPool pool(32 * 1024 * 1024);
+      memory::ResizableVector<uint8_t> code(0, &pool);
+      memory::ResizableVector<uint16_t> lines(0, &pool);
+      for (uint32_t i = 0; i < POOL_COUNT; ++i) {
+        code.pushBack(static_cast<uint8_t>(i));
+        if (withLines) {
+          lines.pushBack(static_cast<uint16_t>(i >> 4));
+        }
+      }
+    });
+  };
+  const double alone = pooled(false);
+  const double sideBySide = pooled(true);
+  printf("    %u pushes in a pool: in place %.3f ms, two vectors %.3f ms\n",
+         POOL_COUNT, alone * 1000.0, sideBySide * 1000.0);
+}
+
+// a 10MB script through the legacy scanner, the tokens are views in the
+// source so the string pool should not see a single allocation
+BINDER_BENCHMARK(memoryLegacyScanner, "memory legacy scanner") {
+  static constexpr uint32_t SIZE = 10 * 1024 * 1024;
+  static const char *LINE = "var counter_%u = \"some text\" + 1234.5 * other;\n";
+  char *source = new char[SIZE + 128];
+  char *cursor = source;
+  uint32_t lines = 0;
+  while (cursor - source < SIZE) {
+    cursor += sprintf(cursor, LINE, lines++);
+  }
+
+  ContextConfig config{};
+  config.loggerType = LOGGER_TYPE::BUFFERED;
+  BinderContext context(config);
+  Scanner scanner(&context);
+  const double seconds =
+      bestOf(MEMORY_REPETITIONS, [&]() { scanner.scan(source); });
+  printf("    %u lines, %u tokens, best of %u: scan %.3f ms\n", lines,
+         scanner.getTokens().size(), MEMORY_REPETITIONS, seconds * 1000.0);
+  printf("    string pool allocations after the scans: %u\n",
+         context.getStringPool().getReport().allocationCount);
+  delete[] source;
+}
+
+// a big generated script for the legacy parser, the same few statements
+// over and over, with blocks and nested expressions so we get all the
+// kinds of nodes
+BINDER_BENCHMARK(memoryAstArena, "memory ast arena") {
+  static constexpr uint32_t COUNT = 50000;
+  char *source = new char[COUNT * 96];
+  char *cursor = source;
+  for (uint32_t i = 0; i < COUNT; ++i) {
+    cursor += sprintf(cursor,
+                      "var a%u = (%u + 2) * -b - c / 4;"
+                      "if (a%u > 10 and x) { print a%u; } else a%u = 0;",
+                      i, i, i, i, i);
+  }
+
+  ContextConfig config{};
+  config.loggerType = LOGGER_TYPE::BUFFERED;
+  BinderContext context(config);
+  Scanner scanner(&context);
+  Parser parser(&context);
+  scanner.scan(source);
+  const memory::ResizableVector<Token> &tokens = scanner.getTokens();
+
+  // the first parse pays for the arena blocks, the next ones reuse them
+  const double seconds =
+      bestOf(MEMORY_REPETITIONS, [&]() { parser.parse(&tokens); });
+  const AstArena::Report report = parser.getArenaReport();
+  printf("    %u tokens, best of %u: parse %.3f ms\n", tokens.size(),
+         MEMORY_REPETITIONS, seconds * 1000.0);
+  printf("    %u nodes, %.2f MB of nodes, %.2f MB reserved in %u blocks\n",
+         report.nodeCount, report.nodeBytes * BYTE_TO_MB_D,
+         report.reservedBytes * BYTE_TO_MB_D, report.blockCount);
+  delete[] source;
+}
+
+} // namespace binder::benchmark
@@ -0,0 +1,302 @@
+#include "benchmark.h"
+
+#include "binder/vm/bytecodeCache.h"
+#include "binder/vm/chunk.h"
+#include "binder/vm/debug.h"
+#include "binder/vm/vm.h"
+
+#include <cstdio>
+#include <string>
+
+namespace binder::benchmark {
+
+static constexpr uint32_t LOOP_ITERATIONS = 1000000;
+static constexpr uint32_t REPETITIONS = 5;
+
+// counts how many instructions a single iteration of the (only) loop in the
+// chunk executes. The scripts below keep the body free of branches so every
+// instruction between the loop start and the OP_LOOP runs exactly once per
+// iteration, the condition jump is not taken until the very end
+static uint32_t countLoopInstructions(const vm::Chunk *chunk) {
+  NullLog nullLog;
+  const auto size = static_cast<int>(chunk->m_code.size());
+  memory::ResizableVector<int> starts;
+  int loopOffset = -1;
+  int offset = 0;
+  while (offset < size) {
+    starts.pushBack(offset);
+    if (chunk->m_code[offset] == static_cast<uint8_t>(vm::OP_CODE::OP_LOOP)) {
+      loopOffset = offset;
+    }
+    offset = vm::disassambleInstruction(chunk, offset, &nullLog);
+  }
+  if (loopOffset == -1) {
+    return 0;
+  }
+  const int jump = (chunk->m_code[loopOffset + 1] << 8) |
+                   chunk->m_code[loopOffset + 2];
+  const int loopStart = loopOffset + 3 - jump;
+
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < starts.size(); ++i) {
+    count += (starts[i] >= loopStart) & (starts[i] <= loopOffset);
+  }
+  return count;
+}
+
+static void runLoopBenchmark(
+    const char *source, uint32_t iterations,
+    const vm::CompilerConfig &config = vm::CompilerConfig()) {
+  NullLog log;
+  vm::VirtualMachine machine(&log);
+  machine.setCompilerConfig(config);
+  if (machine.compile(source) != vm::INTERPRET_RESULT::INTERPRET_OK) {
+    printf("    failed to compile benchmark script\n");
+    return;
+  }
+  const vm::Chunk *chunk = machine.getCompiledChunk();
+  const uint32_t perIteration = countLoopInstructions(chunk);
+
+  vm::INTERPRET_RESULT result = vm::INTERPRET_RESULT::INTERPRET_OK;
+  double seconds = bestOf(REPETITIONS, [&]() {
+    result = machine.interpret(chunk);
+  });
+  if (result != vm::INTERPRET_RESULT::INTERPRET_OK) {
+    printf("    benchmark script failed at runtime\n");
+    return;
+  }
+
+  const double instructions =
+      static_cast<double>(perIteration) * static_cast<double>(iterations);
+  printf("    %u instructions per iteration, best of %u: %.3f ms, %.1f "
+         "Minstr/s\n",
+         perIteration, REPETITIONS, seconds * 1000.0,
+         instructions / seconds / 1.0e6);
+}
+
+static const char *WHILE_GLOBALS_SCRIPT =
+    "var i = 0; var a = 0;"
+    "while (i < 1000000) { a = a + i * 2; i = i + 1; }";
+static const char *FOR_LOCALS_SCRIPT = "{ var a = 0;"
+                                       "for (var i = 0; i < 1000000; i = i + 1) {"
+                                       "a = a + i - 1; } }";
+static const char *ARITHMETIC_MIX_SCRIPT = "{ var x = 1; var y = 2; var i = 0;"
+                                           "while (i < 1000000) {"
+                                           "x = (x * 3 + y) / 2 - x;"
+                                           "y = !(x > y) == true;"
+                                           "y = -x + 4;"
+                                           "i = i + 1; } }";
+
+BINDER_BENCHMARK(vmWhileGlobals, "vm dispatch while loop globals") {
+  runLoopBenchmark(WHILE_GLOBALS_SCRIPT, LOOP_ITERATIONS);
+}
+
+BINDER_BENCHMARK(vmForLocals, "vm dispatch for loop locals") {
+  runLoopBenchmark(FOR_LOCALS_SCRIPT, LOOP_ITERATIONS);
+}
+
+BINDER_BENCHMARK(vmArithmeticMix, "vm dispatch arithmetic mix") {
+  runLoopBenchmark(ARITHMETIC_MIX_SCRIPT, LOOP_ITERATIONS);
+}
+
+// same scripts without the peephole pass, superinstructions count as one
+// instruction so compare the times rather than the rate
+BINDER_BENCHMARK(vmNoPeephole, "vm peephole off") {
+  vm::CompilerConfig config;
+  config.peephole = false;
+  const char *scripts[] = {WHILE_GLOBALS_SCRIPT, FOR_LOCALS_SCRIPT,
+                           ARITHMETIC_MIX_SCRIPT};
+  for (const char *script : scripts) {
+    runLoopBenchmark(script, LOOP_ITERATIONS, config);
+  }
+}
+
+// a loop growing a string, every iteration throws away the previous one,
+// about 50MB go through the heap, it should stay flat while the collector
+// keeps up
+BINDER_BENCHMARK(vmGCStringChurn, "vm gc string churn") {
+  const char *script = "var s = \"\"; { var i = 0; while (i < 10000) {"
+                       "s = s + \"c\"; i = i + 1; } }";
+  NullLog log;
+  vm::VirtualMachine machine(&log);
+  if (machine.compile(script) != vm::INTERPRET_RESULT::INTERPRET_OK) {
+    printf("    failed to compile benchmark script\n");
+    return;
+  }
+  const vm::Chunk *chunk = machine.getCompiledChunk();
+  vm::INTERPRET_RESULT result = vm::INTERPRET_RESULT::INTERPRET_OK;
+  double seconds =
+      bestOf(REPETITIONS, [&]() { result = machine.interpret(chunk); });
+  if (result != vm::INTERPRET_RESULT::INTERPRET_OK) {
+    printf("    benchmark script failed at runtime\n");
+    return;
+  }
+  const vm::GCStats &stats = machine.getGCStats();
+  printf("    best of %u: %.3f ms, %u collections, %llu objects and %llu "
+         "bytes freed, heap after %u bytes\n",
+         REPETITIONS, seconds * 1000.0, stats.collections,
+         static_cast<unsigned long long>(stats.objectsFreed),
+         static_cast<unsigned long long>(stats.bytesFreed),
+         static_cast<uint32_t>(machine.getHeap().getAllocatedBytes()));
+  const memory::SlabAllocator::Stats allocator =
+      machine.getHeap().getAllocatorStats();
+  uint32_t slabs = 0;
+  for (const auto &sizeClass : allocator.classes) {
+    slabs += sizeClass.slabs;
+  }
+  printf("    allocator: %llu allocations, %u slabs, %u large blocks in use, "
+         "%llu bytes in use, %llu reserved\n",
+         static_cast<unsigned long long>(allocator.allocations), slabs,
+         allocator.largeInUse,
+         static_cast<unsigned long long>(allocator.bytesInUse),
+         static_cast<unsigned long long>(allocator.bytesReserved));
+  machine.releaseChunk(chunk);
+}
+
+// lots of short lived small strings, the collector runs on every allocation
+// so every string gets freed and allocated again, mostly measures how cheap
+// object allocation is
+BINDER_BENCHMARK(vmSmallStrings, "vm gc small strings") {
+  const char *script = "{ var i = 0; while (i < 20000) { var s = \"\";"
+                       "var j = 0; while (j < 16) { s = s + \"x\"; j = j + 1; }"
+                       "i = i + 1; } }";
+  NullLog log;
+  vm::VirtualMachine machine(&log);
+  vm::GCConfig config;
+  config.stress = true;
+  machine.setGCConfig(config);
+  if (machine.compile(script) != vm::INTERPRET_RESULT::INTERPRET_OK) {
+    printf("    failed to compile benchmark script\n");
+    return;
+  }
+  const vm::Chunk *chunk = machine.getCompiledChunk();
+  vm::INTERPRET_RESULT result = vm::INTERPRET_RESULT::INTERPRET_OK;
+  double seconds =
+      bestOf(REPETITIONS, [&]() { result = machine.interpret(chunk); });
+  if (result != vm::INTERPRET_RESULT::INTERPRET_OK) {
+    printf("    benchmark script failed at runtime\n");
+    return;
+  }
+  printf("    best of %u: %.3f ms, %llu objects freed\n", REPETITIONS,
+         seconds * 1000.0,
+         static_cast<unsigned long long>(machine.getGCStats().objectsFreed));
+  machine.releaseChunk(chunk);
+}
+
+static void runStringBuildingScript(const char *label, const char *script) {
+  NullLog log;
+  vm::VirtualMachine machine(&log);
+  if (machine.compile(script) != vm::INTERPRET_RESULT::INTERPRET_OK) {
+    printf("    failed to compile benchmark script\n");
+    return;
+  }
+  const vm::Chunk *chunk = machine.getCompiledChunk();
+  vm::INTERPRET_RESULT result = vm::INTERPRET_RESULT::INTERPRET_OK;
+  double seconds =
+      bestOf(REPETITIONS, [&]() { result = machine.interpret(chunk); });
+  if (result != vm::INTERPRET_RESULT::INTERPRET_OK) {
+    printf("    benchmark script failed at runtime\n");
+  } else {
+    printf("    %s, best of %u: %.3f ms, %llu allocations\n", label,
+           REPETITIONS, seconds * 1000.0,
+           static_cast<unsigned long long>(
+               machine.getHeap().getAllocatorStats().allocations));
+  }
+  machine.releaseChunk(chunk);
+}
+
+// building strings in a loop, the accumulating script creates a new string
+// every iteration, the repeating one builds the same strings over and over
+// so after the first round every concatenation finds an existing string
+BINDER_BENCHMARK(vmStringBuilding, "vm string building") {
+  runStringBuildingScript(
+      "accumulate 8000 x 16 chars",
+      "var s = \"\"; { var i = 0; while (i < 8000) {"
+      "s = s + \"0123456789abcdef\"; i = i + 1; } }");
+  runStringBuildingScript(
+      "rebuild the same 64 chars 4000 times",
+      "{ var i = 0; while (i < 4000) { var s = \"\"; var j = 0;"
+      "while (j < 64) { s = s + \"x\"; j = j + 1; } i = i + 1; } }");
+}
+
+// startup cost of a big script, compiling from source against loading the
+// cached bytecode of the same script
+BINDER_BENCHMARK(vmBytecodeCache, "vm bytecode cache") {
+  std::string source;
+  for (int i = 0; i < 200; ++i) {
+    source += "var g" + std::to_string(i) + " = \"value " +
+              std::to_string(i) + "\";";
+  }
+  for (int i = 0; i < 5000; ++i) {
+    const std::string name = "g" + std::to_string(i % 200);
+    source += "if (" + name + " == \"text " + std::to_string(i % 300) +
+              "\") {" +
+              name + " = " + name + " + \"!\"; } else { print " +
+              std::to_string(i) + " * 2 + 1; }";
+  }
+  const char *path = "vmBytecodeCacheBenchmark.bnc";
+
+  NullLog log;
+  vm::VirtualMachine machine(&log);
+  const vm::Chunk *chunk = nullptr;
+  double compileSeconds = bestOf(REPETITIONS, [&]() {
+    machine.releaseChunk(chunk);
+    chunk = nullptr;
+    if (machine.compile(source.c_str()) == vm::INTERPRET_RESULT::INTERPRET_OK) {
+      chunk = machine.getCompiledChunk();
+    }
+  });
+  if ((chunk == nullptr) || !machine.saveCompiledChunk(path)) {
+    printf("    failed to compile and save benchmark script\n");
+    return;
+  }
+
+  const vm::Chunk *loaded = nullptr;
+  double loadSeconds = bestOf(REPETITIONS, [&]() {
+    machine.releaseChunk(loaded);
+    loaded = machine.loadChunk(path);
+  });
+  if (loaded == nullptr) {
+    printf("    failed to load the cached chunk\n");
+  } else {
+    printf("    %u bytes of source, %u bytes of code\n",
+           static_cast<uint32_t>(source.size()), chunk->m_code.size());
+    printf("    compile best of %u: %.3f ms, cache load: %.3f ms\n",
+           REPETITIONS, compileSeconds * 1000.0, loadSeconds * 1000.0);
+  }
+  machine.releaseChunk(loaded);
+  machine.releaseChunk(chunk);
+  remove(path);
+}
+
+// not a timing, reports how much memory the value representation costs in
+// the main vm structures, handy to compare the nan boxing build
+BINDER_BENCHMARK(vmValueFootprint, "vm value footprint") {
+  const uint32_t valueSize = sizeof(vm::Value);
+  printf("    sizeof(Value): %u bytes\n", valueSize);
+
+  const char *scripts[] = {WHILE_GLOBALS_SCRIPT, FOR_LOCALS_SCRIPT,
+                           ARITHMETIC_MIX_SCRIPT};
+  uint32_t constantCount = 0;
+  uint32_t maxStackDepth = 0;
+  for (const char *script : scripts) {
+    NullLog log;
+    vm::VirtualMachine machine(&log);
+    if (machine.compile(script) != vm::INTERPRET_RESULT::INTERPRET_OK) {
+      printf("    failed to compile benchmark script\n");
+      return;
+    }
+    const vm::Chunk *chunk = machine.getCompiledChunk();
+    constantCount += chunk->m_constants.size();
+    maxStackDepth = chunk->m_maxStackDepth > maxStackDepth
+                        ? chunk->m_maxStackDepth
+                        : maxStackDepth;
+  }
+  printf("    deepest stack of the dispatch scripts: %u values, %u bytes\n",
+         maxStackDepth, maxStackDepth * valueSize);
+  printf("    constant tables of the dispatch scripts: %u constants, %u "
+         "bytes\n",
+         constantCount, constantCount * valueSize);
+}
+
+} // namespace binder::benchmark
@@ -67,7 +67,7 @@ const char *bindExecute(const char *source) {
   // vm based
   binder::log::BufferedLog log;
   binder::log::BufferedLog debugLog;
-  binder::vm::VirtualMachine vm(&log, &debugLog);
+  binder::vm::VirtualMachine vm(&log);
   binder::vm::INTERPRET_RESULT compileResult = vm.compile(source);
   if (compileResult != binder::vm::INTERPRET_RESULT::INTERPRET_OK) {
     printf("%s\n", log.getBuffer());
@@ -93,8 +93,8 @@ const char *bindExecute(const char *source) {
   const char *toReturn = new char[len + 1];
   memcpy((char *)toReturn, bytecode, len + 1);
 
-  //freeing the chunk
-  delete chunk;
+  //the chunk belongs to the vm, we are done with it
+  vm.releaseChunk(chunk);
 
   return toReturn;
 }